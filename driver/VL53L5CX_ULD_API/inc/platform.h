@@ -76,12 +76,36 @@
  * layer.
  */
 
+/**
+ * @brief Boot phases timed by the platform layer, see VL53L5CX_BootPhase().
+ */
+
+typedef enum
+{
+	VL53L5CX_BOOT_ALIVE = 0,	/* is_alive poll until the sensor answers */
+	VL53L5CX_BOOT_RESET,		/* SW reboot, up to the firmware download */
+	VL53L5CX_BOOT_FIRMWARE,		/* firmware download and MCU boot */
+	VL53L5CX_BOOT_CALIBRATION,	/* NVM read, offset and xtalk send */
+	VL53L5CX_BOOT_CONFIG,		/* default configuration and user settings */
+	VL53L5CX_BOOT_START,		/* start_ranging */
+	VL53L5CX_BOOT_PHASE_COUNT
+} VL53L5CX_BootPhase_t;
+
+/* Passed to VL53L5CX_BootPhase() once the last phase is over */
+#define VL53L5CX_BOOT_DONE		VL53L5CX_BOOT_PHASE_COUNT
+
 typedef struct
 {
 	/* To be filled with customer's platform. At least an I2C address/descriptor
 	 * needs to be added */
 	/* Example for most standard platform : I2C address of sensor */
     uint16_t  			address;
+	/* Bus the sensor sits on, NULL selects hi2c1 */
+    I2C_HandleTypeDef	*hi2c;
+	/* Duration of the last run of each boot phase, in ms */
+    uint32_t			boot_ms[VL53L5CX_BOOT_PHASE_COUNT];
+    uint32_t			boot_phase_tick;
+    uint8_t				boot_phase;
 
 } VL53L5CX_Platform;
 
@@ -94,6 +118,15 @@ typedef struct
 
 #define 	VL53L5CX_NB_TARGET_PER_ZONE		1U
 
+/*
+ * @brief VL53L5CX_WrMulti() splits writes into chunks of at most this many
+ * bytes, each one bounded by its own timeout. A chunk of 4 KiB takes ~370 ms
+ * at 100 kHz.
+ */
+
+#define 	VL53L5CX_COMMS_CHUNK_SIZE		4096U
+#define 	VL53L5CX_COMMS_CHUNK_TIMEOUT_MS	500U
+
 /*
  * @brief The macro below can be used to avoid data conversion into the driver.
  * By default there is a conversion between firmware and user data. Using this macro
@@ -109,15 +142,25 @@ typedef struct
  * I2C access.
  */
 
-// #define VL53L5CX_DISABLE_AMBIENT_PER_SPAD
-// #define VL53L5CX_DISABLE_NB_SPADS_ENABLED
+/* An output left in here can still be dropped from the stream at run time,
+ * see vl53l5_set_output_profile(). The ones below are not read by the people
+ * counting pipeline and only come with TOF_SENSOR_DIAGNOSTICS, for the
+ * diagnostic profile. nb_target_detected stays, the driver reports zones
+ * without a target through it (status 255). */
+#if !defined(TOF_SENSOR_DIAGNOSTICS) || (TOF_SENSOR_DIAGNOSTICS == 0)
+#define VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+#define VL53L5CX_DISABLE_NB_SPADS_ENABLED
+#define VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+#define VL53L5CX_DISABLE_MOTION_INDICATOR
+#endif
 // #define VL53L5CX_DISABLE_NB_TARGET_DETECTED
-// #define VL53L5CX_DISABLE_SIGNAL_PER_SPAD
-// #define VL53L5CX_DISABLE_RANGE_SIGMA_MM
+/* range_sigma_mm and signal_per_spad feed the zone quality map (TOF_QUALITY) */
+#if defined(TOF_QUALITY) && (TOF_QUALITY == 0) && (!defined(TOF_SENSOR_DIAGNOSTICS) || (TOF_SENSOR_DIAGNOSTICS == 0))
+#define VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+#define VL53L5CX_DISABLE_RANGE_SIGMA_MM
+#endif
 // #define VL53L5CX_DISABLE_DISTANCE_MM
-// #define VL53L5CX_DISABLE_REFLECTANCE_PERCENT
 // #define VL53L5CX_DISABLE_TARGET_STATUS
-// #define VL53L5CX_DISABLE_MOTION_INDICATOR
 
 /**
  * @param (VL53L5CX_Platform*) p_platform : Pointer of VL53L5CX platform
@@ -214,4 +257,17 @@ uint8_t VL53L5CX_WaitMs(
 		VL53L5CX_Platform *p_platform,
 		uint32_t TimeMs);
 
+/**
+ * @brief Optional function, closes the boot phase running and starts the
+ * given one. The time spent in each phase is kept in p_platform->boot_ms.
+ * @param (VL53L5CX_Platform*) p_platform : Pointer of VL53L5CX platform
+ * structure.
+ * @param (uint8_t) phase : VL53L5CX_BootPhase_t starting, or
+ * VL53L5CX_BOOT_DONE.
+ */
+
+void VL53L5CX_BootPhase(
+		VL53L5CX_Platform *p_platform,
+		uint8_t phase);
+
 #endif	// _PLATFORM_H_
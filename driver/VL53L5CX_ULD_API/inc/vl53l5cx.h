@@ -5,10 +5,103 @@
 #include "stdbool.h"
 #include "vl53l5cx_api.h"
 
+/* FRAME_RESOLUTION and DISTANCE_ODR follow the TOF_SENSOR_RESOLUTION / TOF_SENSOR_ODR_HZ CMake options */
+#ifndef FRAME_RESOLUTION
 #define FRAME_RESOLUTION  	64       /* 16 if resolution is VL53L5CX_RESOLUTION_4X4 else, 64 if VL53L5CX_RESOLUTION_8X8 */
+#endif
 #define FRAMES              	1      /* Should be between 1 & 32 */
+#ifndef DISTANCE_ODR
 #define DISTANCE_ODR        	8      /* Should be between 1 -> 60Hz for VL53L5CX_RESOLUTION_4X4 and 1 -> 15Hz for VL53L5CX_RESOLUTION_8X8 */
+#endif
+
+/* One sensor per tile of every pipeline's grid, set from TOF_TILES_X * TOF_TILES_Y * TOF_PIPELINES */
+#ifndef VL53L5_DEVICE_COUNT
+#define VL53L5_DEVICE_COUNT 1U
+#endif
+/* Devices alternate between I2C1 and I2C3: device d sits on bus d % VL53L5_BUS_COUNT */
+#define VL53L5_BUS_COUNT 2U
+
+/*
+ * Output blocks streamed per frame, switched at run time among the ones
+ * compiled in (platform.h). The read size follows, see vl53l5_read_size().
+ */
+typedef enum {
+    VL53L5_PROFILE_MINIMAL = 0, /* distance, target status and target count */
+    VL53L5_PROFILE_TRACKING,    /* and range sigma and signal rate for the zone quality map */
+    VL53L5_PROFILE_DIAGNOSTIC,  /* every output */
+    VL53L5_PROFILE_COUNT,
+} vl53l5_output_profile_t;
+
+#define VL53L5_DEFAULT_PROFILE VL53L5_PROFILE_TRACKING
+
+#define VL53L5_OUTPUTS_MINIMAL                                                                                         \
+    (VL53L5CX_OUTPUT_DISTANCE_MM | VL53L5CX_OUTPUT_TARGET_STATUS | VL53L5CX_OUTPUT_NB_TARGET_DETECTED)
+#define VL53L5_OUTPUTS_TRACKING                                                                                        \
+    (VL53L5_OUTPUTS_MINIMAL | VL53L5CX_OUTPUT_RANGE_SIGMA_MM | VL53L5CX_OUTPUT_SIGNAL_PER_SPAD)
+
+static inline uint32_t vl53l5_profile_outputs(vl53l5_output_profile_t profile)
+{
+    switch (profile)
+    {
+    case VL53L5_PROFILE_MINIMAL:
+        return VL53L5_OUTPUTS_MINIMAL;
+    case VL53L5_PROFILE_TRACKING:
+        return VL53L5_OUTPUTS_TRACKING;
+    default:
+        return VL53L5CX_OUTPUT_ALL;
+    }
+}
+
+typedef void (*vl53l5_data_ready_cb_t)(uint8_t dev);
+typedef void (*vl53l5_read_done_cb_t)(uint8_t dev, bool ok);
+
+/*
+ * Devices are brought up one step per vl53l5_bringup_step() call, so the
+ * main loop keeps running through the boot. A device that does not answer,
+ * fails a step or stops streaming is held in reset and brought up again a
+ * second later.
+ */
+typedef enum {
+    VL53L5_STATE_OFF = 0, /* in reset, until its turn on the bus or the retry delay is over */
+    VL53L5_STATE_ALIVE,   /* out of reset, is_alive polled until it answers */
+    VL53L5_STATE_INIT,    /* firmware download and boot, see vl53l5cx_init_step() */
+    VL53L5_STATE_CONFIG,  /* user settings */
+    VL53L5_STATE_SLOT,    /* configured, waits for its ranging start slot */
+    VL53L5_STATE_RUNNING,
+} vl53l5_state_t;
+
+typedef enum {
+    VL53L5_FAULT_NONE = 0,
+    VL53L5_FAULT_NO_ANSWER, /* is_alive never answered */
+    VL53L5_FAULT_INIT,
+    VL53L5_FAULT_CONFIG,
+    VL53L5_FAULT_START,
+    VL53L5_FAULT_STALLED, /* no data-ready for several frame periods */
+    VL53L5_FAULT_READ,    /* ranging data reads kept failing */
+} vl53l5_fault_t;
+
+typedef struct {
+    vl53l5_state_t state;
+    vl53l5_fault_t last_fault;
+    uint8_t last_error; /* ULD status of the step that failed */
+    uint16_t attempts;  /* bring-ups started */
+    uint16_t faults;
+} vl53l5_status_t;
 
-VL53L5CX_ResultsData* vl53l5_tof_init(void);
-bool vl53l5_update_data();
+void vl53l5_tof_init(void);
+/* Whether a device on the bus has a step to run; vl53l5_bringup_step() needs the bus to itself */
+bool vl53l5_bringup_due(uint8_t bus);
+void vl53l5_bringup_step(uint8_t bus);
+bool vl53l5_get_status(uint8_t dev, vl53l5_status_t *status);
+void vl53l5_set_callbacks(vl53l5_data_ready_cb_t data_ready_cb, vl53l5_read_done_cb_t read_done_cb);
+bool vl53l5_is_ready(uint8_t dev);
+/* Time spent in each VL53L5CX_BootPhase_t by the device, in ms */
+bool vl53l5_get_boot_ms(uint8_t dev, uint32_t boot_ms[VL53L5CX_BOOT_PHASE_COUNT]);
+uint8_t vl53l5_bus(uint8_t dev);
+uint32_t vl53l5_read_size(void);
+bool vl53l5_start_read(uint8_t dev, uint8_t *raw);
+bool vl53l5_decode(uint8_t dev, uint8_t *raw, VL53L5CX_ResultsData *results);
+/* Stops every running device, each one restarts in its slot with the new outputs; no read may be in flight */
+bool vl53l5_set_output_profile(vl53l5_output_profile_t profile);
+vl53l5_output_profile_t vl53l5_get_output_profile(void);
 #endif
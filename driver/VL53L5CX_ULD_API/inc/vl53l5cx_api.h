@@ -143,6 +143,23 @@
 #define VL53L5CX_MOTION_DETEC_IDX		((uint16_t)0xCC50U)
 #endif
 
+/**
+ * @brief Output blocks selected with vl53l5cx_set_outputs(), bits of the DCI
+ * output enables. An output disabled in the 'platform.h' file is never
+ * streamed.
+ */
+
+#define VL53L5CX_OUTPUT_AMBIENT_PER_SPAD	((uint32_t)8U)
+#define VL53L5CX_OUTPUT_NB_SPADS_ENABLED	((uint32_t)16U)
+#define VL53L5CX_OUTPUT_NB_TARGET_DETECTED	((uint32_t)32U)
+#define VL53L5CX_OUTPUT_SIGNAL_PER_SPAD		((uint32_t)64U)
+#define VL53L5CX_OUTPUT_RANGE_SIGMA_MM		((uint32_t)128U)
+#define VL53L5CX_OUTPUT_DISTANCE_MM		((uint32_t)256U)
+#define VL53L5CX_OUTPUT_REFLECTANCE_PERCENT	((uint32_t)512U)
+#define VL53L5CX_OUTPUT_TARGET_STATUS		((uint32_t)1024U)
+#define VL53L5CX_OUTPUT_MOTION_INDICATOR	((uint32_t)2048U)
+#define VL53L5CX_OUTPUT_ALL			((uint32_t)0x00000FF8U)
+
 
 /**
  * @brief Inner Macro for API. Not for user, only for development.
@@ -284,6 +301,12 @@ typedef struct
 	 uint8_t	        temp_buffer[VL53L5CX_TEMPORARY_BUFFER_SIZE];
 	/* Auto-stop flag for stopping the sensor */
 	uint8_t				is_auto_stop_enabled;
+	/* Outputs left out of the next ranging session (VL53L5CX_OUTPUT_* bits) */
+	uint32_t			disabled_outputs;
+	/* Progress of vl53l5cx_init_step(): step, polls of the step, firmware bytes sent */
+	uint8_t				init_step;
+	uint16_t			init_polls;
+	uint32_t			init_offset;
 } VL53L5CX_Configuration;
 
 
@@ -389,6 +412,28 @@ uint8_t vl53l5cx_is_alive(
 uint8_t vl53l5cx_init(
 		VL53L5CX_Configuration		*p_dev);
 
+/**
+ * @brief Resumable form of vl53l5cx_init(), for callers that cannot block for
+ * the whole boot. vl53l5cx_init_start() rewinds the sequence, then every call
+ * to vl53l5cx_init_step() runs one step of it without waiting: a batch of
+ * register writes, one poll of the boot status or one firmware chunk of
+ * VL53L5CX_COMMS_CHUNK_SIZE bytes. The calibration and configuration steps
+ * still wait on the firmware answer (a few tens of ms).
+ * @param (VL53L5CX_Configuration) *p_dev : VL53L5CX configuration structure.
+ * @param (uint32_t) *p_wait_ms : Time to let pass before the next step.
+ * @param (uint8_t) *p_done : Set to 1 once the sensor is initialized.
+ * @return (uint8_t) status : 0 if the step is OK, the sequence must be
+ * restarted from vl53l5cx_init_start() otherwise.
+ */
+
+uint8_t vl53l5cx_init_start(
+		VL53L5CX_Configuration		*p_dev);
+
+uint8_t vl53l5cx_init_step(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			*p_wait_ms,
+		uint8_t				*p_done);
+
 /**
  * @brief This function is used to change the I2C address of the sensor. If
  * multiple VL53L5 sensors are connected to the same I2C line, all other LPn
@@ -453,6 +498,34 @@ uint8_t vl53l5cx_start_ranging(
 uint8_t vl53l5cx_stop_ranging(
 		VL53L5CX_Configuration		*p_dev);
 
+/**
+ * @brief This function selects the outputs streamed by the next ranging
+ * session, among the ones enabled in the 'platform.h' file. The data size is
+ * recomputed by vl53l5cx_start_ranging(), and the results of an output that is
+ * not streamed are cleared when decoding. All outputs are selected after
+ * vl53l5cx_init(). Please ensure that the device is not streaming before
+ * calling the function.
+ * @param (VL53L5CX_Configuration) *p_dev : VL53L5CX configuration structure.
+ * @param (uint32_t) outputs : VL53L5CX_OUTPUT_* bits of the selected outputs.
+ * @return (uint8_t) status : 0 if OK, or 127 if an unknown output is selected.
+ */
+
+uint8_t vl53l5cx_set_outputs(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			outputs);
+
+/**
+ * @brief This function gets the outputs streamed by the next ranging session.
+ * @param (VL53L5CX_Configuration) *p_dev : VL53L5CX configuration structure.
+ * @param (uint32_t) *p_outputs : VL53L5CX_OUTPUT_* bits of the outputs both
+ * enabled in the 'platform.h' file and selected.
+ * @return (uint8_t) status : 0 if OK.
+ */
+
+uint8_t vl53l5cx_get_outputs(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			*p_outputs);
+
 /**
  * @brief This function checks if a new data is ready by polling I2C. If a new
  * data is ready, a flag will be raised.
@@ -478,6 +551,21 @@ uint8_t vl53l5cx_get_ranging_data(
 		VL53L5CX_Configuration		*p_dev,
 		VL53L5CX_ResultsData		*p_results);
 
+/**
+ * @brief This function decodes ranging data already transferred from the
+ * sensor, e.g. by a DMA read of p_dev->data_read_size bytes at address 0x0.
+ * The buffer is byte-swapped in place.
+ * @param (VL53L5CX_Configuration) *p_dev : VL53L5CX configuration structure.
+ * @param (uint8_t) *p_raw : Raw results buffer of p_dev->data_read_size bytes.
+ * @param (VL53L5CX_ResultsData) *p_results : VL53L5 results structure.
+ * @return (uint8_t) status : 0 data are successfully decoded.
+ */
+
+uint8_t vl53l5cx_decode_ranging_data(
+		VL53L5CX_Configuration		*p_dev,
+		uint8_t				*p_raw,
+		VL53L5CX_ResultsData		*p_results);
+
 /**
  * @brief This function gets the current resolution (4x4 or 8x8).
  * @param (VL53L5CX_Configuration) *p_dev : VL53L5CX configuration structure.
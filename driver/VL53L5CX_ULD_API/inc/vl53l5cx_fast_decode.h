@@ -0,0 +1,51 @@
+#ifndef __VL53L5CX_FAST_DECODE_H
+#define __VL53L5CX_FAST_DECODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vl53l5cx_api.h"
+
+/*
+ * Alternative to vl53l5cx_decode_ranging_data() for the fields the people
+ * counting pipeline consumes. The block table of the streamed blob is parsed
+ * once and the offsets are cached in the layout; every following frame is
+ * decoded in one pass straight from the bus byte order (no in-place
+ * SwapBuffer, no per-block memcpy, no separate conversion passes), into a
+ * structure of arrays. The raw buffer is left untouched.
+ *
+ * The layout only depends on the ranging configuration, so it has to be
+ * reset with vl53l5cx_fast_decode_reset() after vl53l5cx_start_ranging().
+ */
+
+#define VL53L5CX_FAST_TARGETS (VL53L5CX_RESOLUTION_8X8 * VL53L5CX_NB_TARGET_PER_ZONE)
+
+typedef struct {
+    uint32_t size;
+    uint16_t meta_off;
+    uint16_t nb_target_off;
+    uint16_t sigma_off;
+    uint16_t signal_off;
+    uint16_t distance_off;
+    uint16_t status_off;
+    uint8_t zones;
+    bool valid;
+} vl53l5cx_fast_layout_t;
+
+typedef struct {
+    int16_t distance_mm[VL53L5CX_FAST_TARGETS];
+    uint16_t range_sigma_mm[VL53L5CX_FAST_TARGETS];
+    uint32_t signal_per_spad[VL53L5CX_FAST_TARGETS];
+    uint8_t target_status[VL53L5CX_FAST_TARGETS];
+    int8_t silicon_temp_degc;
+    uint8_t stream_count;
+} vl53l5cx_fast_frame_t;
+
+void vl53l5cx_fast_decode_reset(vl53l5cx_fast_layout_t *layout);
+uint8_t vl53l5cx_fast_decode_prepare(vl53l5cx_fast_layout_t *layout, const uint8_t *p_raw, uint32_t size);
+uint8_t vl53l5cx_fast_decode(vl53l5cx_fast_layout_t *layout,
+                             const uint8_t *p_raw,
+                             uint32_t size,
+                             vl53l5cx_fast_frame_t *frame);
+
+#endif
@@ -64,6 +64,9 @@
 
 extern I2C_HandleTypeDef 	hi2c1;
 
+#define PLATFORM_I2C(p_platform) \
+	(((p_platform)->hi2c != NULL) ? (p_platform)->hi2c : &hi2c1)
+
 uint8_t VL53L5CX_RdByte(
 		VL53L5CX_Platform *p_platform,
 		uint16_t RegisterAdress,
@@ -75,8 +78,8 @@ uint8_t VL53L5CX_RdByte(
 
 	data_write[0] = (RegisterAdress >> 8) & 0xFF;
 	data_write[1] = RegisterAdress & 0xFF;
-	status = HAL_I2C_Master_Transmit(&hi2c1, p_platform->address, data_write, 2, 100);
-	status = HAL_I2C_Master_Receive(&hi2c1, p_platform->address, data_read, 1, 100);
+	status = HAL_I2C_Master_Transmit(PLATFORM_I2C(p_platform), p_platform->address, data_write, 2, 100);
+	status = HAL_I2C_Master_Receive(PLATFORM_I2C(p_platform), p_platform->address, data_read, 1, 100);
 	*p_value = data_read[0];
   
 	return status;
@@ -93,19 +96,66 @@ uint8_t VL53L5CX_WrByte(
 	data_write[0] = (RegisterAdress >> 8) & 0xFF;
 	data_write[1] = RegisterAdress & 0xFF;
 	data_write[2] = value & 0xFF;
-	status = HAL_I2C_Master_Transmit(&hi2c1,p_platform->address, data_write, 3, 100);
+	status = HAL_I2C_Master_Transmit(PLATFORM_I2C(p_platform), p_platform->address, data_write, 3, 100);
 
 	return status;
 }
 
+/* A bus with a TX DMA channel sends the chunk straight from its source, flash
+ * included, and is waited on; the other one is written under polling. */
+static uint8_t _platform_write_chunk(
+		VL53L5CX_Platform *p_platform,
+		uint16_t RegisterAdress,
+		uint8_t *p_values,
+		uint16_t size)
+{
+	I2C_HandleTypeDef *hi2c = PLATFORM_I2C(p_platform);
+	uint32_t start_tick;
+
+	if (hi2c->hdmatx == NULL)
+	{
+		return HAL_I2C_Mem_Write(hi2c, p_platform->address, RegisterAdress, I2C_MEMADD_SIZE_16BIT,
+								p_values, size, VL53L5CX_COMMS_CHUNK_TIMEOUT_MS);
+	}
+
+	if (HAL_I2C_Mem_Write_DMA(hi2c, p_platform->address, RegisterAdress, I2C_MEMADD_SIZE_16BIT,
+							p_values, size) != HAL_OK)
+	{
+		return HAL_ERROR;
+	}
+	start_tick = HAL_GetTick();
+	while (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY)
+	{
+		if ((HAL_GetTick() - start_tick) > VL53L5CX_COMMS_CHUNK_TIMEOUT_MS)
+		{
+			(void)HAL_I2C_Master_Abort_IT(hi2c, p_platform->address);
+			return HAL_TIMEOUT;
+		}
+	}
+	return (HAL_I2C_GetError(hi2c) == HAL_I2C_ERROR_NONE) ? HAL_OK : HAL_ERROR;
+}
+
+/* The sensor takes each chunk at its own register address, so a long write
+ * (firmware pages are 32 KiB) is cut into VL53L5CX_COMMS_CHUNK_SIZE pieces */
 uint8_t VL53L5CX_WrMulti(
 		VL53L5CX_Platform *p_platform,
 		uint16_t RegisterAdress,
 		uint8_t *p_values,
 		uint32_t size)
 {
-	uint8_t status = HAL_I2C_Mem_Write(&hi2c1, p_platform->address, RegisterAdress,
-									I2C_MEMADD_SIZE_16BIT, p_values, size, 65535);
+	uint8_t status = 0;
+	uint32_t offset, chunk;
+
+	for (offset = 0; (offset < size) && (status == 0); offset += chunk)
+	{
+		chunk = size - offset;
+		if (chunk > VL53L5CX_COMMS_CHUNK_SIZE)
+		{
+			chunk = VL53L5CX_COMMS_CHUNK_SIZE;
+		}
+		status = _platform_write_chunk(p_platform, (uint16_t)(RegisterAdress + offset), &p_values[offset],
+									(uint16_t)chunk);
+	}
 	return status;
 }
 
@@ -119,8 +169,8 @@ uint8_t VL53L5CX_RdMulti(
 	uint8_t data_write[2];
 	data_write[0] = (RegisterAdress>>8) & 0xFF;
 	data_write[1] = RegisterAdress & 0xFF;
-	status = HAL_I2C_Master_Transmit(&hi2c1, p_platform->address, data_write, 2, 100);
-	status += HAL_I2C_Master_Receive(&hi2c1, p_platform->address, p_values, size, 100);
+	status = HAL_I2C_Master_Transmit(PLATFORM_I2C(p_platform), p_platform->address, data_write, 2, 100);
+	status += HAL_I2C_Master_Receive(PLATFORM_I2C(p_platform), p_platform->address, p_values, size, 100);
 
 	return status;
 }
@@ -168,3 +218,17 @@ uint8_t VL53L5CX_WaitMs(
 	HAL_Delay(TimeMs);
 	return 0;
 }
+
+void VL53L5CX_BootPhase(
+		VL53L5CX_Platform *p_platform,
+		uint8_t phase)
+{
+	uint32_t now = HAL_GetTick();
+
+	if (p_platform->boot_phase < (uint8_t)VL53L5CX_BOOT_PHASE_COUNT)
+	{
+		p_platform->boot_ms[p_platform->boot_phase] = now - p_platform->boot_phase_tick;
+	}
+	p_platform->boot_phase = phase;
+	p_platform->boot_phase_tick = now;
+}
@@ -1,61 +1,603 @@
 #include "main.h"
 #include "bsp_gpio.h"
+#include "i2c.h"
 #include "vl53l5cx_api.h"
 #include "vl53l5cx_plugin_xtalk.h"
 #include "vl53l5cx.h"
 
-static VL53L5CX_Configuration Dev;
-static VL53L5CX_ResultsData Results;
-volatile uint8_t vl53l5_data_ready = 0;
+#if VL53L5_DEVICE_COUNT > 4U
+#error "bsp_gpio dispatches at most 4 data-ready interrupts"
+#endif
+#if (VL53L5_DEVICE_COUNT > 1U) && !(defined(VL53_2_INT_Pin) && defined(VL53_2_xshut_Pin))
+#error "VL53_2_INT / VL53_2_xshut pins are missing from main.h, add them to the CubeMX project"
+#endif
+#if (VL53L5_DEVICE_COUNT > 2U) && !(defined(VL53_3_INT_Pin) && defined(VL53_3_xshut_Pin))
+#error "VL53_3_INT / VL53_3_xshut pins are missing from main.h, add them to the CubeMX project"
+#endif
+#if (VL53L5_DEVICE_COUNT > 3U) && !(defined(VL53_4_INT_Pin) && defined(VL53_4_xshut_Pin))
+#error "VL53_4_INT / VL53_4_xshut pins are missing from main.h, add them to the CubeMX project"
+#endif
 
-void vl53l5_cb(void);
+/* is_alive is polled every 10 ms, a missing sensor is given up on after half a second */
+#define VL53L5_ALIVE_RETRIES 50U
+#define VL53L5_ALIVE_POLL_MS 10U
+/* A device that did not come up, or was lost, is powered up again after this long */
+#define VL53L5_RETRY_MS 1000U
+#define VL53L5_FRAME_PERIOD_MS (1000U / DISTANCE_ODR)
+/* Ranging start offset between consecutive devices, so their emitters take turns */
+#define VL53L5_STAGGER_MS (VL53L5_FRAME_PERIOD_MS / VL53L5_DEVICE_COUNT)
+/* In autonomous mode a device only emits for half of its slot */
+#define VL53L5_INTEGRATION_MS ((VL53L5_STAGGER_MS / 2U) < 2U ? 2U : (VL53L5_STAGGER_MS / 2U))
+/* A running device that raised no data-ready for this long, or failed this many reads in a row, is restarted */
+#define VL53L5_STALL_MS ((4U * VL53L5_FRAME_PERIOD_MS) + 100U)
+#define VL53L5_READ_ERROR_LIMIT 3U
+/* No device keeps the default address, so the one being brought up never collides with a running one */
+#define VL53L5_ADDRESS(dev) ((uint16_t)(VL53L5CX_DEFAULT_I2C_ADDRESS + (2U * ((uint16_t)(dev) + 1U))))
 
-VL53L5CX_ResultsData* vl53l5_tof_init(void) 
+typedef struct
 {
-    uint8_t status, isAlive;
-    HAL_GPIO_WritePin(VL53_xshut_GPIO_Port, VL53_xshut_Pin, GPIO_PIN_SET);
-    Dev.platform.address = VL53L5CX_DEFAULT_I2C_ADDRESS;
+    I2C_HandleTypeDef *hi2c;
+    GPIO_TypeDef *xshut_port;
+    uint16_t xshut_pin;
+    uint16_t int_pin;
+} vl53l5_board_t;
 
-	do 
+static const vl53l5_board_t s_board[VL53L5_DEVICE_COUNT] = {
+    {&hi2c1, VL53_xshut_GPIO_Port, VL53_xshut_Pin, VL53_INT_Pin},
+#if VL53L5_DEVICE_COUNT > 1U
+    {&hi2c3, VL53_2_xshut_GPIO_Port, VL53_2_xshut_Pin, VL53_2_INT_Pin},
+#endif
+#if VL53L5_DEVICE_COUNT > 2U
+    {&hi2c1, VL53_3_xshut_GPIO_Port, VL53_3_xshut_Pin, VL53_3_INT_Pin},
+#endif
+#if VL53L5_DEVICE_COUNT > 3U
+    {&hi2c3, VL53_4_xshut_GPIO_Port, VL53_4_xshut_Pin, VL53_4_INT_Pin},
+#endif
+};
+
+typedef struct
+{
+    vl53l5_state_t state;
+    vl53l5_fault_t last_fault;
+    uint8_t last_error;
+    /* Alive polls or settings done in the current state */
+    uint8_t step;
+    uint16_t attempts;
+    uint16_t faults;
+    /* The next step runs once HAL_GetTick() reaches it */
+    uint32_t due_tick;
+    /* Profile whose outputs the device is configured for */
+    vl53l5_output_profile_t profile;
+    volatile uint32_t ready_tick;
+    volatile uint8_t read_errors;
+} vl53l5_device_t;
+
+static VL53L5CX_Configuration Dev[VL53L5_DEVICE_COUNT];
+static vl53l5_device_t s_devices[VL53L5_DEVICE_COUNT];
+/* Set while the device's ranging data is being read, to route the I2C completion back to it */
+static volatile bool s_reading[VL53L5_DEVICE_COUNT];
+static vl53l5_data_ready_cb_t s_data_ready_cb = NULL;
+static vl53l5_read_done_cb_t s_read_done_cb = NULL;
+static vl53l5_output_profile_t s_profile = VL53L5_DEFAULT_PROFILE;
+/* Ranging start slots are counted from here, see vl53l5_next_slot() */
+static uint32_t s_slot_tick = 0U;
+static bool s_callbacks_registered = false;
+
+/* Data-ready of a device still being brought up is ignored */
+static void vl53l5_cb(uint8_t dev)
+{
+    if (s_devices[dev].state != VL53L5_STATE_RUNNING)
+    {
+        return;
+    }
+
+    s_devices[dev].ready_tick = HAL_GetTick();
+    if (s_data_ready_cb != NULL)
+    {
+        s_data_ready_cb(dev);
+    }
+}
+
+static void vl53l5_cb0(void)
+{
+    vl53l5_cb(0U);
+}
+#if VL53L5_DEVICE_COUNT > 1U
+static void vl53l5_cb1(void)
+{
+    vl53l5_cb(1U);
+}
+#endif
+#if VL53L5_DEVICE_COUNT > 2U
+static void vl53l5_cb2(void)
+{
+    vl53l5_cb(2U);
+}
+#endif
+#if VL53L5_DEVICE_COUNT > 3U
+static void vl53l5_cb3(void)
+{
+    vl53l5_cb(3U);
+}
+#endif
+
+static const gpio_exit_cb_t s_int_cb[VL53L5_DEVICE_COUNT] = {
+    vl53l5_cb0,
+#if VL53L5_DEVICE_COUNT > 1U
+    vl53l5_cb1,
+#endif
+#if VL53L5_DEVICE_COUNT > 2U
+    vl53l5_cb2,
+#endif
+#if VL53L5_DEVICE_COUNT > 3U
+    vl53l5_cb3,
+#endif
+};
+
+static bool vl53l5_tick_reached(uint32_t now, uint32_t tick)
+{
+    return (int32_t)(now - tick) >= 0;
+}
+
+/* Device dev starts VL53L5_STAGGER_MS after device dev - 1 of the same frame, and free-runs from there */
+static uint32_t vl53l5_next_slot(uint8_t dev, uint32_t now)
+{
+    uint32_t offset = (uint32_t)dev * VL53L5_STAGGER_MS;
+    uint32_t elapsed = (now - s_slot_tick) % VL53L5_FRAME_PERIOD_MS;
+
+    return now + ((offset + VL53L5_FRAME_PERIOD_MS - elapsed) % VL53L5_FRAME_PERIOD_MS);
+}
+
+/* Holds the device in reset and schedules its next bring-up */
+static void vl53l5_fail(uint8_t dev, vl53l5_fault_t fault, uint8_t status)
+{
+    vl53l5_device_t *device = &s_devices[dev];
+
+    HAL_GPIO_WritePin(s_board[dev].xshut_port, s_board[dev].xshut_pin, GPIO_PIN_RESET);
+    VL53L5CX_BootPhase(&Dev[dev].platform, VL53L5CX_BOOT_DONE);
+    Dev[dev].data_read_size = 0U;
+    device->state = VL53L5_STATE_OFF;
+    device->last_fault = fault;
+    device->last_error = status;
+    device->faults++;
+    device->due_tick = HAL_GetTick() + VL53L5_RETRY_MS;
+}
+
+/*
+ * Every device powers up at the default address, so only one per bus is
+ * released from XSHUT at a time, and it is moved to its own address as soon
+ * as it answers.
+ */
+static void vl53l5_power_up(uint8_t dev)
+{
+    VL53L5CX_Configuration *p_dev = &Dev[dev];
+    vl53l5_device_t *device = &s_devices[dev];
+
+    HAL_GPIO_WritePin(s_board[dev].xshut_port, s_board[dev].xshut_pin, GPIO_PIN_SET);
+    p_dev->platform.address = VL53L5CX_DEFAULT_I2C_ADDRESS;
+    p_dev->platform.hi2c = s_board[dev].hi2c;
+    memset(p_dev->platform.boot_ms, 0, sizeof(p_dev->platform.boot_ms));
+    p_dev->platform.boot_phase = VL53L5CX_BOOT_DONE;
+
+    /* vl53l5cx_init_step() moves on through the reset, firmware, calibration and configuration phases */
+    VL53L5CX_BootPhase(&p_dev->platform, VL53L5CX_BOOT_ALIVE);
+    device->attempts++;
+    device->step = 0U;
+    device->state = VL53L5_STATE_ALIVE;
+    device->due_tick = HAL_GetTick() + VL53L5_ALIVE_POLL_MS;
+}
+
+static void vl53l5_poll_alive(uint8_t dev)
+{
+    VL53L5CX_Configuration *p_dev = &Dev[dev];
+    vl53l5_device_t *device = &s_devices[dev];
+    uint8_t status, isAlive = 0U;
+
+    /* Check if there is a VL53L5CX sensor connected */
+    status = vl53l5cx_is_alive(p_dev, &isAlive);
+    if ((status != VL53L5CX_STATUS_OK) || !isAlive)
+    {
+        if (++device->step >= VL53L5_ALIVE_RETRIES)
+        {
+            vl53l5_fail(dev, VL53L5_FAULT_NO_ANSWER, status);
+            return;
+        }
+        device->due_tick = HAL_GetTick() + VL53L5_ALIVE_POLL_MS;
+        return;
+    }
+
+    status = vl53l5cx_set_i2c_address(p_dev, VL53L5_ADDRESS(dev));
+    status |= vl53l5cx_init_start(p_dev);
+    if (status != VL53L5CX_STATUS_OK)
+    {
+        vl53l5_fail(dev, VL53L5_FAULT_INIT, status);
+        return;
+    }
+    device->state = VL53L5_STATE_INIT;
+    device->due_tick = HAL_GetTick();
+}
+
+static void vl53l5_init_step(uint8_t dev)
+{
+    vl53l5_device_t *device = &s_devices[dev];
+    uint32_t wait_ms = 0U;
+    uint8_t status, done = 0U;
+
+    status = vl53l5cx_init_step(&Dev[dev], &wait_ms, &done);
+    if (status != VL53L5CX_STATUS_OK)
+    {
+        vl53l5_fail(dev, VL53L5_FAULT_INIT, status);
+        return;
+    }
+    if (done)
+    {
+        device->step = 0U;
+        device->state = VL53L5_STATE_CONFIG;
+    }
+    device->due_tick = HAL_GetTick() + wait_ms;
+}
+
+/* One setting per step, each one is a DCI write the firmware answers within a few tens of ms */
+static uint8_t vl53l5_configure(VL53L5CX_Configuration *p_dev, uint8_t step, bool *done)
+{
+    *done = false;
+    switch (step)
+    {
+    case 0U:
+        return vl53l5cx_set_xtalk_margin(p_dev, 50);
+    case 1U:
+        return vl53l5cx_set_target_order(p_dev, VL53L5CX_TARGET_ORDER_STRONGEST);
+    case 2U:
+        return vl53l5cx_set_sharpener_percent(p_dev, 5);
+    case 3U:
+        return vl53l5cx_set_ranging_frequency_hz(p_dev, DISTANCE_ODR);
+    case 4U:
+        return vl53l5cx_set_resolution(p_dev, FRAME_RESOLUTION);
+#if VL53L5_DEVICE_COUNT > 1U
+    /* Continuous mode integrates over the whole period, which would overlap every other device */
+    case 5U:
+        return vl53l5cx_set_ranging_mode(p_dev, VL53L5CX_RANGING_MODE_AUTONOMOUS);
+    case 6U:
+        return vl53l5cx_set_integration_time_ms(p_dev, VL53L5_INTEGRATION_MS);
+#else
+    case 5U:
+        return vl53l5cx_set_ranging_mode(p_dev, VL53L5CX_RANGING_MODE_CONTINUOUS);
+#endif
+    default:
+        *done = true;
+        return VL53L5CX_STATUS_OK;
+    }
+}
+
+static void vl53l5_config_step(uint8_t dev)
+{
+    vl53l5_device_t *device = &s_devices[dev];
+    uint8_t status;
+    bool done;
+
+    status = vl53l5_configure(&Dev[dev], device->step++, &done);
+    if (status != VL53L5CX_STATUS_OK)
+    {
+        vl53l5_fail(dev, VL53L5_FAULT_CONFIG, status);
+        return;
+    }
+    if (done)
+    {
+        VL53L5CX_BootPhase(&Dev[dev].platform, VL53L5CX_BOOT_DONE);
+        /* The outputs are set right before ranging starts, so a profile switched meanwhile is picked up */
+        device->profile = VL53L5_PROFILE_COUNT;
+        device->state = VL53L5_STATE_SLOT;
+        device->due_tick = vl53l5_next_slot(dev, HAL_GetTick());
+    }
+}
+
+static void vl53l5_start(uint8_t dev)
+{
+    vl53l5_device_t *device = &s_devices[dev];
+    uint8_t status = VL53L5CX_STATUS_OK;
+
+    if (device->profile != s_profile)
+    {
+        status = vl53l5cx_set_outputs(&Dev[dev], vl53l5_profile_outputs(s_profile));
+        device->profile = s_profile;
+    }
+    VL53L5CX_BootPhase(&Dev[dev].platform, VL53L5CX_BOOT_START);
+    status |= vl53l5cx_start_ranging(&Dev[dev]);
+    VL53L5CX_BootPhase(&Dev[dev].platform, VL53L5CX_BOOT_DONE);
+    if (status != VL53L5CX_STATUS_OK)
+    {
+        vl53l5_fail(dev, VL53L5_FAULT_START, status);
+        return;
+    }
+    device->read_errors = 0U;
+    device->ready_tick = HAL_GetTick();
+    device->state = VL53L5_STATE_RUNNING;
+}
+
+/* Whether the device was lost while running: it stopped raising data-ready or its reads keep failing */
+static vl53l5_fault_t vl53l5_running_fault(uint8_t dev, uint32_t now)
+{
+    const vl53l5_device_t *device = &s_devices[dev];
+
+    if (device->read_errors >= VL53L5_READ_ERROR_LIMIT)
+    {
+        return VL53L5_FAULT_READ;
+    }
+    if ((int32_t)(now - device->ready_tick) >= (int32_t)VL53L5_STALL_MS)
+    {
+        return VL53L5_FAULT_STALLED;
+    }
+    return VL53L5_FAULT_NONE;
+}
+
+/* Only one device per bus sits at the default address, from its release out of reset until it answers */
+static bool vl53l5_bus_booting(uint8_t bus)
+{
+    for (uint8_t dev = bus; dev < VL53L5_DEVICE_COUNT; dev += VL53L5_BUS_COUNT)
+    {
+        vl53l5_state_t state = s_devices[dev].state;
+
+        if ((state == VL53L5_STATE_ALIVE) || (state == VL53L5_STATE_INIT) || (state == VL53L5_STATE_CONFIG))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* First device on the bus with a step to run, VL53L5_DEVICE_COUNT if none */
+static uint8_t vl53l5_due_device(uint8_t bus, uint32_t now)
+{
+    bool booting = vl53l5_bus_booting(bus);
+
+    for (uint8_t dev = bus; dev < VL53L5_DEVICE_COUNT; dev += VL53L5_BUS_COUNT)
+    {
+        const vl53l5_device_t *device = &s_devices[dev];
+
+        if (device->state == VL53L5_STATE_RUNNING)
+        {
+            if (vl53l5_running_fault(dev, now) != VL53L5_FAULT_NONE)
+            {
+                return dev;
+            }
+        }
+        else if (vl53l5_tick_reached(now, device->due_tick) && ((device->state != VL53L5_STATE_OFF) || !booting))
+        {
+            return dev;
+        }
+    }
+    return VL53L5_DEVICE_COUNT;
+}
+
+/* Holds every device in reset; they are brought up by vl53l5_bringup_step() */
+void vl53l5_tof_init(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    memset(s_devices, 0, sizeof(s_devices));
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        HAL_GPIO_WritePin(s_board[dev].xshut_port, s_board[dev].xshut_pin, GPIO_PIN_RESET);
+        Dev[dev].platform.boot_phase = VL53L5CX_BOOT_DONE;
+        s_devices[dev].state = VL53L5_STATE_OFF;
+        s_devices[dev].due_tick = now;
+        s_reading[dev] = false;
+        /* bsp_gpio keeps its handlers for good */
+        if (!s_callbacks_registered)
+        {
+            bsp_gpio_exit_register_cb(s_int_cb[dev], s_board[dev].int_pin);
+        }
+    }
+    s_callbacks_registered = true;
+    s_slot_tick = now;
+}
+
+bool vl53l5_bringup_due(uint8_t bus)
+{
+    return (bus < VL53L5_BUS_COUNT) && (vl53l5_due_device(bus, HAL_GetTick()) < VL53L5_DEVICE_COUNT);
+}
+
+void vl53l5_bringup_step(uint8_t bus)
+{
+    uint32_t now = HAL_GetTick();
+    uint8_t dev = (bus < VL53L5_BUS_COUNT) ? vl53l5_due_device(bus, now) : VL53L5_DEVICE_COUNT;
+
+    if (dev >= VL53L5_DEVICE_COUNT)
+    {
+        return;
+    }
+
+    switch (s_devices[dev].state)
+    {
+    case VL53L5_STATE_OFF:
+        vl53l5_power_up(dev);
+        break;
+    case VL53L5_STATE_ALIVE:
+        vl53l5_poll_alive(dev);
+        break;
+    case VL53L5_STATE_INIT:
+        vl53l5_init_step(dev);
+        break;
+    case VL53L5_STATE_CONFIG:
+        vl53l5_config_step(dev);
+        break;
+    case VL53L5_STATE_SLOT:
+        vl53l5_start(dev);
+        break;
+    case VL53L5_STATE_RUNNING:
+        vl53l5_fail(dev, vl53l5_running_fault(dev, now), VL53L5CX_STATUS_OK);
+        break;
+    default:
+        break;
+    }
+}
+
+/* The outputs, and so the read size, can only change between ranging sessions. Running devices are
+ * stopped and take their start slot again, the outputs are set right before, see vl53l5_start(). */
+bool vl53l5_set_output_profile(vl53l5_output_profile_t profile)
+{
+    uint32_t now = HAL_GetTick();
+    bool all_ok = true;
+
+    if (profile >= VL53L5_PROFILE_COUNT)
+    {
+        return false;
+    }
+
+    s_profile = profile;
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        uint8_t status;
+
+        if ((s_devices[dev].state != VL53L5_STATE_RUNNING) || (s_devices[dev].profile == profile))
+        {
+            continue;
+        }
+        status = vl53l5cx_stop_ranging(&Dev[dev]);
+        if (status != VL53L5CX_STATUS_OK)
+        {
+            vl53l5_fail(dev, VL53L5_FAULT_CONFIG, status);
+            all_ok = false;
+            continue;
+        }
+        s_devices[dev].state = VL53L5_STATE_SLOT;
+        s_devices[dev].due_tick = vl53l5_next_slot(dev, now);
+    }
+    return all_ok;
+}
+
+vl53l5_output_profile_t vl53l5_get_output_profile(void)
+{
+    return s_profile;
+}
+
+void vl53l5_set_callbacks(vl53l5_data_ready_cb_t data_ready_cb, vl53l5_read_done_cb_t read_done_cb)
+{
+    s_data_ready_cb = data_ready_cb;
+    s_read_done_cb = read_done_cb;
+}
+
+bool vl53l5_is_ready(uint8_t dev)
+{
+    return (dev < VL53L5_DEVICE_COUNT) && (s_devices[dev].state == VL53L5_STATE_RUNNING);
+}
+
+bool vl53l5_get_status(uint8_t dev, vl53l5_status_t *status)
+{
+    const vl53l5_device_t *device;
+
+    if ((dev >= VL53L5_DEVICE_COUNT) || (status == NULL))
+    {
+        return false;
+    }
+
+    device = &s_devices[dev];
+    status->state = device->state;
+    status->last_fault = device->last_fault;
+    status->last_error = device->last_error;
+    status->attempts = device->attempts;
+    status->faults = device->faults;
+    return true;
+}
+
+/* The start phase is that of the last ranging restart, see vl53l5_set_output_profile() */
+bool vl53l5_get_boot_ms(uint8_t dev, uint32_t boot_ms[VL53L5CX_BOOT_PHASE_COUNT])
+{
+    if ((dev >= VL53L5_DEVICE_COUNT) || (boot_ms == NULL))
     {
-		HAL_Delay(10);
-		/* Check if there is a VL53L5CX sensor connected */
-		status = vl53l5cx_is_alive(&Dev, &isAlive);
-	} while (!isAlive || status);
+        return false;
+    }
 
-	/* Init VL53L5CX sensor */
-	status = vl53l5cx_init(&Dev);
-//  status = vl53l5cx_motion_indicator_init(&Dev, &motion_config, VL53L5CX_RESOLUTION_8X8);
-	if (status) 
+    memcpy(boot_ms, Dev[dev].platform.boot_ms, sizeof(Dev[dev].platform.boot_ms));
+    return true;
+}
+
+uint8_t vl53l5_bus(uint8_t dev)
+{
+    return (uint8_t)(dev % VL53L5_BUS_COUNT);
+}
+
+/* Every device runs the same configuration, so they all stream the same amount; 0 until one ranges */
+uint32_t vl53l5_read_size(void)
+{
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
     {
-		while (1);
-	}
-	status = vl53l5cx_set_xtalk_margin(&Dev, 50);
-	status = vl53l5cx_set_target_order(&Dev, VL53L5CX_TARGET_ORDER_STRONGEST);
-	status = vl53l5cx_set_sharpener_percent(&Dev, 5);
-	status = vl53l5cx_set_ranging_frequency_hz(&Dev, DISTANCE_ODR);
-	status = vl53l5cx_set_resolution(&Dev, FRAME_RESOLUTION);
-	status = vl53l5cx_set_ranging_mode(&Dev, VL53L5CX_RANGING_MODE_CONTINUOUS);
-	status = vl53l5cx_start_ranging(&Dev);
-    bsp_gpio_exit_register_cb(vl53l5_cb , VL53_INT_Pin);
-    return &Results;
+        if (Dev[dev].data_read_size != 0U)
+        {
+            return Dev[dev].data_read_size;
+        }
+    }
+    return 0U;
 }
 
-bool vl53l5_update_data(void)
+/* Starts the read of one ranging frame, completion is reported through read_done_cb.
+ * I2C1 has a DMA channel, the other bus is read under interrupts. */
+bool vl53l5_start_read(uint8_t dev, uint8_t *raw)
 {
-    if (vl53l5_data_ready)
+    I2C_HandleTypeDef *hi2c;
+    uint16_t size;
+    HAL_StatusTypeDef status;
+
+    if ((dev >= VL53L5_DEVICE_COUNT) || (raw == NULL) || (s_devices[dev].state != VL53L5_STATE_RUNNING) ||
+        (Dev[dev].data_read_size == 0U) || (Dev[dev].data_read_size > VL53L5CX_MAX_RESULTS_SIZE))
     {
-        vl53l5_data_ready = 0;
-        vl53l5cx_get_ranging_data(&Dev, &Results);
-        return true;
+        return false;
+    }
+
+    hi2c = s_board[dev].hi2c;
+    size = (uint16_t)Dev[dev].data_read_size;
+    s_reading[dev] = true;
+    if (hi2c->hdmarx != NULL)
+    {
+        status = HAL_I2C_Mem_Read_DMA(hi2c, Dev[dev].platform.address, 0x0000U, I2C_MEMADD_SIZE_16BIT, raw, size);
+    }
+    else
+    {
+        status = HAL_I2C_Mem_Read_IT(hi2c, Dev[dev].platform.address, 0x0000U, I2C_MEMADD_SIZE_16BIT, raw, size);
     }
-	else
+    if (status != HAL_OK)
+    {
+        s_reading[dev] = false;
+    }
+    return status == HAL_OK;
+}
+
+bool vl53l5_decode(uint8_t dev, uint8_t *raw, VL53L5CX_ResultsData *results)
+{
+    if (dev >= VL53L5_DEVICE_COUNT)
     {
         return false;
     }
+
+    return vl53l5cx_decode_ranging_data(&Dev[dev], raw, results) == VL53L5CX_STATUS_OK;
 }
 
-void vl53l5_cb(void)
+/* A bus carries one transfer at a time, so the reading device on it is the one that completed */
+static void vl53l5_read_done(I2C_HandleTypeDef *hi2c, bool ok)
 {
-    vl53l5_data_ready = 1;
-}
\ No newline at end of file
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        if ((s_board[dev].hi2c == hi2c) && s_reading[dev])
+        {
+            uint8_t errors = s_devices[dev].read_errors;
+
+            s_reading[dev] = false;
+            s_devices[dev].read_errors = ok ? 0U : ((errors < 0xFFU) ? (uint8_t)(errors + 1U) : errors);
+            if (s_read_done_cb != NULL)
+            {
+                s_read_done_cb(dev, ok);
+            }
+            return;
+        }
+    }
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    vl53l5_read_done(hi2c, true);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    vl53l5_read_done(hi2c, false);
+}
@@ -36,7 +36,12 @@ static uint8_t _vl53l5cx_poll_for_answer(
 				p_dev->temp_buffer, size);
 		status |= VL53L5CX_WaitMs(&(p_dev->platform), 10);
 
-		if(timeout >= (uint8_t)200)	/* 2s timeout */
+		if(status != (uint8_t)VL53L5CX_STATUS_OK)
+		{
+			/* No answer on the bus, waiting out the timeout would not help */
+			break;
+		}
+		else if(timeout >= (uint8_t)200)	/* 2s timeout */
 		{
 			status |= (uint8_t)VL53L5CX_STATUS_TIMEOUT_ERROR;
 			break;
@@ -55,35 +60,6 @@ static uint8_t _vl53l5cx_poll_for_answer(
 	return status;
 }
 
-/*
- * Inner function, not available outside this file. This function is used to
- * wait for the MCU to boot.
- */
-static uint8_t _vl53l5cx_poll_for_mcu_boot(
-              VL53L5CX_Configuration      *p_dev)
-{
-   uint8_t go2_status0, go2_status1, status = VL53L5CX_STATUS_OK;
-   uint16_t timeout = 0;
-
-   do {
-		status |= VL53L5CX_RdByte(&(p_dev->platform), 0x06, &go2_status0);
-		if((go2_status0 & (uint8_t)0x80) != (uint8_t)0){
-			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x07, &go2_status1);
-			status |= go2_status1;
-			break;
-		}
-		(void)VL53L5CX_WaitMs(&(p_dev->platform), 1);
-		timeout++;
-
-		if((go2_status0 & (uint8_t)0x1) != (uint8_t)0){
-			break;
-		}
-
-	}while (timeout < (uint16_t)500);
-
-   return status;
-}
-
 /**
  * @brief Inner function, not available outside this file. This function is used
  * to set the offset data gathered from NVM.
@@ -214,6 +190,121 @@ static uint8_t _vl53l5cx_send_xtalk_data(
 	return status;
 }
 
+/**
+ * @brief Inner function, not available outside this file. This function
+ * returns the outputs enabled in the 'platform.h' file.
+ */
+
+static uint32_t _vl53l5cx_platform_outputs(void)
+{
+	uint32_t outputs = 0;
+
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+	outputs |= VL53L5CX_OUTPUT_AMBIENT_PER_SPAD;
+#endif
+#ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
+	outputs |= VL53L5CX_OUTPUT_NB_SPADS_ENABLED;
+#endif
+#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
+	outputs |= VL53L5CX_OUTPUT_NB_TARGET_DETECTED;
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+	outputs |= VL53L5CX_OUTPUT_SIGNAL_PER_SPAD;
+#endif
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+	outputs |= VL53L5CX_OUTPUT_RANGE_SIGMA_MM;
+#endif
+#ifndef VL53L5CX_DISABLE_DISTANCE_MM
+	outputs |= VL53L5CX_OUTPUT_DISTANCE_MM;
+#endif
+#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+	outputs |= VL53L5CX_OUTPUT_REFLECTANCE_PERCENT;
+#endif
+#ifndef VL53L5CX_DISABLE_TARGET_STATUS
+	outputs |= VL53L5CX_OUTPUT_TARGET_STATUS;
+#endif
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+	outputs |= VL53L5CX_OUTPUT_MOTION_INDICATOR;
+#endif
+
+	return outputs;
+}
+
+/**
+ * @brief Inner function, not available outside this file. This function clears
+ * the results of the outputs left out of the ranging session, so they do not
+ * keep the data of an earlier one.
+ */
+
+static void _vl53l5cx_clear_outputs(
+		uint32_t			disabled_outputs,
+		VL53L5CX_ResultsData		*p_results)
+{
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+	if((disabled_outputs & VL53L5CX_OUTPUT_AMBIENT_PER_SPAD) != (uint32_t)0)
+	{
+		(void)memset(p_results->ambient_per_spad, 0,
+			sizeof(p_results->ambient_per_spad));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
+	if((disabled_outputs & VL53L5CX_OUTPUT_NB_SPADS_ENABLED) != (uint32_t)0)
+	{
+		(void)memset(p_results->nb_spads_enabled, 0,
+			sizeof(p_results->nb_spads_enabled));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
+	if((disabled_outputs & VL53L5CX_OUTPUT_NB_TARGET_DETECTED) != (uint32_t)0)
+	{
+		(void)memset(p_results->nb_target_detected, 0,
+			sizeof(p_results->nb_target_detected));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+	if((disabled_outputs & VL53L5CX_OUTPUT_SIGNAL_PER_SPAD) != (uint32_t)0)
+	{
+		(void)memset(p_results->signal_per_spad, 0,
+			sizeof(p_results->signal_per_spad));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+	if((disabled_outputs & VL53L5CX_OUTPUT_RANGE_SIGMA_MM) != (uint32_t)0)
+	{
+		(void)memset(p_results->range_sigma_mm, 0,
+			sizeof(p_results->range_sigma_mm));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_DISTANCE_MM
+	if((disabled_outputs & VL53L5CX_OUTPUT_DISTANCE_MM) != (uint32_t)0)
+	{
+		(void)memset(p_results->distance_mm, 0,
+			sizeof(p_results->distance_mm));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+	if((disabled_outputs & VL53L5CX_OUTPUT_REFLECTANCE_PERCENT) != (uint32_t)0)
+	{
+		(void)memset(p_results->reflectance, 0,
+			sizeof(p_results->reflectance));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_TARGET_STATUS
+	if((disabled_outputs & VL53L5CX_OUTPUT_TARGET_STATUS) != (uint32_t)0)
+	{
+		(void)memset(p_results->target_status, 0,
+			sizeof(p_results->target_status));
+	}
+#endif
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+	if((disabled_outputs & VL53L5CX_OUTPUT_MOTION_INDICATOR) != (uint32_t)0)
+	{
+		(void)memset(&p_results->motion_indicator, 0,
+			sizeof(p_results->motion_indicator));
+	}
+#endif
+}
+
 uint8_t vl53l5cx_is_alive(
 		VL53L5CX_Configuration		*p_dev,
 		uint8_t				*p_is_alive)
@@ -238,170 +329,383 @@ uint8_t vl53l5cx_is_alive(
 	return status;
 }
 
+/*
+ * Steps of vl53l5cx_init_step(), in the order of the boot sequence.
+ */
+enum
+{
+	VL53L5CX_INIT_REBOOT = 0,
+	VL53L5CX_INIT_REBOOT_RELEASE,
+	VL53L5CX_INIT_BOOT_POLL,
+	VL53L5CX_INIT_FW_ACCESS,
+	VL53L5CX_INIT_FW_ACCESS_POLL,
+	VL53L5CX_INIT_WAKE_UP,
+	VL53L5CX_INIT_DOWNLOAD,
+	VL53L5CX_INIT_FW_CHECK,
+	VL53L5CX_INIT_FW_CHECK_POLL,
+	VL53L5CX_INIT_MCU_RESET,
+	VL53L5CX_INIT_MCU_BOOT_POLL,
+	VL53L5CX_INIT_NVM,
+	VL53L5CX_INIT_NVM_POLL,
+	VL53L5CX_INIT_CALIBRATION,
+	VL53L5CX_INIT_CONFIG,
+	VL53L5CX_INIT_CONFIG_POLL,
+	VL53L5CX_INIT_DCI,
+	VL53L5CX_INIT_DONE
+};
+
+/* Firmware image, downloaded to the pages from 0x09 on, 0x8000 bytes each */
+#define VL53L5CX_FW_SIZE			((uint32_t)0x15000)
+#define VL53L5CX_FW_PAGE_SIZE		((uint32_t)0x8000)
+#define VL53L5CX_FW_FIRST_PAGE		((uint8_t)0x09)
+
+/*
+ * Inner function, not available outside this file. One iteration of
+ * _vl53l5cx_poll_for_answer(), the 10 ms wait is left to the caller. The
+ * sequence moves on to the next step once the answer is there.
+ */
+static uint8_t _vl53l5cx_init_poll(
+		VL53L5CX_Configuration	*p_dev,
+		uint8_t					size,
+		uint8_t					pos,
+		uint16_t				address,
+		uint8_t					mask,
+		uint8_t					expected_value,
+		uint32_t				*p_wait_ms)
+{
+	uint8_t status = VL53L5CX_STATUS_OK;
+
+	status |= VL53L5CX_RdMulti(&(p_dev->platform), address,
+			p_dev->temp_buffer, size);
+	*p_wait_ms = 10;
+
+	if(status != (uint8_t)VL53L5CX_STATUS_OK)
+	{
+		/* No answer on the bus */
+	}
+	else if(p_dev->init_polls >= (uint16_t)200)	/* 2s timeout */
+	{
+		status |= (uint8_t)VL53L5CX_STATUS_TIMEOUT_ERROR;
+	}
+	else if((size >= (uint8_t)4)
+			&& (p_dev->temp_buffer[2] >= (uint8_t)0x7f))
+	{
+		status |= VL53L5CX_MCU_ERROR;
+	}
+	else
+	{
+		p_dev->init_polls++;
+		if((p_dev->temp_buffer[pos] & mask) == expected_value)
+		{
+			p_dev->init_step++;
+		}
+	}
+
+	return status;
+}
+
 uint8_t vl53l5cx_init(
 		VL53L5CX_Configuration		*p_dev)
 {
-	uint8_t tmp, status = VL53L5CX_STATUS_OK;
-	uint8_t pipe_ctrl[] = {VL53L5CX_NB_TARGET_PER_ZONE, 0x00, 0x01, 0x00};
-	uint32_t single_range = 0x01;
+	uint8_t done = 0, status;
+	uint32_t wait_ms;
 
+	status = vl53l5cx_init_start(p_dev);
+	while((status == (uint8_t)VL53L5CX_STATUS_OK) && (done == (uint8_t)0))
+	{
+		status |= vl53l5cx_init_step(p_dev, &wait_ms, &done);
+		if(wait_ms != (uint32_t)0)
+		{
+			status |= VL53L5CX_WaitMs(&(p_dev->platform), wait_ms);
+		}
+	}
+
+	return status;
+}
+
+uint8_t vl53l5cx_init_start(
+		VL53L5CX_Configuration		*p_dev)
+{
 	p_dev->default_xtalk = (uint8_t*)VL53L5CX_DEFAULT_XTALK;
 	p_dev->default_configuration = (uint8_t*)VL53L5CX_DEFAULT_CONFIGURATION;
 	p_dev->is_auto_stop_enabled = (uint8_t)0x0;
+	p_dev->disabled_outputs = (uint32_t)0x0;
+	p_dev->init_step = (uint8_t)VL53L5CX_INIT_REBOOT;
+	p_dev->init_polls = 0;
+	p_dev->init_offset = 0;
 
-	/* SW reboot sequence */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0009, 0x04);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000F, 0x40);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000A, 0x03);
-	status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7FFF, &tmp);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000C, 0x01);
-
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0101, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0102, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x03);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0103, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000C, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000F, 0x43);
-	status |= VL53L5CX_WaitMs(&(p_dev->platform), 1);
-
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000F, 0x40);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000A, 0x01);
-	status |= VL53L5CX_WaitMs(&(p_dev->platform), 100);
-
-	/* Wait for sensor booted (several ms required to get sensor ready ) */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
-	status |= _vl53l5cx_poll_for_answer(p_dev, 1, 0, 0x06, 0xff, 1);
-	if(status != (uint8_t)0){
-		goto exit;
-	}
+	return VL53L5CX_STATUS_OK;
+}
 
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000E, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
+uint8_t vl53l5cx_init_step(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			*p_wait_ms,
+		uint8_t				*p_done)
+{
+	uint8_t tmp, step = p_dev->init_step, status = VL53L5CX_STATUS_OK;
+	uint8_t pipe_ctrl[] = {VL53L5CX_NB_TARGET_PER_ZONE, 0x00, 0x01, 0x00};
+	uint32_t single_range = 0x01;
+	uint32_t chunk;
 
-	/* Enable FW access */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x03, 0x0D);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
-	status |= _vl53l5cx_poll_for_answer(p_dev, 1, 0, 0x21, 0x10, 0x10);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+	*p_wait_ms = 0;
+	*p_done = 0;
 
-	/* Enable host access to GO1 */
-	status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x01);
+	switch(step)
+	{
+		case VL53L5CX_INIT_REBOOT:
+			/* SW reboot sequence */
+			VL53L5CX_BootPhase(&(p_dev->platform), VL53L5CX_BOOT_RESET);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0009, 0x04);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000F, 0x40);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000A, 0x03);
+			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7FFF, &tmp);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000C, 0x01);
+
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0101, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0102, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x03);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0103, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000C, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000F, 0x43);
+			*p_wait_ms = 1;
+			p_dev->init_step++;
+			break;
 
-	/* Power ON status */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x101, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x102, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x03);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x103, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x400F, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x43);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x03);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x219, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21B, 0x00);
-
-	/* Wake up MCU */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
-	status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x20, 0x07);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x20, 0x06);
-
-	/* Download FW into VL53L5 */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x09);
-	status |= VL53L5CX_WrMulti(&(p_dev->platform),0,
-		(uint8_t*)&VL53L5CX_FIRMWARE[0],0x8000);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x0a);
-	status |= VL53L5CX_WrMulti(&(p_dev->platform),0,
-		(uint8_t*)&VL53L5CX_FIRMWARE[0x8000],0x8000);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x0b);
-	status |= VL53L5CX_WrMulti(&(p_dev->platform),0,
-		(uint8_t*)&VL53L5CX_FIRMWARE[0x10000],0x5000);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
-
-	/* Check if FW correctly downloaded */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x03, 0x0D);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
-	status |= _vl53l5cx_poll_for_answer(p_dev, 1, 0, 0x21, 0x10, 0x10);
-	if(status != (uint8_t)0){
-		goto exit;
-	}
+		case VL53L5CX_INIT_REBOOT_RELEASE:
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000F, 0x40);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000A, 0x01);
+			*p_wait_ms = 100;
+			p_dev->init_step++;
+			break;
 
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
-	status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x01);
+		case VL53L5CX_INIT_BOOT_POLL:
+			/* Wait for sensor booted (several ms required to get sensor ready ) */
+			if(p_dev->init_polls == (uint16_t)0)
+			{
+				status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+			}
+			status |= _vl53l5cx_init_poll(p_dev, 1, 0, 0x06, 0xff, 1,
+					p_wait_ms);
+			break;
 
-	/* Reset MCU and wait boot */
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7FFF, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x114, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x115, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x116, 0x42);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x117, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0B, 0x00);
-	status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x00);
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0B, 0x01);
-	status |= _vl53l5cx_poll_for_mcu_boot(p_dev);
-	if(status != (uint8_t)0){
-		goto exit;
-	}
+		case VL53L5CX_INIT_FW_ACCESS:
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x000E, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
 
-	status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
+			/* Enable FW access */
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x03, 0x0D);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
+			p_dev->init_step++;
+			break;
 
-	/* Get offset NVM data and store them into the offset buffer */
-	status |= VL53L5CX_WrMulti(&(p_dev->platform), 0x2fd8,
-		(uint8_t*)VL53L5CX_GET_NVM_CMD, sizeof(VL53L5CX_GET_NVM_CMD));
-	status |= _vl53l5cx_poll_for_answer(p_dev, 4, 0,
-		VL53L5CX_UI_CMD_STATUS, 0xff, 2);
-	status |= VL53L5CX_RdMulti(&(p_dev->platform), VL53L5CX_UI_CMD_START,
-		p_dev->temp_buffer, VL53L5CX_NVM_DATA_SIZE);
-	(void)memcpy(p_dev->offset_data, p_dev->temp_buffer,
-		VL53L5CX_OFFSET_BUFFER_SIZE);
-	status |= _vl53l5cx_send_offset_data(p_dev, VL53L5CX_RESOLUTION_4X4);
+		case VL53L5CX_INIT_FW_ACCESS_POLL:
+			status |= _vl53l5cx_init_poll(p_dev, 1, 0, 0x21, 0x10, 0x10,
+					p_wait_ms);
+			break;
 
-	/* Set default Xtalk shape. Send Xtalk to sensor */
-	(void)memcpy(p_dev->xtalk_data, (uint8_t*)VL53L5CX_DEFAULT_XTALK,
-		VL53L5CX_XTALK_BUFFER_SIZE);
-	status |= _vl53l5cx_send_xtalk_data(p_dev, VL53L5CX_RESOLUTION_4X4);
+		case VL53L5CX_INIT_WAKE_UP:
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+
+			/* Enable host access to GO1 */
+			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x01);
+
+			/* Power ON status */
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x101, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x102, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x4002, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x010A, 0x03);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x103, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x400F, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x43);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x03);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21A, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x219, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x21B, 0x00);
+
+			/* Wake up MCU */
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x20, 0x07);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x20, 0x06);
+			p_dev->init_step++;
+			break;
 
-	/* Send default configuration to VL53L5CX firmware */
-	status |= VL53L5CX_WrMulti(&(p_dev->platform), 0x2c34,
-		p_dev->default_configuration,
-		sizeof(VL53L5CX_DEFAULT_CONFIGURATION));
-	status |= _vl53l5cx_poll_for_answer(p_dev, 4, 1,
-		VL53L5CX_UI_CMD_STATUS, 0xff, 0x03);
+		case VL53L5CX_INIT_DOWNLOAD:
+			/* Download FW into VL53L5, one chunk per step */
+			if(p_dev->init_offset == (uint32_t)0)
+			{
+				VL53L5CX_BootPhase(&(p_dev->platform), VL53L5CX_BOOT_FIRMWARE);
+			}
+			if((p_dev->init_offset % VL53L5CX_FW_PAGE_SIZE) == (uint32_t)0)
+			{
+				status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff,
+					(uint8_t)(VL53L5CX_FW_FIRST_PAGE
+					+ (p_dev->init_offset / VL53L5CX_FW_PAGE_SIZE)));
+			}
+			chunk = VL53L5CX_FW_PAGE_SIZE
+				- (p_dev->init_offset % VL53L5CX_FW_PAGE_SIZE);
+			if(chunk > (VL53L5CX_FW_SIZE - p_dev->init_offset))
+			{
+				chunk = VL53L5CX_FW_SIZE - p_dev->init_offset;
+			}
+			if(chunk > (uint32_t)VL53L5CX_COMMS_CHUNK_SIZE)
+			{
+				chunk = VL53L5CX_COMMS_CHUNK_SIZE;
+			}
+			status |= VL53L5CX_WrMulti(&(p_dev->platform),
+				(uint16_t)(p_dev->init_offset % VL53L5CX_FW_PAGE_SIZE),
+				(uint8_t*)&VL53L5CX_FIRMWARE[p_dev->init_offset], chunk);
+			p_dev->init_offset += chunk;
+			if(p_dev->init_offset >= VL53L5CX_FW_SIZE)
+			{
+				status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
+				p_dev->init_step++;
+			}
+			break;
+
+		case VL53L5CX_INIT_FW_CHECK:
+			/* Check if FW correctly downloaded */
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x03, 0x0D);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x01);
+			p_dev->init_step++;
+			break;
+
+		case VL53L5CX_INIT_FW_CHECK_POLL:
+			status |= _vl53l5cx_init_poll(p_dev, 1, 0, 0x21, 0x10, 0x10,
+					p_wait_ms);
+			break;
+
+		case VL53L5CX_INIT_MCU_RESET:
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
+			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x01);
+
+			/* Reset MCU and wait boot */
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7FFF, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x114, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x115, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x116, 0x42);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x117, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0B, 0x00);
+			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x7fff, &tmp);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0C, 0x00);
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x0B, 0x01);
+			p_dev->init_step++;
+			break;
 
-	status |= vl53l5cx_dci_write_data(p_dev, (uint8_t*)&pipe_ctrl,
-		VL53L5CX_DCI_PIPE_CONTROL, (uint16_t)sizeof(pipe_ctrl));
+		case VL53L5CX_INIT_MCU_BOOT_POLL:
+			/* Wait for the MCU to boot, 500 ms at most */
+			status |= VL53L5CX_RdByte(&(p_dev->platform), 0x06, &tmp);
+			if(status != (uint8_t)VL53L5CX_STATUS_OK)
+			{
+				break;
+			}
+			if((tmp & (uint8_t)0x80) != (uint8_t)0)
+			{
+				status |= VL53L5CX_RdByte(&(p_dev->platform), 0x07, &tmp);
+				status |= tmp;
+				p_dev->init_step++;
+				break;
+			}
+			*p_wait_ms = 1;
+			p_dev->init_polls++;
+			if(((tmp & (uint8_t)0x1) != (uint8_t)0)
+				|| (p_dev->init_polls >= (uint16_t)500))
+			{
+				p_dev->init_step++;
+			}
+			break;
+
+		case VL53L5CX_INIT_NVM:
+			status |= VL53L5CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
+
+			/* Get offset NVM data and store them into the offset buffer */
+			VL53L5CX_BootPhase(&(p_dev->platform), VL53L5CX_BOOT_CALIBRATION);
+			status |= VL53L5CX_WrMulti(&(p_dev->platform), 0x2fd8,
+				(uint8_t*)VL53L5CX_GET_NVM_CMD, sizeof(VL53L5CX_GET_NVM_CMD));
+			p_dev->init_step++;
+			break;
+
+		case VL53L5CX_INIT_NVM_POLL:
+			status |= _vl53l5cx_init_poll(p_dev, 4, 0,
+					VL53L5CX_UI_CMD_STATUS, 0xff, 2, p_wait_ms);
+			break;
+
+		case VL53L5CX_INIT_CALIBRATION:
+			status |= VL53L5CX_RdMulti(&(p_dev->platform), VL53L5CX_UI_CMD_START,
+				p_dev->temp_buffer, VL53L5CX_NVM_DATA_SIZE);
+			(void)memcpy(p_dev->offset_data, p_dev->temp_buffer,
+				VL53L5CX_OFFSET_BUFFER_SIZE);
+			status |= _vl53l5cx_send_offset_data(p_dev, VL53L5CX_RESOLUTION_4X4);
+
+			/* Set default Xtalk shape. Send Xtalk to sensor */
+			(void)memcpy(p_dev->xtalk_data, (uint8_t*)VL53L5CX_DEFAULT_XTALK,
+				VL53L5CX_XTALK_BUFFER_SIZE);
+			status |= _vl53l5cx_send_xtalk_data(p_dev, VL53L5CX_RESOLUTION_4X4);
+			p_dev->init_step++;
+			break;
+
+		case VL53L5CX_INIT_CONFIG:
+			/* Send default configuration to VL53L5CX firmware */
+			VL53L5CX_BootPhase(&(p_dev->platform), VL53L5CX_BOOT_CONFIG);
+			status |= VL53L5CX_WrMulti(&(p_dev->platform), 0x2c34,
+				p_dev->default_configuration,
+				sizeof(VL53L5CX_DEFAULT_CONFIGURATION));
+			p_dev->init_step++;
+			break;
+
+		case VL53L5CX_INIT_CONFIG_POLL:
+			status |= _vl53l5cx_init_poll(p_dev, 4, 1,
+					VL53L5CX_UI_CMD_STATUS, 0xff, 0x03, p_wait_ms);
+			break;
+
+		case VL53L5CX_INIT_DCI:
+			status |= vl53l5cx_dci_write_data(p_dev, (uint8_t*)&pipe_ctrl,
+				VL53L5CX_DCI_PIPE_CONTROL, (uint16_t)sizeof(pipe_ctrl));
 #if VL53L5CX_NB_TARGET_PER_ZONE != 1
-	tmp = VL53L5CX_NB_TARGET_PER_ZONE;
-	status |= vl53l5cx_dci_replace_data(p_dev, p_dev->temp_buffer,
-		VL53L5CX_DCI_FW_NB_TARGET, 16,
-	(uint8_t*)&tmp, 1, 0x0C);
+			tmp = VL53L5CX_NB_TARGET_PER_ZONE;
+			status |= vl53l5cx_dci_replace_data(p_dev, p_dev->temp_buffer,
+				VL53L5CX_DCI_FW_NB_TARGET, 16,
+			(uint8_t*)&tmp, 1, 0x0C);
 #endif
 
-	status |= vl53l5cx_dci_write_data(p_dev, (uint8_t*)&single_range,
-			VL53L5CX_DCI_SINGLE_RANGE,
-			(uint16_t)sizeof(single_range));
+			status |= vl53l5cx_dci_write_data(p_dev, (uint8_t*)&single_range,
+					VL53L5CX_DCI_SINGLE_RANGE,
+					(uint16_t)sizeof(single_range));
 
-	tmp = (uint8_t)1;
-	status |= vl53l5cx_dci_replace_data(p_dev, p_dev->temp_buffer,
-			VL53L5CX_GLARE_FILTER, 40, (uint8_t*)&tmp, 1, 0x26);
-	status |= vl53l5cx_dci_replace_data(p_dev, p_dev->temp_buffer,
-			VL53L5CX_GLARE_FILTER, 40, (uint8_t*)&tmp, 1, 0x25);
+			tmp = (uint8_t)1;
+			status |= vl53l5cx_dci_replace_data(p_dev, p_dev->temp_buffer,
+					VL53L5CX_GLARE_FILTER, 40, (uint8_t*)&tmp, 1, 0x26);
+			status |= vl53l5cx_dci_replace_data(p_dev, p_dev->temp_buffer,
+					VL53L5CX_GLARE_FILTER, 40, (uint8_t*)&tmp, 1, 0x25);
+			p_dev->init_step++;
+			break;
+
+		default:
+			break;
+	}
+
+	if(p_dev->init_step != step)
+	{
+		p_dev->init_polls = 0;
+	}
+	if(p_dev->init_step >= (uint8_t)VL53L5CX_INIT_DONE)
+	{
+		*p_done = 1;
+	}
 
-exit:
 	return status;
 }
 
@@ -519,34 +823,10 @@ uint8_t vl53l5cx_start_ranging(
 		VL53L5CX_TARGET_STATUS_BH,
 		VL53L5CX_MOTION_DETECT_BH};
 
-	/* Enable selected outputs in the 'platform.h' file */
-#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
-	output_bh_enable[0] += (uint32_t)8;
-#endif
-#ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
-	output_bh_enable[0] += (uint32_t)16;
-#endif
-#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
-	output_bh_enable[0] += (uint32_t)32;
-#endif
-#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
-	output_bh_enable[0] += (uint32_t)64;
-#endif
-#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
-	output_bh_enable[0] += (uint32_t)128;
-#endif
-#ifndef VL53L5CX_DISABLE_DISTANCE_MM
-	output_bh_enable[0] += (uint32_t)256;
-#endif
-#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
-	output_bh_enable[0] += (uint32_t)512;
-#endif
-#ifndef VL53L5CX_DISABLE_TARGET_STATUS
-	output_bh_enable[0] += (uint32_t)1024;
-#endif
-#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
-	output_bh_enable[0] += (uint32_t)2048;
-#endif
+	/* Enable selected outputs in the 'platform.h' file, minus the ones left
+	 * out with vl53l5cx_set_outputs() */
+	output_bh_enable[0] |= _vl53l5cx_platform_outputs()
+		& ~p_dev->disabled_outputs;
 
 	/* Update data size */
 	for (i = 0; i < (uint32_t)(sizeof(output)/sizeof(uint32_t)); i++)
@@ -645,7 +925,12 @@ uint8_t vl53l5cx_stop_ranging(
 			status |= VL53L5CX_WaitMs(&(p_dev->platform), 10);
 			timeout++;	/* Timeout reached after 5 seconds */
 
-			if(timeout > (uint16_t)500)
+			if(status != (uint8_t)VL53L5CX_STATUS_OK)
+			{
+				/* No answer on the bus */
+				break;
+			}
+			else if(timeout > (uint16_t)500)
 			{
 				status |= tmp;
 				break;
@@ -674,6 +959,33 @@ uint8_t vl53l5cx_stop_ranging(
 	return status;
 }
 
+uint8_t vl53l5cx_set_outputs(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			outputs)
+{
+	uint8_t status = VL53L5CX_STATUS_OK;
+
+	if((outputs & ~VL53L5CX_OUTPUT_ALL) != (uint32_t)0)
+	{
+		status = VL53L5CX_STATUS_INVALID_PARAM;
+	}
+	else
+	{
+		p_dev->disabled_outputs = VL53L5CX_OUTPUT_ALL & ~outputs;
+	}
+
+	return status;
+}
+
+uint8_t vl53l5cx_get_outputs(
+		VL53L5CX_Configuration		*p_dev,
+		uint32_t			*p_outputs)
+{
+	*p_outputs = _vl53l5cx_platform_outputs() & ~p_dev->disabled_outputs;
+
+	return VL53L5CX_STATUS_OK;
+}
+
 uint8_t vl53l5cx_check_data_ready(
 		VL53L5CX_Configuration		*p_dev,
 		uint8_t				*p_isReady)
@@ -710,20 +1022,38 @@ uint8_t vl53l5cx_get_ranging_data(
 		VL53L5CX_ResultsData		*p_results)
 {
 	uint8_t status = VL53L5CX_STATUS_OK;
+
+	status |= VL53L5CX_RdMulti(&(p_dev->platform), 0x0,
+			p_dev->temp_buffer, p_dev->data_read_size);
+	status |= vl53l5cx_decode_ranging_data(p_dev, p_dev->temp_buffer,
+			p_results);
+
+	return status;
+}
+
+uint8_t vl53l5cx_decode_ranging_data(
+		VL53L5CX_Configuration		*p_dev,
+		uint8_t				*p_raw,
+		VL53L5CX_ResultsData		*p_results)
+{
+	uint8_t status = VL53L5CX_STATUS_OK;
 	union Block_header *bh_ptr;
 	uint16_t header_id, footer_id;
 	uint32_t i, j, msize;
 
-	status |= VL53L5CX_RdMulti(&(p_dev->platform), 0x0,
-			p_dev->temp_buffer, p_dev->data_read_size);
-	p_dev->streamcount = p_dev->temp_buffer[0];
-	VL53L5CX_SwapBuffer(p_dev->temp_buffer, (uint16_t)p_dev->data_read_size);
+	p_dev->streamcount = p_raw[0];
+	VL53L5CX_SwapBuffer(p_raw, (uint16_t)p_dev->data_read_size);
+
+	if(p_dev->disabled_outputs != (uint32_t)0)
+	{
+		_vl53l5cx_clear_outputs(p_dev->disabled_outputs, p_results);
+	}
 
 	/* Start conversion at position 16 to avoid headers */
 	for (i = (uint32_t)16; i 
              < (uint32_t)p_dev->data_read_size; i+=(uint32_t)4)
 	{
-		bh_ptr = (union Block_header *)&(p_dev->temp_buffer[i]);
+		bh_ptr = (union Block_header *)&(p_raw[i]);
 		if ((bh_ptr->type > (uint32_t)0x1) 
                     && (bh_ptr->type < (uint32_t)0xd))
 		{
@@ -737,61 +1067,61 @@ uint8_t vl53l5cx_get_ranging_data(
 		switch(bh_ptr->idx){
 			case VL53L5CX_METADATA_IDX:
 				p_results->silicon_temp_degc =
-						(int8_t)p_dev->temp_buffer[i + (uint32_t)12];
+						(int8_t)p_raw[i + (uint32_t)12];
 				break;
 
 #ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
 			case VL53L5CX_AMBIENT_RATE_IDX:
 				(void)memcpy(p_results->ambient_per_spad,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
 			case VL53L5CX_SPAD_COUNT_IDX:
 				(void)memcpy(p_results->nb_spads_enabled,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
 			case VL53L5CX_NB_TARGET_DETECTED_IDX:
 				(void)memcpy(p_results->nb_target_detected,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
 			case VL53L5CX_SIGNAL_RATE_IDX:
 				(void)memcpy(p_results->signal_per_spad,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
 			case VL53L5CX_RANGE_SIGMA_MM_IDX:
 				(void)memcpy(p_results->range_sigma_mm,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_DISTANCE_MM
 			case VL53L5CX_DISTANCE_IDX:
 				(void)memcpy(p_results->distance_mm,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
 			case VL53L5CX_REFLECTANCE_EST_PC_IDX:
 				(void)memcpy(p_results->reflectance,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_TARGET_STATUS
 			case VL53L5CX_TARGET_STATUS_IDX:
 				(void)memcpy(p_results->target_status,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
 			case VL53L5CX_MOTION_DETEC_IDX:
 				(void)memcpy(&p_results->motion_indicator,
-				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
+				&(p_raw[i + (uint32_t)4]), msize);
 				break;
 #endif
 			default:
@@ -835,7 +1165,9 @@ uint8_t vl53l5cx_get_ranging_data(
 #ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
 	for(i = 0; i < (uint32_t)VL53L5CX_RESOLUTION_8X8; i++)
 	{
-		if(p_results->nb_target_detected[i] == (uint8_t)0){
+		if((p_results->nb_target_detected[i] == (uint8_t)0)
+			&& ((p_dev->disabled_outputs
+			& VL53L5CX_OUTPUT_NB_TARGET_DETECTED) == (uint32_t)0)){
 			for(j = 0; j < (uint32_t)
 				VL53L5CX_NB_TARGET_PER_ZONE; j++)
 			{
@@ -860,12 +1192,12 @@ uint8_t vl53l5cx_get_ranging_data(
 
 	/* Check if footer id and header id are matching. This allows to detect
 	 * corrupted frames */
-	header_id = ((uint16_t)(p_dev->temp_buffer[0x8])<<8) & 0xFF00U;
-	header_id |= ((uint16_t)(p_dev->temp_buffer[0x9])) & 0x00FFU;
+	header_id = ((uint16_t)(p_raw[0x8])<<8) & 0xFF00U;
+	header_id |= ((uint16_t)(p_raw[0x9])) & 0x00FFU;
 
-	footer_id = ((uint16_t)(p_dev->temp_buffer[p_dev->data_read_size
+	footer_id = ((uint16_t)(p_raw[p_dev->data_read_size
 		- (uint32_t)4]) << 8) & 0xFF00U;
-	footer_id |= ((uint16_t)(p_dev->temp_buffer[p_dev->data_read_size
+	footer_id |= ((uint16_t)(p_raw[p_dev->data_read_size
 		- (uint32_t)3])) & 0xFFU;
 
 	if(header_id != footer_id)
@@ -0,0 +1,226 @@
+#include "vl53l5cx_fast_decode.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define FAST_DECODE_HEADER_SIZE 16U
+#define FAST_DECODE_NO_BLOCK 0U
+/* Metadata bytes read, up to the silicon temperature */
+#define FAST_DECODE_META_SIZE 12U
+
+/*
+ * The sensor streams 32-bit big-endian words. Byte i of a little-endian view
+ * of the blob is at (i ^ 3) on the wire, which is what SwapBuffer undoes.
+ */
+static inline uint8_t fast_decode_u8(const uint8_t *p_raw, uint32_t off, uint32_t i)
+{
+    return p_raw[off + (i ^ 3U)];
+}
+
+static inline uint16_t fast_decode_u16(const uint8_t *p_raw, uint32_t off, uint32_t i)
+{
+    uint32_t pos = off + ((2U * i) ^ 2U);
+    return (uint16_t)(((uint16_t)p_raw[pos] << 8) | p_raw[pos + 1U]);
+}
+
+/* Signal rate per SPAD, in kcps/SPAD like vl53l5cx_decode_ranging_data() */
+static inline uint32_t fast_decode_signal(const uint8_t *p_raw, uint32_t off, uint32_t i)
+{
+    const uint8_t *p = &p_raw[off + (4U * i)];
+    return ((((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]) / 2048U);
+}
+
+void vl53l5cx_fast_decode_reset(vl53l5cx_fast_layout_t *layout)
+{
+    if (layout != NULL)
+    {
+        memset(layout, 0, sizeof(*layout));
+    }
+}
+
+/* A block the decoder reads must hold an element for every target it decodes */
+static bool fast_decode_block_fits(uint16_t off, uint32_t msize, uint32_t needed)
+{
+    return (off == FAST_DECODE_NO_BLOCK) || (msize >= needed);
+}
+
+uint8_t vl53l5cx_fast_decode_prepare(vl53l5cx_fast_layout_t *layout, const uint8_t *p_raw, uint32_t size)
+{
+    uint32_t i = FAST_DECODE_HEADER_SIZE;
+    uint32_t meta_size = 0U;
+    uint32_t nb_target_size = 0U;
+    uint32_t sigma_size = 0U;
+    uint32_t signal_size = 0U;
+    uint32_t distance_size = 0U;
+    uint32_t status_size = 0U;
+    uint32_t targets;
+
+    if ((layout == NULL) || (p_raw == NULL) || (size > VL53L5CX_MAX_RESULTS_SIZE) || ((size & 3U) != 0U))
+    {
+        return VL53L5CX_STATUS_INVALID_PARAM;
+    }
+
+    vl53l5cx_fast_decode_reset(layout);
+    while ((i + 4U) <= size)
+    {
+        /* Block header word: idx in the upper half, size and type below */
+        uint16_t idx = (uint16_t)(((uint16_t)p_raw[i] << 8) | p_raw[i + 1U]);
+        uint32_t bh_size = ((uint32_t)p_raw[i + 2U] << 4) | ((uint32_t)p_raw[i + 3U] >> 4);
+        uint32_t bh_type = (uint32_t)p_raw[i + 3U] & 0x0FU;
+        uint32_t msize = ((bh_type > 0x1U) && (bh_type < 0xdU)) ? (bh_type * bh_size) : bh_size;
+        uint16_t data_off = (uint16_t)(i + 4U);
+
+        /* The footer runs past the blob, a block that is read must not: the table is truncated or corrupted */
+        if ((i + 4U + msize) > size)
+        {
+            if ((idx == VL53L5CX_METADATA_IDX) || (idx == VL53L5CX_NB_TARGET_DETECTED_IDX) ||
+                (idx == VL53L5CX_RANGE_SIGMA_MM_IDX) || (idx == VL53L5CX_SIGNAL_RATE_IDX) ||
+                (idx == VL53L5CX_DISTANCE_IDX) || (idx == VL53L5CX_TARGET_STATUS_IDX))
+            {
+                vl53l5cx_fast_decode_reset(layout);
+                return VL53L5CX_STATUS_CORRUPTED_FRAME;
+            }
+            break;
+        }
+        switch (idx)
+        {
+        case VL53L5CX_METADATA_IDX:
+            layout->meta_off = data_off;
+            meta_size = msize;
+            break;
+        case VL53L5CX_NB_TARGET_DETECTED_IDX:
+            layout->nb_target_off = data_off;
+            layout->zones = (bh_size > VL53L5CX_RESOLUTION_8X8) ? 0U : (uint8_t)bh_size;
+            nb_target_size = msize;
+            break;
+        case VL53L5CX_RANGE_SIGMA_MM_IDX:
+            layout->sigma_off = data_off;
+            sigma_size = msize;
+            break;
+        case VL53L5CX_SIGNAL_RATE_IDX:
+            layout->signal_off = data_off;
+            signal_size = msize;
+            break;
+        case VL53L5CX_DISTANCE_IDX:
+            layout->distance_off = data_off;
+            distance_size = msize;
+            break;
+        case VL53L5CX_TARGET_STATUS_IDX:
+            layout->status_off = data_off;
+            status_size = msize;
+            break;
+        default:
+            break;
+        }
+        i += 4U + msize;
+    }
+
+    if (layout->distance_off == FAST_DECODE_NO_BLOCK)
+    {
+        return VL53L5CX_STATUS_ERROR;
+    }
+    if (layout->zones == 0U)
+    {
+        /* Without the target count block the distance block tells the resolution */
+        targets = distance_size / (2U * VL53L5CX_NB_TARGET_PER_ZONE);
+        layout->zones = (targets > VL53L5CX_RESOLUTION_8X8) ? (uint8_t)VL53L5CX_RESOLUTION_8X8 : (uint8_t)targets;
+    }
+    targets = (uint32_t)layout->zones * VL53L5CX_NB_TARGET_PER_ZONE;
+    if ((layout->zones == 0U) || !fast_decode_block_fits(layout->distance_off, distance_size, targets * 2U) ||
+        !fast_decode_block_fits(layout->sigma_off, sigma_size, targets * 2U) ||
+        !fast_decode_block_fits(layout->signal_off, signal_size, targets * 4U) ||
+        !fast_decode_block_fits(layout->status_off, status_size, targets) ||
+        !fast_decode_block_fits(layout->nb_target_off, nb_target_size, layout->zones) ||
+        !fast_decode_block_fits(layout->meta_off, meta_size, FAST_DECODE_META_SIZE))
+    {
+        vl53l5cx_fast_decode_reset(layout);
+        return VL53L5CX_STATUS_CORRUPTED_FRAME;
+    }
+
+    layout->size = size;
+    layout->valid = true;
+    return VL53L5CX_STATUS_OK;
+}
+
+uint8_t vl53l5cx_fast_decode(vl53l5cx_fast_layout_t *layout,
+                             const uint8_t *p_raw,
+                             uint32_t size,
+                             vl53l5cx_fast_frame_t *frame)
+{
+    uint32_t targets;
+    uint16_t header_id;
+    uint16_t footer_id;
+
+    if ((layout == NULL) || (p_raw == NULL) || (frame == NULL))
+    {
+        return VL53L5CX_STATUS_INVALID_PARAM;
+    }
+    if (!layout->valid || (layout->size != size))
+    {
+        uint8_t status = vl53l5cx_fast_decode_prepare(layout, p_raw, size);
+        if (status != VL53L5CX_STATUS_OK)
+        {
+            return status;
+        }
+    }
+
+    frame->stream_count = p_raw[0];
+    frame->silicon_temp_degc =
+        (layout->meta_off != FAST_DECODE_NO_BLOCK) ? (int8_t)fast_decode_u8(p_raw, layout->meta_off, 8U) : 0;
+
+    targets = (uint32_t)layout->zones * VL53L5CX_NB_TARGET_PER_ZONE;
+    if ((layout->sigma_off == FAST_DECODE_NO_BLOCK) || (layout->signal_off == FAST_DECODE_NO_BLOCK) ||
+        (layout->status_off == FAST_DECODE_NO_BLOCK) || (layout->nb_target_off == FAST_DECODE_NO_BLOCK))
+    {
+        /* Reduced output configuration, missing fields read as zero */
+        memset(frame->range_sigma_mm, 0, sizeof(frame->range_sigma_mm));
+        memset(frame->signal_per_spad, 0, sizeof(frame->signal_per_spad));
+        memset(frame->target_status, 0, sizeof(frame->target_status));
+        for (uint32_t i = 0U; i < targets; i++)
+        {
+            int16_t distance = (int16_t)fast_decode_u16(p_raw, layout->distance_off, i);
+
+            frame->distance_mm[i] = (distance < 0) ? 0 : (int16_t)(distance >> 2);
+            if (layout->sigma_off != FAST_DECODE_NO_BLOCK)
+            {
+                frame->range_sigma_mm[i] = (uint16_t)(fast_decode_u16(p_raw, layout->sigma_off, i) >> 7);
+            }
+            if (layout->signal_off != FAST_DECODE_NO_BLOCK)
+            {
+                frame->signal_per_spad[i] = fast_decode_signal(p_raw, layout->signal_off, i);
+            }
+            if (layout->status_off != FAST_DECODE_NO_BLOCK)
+            {
+                frame->target_status[i] = fast_decode_u8(p_raw, layout->status_off, i);
+            }
+            if ((layout->nb_target_off != FAST_DECODE_NO_BLOCK) &&
+                (fast_decode_u8(p_raw, layout->nb_target_off, i / VL53L5CX_NB_TARGET_PER_ZONE) == 0U))
+            {
+                frame->target_status[i] = 255U;
+            }
+        }
+    }
+    else
+    {
+        const uint8_t *p_distance = &p_raw[layout->distance_off];
+        const uint8_t *p_sigma = &p_raw[layout->sigma_off];
+        const uint8_t *p_status = &p_raw[layout->status_off];
+        const uint8_t *p_nb_target = &p_raw[layout->nb_target_off];
+
+        for (uint32_t i = 0U; i < targets; i++)
+        {
+            int16_t distance = (int16_t)fast_decode_u16(p_distance, 0U, i);
+            uint8_t detected = fast_decode_u8(p_nb_target, 0U, i / VL53L5CX_NB_TARGET_PER_ZONE);
+
+            frame->distance_mm[i] = (distance < 0) ? 0 : (int16_t)(distance >> 2);
+            frame->range_sigma_mm[i] = (uint16_t)(fast_decode_u16(p_sigma, 0U, i) >> 7);
+            frame->signal_per_spad[i] = fast_decode_signal(p_raw, layout->signal_off, i);
+            frame->target_status[i] = (detected == 0U) ? 255U : fast_decode_u8(p_status, 0U, i);
+        }
+    }
+
+    /* Same header/footer id check as vl53l5cx_decode_ranging_data(), on wire byte order */
+    header_id = (uint16_t)(((uint16_t)p_raw[0xB] << 8) | p_raw[0xA]);
+    footer_id = (uint16_t)(((uint16_t)p_raw[size - 1U] << 8) | p_raw[size - 2U]);
+    return (header_id == footer_id) ? VL53L5CX_STATUS_OK : VL53L5CX_STATUS_CORRUPTED_FRAME;
+}
@@ -0,0 +1,2151 @@
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "background.h"
+#include "bg_store.h"
+#include "classifier.h"
+#include "depth_profile.h"
+#include "flash_sim.h"
+#include "foreground_filter.h"
+#include "frame_log_reader.h"
+#include "line_counter.h"
+#include "presence_logic.h"
+#include "region_counter.h"
+#include "segmentation.h"
+#include "tof_grid.h"
+#include "tof_mask.h"
+#include "tof_process.h"
+#include "tof_profiler.h"
+#include "tracking.h"
+#include "trajectory.h"
+#include "vl53l5cx.h"
+#include "vl53l5cx_fast_decode.h"
+#include "vl53l5cx_sim.h"
+
+#define BENCH_DEFAULT_LOOPS 20U
+#define BENCH_DEFAULT_SYNTH_FRAMES 1000U
+#define BENCH_SYNTH_BG_FRAMES 120U
+#define BENCH_SYNTH_FLOOR_MM 2600
+#define BENCH_SYNTH_HEAD_MM 900
+#define BENCH_SYNTH_BODY_MM 1400
+#define BENCH_STATUS_VALID 5U
+#define BENCH_MIN_COMPONENT_SIZE 2U
+#define BENCH_RANDOM_MASKS 20000U
+/* Background adaptation scene: 12.5 min at 8 Hz */
+#define BENCH_DRIFT_FRAMES 6000U
+#define BENCH_DRIFT_FLOOR_MM 150
+#define BENCH_DRIFT_OBJECT_FRAME 1000U
+#define BENCH_DRIFT_OBJECT_MM 1400
+#define BENCH_DRIFT_WALK_PERIOD 160U
+/* Frames the smoothed count may trail the walker by */
+#define BENCH_DRIFT_LAG_FRAMES 16U
+/* Remote re-calibration of the static model every 3 min at 8 Hz */
+#define BENCH_DRIFT_RECAL_PERIOD 1500U
+/* Sensor remounted 30 cm lower between two boots */
+#define BENCH_STORE_MOVED_MM 300
+#define BENCH_BUSY_FRAMES 2000U
+#define BENCH_BUSY_PERIOD ((TOF_SENSOR_COLS + 4U) * 4U)
+/* Sunlight scene: 5 min at 8 Hz, the sun reaches the floor 30 s in */
+#define BENCH_SUN_FRAMES 2400U
+#define BENCH_SUN_START_FRAME 240U
+/* A glare burst on 1 frame in BENCH_SUN_GLARE_ODDS, closer than the floor by 300..700 mm */
+#define BENCH_SUN_GLARE_ODDS 8U
+#define BENCH_SUN_GLARE_MIN_MM 300
+#define BENCH_SUN_GLARE_SPAN_MM 400U
+/* Tracking scene: 8 min at 8 Hz of walkers crossing on straight paths, a new one on 1 free slot in
+ * BENCH_TRACK_SPAWN_ODDS per frame, once per speed band of s_track_speeds */
+#define BENCH_TRACK_FRAMES 4000U
+#define BENCH_TRACK_MAX_WALKERS 3U
+#define BENCH_TRACK_SPAWN_ODDS 24U
+#define BENCH_TRACK_SPEED_BANDS 3U
+#define BENCH_TRACK_MIN_HEAD_MM 800.0f
+#define BENCH_TRACK_MAX_HEAD_MM 1200.0f
+/* A walker is followed by the closest track within this many zones of its head */
+#define BENCH_TRACK_GATE_ZONES 2.0f
+/* Jumping tracks: two of them, the second renumbered every BENCH_TRAJ_RENUMBER_FRAMES, both jumping across
+ * BENCH_TRAJ_JUMP_SPAN sub-zones every BENCH_TRAJ_JUMP_PERIOD frames and missing 1 frame in BENCH_TRAJ_COAST_ODDS */
+#define BENCH_TRAJ_JUMP_FRAMES 10000U
+#define BENCH_TRAJ_JUMP_PERIOD 7U
+#define BENCH_TRAJ_JUMP_SPAN 3600
+#define BENCH_TRAJ_RENUMBER_FRAMES 300U
+#define BENCH_TRAJ_COAST_ODDS 4U
+#define BENCH_TRAJ_IDS 256U
+#define BENCH_TRAJ_BUFFER_SIZE 1024U
+
+typedef enum
+{
+    BENCH_RECAL_NONE = 0,
+    BENCH_RECAL_RESTART,
+    BENCH_RECAL_REFRESH,
+} bench_recal_t;
+
+/* Where a reset cuts the store of a power cycle short */
+typedef enum
+{
+    BENCH_TEAR_NONE = 0,
+    BENCH_TEAR_WRITE,
+    BENCH_TEAR_ERASE,
+} bench_tear_t;
+
+typedef struct
+{
+    VL53L5CX_ResultsData *frames;
+    uint32_t frame_count;
+} bench_frames_t;
+
+typedef struct
+{
+    uint32_t id; /* 0: slot free */
+    float row;
+    float col;
+    float d_row;
+    float d_col;
+    int32_t head_mm;
+} bench_walker_t;
+
+typedef struct
+{
+    uint32_t id;
+    float row;
+    float col;
+} bench_truth_t;
+
+/* Module state of the checks that drive the modules without a pipeline instance */
+typedef struct
+{
+    bg_state_t bg;
+    track_state_t tracks;
+    line_counter_t lines;
+    region_counter_t regions;
+    classifier_state_t classifier;
+    presence_logic_state_t presence;
+} bench_state_t;
+
+static bench_state_t s_state;
+static tof_pipeline_t s_pipeline;
+static bg_info_t s_bg_snapshot;
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t bench_lcg_next(uint32_t *state)
+{
+    *state = (*state * 1664525U) + 1013904223U;
+    return *state >> 16;
+}
+
+/* Ceiling-mounted scene: a noisy floor plane and, after the background
+ * window, one or two people walking across the grid in opposite directions. */
+static void bench_synth_frame(VL53L5CX_ResultsData *frame, uint32_t index, uint32_t *seed)
+{
+    memset(frame, 0, sizeof(*frame));
+
+    for (uint32_t zone = 0U; zone < (TOF_SENSOR_ZONES); zone++)
+    {
+        uint32_t target = zone * VL53L5CX_NB_TARGET_PER_ZONE;
+        int32_t noise = (int32_t)(bench_lcg_next(seed) % 31U) - 15;
+
+        frame->distance_mm[target] = (int16_t)(BENCH_SYNTH_FLOOR_MM + noise);
+        frame->target_status[target] = BENCH_STATUS_VALID;
+    }
+
+    if (index < BENCH_SYNTH_BG_FRAMES)
+    {
+        return;
+    }
+
+    uint32_t t = index - BENCH_SYNTH_BG_FRAMES;
+    uint32_t walkers = ((t / 64U) % 2U) + 1U;
+
+    for (uint32_t w = 0U; w < walkers; w++)
+    {
+        int32_t step = (int32_t)((t / 4U) % (TOF_SENSOR_COLS + 4U)) - 2;
+        int32_t center_col = (w == 0U) ? step : ((int32_t)TOF_SENSOR_COLS - 1 - step);
+        int32_t center_row = (w == 0U) ? 2 : 5;
+
+        for (int32_t dr = -1; dr <= 1; dr++)
+        {
+            for (int32_t dc = -1; dc <= 1; dc++)
+            {
+                int32_t row = center_row + dr;
+                int32_t col = center_col + dc;
+
+                if ((row < 0) || (row >= (int32_t)TOF_SENSOR_ROWS) || (col < 0) || (col >= (int32_t)TOF_SENSOR_COLS))
+                {
+                    continue;
+                }
+
+                uint32_t target = (uint32_t)((row * (int32_t)TOF_SENSOR_COLS) + col) * VL53L5CX_NB_TARGET_PER_ZONE;
+                int32_t depth = ((dr == 0) && (dc == 0)) ? BENCH_SYNTH_HEAD_MM : BENCH_SYNTH_BODY_MM;
+                frame->distance_mm[target] = (int16_t)(depth + ((int32_t)(bench_lcg_next(seed) % 21U) - 10));
+            }
+        }
+    }
+}
+
+static bool bench_synth_frames(bench_frames_t *set, uint32_t frame_count)
+{
+    uint32_t seed = 0x1234U;
+
+    set->frames = calloc(frame_count, sizeof(VL53L5CX_ResultsData));
+    if (set->frames == NULL)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        bench_synth_frame(&set->frames[i], i, &seed);
+    }
+    set->frame_count = frame_count;
+    return true;
+}
+
+static bool bench_load_frame_log(bench_frames_t *set, const char *path)
+{
+    frame_log_reader_t reader;
+    uint32_t capacity = 0U;
+
+    if (!frame_log_reader_open(&reader, path))
+    {
+        return false;
+    }
+
+    set->frame_count = 0U;
+    for (;;)
+    {
+        if (set->frame_count == capacity)
+        {
+            VL53L5CX_ResultsData *grown;
+
+            capacity = (capacity == 0U) ? 1024U : (capacity * 2U);
+            grown = realloc(set->frames, (size_t)capacity * sizeof(VL53L5CX_ResultsData));
+            if (grown == NULL)
+            {
+                frame_log_reader_close(&reader);
+                return false;
+            }
+            set->frames = grown;
+            memset(&set->frames[set->frame_count], 0,
+                   (size_t)(capacity - set->frame_count) * sizeof(VL53L5CX_ResultsData));
+        }
+        if (!frame_log_reader_next(&reader, &set->frames[set->frame_count], NULL))
+        {
+            break;
+        }
+        set->frame_count++;
+    }
+
+    frame_log_reader_close(&reader);
+    return set->frame_count > 0U;
+}
+
+static bool bench_save_frame_log(const bench_frames_t *set, const char *path)
+{
+    frame_log_writer_t writer;
+    frame_log_config_t config = {
+        .flags = FRAME_LOG_FLAG_DELTA_DISTANCE,
+        .key_interval = 16U,
+        .odr_hz = DISTANCE_ODR,
+    };
+    bool ok = true;
+
+    if (!frame_log_writer_open(&writer, path, &config))
+    {
+        return false;
+    }
+    for (uint32_t i = 0U; (i < set->frame_count) && ok; i++)
+    {
+        ok = frame_log_writer_append(&writer, &set->frames[i], (i * 1000U) / DISTANCE_ODR);
+    }
+    frame_log_writer_close(&writer);
+    return ok;
+}
+
+/* Captures are either frame logs (see frame_log.h) or raw consecutive
+ * VL53L5CX_ResultsData images produced by a firmware built with the same
+ * platform.h output configuration. */
+static bool bench_load_frames(bench_frames_t *set, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t magic[4] = {0};
+    long size;
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    if ((fread(magic, 1U, sizeof(magic), file) == sizeof(magic)) && (memcmp(magic, "TOFL", sizeof(magic)) == 0))
+    {
+        fclose(file);
+        return bench_load_frame_log(set, path);
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if ((size <= 0) || (((size_t)size % sizeof(VL53L5CX_ResultsData)) != 0U))
+    {
+        fprintf(stderr, "%s: size %ld is not a multiple of %zu\n", path, size, sizeof(VL53L5CX_ResultsData));
+        fclose(file);
+        return false;
+    }
+
+    set->frame_count = (uint32_t)((size_t)size / sizeof(VL53L5CX_ResultsData));
+    set->frames = malloc((size_t)size);
+    if ((set->frames == NULL) || (fread(set->frames, 1U, (size_t)size, file) != (size_t)size))
+    {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(file);
+        return false;
+    }
+
+    fclose(file);
+    return true;
+}
+
+/* The stage breakdown comes from the pipeline's own profiler; a timed pass leaves it off */
+static uint64_t bench_run_pipeline(const bench_frames_t *set, uint32_t loops, bool profiling,
+                                   tof_pipeline_output_t *output)
+{
+    uint64_t start_ns;
+
+    tof_pipeline_runtime_init();
+    tof_pipeline_init(&s_pipeline);
+    tof_pipeline_set_profiling(&s_pipeline, profiling);
+    start_ns = bench_now_ns();
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        for (uint32_t i = 0U; i < set->frame_count; i++)
+        {
+            tof_pipeline_process_frame(&s_pipeline, &set->frames[i], output);
+        }
+    }
+    return bench_now_ns() - start_ns;
+}
+
+typedef struct
+{
+    uint16_t filtered_mm[TOF_ROWS][TOF_COLS];
+    uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS];
+    tof_label_t labels[TOF_ROWS][TOF_COLS];
+    tof_component_t components[TOF_MAX_COMPONENTS];
+    uint8_t component_count;
+} bench_seg_result_t;
+
+static bool bench_component_equal(const tof_component_t *a, const tof_component_t *b)
+{
+    return (a->label == b->label) && (a->size == b->size) && (a->box.x1 == b->box.x1) && (a->box.y1 == b->box.y1) &&
+           (a->box.x2 == b->box.x2) && (a->box.y2 == b->box.y2) && (a->min_distance_mm == b->min_distance_mm) &&
+           (a->max_distance_mm == b->max_distance_mm) && (a->second_max_distance_mm == b->second_max_distance_mm) &&
+           tof_mask_equal(a->mask, b->mask);
+}
+
+static bool bench_seg_equal(const bench_seg_result_t *a, const bench_seg_result_t *b)
+{
+    if ((a->component_count != b->component_count) ||
+        (memcmp(a->filtered_mm, b->filtered_mm, sizeof(a->filtered_mm)) != 0) ||
+        (memcmp(a->pixel_distance_bg_mm, b->pixel_distance_bg_mm, sizeof(a->pixel_distance_bg_mm)) != 0) ||
+        (memcmp(a->labels, b->labels, sizeof(a->labels)) != 0))
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0U; i < a->component_count; i++)
+    {
+        if (!bench_component_equal(&a->components[i], &b->components[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void bench_seg_separate(const tof_frame_t *frame, bench_seg_result_t *out)
+{
+    fg_filter_apply(frame, bg_get_info(&s_state.bg), out->filtered_mm, out->pixel_distance_bg_mm);
+    seg_clear_labels(out->labels);
+    out->component_count = seg_label_components(out->filtered_mm, out->labels, out->components, TOF_MAX_COMPONENTS,
+                                                BENCH_MIN_COMPONENT_SIZE);
+}
+
+static void bench_seg_fused(const tof_frame_t *frame, bench_seg_result_t *out)
+{
+    out->component_count = fg_filter_segment(frame, bg_get_info(&s_state.bg), out->filtered_mm,
+                                             out->pixel_distance_bg_mm, out->labels, out->components,
+                                             TOF_MAX_COMPONENTS, BENCH_MIN_COMPONENT_SIZE);
+}
+
+/* Random masks with larger minimum sizes and a small component limit, to
+ * exercise rejected components and the limit the captures rarely hit. */
+static uint32_t bench_check_random_masks(void)
+{
+    uint32_t seed = 0xC0FFEEU;
+    uint32_t mismatches = 0U;
+
+    for (uint32_t n = 0U; n < BENCH_RANDOM_MASKS; n++)
+    {
+        uint16_t mask[TOF_ROWS][TOF_COLS];
+        bench_seg_result_t separate;
+        bench_seg_result_t uf;
+        seg_uf_t state;
+        uint8_t min_size = (uint8_t)(1U + (n % 5U));
+        uint8_t max_components = (uint8_t)(1U + (n % TOF_MAX_COMPONENTS));
+        uint32_t density = 20U + (n % 50U);
+
+        memset(&separate, 0, sizeof(separate));
+        memset(&uf, 0, sizeof(uf));
+        for (uint8_t row = 0U; row < TOF_ROWS; row++)
+        {
+            for (uint8_t col = 0U; col < TOF_COLS; col++)
+            {
+                mask[row][col] =
+                    ((bench_lcg_next(&seed) % 100U) < density) ? (uint16_t)(1U + (bench_lcg_next(&seed) % 8U)) : 0U;
+            }
+        }
+
+        seg_clear_labels(separate.labels);
+        separate.component_count =
+            seg_label_components(mask, separate.labels, separate.components, max_components, min_size);
+        seg_uf_begin(&state, uf.labels);
+        for (uint8_t row = 0U; row < TOF_ROWS; row++)
+        {
+            for (uint8_t col = 0U; col < TOF_COLS; col++)
+            {
+                seg_uf_add_pixel(&state, uf.labels, row, col, mask[row][col]);
+            }
+        }
+        uf.component_count = seg_uf_finish(&state, uf.labels, uf.components, max_components, min_size);
+
+        if (!bench_seg_equal(&separate, &uf))
+        {
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+/* Checks fg_filter_segment() against fg_filter_apply() + seg_label_components()
+ * on every frame after the background window, then times both. */
+static bool bench_run_segmentation_check(const bench_frames_t *set, uint32_t loops)
+{
+    bench_seg_result_t separate;
+    bench_seg_result_t fused;
+    uint32_t compared = 0U;
+    uint32_t mismatches = 0U;
+    uint32_t random_mismatches;
+    uint64_t separate_ns = 0U;
+    uint64_t fused_ns = 0U;
+    uint64_t timed = 0U;
+    tof_frame_t *grids = calloc(set->frame_count, sizeof(tof_frame_t));
+
+    if (grids == NULL)
+    {
+        return false;
+    }
+    for (uint32_t i = 0U; i < set->frame_count; i++)
+    {
+        tof_grid_clear(&grids[i]);
+        (void)tof_grid_load_tile(&grids[i], 0U, &set->frames[i]);
+    }
+
+    memset(&separate, 0, sizeof(separate));
+    memset(&fused, 0, sizeof(fused));
+    bg_init(&s_state.bg, NULL);
+    for (uint32_t i = 0U; i < set->frame_count; i++)
+    {
+        if (bg_update(&s_state.bg, &grids[i]))
+        {
+            continue;
+        }
+
+        bench_seg_separate(&grids[i], &separate);
+        bench_seg_fused(&grids[i], &fused);
+        compared++;
+        if (!bench_seg_equal(&separate, &fused))
+        {
+            if (mismatches == 0U)
+            {
+                fprintf(stderr, "first mismatch at frame %u\n", i);
+            }
+            mismatches++;
+        }
+    }
+
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        for (uint32_t i = set->frame_count - compared; i < set->frame_count; i++)
+        {
+            uint64_t start_ns = bench_now_ns();
+            bench_seg_separate(&grids[i], &separate);
+            separate_ns += bench_now_ns() - start_ns;
+
+            start_ns = bench_now_ns();
+            bench_seg_fused(&grids[i], &fused);
+            fused_ns += bench_now_ns() - start_ns;
+            timed++;
+        }
+    }
+
+    free(grids);
+
+    random_mismatches = bench_check_random_masks();
+    printf("segmentation: %u frames compared, %u mismatching; %u random masks, %u mismatching\n", compared,
+           mismatches, BENCH_RANDOM_MASKS, random_mismatches);
+    if (timed > 0U)
+    {
+        printf("%-14s %12s\n", "kernel", "ns/frame");
+        printf("%-14s %12llu\n", "fg+bitboard", (unsigned long long)(separate_ns / timed));
+        printf("%-14s %12llu\n", "fused_uf", (unsigned long long)(fused_ns / timed));
+    }
+
+    return (mismatches == 0U) && (random_mismatches == 0U);
+}
+
+/*
+ * Slow drift of the whole floor (sunlight, temperature), a person-sized
+ * object that is put down at BENCH_DRIFT_OBJECT_FRAME and stays, and one
+ * person crossing the grid every BENCH_DRIFT_WALK_PERIOD frames. Returns
+ * whether the person is in view.
+ */
+static bool bench_drift_frame(VL53L5CX_ResultsData *frame, uint32_t index, uint32_t *seed)
+{
+    int32_t floor_mm = BENCH_SYNTH_FLOOR_MM - (int32_t)((BENCH_DRIFT_FLOOR_MM * index) / BENCH_DRIFT_FRAMES);
+    uint32_t t = index % BENCH_DRIFT_WALK_PERIOD;
+    int32_t walker_col = (int32_t)(t / 4U) - 2;
+    bool visible = (index >= BENCH_SYNTH_BG_FRAMES) && (walker_col >= 0) && (walker_col < (int32_t)TOF_SENSOR_COLS);
+
+    memset(frame, 0, sizeof(*frame));
+    for (uint32_t row = 0U; row < TOF_SENSOR_ROWS; row++)
+    {
+        for (uint32_t col = 0U; col < TOF_SENSOR_COLS; col++)
+        {
+            uint32_t target = ((row * TOF_SENSOR_COLS) + col) * VL53L5CX_NB_TARGET_PER_ZONE;
+            int32_t depth = floor_mm;
+            int32_t noise = (int32_t)(bench_lcg_next(seed) % 31U) - 15;
+
+            /* Object in the bottom-right corner, clear of the walker's lane */
+            if ((index >= BENCH_DRIFT_OBJECT_FRAME) && (row + 3U >= TOF_SENSOR_ROWS) && (col + 3U >= TOF_SENSOR_COLS))
+            {
+                depth = BENCH_DRIFT_OBJECT_MM;
+            }
+            if ((index >= BENCH_SYNTH_BG_FRAMES) && (row <= 2U) && ((int32_t)col >= walker_col - 1) &&
+                ((int32_t)col <= walker_col + 1))
+            {
+                depth = ((row == 1U) && ((int32_t)col == walker_col)) ? BENCH_SYNTH_HEAD_MM : BENCH_SYNTH_BODY_MM;
+            }
+            frame->distance_mm[target] = (int16_t)(depth + noise);
+            frame->target_status[target] = BENCH_STATUS_VALID;
+        }
+    }
+    return visible;
+}
+
+/* Runs the drift scene through a pipeline with the given background config,
+ * re-calibrated every BENCH_DRIFT_RECAL_PERIOD frames unless recal is
+ * BENCH_RECAL_NONE. A phantom frame reports more people than are in view. */
+static void bench_drift_run(const char *name, const bg_config_t *config, bench_recal_t recal)
+{
+    VL53L5CX_ResultsData frame;
+    tof_pipeline_output_t output;
+    uint32_t seed = 0x5EEDU;
+    uint32_t blind = 0U;
+    uint32_t phantom = 0U;
+    uint32_t crossings = 0U;
+    uint32_t last_visible = 0U;
+    bool was_visible = false;
+
+    tof_pipeline_init(&s_pipeline);
+    tof_pipeline_set_background_config(&s_pipeline, config);
+    for (uint32_t i = 0U; i < BENCH_DRIFT_FRAMES; i++)
+    {
+        bool visible = bench_drift_frame(&frame, i, &seed);
+        uint32_t expected;
+
+        if (visible)
+        {
+            last_visible = i;
+        }
+        else if (was_visible)
+        {
+            crossings++;
+        }
+        was_visible = visible;
+
+        if ((recal != BENCH_RECAL_NONE) && (i > 0U) && ((i % BENCH_DRIFT_RECAL_PERIOD) == 0U))
+        {
+            if (recal == BENCH_RECAL_RESTART)
+            {
+                tof_pipeline_restart_background(&s_pipeline);
+            }
+            else
+            {
+                tof_pipeline_refresh_background(&s_pipeline);
+            }
+        }
+        tof_pipeline_process_frame(&s_pipeline, &frame, &output);
+        if (output.background_collecting)
+        {
+            blind++;
+            continue;
+        }
+        expected = (visible || ((i - last_visible) <= BENCH_DRIFT_LAG_FRAMES)) ? 1U : 0U;
+        phantom += (output.smoothed_people_count > expected) ? 1U : 0U;
+    }
+
+    printf("%-10s %10u %10u %9.1f%% %6u %6u %10u\n", name, blind, phantom,
+           100.0 * (double)phantom / (double)(BENCH_DRIFT_FRAMES - blind), output.people.people_in,
+           output.people.people_out, crossings);
+}
+
+/* Lobby that is never empty: two people cross the grid in opposite lanes
+ * from the first frame on, half a crossing apart. Returns a bit per person
+ * in view. */
+static uint32_t bench_busy_frame(VL53L5CX_ResultsData *frame, uint32_t index, uint32_t *seed)
+{
+    uint32_t visible = 0U;
+
+    memset(frame, 0, sizeof(*frame));
+    for (uint32_t zone = 0U; zone < TOF_SENSOR_ZONES; zone++)
+    {
+        uint32_t target = zone * VL53L5CX_NB_TARGET_PER_ZONE;
+
+        frame->distance_mm[target] = (int16_t)(BENCH_SYNTH_FLOOR_MM + ((int32_t)(bench_lcg_next(seed) % 31U) - 15));
+        frame->target_status[target] = BENCH_STATUS_VALID;
+    }
+
+    for (uint32_t w = 0U; w < 2U; w++)
+    {
+        uint32_t t = (index + (w * (BENCH_BUSY_PERIOD / 2U))) % BENCH_BUSY_PERIOD;
+        int32_t step = (int32_t)(t / 4U) - 2;
+        int32_t center_col = (w == 0U) ? step : ((int32_t)TOF_SENSOR_COLS - 1 - step);
+        int32_t center_row = (w == 0U) ? (int32_t)(TOF_SENSOR_ROWS / 4U) : (int32_t)((3U * TOF_SENSOR_ROWS) / 4U);
+
+        if ((center_col >= 0) && (center_col < (int32_t)TOF_SENSOR_COLS))
+        {
+            visible |= 1U << w;
+        }
+        for (int32_t row = center_row - 1; row <= center_row + 1; row++)
+        {
+            for (int32_t col = center_col - 1; col <= center_col + 1; col++)
+            {
+                uint32_t target;
+
+                if ((row < 0) || (row >= (int32_t)TOF_SENSOR_ROWS) || (col < 0) || (col >= (int32_t)TOF_SENSOR_COLS))
+                {
+                    continue;
+                }
+                target = (uint32_t)((row * (int32_t)TOF_SENSOR_COLS) + col) * VL53L5CX_NB_TARGET_PER_ZONE;
+                frame->distance_mm[target] =
+                    (int16_t)((((row == center_row) && (col == center_col)) ? BENCH_SYNTH_HEAD_MM : BENCH_SYNTH_BODY_MM) +
+                              ((int32_t)(bench_lcg_next(seed) % 21U) - 10));
+            }
+        }
+    }
+    return visible;
+}
+
+/* Largest distance between the learnt background and the floor, and the zones further off than the threshold floor */
+static uint32_t bench_busy_error(uint32_t *zones_off)
+{
+    const bg_info_t *info = tof_pipeline_get_background(&s_pipeline);
+    uint32_t worst_mm = 0U;
+
+    *zones_off = 0U;
+    for (uint32_t row = 0U; row < TOF_ROWS; row++)
+    {
+        for (uint32_t col = 0U; col < TOF_COLS; col++)
+        {
+            int32_t error = (int32_t)info->mean[row][col] - BENCH_SYNTH_FLOOR_MM;
+            uint32_t error_mm = (uint32_t)((error < 0) ? -error : error);
+
+            worst_mm = (error_mm > worst_mm) ? error_mm : worst_mm;
+            *zones_off += (error_mm > BG_THRESHOLD_MIN_MM) ? 1U : 0U;
+        }
+    }
+    return worst_mm;
+}
+
+/* Runs the busy scene with the given background config and reports how far
+ * the background lies from the floor once learnt and at the end, and what
+ * was counted. */
+static void bench_busy_run(const char *name, const bg_config_t *config)
+{
+    VL53L5CX_ResultsData frame;
+    tof_pipeline_output_t output;
+    uint32_t seed = 0xB05BU;
+    uint32_t crossings = 0U;
+    uint32_t was_visible = 0U;
+    uint32_t learnt_mm = 0U;
+    uint32_t zones_off = 0U;
+    uint32_t final_mm;
+    uint32_t final_off;
+
+    tof_pipeline_init(&s_pipeline);
+    tof_pipeline_set_background_config(&s_pipeline, config);
+    for (uint32_t i = 0U; i < BENCH_BUSY_FRAMES; i++)
+    {
+        uint32_t visible = bench_busy_frame(&frame, i, &seed);
+
+        crossings += (uint32_t)__builtin_popcount(was_visible & ~visible);
+        was_visible = visible;
+        tof_pipeline_process_frame(&s_pipeline, &frame, &output);
+        if (output.background_learnt)
+        {
+            learnt_mm = bench_busy_error(&zones_off);
+        }
+    }
+    final_mm = bench_busy_error(&final_off);
+
+    printf("%-16s %8u %8u %8u %8u %6u %6u %10u\n", name, learnt_mm, zones_off, final_mm, final_off,
+           output.people.people_in, output.people.people_out, crossings);
+}
+
+static void bench_run_background_check(void)
+{
+    bg_config_t config;
+
+    tof_pipeline_runtime_init();
+    printf("background: %u frames, floor drifts %d mm, object put down at frame %u\n", BENCH_DRIFT_FRAMES,
+           -BENCH_DRIFT_FLOOR_MM, BENCH_DRIFT_OBJECT_FRAME);
+    printf("restart / refresh: the static model re-calibrated every %u frames by a restart or a refresh\n",
+           BENCH_DRIFT_RECAL_PERIOD);
+    printf("%-10s %10s %10s %10s %6s %6s %10s\n", "model", "blind", "phantom", "", "in", "out", "crossings");
+
+    bg_default_config(&config);
+    config.adaptive = false;
+    config.collect_frames = BG_DEFAULT_FRAMES;
+    bench_drift_run("static", &config, BENCH_RECAL_NONE);
+    bench_drift_run("restart", &config, BENCH_RECAL_RESTART);
+    bench_drift_run("refresh", &config, BENCH_RECAL_REFRESH);
+
+    bg_default_config(&config);
+    config.adaptive = true;
+    config.collect_frames = BG_ADAPTIVE_FRAMES;
+    bench_drift_run("adaptive", &config, BENCH_RECAL_NONE);
+
+    printf("\nbusy calibration: %u frames, two people crossing from the first frame on\n", BENCH_BUSY_FRAMES);
+    printf("background error against the floor in mm, and zones off by more than %u mm\n", BG_THRESHOLD_MIN_MM);
+    printf("%-16s %8s %8s %8s %8s %6s %6s %10s\n", "estimator", "learnt", "off", "final", "off", "in", "out",
+           "crossings");
+    for (uint32_t adaptive = 0U; adaptive < 2U; adaptive++)
+    {
+        /* The median estimator is only built in with TOF_BG_MEDIAN */
+        for (uint32_t median = 0U; median <= (uint32_t)TOF_BG_MEDIAN; median++)
+        {
+            char name[32];
+
+            bg_default_config(&config);
+            config.adaptive = (adaptive != 0U);
+            config.collect_frames = config.adaptive ? BG_ADAPTIVE_FRAMES : BG_DEFAULT_FRAMES;
+            config.estimator = (median != 0U) ? BG_ESTIMATOR_MEDIAN : BG_ESTIMATOR_MEAN;
+            snprintf(name, sizeof(name), "%s %s", (median != 0U) ? "median" : "mean",
+                     config.adaptive ? "adaptive" : "static");
+            bench_busy_run(name, &config);
+        }
+    }
+}
+
+#if TOF_QUALITY
+static bool bench_sun_zone(uint32_t index, uint32_t row, uint32_t col)
+{
+    return (index >= BENCH_SUN_START_FRAME) && (row >= 2U) && (col >= (TOF_SENSOR_COLS / 2U));
+}
+
+/* The walker's lane of the drift scene under a sunlit patch of floor: its
+ * zones range with a larger spread and a weaker return, and now and then a
+ * 2x2 glare spot reads well short of the floor. Sigma and signal rate come
+ * out as the sensor would report them, or as 0 with strip set. Returns
+ * whether the walker is in view. */
+static bool bench_sun_frame(VL53L5CX_ResultsData *frame, uint32_t index, uint32_t *seed, bool strip)
+{
+    uint32_t t = index % BENCH_DRIFT_WALK_PERIOD;
+    int32_t walker_col = (int32_t)(t / 4U) - 2;
+    bool glare = (index >= BENCH_SUN_START_FRAME) && ((bench_lcg_next(seed) % BENCH_SUN_GLARE_ODDS) == 0U);
+    uint32_t glare_row = 2U + (bench_lcg_next(seed) % (TOF_SENSOR_ROWS - 3U));
+    uint32_t glare_col = (TOF_SENSOR_COLS / 2U) + (bench_lcg_next(seed) % ((TOF_SENSOR_COLS / 2U) - 1U));
+
+    memset(frame, 0, sizeof(*frame));
+    for (uint32_t row = 0U; row < TOF_SENSOR_ROWS; row++)
+    {
+        for (uint32_t col = 0U; col < TOF_SENSOR_COLS; col++)
+        {
+            uint32_t target = ((row * TOF_SENSOR_COLS) + col) * VL53L5CX_NB_TARGET_PER_ZONE;
+            bool sunlit = bench_sun_zone(index, row, col);
+            bool walker = (row <= 2U) && ((int32_t)col >= walker_col - 1) && ((int32_t)col <= walker_col + 1);
+            int32_t depth = BENCH_SYNTH_FLOOR_MM;
+            uint32_t sigma = 5U + (bench_lcg_next(seed) % 6U);
+            uint32_t signal = 20U;
+            int32_t noise = (int32_t)(bench_lcg_next(seed) % 31U) - 15;
+
+            if (walker)
+            {
+                depth = ((row == 1U) && ((int32_t)col == walker_col)) ? BENCH_SYNTH_HEAD_MM : BENCH_SYNTH_BODY_MM;
+                sigma += sunlit ? 15U : 0U;
+            }
+            else if (glare && (row >= glare_row) && (row <= glare_row + 1U) && (col >= glare_col) &&
+                     (col <= glare_col + 1U))
+            {
+                depth -= BENCH_SUN_GLARE_MIN_MM + (int32_t)(bench_lcg_next(seed) % BENCH_SUN_GLARE_SPAN_MM);
+                sigma = 60U + (bench_lcg_next(seed) % 30U);
+                signal = 1U;
+            }
+            else if (sunlit)
+            {
+                noise = (int32_t)(bench_lcg_next(seed) % 121U) - 60;
+                sigma = 35U + (bench_lcg_next(seed) % 20U);
+                signal = 3U;
+            }
+            frame->distance_mm[target] = (int16_t)(depth + noise);
+            frame->target_status[target] = BENCH_STATUS_VALID;
+            frame->range_sigma_mm[target] = strip ? 0U : (uint16_t)sigma;
+            frame->signal_per_spad[target] = strip ? 0U : signal;
+        }
+    }
+    return (walker_col >= 0) && (walker_col < (int32_t)TOF_SENSOR_COLS);
+}
+
+/* Runs the sunlight scene with the quality fields recorded or stripped. A
+ * phantom frame reports more people than are in view. */
+static void bench_sun_run(const char *name, bool strip)
+{
+    VL53L5CX_ResultsData frame;
+    tof_pipeline_output_t output;
+    uint32_t seed = 0x5017U;
+    uint32_t blind = 0U;
+    uint32_t phantom = 0U;
+    uint32_t crossings = 0U;
+    uint32_t last_visible = 0U;
+    bool was_visible = false;
+
+    tof_pipeline_init(&s_pipeline);
+    for (uint32_t i = 0U; i < BENCH_SUN_FRAMES; i++)
+    {
+        bool visible = bench_sun_frame(&frame, i, &seed, strip);
+        uint32_t expected;
+
+        if (visible)
+        {
+            last_visible = i;
+        }
+        else if (was_visible)
+        {
+            crossings++;
+        }
+        was_visible = visible;
+
+        tof_pipeline_process_frame(&s_pipeline, &frame, &output);
+        if (output.background_collecting)
+        {
+            blind++;
+            continue;
+        }
+        expected = (visible || ((i - last_visible) <= BENCH_DRIFT_LAG_FRAMES)) ? 1U : 0U;
+        phantom += (output.smoothed_people_count > expected) ? 1U : 0U;
+    }
+
+    printf("%-10s %10u %10u %9.1f%% %6u %6u %10u\n", name, blind, phantom,
+           100.0 * (double)phantom / (double)(BENCH_SUN_FRAMES - blind), output.people.people_in,
+           output.people.people_out, crossings);
+}
+#endif
+
+/* The same sunlit scene with and without range_sigma_mm / signal_per_spad */
+static void bench_run_quality_check(void)
+{
+#if TOF_QUALITY
+    tof_pipeline_runtime_init();
+    printf("sunlight: %u frames, a patch of floor sunlit from frame %u, glare on 1 frame in %u\n",
+           BENCH_SUN_FRAMES, BENCH_SUN_START_FRAME, BENCH_SUN_GLARE_ODDS);
+    printf("%-10s %10s %10s %10s %6s %6s %10s\n", "quality", "blind", "phantom", "", "in", "out", "crossings");
+    bench_sun_run("stripped", true);
+    bench_sun_run("weighted", false);
+#else
+    printf("built with TOF_QUALITY=OFF, the sensor reports no sigma or signal rate\n");
+#endif
+}
+
+/* One power cycle: load the stored background, run the frame set with every
+ * distance shifted by offset_mm and store the background once learnt, cut
+ * short by a reset in the write or erase tear names. */
+static void bench_store_boot(const char *name, const bench_frames_t *set, int32_t offset_mm, bench_tear_t tear)
+{
+    VL53L5CX_ResultsData frame;
+    tof_pipeline_output_t output;
+    bool loaded;
+    bool saved = false;
+    uint32_t blind = 0U;
+    uint32_t erases = flash_sim_erase_count();
+    uint32_t ecc_errors = flash_sim_ecc_errors();
+
+    tof_pipeline_init(&s_pipeline);
+    loaded = bg_store_load(&s_bg_snapshot);
+    if (loaded)
+    {
+        tof_pipeline_restore_background(&s_pipeline, &s_bg_snapshot);
+    }
+
+    memset(&output, 0, sizeof(output));
+    for (uint32_t i = 0U; i < set->frame_count; i++)
+    {
+        frame = set->frames[i];
+        for (uint32_t zone = 0U; zone < TOF_SENSOR_ZONES; zone++)
+        {
+            frame.distance_mm[zone * VL53L5CX_NB_TARGET_PER_ZONE] += (int16_t)offset_mm;
+        }
+
+        tof_pipeline_process_frame(&s_pipeline, &frame, &output);
+        blind += output.background_collecting ? 1U : 0U;
+        if (output.background_learnt)
+        {
+            if (tear == BENCH_TEAR_WRITE)
+            {
+                flash_sim_tear_next_write(1U);
+            }
+            else if (tear == BENCH_TEAR_ERASE)
+            {
+                flash_sim_tear_next_erase();
+            }
+            saved = bg_store_save(tof_pipeline_get_background(&s_pipeline));
+        }
+    }
+
+    printf("%-10s %8s %8u %6u %6u %8s %8u %8u\n", name, loaded ? "yes" : "no", blind, output.people.people_in,
+           output.people.people_out, saved ? "yes" : "no", flash_sim_erase_count() - erases,
+           flash_sim_ecc_errors() - ecc_errors);
+}
+
+/* Power cycles against the file-backed flash store: a cold start, a warm
+ * start on the same scene, a store torn by a reset, a changed scene whose
+ * erase is torn, leaving quad-words that fail their ECC, and the boots that
+ * recover from both. */
+static bool bench_run_store_check(const bench_frames_t *set, const char *store_path)
+{
+    if (!flash_sim_open(store_path) || !bsp_flash_store_erase())
+    {
+        fprintf(stderr, "cannot open flash store %s\n", store_path);
+        return false;
+    }
+
+    tof_pipeline_runtime_init();
+    printf("flash store %s, fingerprint %08x, %u frames per boot\n", store_path, bg_store_fingerprint(),
+           set->frame_count);
+    printf("%-10s %8s %8s %6s %6s %8s %8s %8s\n", "boot", "loaded", "blind", "in", "out", "stored", "erases",
+           "ecc");
+    bench_store_boot("cold", set, 0, BENCH_TEAR_NONE);
+    bench_store_boot("warm", set, 0, BENCH_TEAR_NONE);
+    bench_store_boot("warm", set, 0, BENCH_TEAR_NONE);
+    (void)bsp_flash_store_erase();
+    bench_store_boot("torn", set, 0, BENCH_TEAR_WRITE);
+    bench_store_boot("after", set, 0, BENCH_TEAR_NONE);
+    bench_store_boot("moved", set, BENCH_STORE_MOVED_MM, BENCH_TEAR_ERASE);
+    bench_store_boot("after", set, BENCH_STORE_MOVED_MM, BENCH_TEAR_NONE);
+    bench_store_boot("warm", set, BENCH_STORE_MOVED_MM, BENCH_TEAR_NONE);
+    flash_sim_close();
+    return true;
+}
+
+/* Without the sigma or signal output the fast decoder leaves that field at 0 */
+static bool bench_quality_equal(const vl53l5cx_fast_frame_t *fast, const VL53L5CX_ResultsData *reference)
+{
+    bool equal = true;
+
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+    equal = equal && (memcmp(fast->range_sigma_mm, reference->range_sigma_mm, sizeof(fast->range_sigma_mm)) == 0);
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+    equal = equal && (memcmp(fast->signal_per_spad, reference->signal_per_spad, sizeof(fast->signal_per_spad)) == 0);
+#endif
+    (void)fast;
+    (void)reference;
+    return equal;
+}
+
+static bool bench_block_within(uint16_t off, uint32_t bytes, uint32_t size)
+{
+    return (off == 0U) || ((off + bytes) <= size);
+}
+
+/* Layouts vl53l5cx_fast_decode_prepare() accepts from blob cut short at every word, or with one block header's size
+ * corrupted, that point past the bytes they were given */
+static uint32_t bench_decode_overruns(const uint8_t *blob, uint32_t size)
+{
+    static uint8_t damaged[VL53L5CX_MAX_RESULTS_SIZE];
+    vl53l5cx_fast_layout_t layout;
+    uint32_t overruns = 0U;
+
+    for (uint32_t cut = 4U; cut <= (2U * size); cut += 4U)
+    {
+        uint32_t length = (cut <= size) ? cut : size;
+
+        memcpy(damaged, blob, size);
+        /* Past the cuts, the header word at cut - size gets its size field set to the maximum */
+        if ((cut > size) && ((cut - size + 4U) <= size))
+        {
+            damaged[cut - size + 2U] = 0xFFU;
+            damaged[cut - size + 3U] |= 0xF0U;
+        }
+        if (vl53l5cx_fast_decode_prepare(&layout, damaged, length) != VL53L5CX_STATUS_OK)
+        {
+            continue;
+        }
+
+        uint32_t targets = (uint32_t)layout.zones * VL53L5CX_NB_TARGET_PER_ZONE;
+        if ((targets > VL53L5CX_FAST_TARGETS) || !bench_block_within(layout.distance_off, targets * 2U, length) ||
+            !bench_block_within(layout.sigma_off, targets * 2U, length) ||
+            !bench_block_within(layout.signal_off, targets * 4U, length) ||
+            !bench_block_within(layout.status_off, targets, length) ||
+            !bench_block_within(layout.nb_target_off, layout.zones, length) ||
+            !bench_block_within(layout.meta_off, 12U, length))
+        {
+            overruns++;
+        }
+    }
+    return overruns;
+}
+
+/* Encodes the frame set into the blobs the sensor streams and times
+ * vl53l5cx_decode_ranging_data() against vl53l5cx_fast_decode() on them. The
+ * reference decoder swaps the blob in place, so each of its runs starts from
+ * a copy; the cost of that copy is measured separately and subtracted. */
+static bool bench_run_decode(const bench_frames_t *set, uint32_t loops)
+{
+    static uint8_t scratch[VL53L5CX_MAX_RESULTS_SIZE] __attribute__((aligned(4)));
+    vl53l5cx_fast_layout_t layout;
+    vl53l5cx_fast_frame_t fast;
+    VL53L5CX_ResultsData reference;
+    uint8_t *blobs;
+    uint32_t size;
+    uint32_t mismatches = 0U;
+    uint32_t overruns;
+    uint64_t copy_ns;
+    uint64_t reference_ns;
+    uint64_t fast_ns;
+    uint64_t start_ns;
+    uint64_t total_frames = (uint64_t)set->frame_count * loops;
+    volatile uint32_t sink = 0U;
+
+    vl53l5_sim_init();
+    size = vl53l5_read_size();
+    blobs = malloc((size_t)set->frame_count * size);
+    if (blobs == NULL)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0U; i < set->frame_count; i++)
+    {
+        VL53L5CX_ResultsData frame = set->frames[i];
+
+        for (uint32_t zone = 0U; zone < VL53L5CX_RESOLUTION_8X8; zone++)
+        {
+            frame.nb_target_detected[zone] = (frame.target_status[zone * VL53L5CX_NB_TARGET_PER_ZONE] == 255U) ? 0U : 1U;
+        }
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+        /* Synthetic frames and captures without it get a signal, so that the comparison covers it */
+        for (uint32_t t = 0U; t < VL53L5CX_FAST_TARGETS; t++)
+        {
+            if (frame.signal_per_spad[t] == 0U)
+            {
+                frame.signal_per_spad[t] = ((i * 977U) + (t * 131U)) & 0xFFFFU;
+            }
+        }
+#endif
+        vl53l5_sim_quantize(&frame);
+        (void)vl53l5_sim_encode(&frame, (uint8_t)i, &blobs[(size_t)i * size]);
+    }
+
+    memset(&reference, 0, sizeof(reference));
+    vl53l5cx_fast_decode_reset(&layout);
+    for (uint32_t i = 0U; i < set->frame_count; i++)
+    {
+        const uint8_t *blob = &blobs[(size_t)i * size];
+
+        memcpy(scratch, blob, size);
+        if (!vl53l5_decode(0U, scratch, &reference) || (vl53l5cx_fast_decode(&layout, blob, size, &fast) != 0U) ||
+            (memcmp(fast.distance_mm, reference.distance_mm, sizeof(fast.distance_mm)) != 0) ||
+            !bench_quality_equal(&fast, &reference) ||
+            (memcmp(fast.target_status, reference.target_status, sizeof(fast.target_status)) != 0) ||
+            (fast.silicon_temp_degc != reference.silicon_temp_degc))
+        {
+            mismatches++;
+        }
+    }
+
+    start_ns = bench_now_ns();
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        for (uint32_t i = 0U; i < set->frame_count; i++)
+        {
+            memcpy(scratch, &blobs[(size_t)i * size], size);
+            sink += scratch[i % size];
+        }
+    }
+    copy_ns = bench_now_ns() - start_ns;
+
+    start_ns = bench_now_ns();
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        for (uint32_t i = 0U; i < set->frame_count; i++)
+        {
+            memcpy(scratch, &blobs[(size_t)i * size], size);
+            (void)vl53l5_decode(0U, scratch, &reference);
+            sink += (uint32_t)reference.distance_mm[i % VL53L5CX_RESOLUTION_8X8];
+        }
+    }
+    reference_ns = bench_now_ns() - start_ns;
+    reference_ns = (reference_ns > copy_ns) ? (reference_ns - copy_ns) : 0U;
+
+    start_ns = bench_now_ns();
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        for (uint32_t i = 0U; i < set->frame_count; i++)
+        {
+            (void)vl53l5cx_fast_decode(&layout, &blobs[(size_t)i * size], size, &fast);
+            sink += (uint32_t)fast.distance_mm[i % VL53L5CX_RESOLUTION_8X8];
+        }
+    }
+    fast_ns = bench_now_ns() - start_ns;
+    (void)sink;
+
+    printf("decode: %u frames x %u loops, %u byte blobs\n", set->frame_count, loops, size);
+    printf("%-14s %12s\n", "decoder", "ns/frame");
+    printf("%-14s %12llu\n", "uld", (unsigned long long)(reference_ns / total_frames));
+    printf("%-14s %12llu\n", "fast", (unsigned long long)(fast_ns / total_frames));
+    printf("speedup: %.1fx, mismatching frames: %u\n", (double)reference_ns / (double)((fast_ns > 0U) ? fast_ns : 1U),
+           mismatches);
+    overruns = bench_decode_overruns(blobs, size);
+    printf("truncated or corrupted block tables read past the blob: %u\n", overruns);
+
+    free(blobs);
+    return (mismatches == 0U) && (overruns == 0U);
+}
+
+/* One frame of the tracking replay: the components the pipeline hands
+ * track_update(), and the walkers actually in view when the scene is
+ * synthetic. */
+typedef struct
+{
+    tof_component_t components[TOF_MAX_COMPONENTS];
+    uint8_t component_count;
+    bool collecting;
+    bench_truth_t truth[BENCH_TRACK_MAX_WALKERS];
+    uint8_t truth_count;
+} bench_track_frame_t;
+
+typedef struct
+{
+    uint64_t total_ns;
+    uint64_t calls;
+    uint32_t tracks_created;
+    uint32_t id_switches;
+    uint32_t followed;
+    uint16_t people_in;
+    uint16_t people_out;
+    uint16_t line_in;
+    uint16_t line_out;
+    uint16_t region_entries;
+    uint32_t region_occupied;
+} bench_track_result_t;
+
+/* What the synthetic walkers did: crossings of s_track_line down the rows then up, entries into s_track_region and
+ * walker-frames in it */
+typedef struct
+{
+    uint32_t walkers;
+    uint32_t crossings[2];
+    uint32_t entries;
+    uint32_t occupied;
+} bench_track_truth_t;
+
+static const char *const s_matcher_names[] = {"greedy", "optimal"};
+static const char *const s_motion_names[] = {"static", "ab"};
+/* Walker speeds of each synthetic scene, in zones per frame */
+static const float s_track_speeds[BENCH_TRACK_SPEED_BANDS][2] = {{0.15f, 0.3f}, {0.3f, 0.6f}, {0.6f, 1.0f}};
+/* Counting line between the two middle rows, across the whole sensor: walking down the rows counts in */
+static const line_config_t s_track_line = {
+    .row_a = (int16_t)(((TOF_SENSOR_ROWS - 1U) * TOF_SUBZONE) / 2U),
+    .col_a = -(TOF_SUBZONE / 2),
+    .row_b = (int16_t)(((TOF_SENSOR_ROWS - 1U) * TOF_SUBZONE) / 2U),
+    .col_b = (int16_t)((TOF_SENSOR_COLS * TOF_SUBZONE) - (TOF_SUBZONE / 2)),
+    .hysteresis = LINE_DEFAULT_HYSTERESIS,
+};
+/* Occupancy region over the middle half of the sensor, by two corners */
+static const region_config_t s_track_region = {
+    .vertex_count = 2U,
+    .row = {(int16_t)(((TOF_SENSOR_ROWS * TOF_SUBZONE) / 4U) - (TOF_SUBZONE / 2U)),
+            (int16_t)(((TOF_SENSOR_ROWS * TOF_SUBZONE * 3U) / 4U) - (TOF_SUBZONE / 2U))},
+    .col = {(int16_t)(((TOF_SENSOR_COLS * TOF_SUBZONE) / 4U) - (TOF_SUBZONE / 2U)),
+            (int16_t)(((TOF_SENSOR_COLS * TOF_SUBZONE * 3U) / 4U) - (TOF_SUBZONE / 2U))},
+};
+
+static float bench_track_random(uint32_t *seed, float lo, float hi)
+{
+    return lo + ((hi - lo) * (float)(bench_lcg_next(seed) % 1001U) / 1000.0f);
+}
+
+/* A point on one side of the grid, half a zone outside it */
+static void bench_track_edge_point(uint32_t side, float along, float *row, float *col)
+{
+    float rows = (float)TOF_SENSOR_ROWS;
+    float cols = (float)TOF_SENSOR_COLS;
+
+    switch (side)
+    {
+    case 0U:
+        *row = -1.5f;
+        *col = along * (cols - 1.0f);
+        break;
+    case 1U:
+        *row = rows + 0.5f;
+        *col = along * (cols - 1.0f);
+        break;
+    case 2U:
+        *row = along * (rows - 1.0f);
+        *col = -1.5f;
+        break;
+    default:
+        *row = along * (rows - 1.0f);
+        *col = cols + 0.5f;
+        break;
+    }
+}
+
+static void bench_track_spawn(bench_walker_t *walker, uint32_t id, const float speeds[2], uint32_t *seed)
+{
+    uint32_t side = bench_lcg_next(seed) % 4U;
+    float speed = bench_track_random(seed, speeds[0], speeds[1]);
+    float exit_row;
+    float exit_col;
+    float length;
+
+    bench_track_edge_point(side, bench_track_random(seed, 0.0f, 1.0f), &walker->row, &walker->col);
+    bench_track_edge_point(side ^ 1U, bench_track_random(seed, 0.0f, 1.0f), &exit_row, &exit_col);
+    length = sqrtf(((exit_row - walker->row) * (exit_row - walker->row)) +
+                   ((exit_col - walker->col) * (exit_col - walker->col)));
+    walker->d_row = (exit_row - walker->row) * speed / length;
+    walker->d_col = (exit_col - walker->col) * speed / length;
+    walker->head_mm = (int32_t)bench_track_random(seed, BENCH_TRACK_MIN_HEAD_MM, BENCH_TRACK_MAX_HEAD_MM);
+    walker->id = id;
+}
+
+static bool bench_track_in_view(float row, float col)
+{
+    return (row > -0.5f) && (row < ((float)TOF_SENSOR_ROWS - 0.5f)) && (col > -0.5f) &&
+           (col < ((float)TOF_SENSOR_COLS - 0.5f));
+}
+
+/* Same edges as region_contains(): the top and left ones are inside */
+static bool bench_track_in_region(float row, float col)
+{
+    return (row >= ((float)s_track_region.row[0] / (float)TOF_SUBZONE)) &&
+           (row < ((float)s_track_region.row[1] / (float)TOF_SUBZONE)) &&
+           (col >= ((float)s_track_region.col[0] / (float)TOF_SUBZONE)) &&
+           (col < ((float)s_track_region.col[1] / (float)TOF_SUBZONE));
+}
+
+/* Same floor and bodies as bench_synth_frame(), the walkers wherever the scene has them */
+static void bench_track_render(VL53L5CX_ResultsData *frame, const bench_walker_t *walkers, uint32_t *seed)
+{
+    memset(frame, 0, sizeof(*frame));
+    for (uint32_t zone = 0U; zone < TOF_SENSOR_ZONES; zone++)
+    {
+        uint32_t target = zone * VL53L5CX_NB_TARGET_PER_ZONE;
+
+        frame->distance_mm[target] = (int16_t)(BENCH_SYNTH_FLOOR_MM + (int32_t)(bench_lcg_next(seed) % 31U) - 15);
+        frame->target_status[target] = BENCH_STATUS_VALID;
+    }
+
+    for (uint32_t w = 0U; w < BENCH_TRACK_MAX_WALKERS; w++)
+    {
+        int32_t center_row = (int32_t)lroundf(walkers[w].row);
+        int32_t center_col = (int32_t)lroundf(walkers[w].col);
+
+        if (walkers[w].id == 0U)
+        {
+            continue;
+        }
+        for (int32_t dr = -1; dr <= 1; dr++)
+        {
+            for (int32_t dc = -1; dc <= 1; dc++)
+            {
+                int32_t row = center_row + dr;
+                int32_t col = center_col + dc;
+                uint32_t target;
+                int32_t depth;
+
+                if ((row < 0) || (row >= (int32_t)TOF_SENSOR_ROWS) || (col < 0) || (col >= (int32_t)TOF_SENSOR_COLS))
+                {
+                    continue;
+                }
+                target = (uint32_t)((row * (int32_t)TOF_SENSOR_COLS) + col) * VL53L5CX_NB_TARGET_PER_ZONE;
+                depth = ((dr == 0) && (dc == 0)) ? walkers[w].head_mm : BENCH_SYNTH_BODY_MM;
+                depth += (int32_t)(bench_lcg_next(seed) % 21U) - 10;
+                /* The nearer body hides the other where two overlap */
+                if (depth < frame->distance_mm[target])
+                {
+                    frame->distance_mm[target] = (int16_t)depth;
+                }
+            }
+        }
+    }
+}
+
+/* Walkers cross the grid edge to edge, up to BENCH_TRACK_MAX_WALKERS at a time, after the background window */
+static bool bench_track_scene(bench_frames_t *set, bench_track_frame_t *track_frames, uint32_t frame_count,
+                              const float speeds[2], bench_track_truth_t *truth)
+{
+    float line_row = (float)s_track_line.row_a / (float)TOF_SUBZONE;
+    bench_walker_t walkers[BENCH_TRACK_MAX_WALKERS];
+    uint32_t seed = 0x7AC4U;
+    uint32_t next_id = 1U;
+
+    memset(walkers, 0, sizeof(walkers));
+    memset(truth, 0, sizeof(*truth));
+    set->frames = calloc(frame_count, sizeof(VL53L5CX_ResultsData));
+    if (set->frames == NULL)
+    {
+        return false;
+    }
+    set->frame_count = frame_count;
+
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        bench_track_frame_t *track_frame = &track_frames[i];
+
+        for (uint32_t w = 0U; w < BENCH_TRACK_MAX_WALKERS; w++)
+        {
+            if (walkers[w].id != 0U)
+            {
+                float row = walkers[w].row;
+                bool was_in_region = bench_track_in_region(row, walkers[w].col);
+
+                walkers[w].row += walkers[w].d_row;
+                walkers[w].col += walkers[w].d_col;
+                if (bench_track_in_view(line_row, walkers[w].col) && ((row < line_row) != (walkers[w].row < line_row)))
+                {
+                    truth->crossings[(row < line_row) ? 0U : 1U]++;
+                }
+                if (bench_track_in_region(walkers[w].row, walkers[w].col))
+                {
+                    truth->entries += was_in_region ? 0U : 1U;
+                    truth->occupied += (i >= BENCH_SYNTH_BG_FRAMES) ? 1U : 0U;
+                }
+                if ((walkers[w].row < -2.0f) || (walkers[w].row > ((float)TOF_SENSOR_ROWS + 1.0f)) ||
+                    (walkers[w].col < -2.0f) || (walkers[w].col > ((float)TOF_SENSOR_COLS + 1.0f)))
+                {
+                    walkers[w].id = 0U;
+                }
+            }
+            else if ((i >= BENCH_SYNTH_BG_FRAMES) && ((bench_lcg_next(&seed) % BENCH_TRACK_SPAWN_ODDS) == 0U))
+            {
+                bench_track_spawn(&walkers[w], next_id++, speeds, &seed);
+            }
+        }
+
+        bench_track_render(&set->frames[i], walkers, &seed);
+        track_frame->truth_count = 0U;
+        for (uint32_t w = 0U; w < BENCH_TRACK_MAX_WALKERS; w++)
+        {
+            if ((walkers[w].id != 0U) && bench_track_in_view(walkers[w].row, walkers[w].col))
+            {
+                bench_truth_t *truth = &track_frame->truth[track_frame->truth_count++];
+
+                truth->id = walkers[w].id;
+                truth->row = walkers[w].row;
+                truth->col = walkers[w].col;
+            }
+        }
+    }
+
+    truth->walkers = next_id - 1U;
+    return true;
+}
+
+/* Runs the stages ahead of tracking once and keeps what track_update() gets on every frame */
+static void bench_track_segment(const bench_frames_t *set, bench_track_frame_t *track_frames)
+{
+    tof_frame_t grid;
+    uint16_t filtered_mm[TOF_ROWS][TOF_COLS];
+    uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS];
+    tof_label_t labels[TOF_ROWS][TOF_COLS];
+    depth_profile_t depth_profile;
+
+    bg_init(&s_state.bg, NULL);
+    tof_grid_clear(&grid);
+    for (uint32_t i = 0U; i < set->frame_count; i++)
+    {
+        bench_track_frame_t *track_frame = &track_frames[i];
+
+        (void)tof_grid_load_tile(&grid, 0U, &set->frames[i]);
+        track_frame->collecting = bg_update(&s_state.bg, &grid);
+        track_frame->component_count = 0U;
+        if (track_frame->collecting)
+        {
+            continue;
+        }
+
+#if TOF_FUSED_SEGMENTATION
+        track_frame->component_count =
+            fg_filter_segment(&grid, bg_get_info(&s_state.bg), filtered_mm, pixel_distance_bg_mm, labels,
+                              track_frame->components, TOF_MAX_COMPONENTS, BENCH_MIN_COMPONENT_SIZE);
+#else
+        fg_filter_apply(&grid, bg_get_info(&s_state.bg), filtered_mm, pixel_distance_bg_mm);
+        seg_clear_labels(labels);
+        track_frame->component_count = seg_label_components(filtered_mm, labels, track_frame->components,
+                                                            TOF_MAX_COMPONENTS, BENCH_MIN_COMPONENT_SIZE);
+#endif
+        depth_profile_generate(filtered_mm, labels, track_frame->components, &track_frame->component_count,
+                               &depth_profile);
+        bg_adapt(&s_state.bg, &grid, filtered_mm);
+    }
+}
+
+/*
+ * Each walker in view is followed by the closest track updated this frame,
+ * within BENCH_TRACK_GATE_ZONES of its head; an ID switch is a walker
+ * followed by another track than the last one that followed it.
+ */
+static void bench_track_score(const track_state_t *tracks, const bench_track_frame_t *track_frame,
+                              uint32_t *last_track, bench_track_result_t *result)
+{
+    bool claimed[TOF_MAX_TRACKS] = {false};
+
+    for (uint8_t k = 0U; k < track_frame->truth_count; k++)
+    {
+        const bench_truth_t *truth = &track_frame->truth[k];
+        float best = BENCH_TRACK_GATE_ZONES * BENCH_TRACK_GATE_ZONES;
+        int best_track = -1;
+
+        for (uint8_t t = 0U; t < tracks->track_count; t++)
+        {
+            const tof_track_t *track = &tracks->tracks[t];
+            float d_row = (float)track->current_row - truth->row;
+            float d_col = (float)track->current_col - truth->col;
+            float distance_sq = (d_row * d_row) + (d_col * d_col);
+
+            if (!claimed[t] && track->active && (track->inactive_frames == 0U) && (distance_sq <= best))
+            {
+                best = distance_sq;
+                best_track = t;
+            }
+        }
+        if (best_track < 0)
+        {
+            continue;
+        }
+
+        claimed[best_track] = true;
+        result->followed++;
+        if ((last_track[truth->id] != 0U) && (last_track[truth->id] != (uint32_t)tracks->tracks[best_track].id))
+        {
+            result->id_switches++;
+        }
+        last_track[truth->id] = (uint32_t)tracks->tracks[best_track].id;
+    }
+}
+
+static bool bench_track_run(const bench_track_frame_t *track_frames, uint32_t frame_count, uint32_t walker_count,
+                            track_matcher_t matcher, track_motion_t motion, uint32_t loops,
+                            bench_track_result_t *result)
+{
+    tof_person_info_t person_info[TOF_MAX_TRACKS];
+    tof_people_data_t people = {0};
+    uint8_t person_info_count;
+    uint32_t *last_track = calloc(walker_count + 1U, sizeof(uint32_t));
+
+    if (last_track == NULL)
+    {
+        return false;
+    }
+
+    memset(result, 0, sizeof(*result));
+    track_reset(&s_state.tracks);
+    s_state.tracks.matcher = matcher;
+    s_state.tracks.motion = motion;
+    line_counter_init(&s_state.lines);
+    (void)line_counter_set(&s_state.lines, 0U, &s_track_line);
+    region_counter_init(&s_state.regions);
+    (void)region_counter_set(&s_state.regions, 0U, &s_track_region);
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        uint8_t next_id = s_state.tracks.next_id;
+
+        if (track_frames[i].collecting)
+        {
+            continue;
+        }
+        track_update(&s_state.tracks, track_frames[i].components, track_frames[i].component_count, &people,
+                     person_info, &person_info_count);
+        line_counter_update(&s_state.lines, &s_state.tracks);
+        region_counter_update(&s_state.regions, &s_state.tracks);
+        result->region_occupied += s_state.regions.stats[0].occupancy;
+        /* next_id is a byte and wraps */
+        result->tracks_created += (uint8_t)(s_state.tracks.next_id - next_id);
+        bench_track_score(&s_state.tracks, &track_frames[i], last_track, result);
+    }
+    result->people_in = people.people_in;
+    result->people_out = people.people_out;
+    result->line_in = s_state.lines.in[0];
+    result->line_out = s_state.lines.out[0];
+    result->region_entries = s_state.regions.stats[0].entries;
+    free(last_track);
+
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        track_reset(&s_state.tracks);
+        s_state.tracks.matcher = matcher;
+        s_state.tracks.motion = motion;
+        for (uint32_t i = 0U; i < frame_count; i++)
+        {
+            uint64_t start_ns;
+
+            if (track_frames[i].collecting)
+            {
+                continue;
+            }
+            start_ns = bench_now_ns();
+            track_update(&s_state.tracks, track_frames[i].components, track_frames[i].component_count, &people,
+                         person_info, &person_info_count);
+            result->total_ns += bench_now_ns() - start_ns;
+            result->calls++;
+        }
+    }
+    return true;
+}
+
+/*
+ * One row per matcher and motion model over the same components: the tracks
+ * counted in and out, the crossings of s_track_line, then the entries into
+ * s_track_region and the track-frames in it. truth is NULL for a capture.
+ */
+static bool bench_track_report(const bench_track_frame_t *track_frames, uint32_t frame_count,
+                               const bench_track_truth_t *truth, uint32_t loops)
+{
+    bool synthetic = truth != NULL;
+    uint32_t walker_count = synthetic ? truth->walkers : 0U;
+    uint32_t truth_frames = 0U;
+
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        truth_frames += track_frames[i].collecting ? 0U : track_frames[i].truth_count;
+    }
+    if (synthetic)
+    {
+        printf(", %u walkers over %u walker-frames\n%u crossing the middle down and %u up, %u entering the centre and "
+               "%u walker-frames in it",
+               walker_count, truth_frames, truth->crossings[0], truth->crossings[1], truth->entries, truth->occupied);
+    }
+    printf("\n%-8s %-6s %10s %8s %8s %9s %6s %6s %6s %6s %6s %8s\n", "matcher", "motion", "ns/update", "tracks",
+           "id_sw", "followed", "in", "out", "down", "up", "enter", "occupied");
+    for (uint32_t motion = TRACK_MOTION_NONE; motion <= TRACK_MOTION_ALPHA_BETA; motion++)
+    {
+        for (uint32_t m = TRACK_MATCHER_GREEDY; m <= TRACK_MATCHER_OPTIMAL; m++)
+        {
+            bench_track_result_t result;
+
+            if (!bench_track_run(track_frames, frame_count, walker_count, (track_matcher_t)m, (track_motion_t)motion,
+                                 loops, &result))
+            {
+                return false;
+            }
+            printf("%-8s %-6s %10llu %8u", s_matcher_names[m], s_motion_names[motion],
+                   (unsigned long long)((result.calls > 0U) ? (result.total_ns / result.calls) : 0U),
+                   result.tracks_created);
+            if (synthetic)
+            {
+                printf(" %8u %8.1f%%", result.id_switches,
+                       (truth_frames > 0U) ? (100.0 * (double)result.followed / (double)truth_frames) : 0.0);
+            }
+            else
+            {
+                printf(" %8s %9s", "-", "-");
+            }
+            printf(" %6u %6u %6u %6u %6u %8u\n", result.people_in, result.people_out, result.line_in, result.line_out,
+                   result.region_entries, result.region_occupied);
+        }
+    }
+    return true;
+}
+
+/*
+ * Replays the same components through every matcher and motion model; the
+ * synthetic scenes, one per speed band, score them against their walkers.
+ */
+static bool bench_run_tracking_check(const char *path, uint32_t loops)
+{
+    bench_frames_t set = {0};
+    bench_track_frame_t *track_frames;
+    bench_track_truth_t truth;
+    bool ok = true;
+
+    if (path != NULL)
+    {
+        if (!bench_load_frames(&set, path))
+        {
+            return false;
+        }
+        track_frames = calloc(set.frame_count, sizeof(bench_track_frame_t));
+        ok = track_frames != NULL;
+        if (ok)
+        {
+            bench_track_segment(&set, track_frames);
+            printf("tracking: %s, %u frames x %u loops", path, set.frame_count, loops);
+            ok = bench_track_report(track_frames, set.frame_count, NULL, loops);
+        }
+        free(track_frames);
+        free(set.frames);
+        return ok;
+    }
+
+    track_frames = calloc(BENCH_TRACK_FRAMES, sizeof(bench_track_frame_t));
+    for (uint32_t band = 0U; ok && (band < BENCH_TRACK_SPEED_BANDS); band++)
+    {
+        ok = (track_frames != NULL) &&
+             bench_track_scene(&set, track_frames, BENCH_TRACK_FRAMES, s_track_speeds[band], &truth);
+        if (ok)
+        {
+            bench_track_segment(&set, track_frames);
+            printf("%stracking: synthetic walkers at %.2f..%.2f zones per frame, %u frames x %u loops",
+                   (band > 0U) ? "\n" : "", (double)s_track_speeds[band][0], (double)s_track_speeds[band][1],
+                   set.frame_count, loops);
+            ok = bench_track_report(track_frames, set.frame_count, &truth, loops);
+        }
+        free(set.frames);
+        set.frames = NULL;
+    }
+    free(track_frames);
+    return ok;
+}
+
+/* A sample the pool should hold, in 1/TRAJECTORY_SCALE zone */
+typedef struct
+{
+    int id;
+    uint32_t frame;
+    int row;
+    int col;
+} bench_traj_sample_t;
+
+/*
+ * What the trajectory pool was given: every located track position in
+ * order, the last ones of each track id since it appeared, and where the
+ * export of each id has got to in the samples.
+ */
+typedef struct
+{
+    bench_traj_sample_t *samples;
+    uint32_t sample_count;
+    uint32_t sample_max;
+    uint32_t cursor[BENCH_TRAJ_IDS];
+    bench_traj_sample_t recent[BENCH_TRAJ_IDS][TOF_TRAJECTORY_LENGTH];
+    uint32_t recent_count[BENCH_TRAJ_IDS];
+    bool active[BENCH_TRAJ_IDS];
+    uint32_t long_steps;
+    uint32_t exported;
+    uint32_t export_mismatches;
+    uint32_t get_mismatches;
+} bench_traj_check_t;
+
+static bench_traj_check_t s_traj_check;
+/* Export buffer sizes, the smallest one record header, and frames between two exports */
+static const uint16_t s_traj_rooms[] = {TRAJECTORY_RECORD_HEADER_SIZE,
+                                        TRAJECTORY_RECORD_HEADER_SIZE + (2U * TRAJECTORY_SAMPLE_SIZE), 64U,
+                                        BENCH_TRAJ_BUFFER_SIZE};
+static const uint32_t s_traj_intervals[] = {1U, 4U, TOF_TRAJECTORY_LENGTH};
+
+/* Same rounding as trajectory_quantize() */
+static int bench_traj_step(int position)
+{
+    int step = TOF_SUBZONE / TRAJECTORY_SCALE;
+
+    return (position >= 0) ? ((position + (step / 2)) / step) : -((-position + (step / 2)) / step);
+}
+
+static void bench_traj_check_reset(bench_traj_check_t *check)
+{
+    bench_traj_sample_t *samples = check->samples;
+    uint32_t sample_max = check->sample_max;
+
+    memset(check, 0, sizeof(*check));
+    check->samples = samples;
+    check->sample_max = sample_max;
+}
+
+/* trajectory_get() of the track against the samples it was given since it appeared */
+static void bench_traj_check_get(bench_traj_check_t *check, const trajectory_pool_t *pool, int id)
+{
+    uint32_t slot = (uint32_t)id & (BENCH_TRAJ_IDS - 1U);
+    uint32_t recorded = check->recent_count[slot];
+    uint32_t kept = (recorded < TOF_TRAJECTORY_LENGTH) ? recorded : TOF_TRAJECTORY_LENGTH;
+    /* A long step takes two entries */
+    uint32_t least = (recorded < (TOF_TRAJECTORY_LENGTH / 2U)) ? recorded : (TOF_TRAJECTORY_LENGTH / 2U);
+    trajectory_point_t points[TOF_TRAJECTORY_LENGTH];
+    uint8_t count = trajectory_get(pool, id, (uint8_t)TOF_TRAJECTORY_LENGTH, points);
+
+    if ((count > kept) || (count < least))
+    {
+        check->get_mismatches++;
+        return;
+    }
+    for (uint8_t k = 0U; k < count; k++)
+    {
+        const bench_traj_sample_t *sample =
+            &check->recent[slot][(recorded - count + k) % TOF_TRAJECTORY_LENGTH];
+
+        if ((points[k].frame != sample->frame) || (points[k].row != (sample->row * (TOF_SUBZONE / TRAJECTORY_SCALE))) ||
+            (points[k].col != (sample->col * (TOF_SUBZONE / TRAJECTORY_SCALE))))
+        {
+            check->get_mismatches++;
+            return;
+        }
+    }
+}
+
+/* After trajectory_update(): notes the located tracks and reads every active one back */
+static bool bench_traj_record(bench_traj_check_t *check, const trajectory_pool_t *pool, const track_state_t *tracks)
+{
+    bool active[BENCH_TRAJ_IDS] = {false};
+
+    for (uint8_t t = 0U; t < tracks->track_count; t++)
+    {
+        const tof_track_t *track = &tracks->tracks[t];
+        uint32_t slot = (uint32_t)track->id & (BENCH_TRAJ_IDS - 1U);
+        bench_traj_sample_t *sample;
+
+        if (!track->active)
+        {
+            continue;
+        }
+        active[slot] = true;
+        if (!check->active[slot])
+        {
+            check->recent_count[slot] = 0U;
+        }
+        if (track_is_located(track))
+        {
+            if (check->sample_count >= check->sample_max)
+            {
+                return false;
+            }
+            sample = &check->samples[check->sample_count++];
+            sample->id = track->id;
+            sample->frame = pool->frame;
+            sample->row = bench_traj_step(track->position_row);
+            sample->col = bench_traj_step(track->position_col);
+            if (check->recent_count[slot] > 0U)
+            {
+                const bench_traj_sample_t *last =
+                    &check->recent[slot][(check->recent_count[slot] - 1U) % TOF_TRAJECTORY_LENGTH];
+
+                check->long_steps += ((abs(sample->row - last->row) > INT8_MAX) ||
+                                      (abs(sample->col - last->col) > INT8_MAX)) ? 1U : 0U;
+            }
+            check->recent[slot][check->recent_count[slot] % TOF_TRAJECTORY_LENGTH] = *sample;
+            check->recent_count[slot]++;
+        }
+        if (check->recent_count[slot] > 0U)
+        {
+            bench_traj_check_get(check, pool, track->id);
+        }
+    }
+    memcpy(check->active, active, sizeof(active));
+    return true;
+}
+
+/* The next sample of id not exported or dropped yet must be the one exported */
+static void bench_traj_match(bench_traj_check_t *check, uint8_t id, uint16_t frame, int row, int col)
+{
+    for (uint32_t i = check->cursor[id]; i < check->sample_count; i++)
+    {
+        const bench_traj_sample_t *sample = &check->samples[i];
+
+        if ((((uint32_t)sample->id & (BENCH_TRAJ_IDS - 1U)) == id) && ((uint16_t)sample->frame == frame))
+        {
+            check->cursor[id] = i + 1U;
+            check->exported++;
+            check->export_mismatches += ((sample->row != row) || (sample->col != col)) ? 1U : 0U;
+            return;
+        }
+    }
+    check->exported++;
+    check->export_mismatches++;
+}
+
+/* Decodes the records trajectory_export() writes into room bytes; false once nothing is pending */
+static bool bench_traj_export(bench_traj_check_t *check, trajectory_pool_t *pool, uint16_t room)
+{
+    uint8_t buffer[BENCH_TRAJ_BUFFER_SIZE];
+    uint16_t size = trajectory_export(pool, buffer, room);
+    uint16_t i = 0U;
+
+    while ((i + TRAJECTORY_RECORD_HEADER_SIZE) <= size)
+    {
+        uint8_t id = buffer[i];
+        uint8_t count = buffer[i + 1U];
+        uint16_t frame = (uint16_t)((buffer[i + 2U] << 8) | buffer[i + 3U]);
+        int row = (int16_t)((buffer[i + 4U] << 8) | buffer[i + 5U]);
+        int col = (int16_t)((buffer[i + 6U] << 8) | buffer[i + 7U]);
+
+        i = (uint16_t)(i + TRAJECTORY_RECORD_HEADER_SIZE);
+        for (uint8_t k = 0U; k < count; k++)
+        {
+            if (k > 0U)
+            {
+                if ((i + TRAJECTORY_SAMPLE_SIZE) > size)
+                {
+                    break;
+                }
+                row += (int8_t)buffer[i];
+                col += (int8_t)buffer[i + 1U];
+                frame = (uint16_t)(frame + buffer[i + 2U]);
+                i = (uint16_t)(i + TRAJECTORY_SAMPLE_SIZE);
+            }
+            bench_traj_match(check, id, frame, row, col);
+        }
+    }
+    check->export_mismatches += (i != size) ? 1U : 0U;
+    return trajectory_pending(pool) > 0U;
+}
+
+/* Exports every interval frames, and on the next frames while samples are left over */
+static void bench_traj_schedule(bench_traj_check_t *check, trajectory_pool_t *pool, uint16_t room, uint32_t interval,
+                                uint32_t *wait)
+{
+    if (*wait > 0U)
+    {
+        (*wait)--;
+        return;
+    }
+    if (!bench_traj_export(check, pool, room))
+    {
+        *wait = interval - 1U;
+    }
+}
+
+static bool bench_traj_run_walkers(bench_traj_check_t *check, trajectory_pool_t *pool,
+                                   const bench_track_frame_t *track_frames, uint32_t frame_count, uint16_t room,
+                                   uint32_t interval)
+{
+    tof_person_info_t person_info[TOF_MAX_TRACKS];
+    tof_people_data_t people = {0};
+    uint8_t person_info_count;
+    uint32_t wait = 0U;
+
+    track_reset(&s_state.tracks);
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        if (track_frames[i].collecting)
+        {
+            continue;
+        }
+        track_update(&s_state.tracks, track_frames[i].components, track_frames[i].component_count, &people,
+                     person_info, &person_info_count);
+        trajectory_update(pool, &s_state.tracks);
+        if (!bench_traj_record(check, pool, &s_state.tracks))
+        {
+            return false;
+        }
+        bench_traj_schedule(check, pool, room, interval, &wait);
+    }
+    return true;
+}
+
+/* Two tracks wandering by up to 100 sub-zones a frame and jumping across the far side now and then */
+static bool bench_traj_run_jumps(bench_traj_check_t *check, trajectory_pool_t *pool, uint16_t room, uint32_t interval)
+{
+    track_state_t tracks;
+    uint32_t seed = 0x7A3U;
+    uint32_t wait = 0U;
+
+    memset(&tracks, 0, sizeof(tracks));
+    tracks.track_count = 2U;
+    for (uint8_t t = 0U; t < tracks.track_count; t++)
+    {
+        tracks.tracks[t].id = (int)t + 1;
+        tracks.tracks[t].active = true;
+        tracks.tracks[t].position_row = 1000;
+        tracks.tracks[t].position_col = 1000;
+    }
+
+    for (uint32_t i = 0U; i < BENCH_TRAJ_JUMP_FRAMES; i++)
+    {
+        if ((i > 0U) && ((i % BENCH_TRAJ_RENUMBER_FRAMES) == 0U))
+        {
+            tracks.tracks[1].id = (int)((tracks.tracks[1].id % 254) + 2);
+        }
+        for (uint8_t t = 0U; t < tracks.track_count; t++)
+        {
+            tof_track_t *track = &tracks.tracks[t];
+            bool coast = ((bench_lcg_next(&seed) % BENCH_TRAJ_COAST_ODDS) == 0U) &&
+                         (track->inactive_frames < TOF_MAX_INACTIVE_FRAMES);
+
+            if (((i + t) % BENCH_TRAJ_JUMP_PERIOD) == 0U)
+            {
+                track->position_row = (track->position_row < (BENCH_TRAJ_JUMP_SPAN / 2)) ? BENCH_TRAJ_JUMP_SPAN : 0;
+                track->position_col = BENCH_TRAJ_JUMP_SPAN - track->position_col;
+            }
+            else
+            {
+                track->position_row += (int)(bench_lcg_next(&seed) % 201U) - 100;
+                track->position_col += (int)(bench_lcg_next(&seed) % 201U) - 100;
+            }
+            track->inactive_frames = coast ? (uint8_t)(track->inactive_frames + 1U) : 0U;
+        }
+        trajectory_update(pool, &tracks);
+        if (!bench_traj_record(check, pool, &tracks))
+        {
+            return false;
+        }
+        bench_traj_schedule(check, pool, room, interval, &wait);
+    }
+    return true;
+}
+
+/* One row per export buffer size and interval: every sample given is exported, dropped or still pending */
+static bool bench_traj_report(const char *feed, const bench_track_frame_t *track_frames, uint32_t frame_count)
+{
+    bench_traj_check_t *check = &s_traj_check;
+    bool ok = true;
+
+    printf("\n%-10s %6s %8s %8s %8s %8s %8s %8s %10s %8s\n", "feed", "room", "interval", "samples", "long",
+           "exported", "dropped", "pending", "mismatches", "get");
+    for (uint32_t r = 0U; r < (sizeof(s_traj_rooms) / sizeof(s_traj_rooms[0])); r++)
+    {
+        for (uint32_t n = 0U; n < (sizeof(s_traj_intervals) / sizeof(s_traj_intervals[0])); n++)
+        {
+            trajectory_pool_t pool;
+            uint16_t pending;
+            bool run_ok;
+
+            bench_traj_check_reset(check);
+            trajectory_init(&pool);
+            run_ok = (track_frames != NULL)
+                         ? bench_traj_run_walkers(check, &pool, track_frames, frame_count, s_traj_rooms[r],
+                                                  s_traj_intervals[n])
+                         : bench_traj_run_jumps(check, &pool, s_traj_rooms[r], s_traj_intervals[n]);
+            pending = trajectory_pending(&pool);
+            printf("%-10s %6u %8u %8u %8u %8u %8u %8u %10u %8u\n", feed, s_traj_rooms[r], s_traj_intervals[n],
+                   check->sample_count, check->long_steps, check->exported, pool.dropped, pending,
+                   check->export_mismatches, check->get_mismatches);
+            ok = ok && run_ok && (pool.dropped < UINT16_MAX) && (check->export_mismatches == 0U) &&
+                 (check->get_mismatches == 0U) &&
+                 (check->sample_count == (check->exported + pool.dropped + pending));
+        }
+    }
+    return ok;
+}
+
+/*
+ * Feeds the trajectory pool the tracks of the synthetic walkers in each
+ * speed band, then two tracks that jump further than a short step holds,
+ * and reads it back through trajectory_get() and trajectory_export().
+ */
+static bool bench_run_trajectory_check(void)
+{
+    bench_frames_t set = {0};
+    bench_track_frame_t *track_frames = calloc(BENCH_TRACK_FRAMES, sizeof(bench_track_frame_t));
+    bench_track_truth_t truth;
+    uint32_t sample_max = BENCH_TRACK_FRAMES * TOF_MAX_TRACKS;
+    bool ok = track_frames != NULL;
+
+    sample_max = (sample_max > (BENCH_TRAJ_JUMP_FRAMES * 2U)) ? sample_max : (BENCH_TRAJ_JUMP_FRAMES * 2U);
+    s_traj_check.samples = calloc(sample_max, sizeof(bench_traj_sample_t));
+    s_traj_check.sample_max = sample_max;
+    ok = ok && (s_traj_check.samples != NULL);
+    printf("trajectory: %u entries per history, export buffers of %u..%u B", TOF_TRAJECTORY_LENGTH, s_traj_rooms[0],
+           BENCH_TRAJ_BUFFER_SIZE);
+    for (uint32_t band = 0U; ok && (band < BENCH_TRACK_SPEED_BANDS); band++)
+    {
+        char feed[16];
+
+        ok = bench_track_scene(&set, track_frames, BENCH_TRACK_FRAMES, s_track_speeds[band], &truth);
+        if (ok)
+        {
+            bench_track_segment(&set, track_frames);
+            snprintf(feed, sizeof(feed), "%.2f..%.2f", (double)s_track_speeds[band][0],
+                     (double)s_track_speeds[band][1]);
+            ok = bench_traj_report(feed, track_frames, set.frame_count);
+        }
+        free(set.frames);
+        set.frames = NULL;
+    }
+    ok = ok && bench_traj_report("jumps", NULL, BENCH_TRAJ_JUMP_FRAMES);
+
+    free(s_traj_check.samples);
+    s_traj_check.samples = NULL;
+    free(track_frames);
+    return ok;
+}
+
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-f capture] [-n synth_frames] [-l loops] [-o out.tofl] [-d] [-s] [-a] [-q] [-t] [-j]"
+            " [-p store]\n"
+            "  -f  replay a frame log or a raw capture of VL53L5CX_ResultsData records\n"
+            "  -n  number of synthetic frames when no capture is given (default %u)\n"
+            "  -l  number of passes over the frame set (default %u)\n"
+            "  -o  also write the frame set as a frame log\n"
+            "  -d  benchmark ranging data decoding instead of the pipeline\n"
+            "  -s  check the fused foreground/labelling kernel against seg_label_components()\n"
+            "  -a  compare the background models on a drifting scene and estimators on a busy one\n"
+            "  -q  run a sunlit scene with and without the zone quality map\n"
+            "  -t  compare the track matchers and motion models on walkers with known paths, or on the capture\n"
+            "  -j  check trajectory histories and their export against the track positions they were given\n"
+            "  -p  power-cycle the pipeline against a flash store kept in the given file\n",
+            prog, BENCH_DEFAULT_SYNTH_FRAMES, BENCH_DEFAULT_LOOPS);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    const char *out_path = NULL;
+    uint32_t synth_frames = BENCH_DEFAULT_SYNTH_FRAMES;
+    uint32_t loops = BENCH_DEFAULT_LOOPS;
+    bool decode_only = false;
+    bool segmentation_only = false;
+    bool background_only = false;
+    bool quality_only = false;
+    bool tracking_only = false;
+    bool trajectory_only = false;
+    const char *store_path = NULL;
+    bench_frames_t set = {0};
+    tof_pipeline_output_t output;
+    uint64_t pipeline_ns;
+    uint64_t total_frames;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:l:o:p:dsaqtjh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            path = optarg;
+            break;
+        case 'n':
+            synth_frames = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            loops = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'd':
+            decode_only = true;
+            break;
+        case 's':
+            segmentation_only = true;
+            break;
+        case 'a':
+            background_only = true;
+            break;
+        case 'q':
+            quality_only = true;
+            break;
+        case 't':
+            tracking_only = true;
+            break;
+        case 'j':
+            trajectory_only = true;
+            break;
+        case 'p':
+            store_path = optarg;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((loops == 0U) || ((path == NULL) && (synth_frames == 0U)))
+    {
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    if (background_only)
+    {
+        bench_run_background_check();
+        return 0;
+    }
+    if (quality_only)
+    {
+        bench_run_quality_check();
+        return 0;
+    }
+    if (tracking_only)
+    {
+        return bench_run_tracking_check(path, loops) ? 0 : 1;
+    }
+    if (trajectory_only)
+    {
+        return bench_run_trajectory_check() ? 0 : 1;
+    }
+
+    if (!((path != NULL) ? bench_load_frames(&set, path) : bench_synth_frames(&set, synth_frames)))
+    {
+        return 1;
+    }
+
+    if ((out_path != NULL) && !bench_save_frame_log(&set, out_path))
+    {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 1;
+    }
+
+    if (store_path != NULL)
+    {
+        bool ok = bench_run_store_check(&set, store_path);
+        free(set.frames);
+        return ok ? 0 : 1;
+    }
+
+    if (decode_only || segmentation_only)
+    {
+        bool ok = decode_only ? bench_run_decode(&set, loops) : bench_run_segmentation_check(&set, loops);
+        free(set.frames);
+        return ok ? 0 : 1;
+    }
+
+    /* The profiled pass runs last, runtime init clears the profiler */
+    pipeline_ns = bench_run_pipeline(&set, loops, false, &output);
+    (void)bench_run_pipeline(&set, loops, true, &output);
+    total_frames = (uint64_t)set.frame_count * loops;
+
+    printf("source: %s, %u frames x %u loops\n", (path != NULL) ? path : "synthetic", set.frame_count, loops);
+    printf("%-14s %12s %10s %10s %10s %10s (ns)\n", "stage", "frames", "mean", "min", "p99", "max");
+    for (uint32_t s = 0U; s < TOF_PROFILE_STAGE_COUNT; s++)
+    {
+        tof_profile_stats_t profile;
+
+        if (!tof_profiler_get_stats((tof_profile_stage_t)s, &profile))
+        {
+            continue;
+        }
+        printf("%-14s %12u %10u %10u %10u %10u\n", tof_profiler_stage_name((tof_profile_stage_t)s), profile.count,
+               profile.mean_ticks, profile.min_ticks, profile.p99_ticks, profile.max_ticks);
+    }
+
+    printf("%-14s %12llu %10llu\n", "pipeline", (unsigned long long)total_frames,
+           (unsigned long long)(pipeline_ns / total_frames));
+    printf("throughput: %.0f frames/s\n", (double)total_frames * 1e9 / (double)((pipeline_ns > 0U) ? pipeline_ns : 1U));
+    printf("people: in=%u out=%u\n", output.people.people_in, output.people.people_out);
+
+    free(set.frames);
+    return 0;
+}
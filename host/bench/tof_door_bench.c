@@ -0,0 +1,239 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "background.h"
+#include "frame_log_reader.h"
+#include "tof_process.h"
+#include "tof_profiler.h"
+
+/*
+ * Background modes against a door (see the TOF_BG_MODES loop in
+ * host/CMakeLists.txt). The synthetic scene is a ceiling view of a floor
+ * with a door leaf that swings into the left columns for a while and back
+ * out, and one person crossing every DOOR_BENCH_WALK_PERIOD frames. A
+ * phantom frame reports more people than are in view. With -f a recorded
+ * sequence is replayed instead; it has no ground truth, so only the frames
+ * with someone counted are reported.
+ */
+
+#define DOOR_BENCH_DEFAULT_FRAMES 8000U
+#define DOOR_BENCH_FLOOR_MM 2600
+#define DOOR_BENCH_LEAF_MM 1700
+#define DOOR_BENCH_HEAD_MM 900
+#define DOOR_BENCH_BODY_MM 1400
+#define DOOR_BENCH_LEAF_COLS 2U
+#define DOOR_BENCH_STATUS_VALID 5U
+/* The leaf stays in view 5..20 s and out of it 10..50 s at 8 Hz, it starts out of view */
+#define DOOR_BENCH_IN_MIN 40U
+#define DOOR_BENCH_IN_SPAN 120U
+#define DOOR_BENCH_OUT_MIN 80U
+#define DOOR_BENCH_OUT_SPAN 320U
+#define DOOR_BENCH_WALK_PERIOD 200U
+/* Frames the smoothed count may trail a person out of view */
+#define DOOR_BENCH_LAG_FRAMES 16U
+
+typedef struct
+{
+    uint32_t seed;
+    bool leaf_in_view;
+    uint32_t leaf_frames_left;
+    uint32_t swings;
+} door_scene_t;
+
+static tof_pipeline_t s_pipeline;
+
+static uint32_t door_bench_lcg_next(uint32_t *state)
+{
+    *state = (*state * 1664525U) + 1013904223U;
+    return *state >> 16;
+}
+
+static void door_bench_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n frames] [-f capture.tofl]\n"
+            "  -n  frames of the synthetic door scene (default %u)\n"
+            "  -f  replay a recorded sequence instead\n",
+            prog, DOOR_BENCH_DEFAULT_FRAMES);
+}
+
+/* Returns whether the person is in view */
+static bool door_bench_frame(door_scene_t *scene, VL53L5CX_ResultsData *frame, uint32_t index)
+{
+    uint32_t t = index % DOOR_BENCH_WALK_PERIOD;
+    int32_t walker_col = (int32_t)(t / 4U) - 2;
+    int32_t walker_row = (int32_t)(TOF_SENSOR_ROWS / 2U);
+
+    if (scene->leaf_frames_left == 0U)
+    {
+        scene->leaf_in_view = !scene->leaf_in_view;
+        scene->leaf_frames_left =
+            scene->leaf_in_view ? (DOOR_BENCH_IN_MIN + (door_bench_lcg_next(&scene->seed) % DOOR_BENCH_IN_SPAN))
+                                : (DOOR_BENCH_OUT_MIN + (door_bench_lcg_next(&scene->seed) % DOOR_BENCH_OUT_SPAN));
+        scene->swings += scene->leaf_in_view ? 1U : 0U;
+    }
+    scene->leaf_frames_left--;
+
+    memset(frame, 0, sizeof(*frame));
+    for (uint32_t row = 0U; row < TOF_SENSOR_ROWS; row++)
+    {
+        for (uint32_t col = 0U; col < TOF_SENSOR_COLS; col++)
+        {
+            uint32_t target = ((row * TOF_SENSOR_COLS) + col) * VL53L5CX_NB_TARGET_PER_ZONE;
+            int32_t depth = (scene->leaf_in_view && (col < DOOR_BENCH_LEAF_COLS)) ? DOOR_BENCH_LEAF_MM
+                                                                                  : DOOR_BENCH_FLOOR_MM;
+
+            if (((int32_t)row >= walker_row - 1) && ((int32_t)row <= walker_row + 1) &&
+                ((int32_t)col >= walker_col - 1) && ((int32_t)col <= walker_col + 1))
+            {
+                depth = (((int32_t)row == walker_row) && ((int32_t)col == walker_col)) ? DOOR_BENCH_HEAD_MM
+                                                                                        : DOOR_BENCH_BODY_MM;
+            }
+            frame->distance_mm[target] =
+                (int16_t)(depth + ((int32_t)(door_bench_lcg_next(&scene->seed) % 31U) - 15));
+            frame->target_status[target] = DOOR_BENCH_STATUS_VALID;
+        }
+    }
+    return (walker_col >= 0) && (walker_col < (int32_t)TOF_SENSOR_COLS);
+}
+
+static uint32_t door_bench_mean_ns(tof_profile_stage_t stage)
+{
+    tof_profile_stats_t stats;
+
+    return tof_profiler_get_stats(stage, &stats) ? (stats.mean_ticks * 1000U) / tof_profiler_ticks_per_us() : 0U;
+}
+
+/* The profiler restarts once the background is learnt, so the costs are those of the running pipeline */
+static void door_bench_process(const VL53L5CX_ResultsData *frame, tof_pipeline_output_t *output)
+{
+    tof_pipeline_process_frame(&s_pipeline, frame, output);
+    if (output->background_learnt)
+    {
+        tof_profiler_reset();
+    }
+}
+
+static void door_bench_synthetic(uint32_t frame_count)
+{
+    VL53L5CX_ResultsData frame;
+    tof_pipeline_output_t output;
+    door_scene_t scene = {.seed = 0xD00AU, .leaf_in_view = true, .leaf_frames_left = 0U, .swings = 0U};
+    uint32_t blind = 0U;
+    uint32_t phantom = 0U;
+    uint32_t crossings = 0U;
+    uint32_t last_visible = 0U;
+    bool was_visible = false;
+
+    memset(&output, 0, sizeof(output));
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        bool visible = door_bench_frame(&scene, &frame, i);
+        uint32_t expected;
+
+        if (visible)
+        {
+            last_visible = i;
+        }
+        else if (was_visible)
+        {
+            crossings++;
+        }
+        was_visible = visible;
+
+        door_bench_process(&frame, &output);
+        if (output.background_collecting)
+        {
+            blind++;
+            continue;
+        }
+        expected = (visible || ((i - last_visible) <= DOOR_BENCH_LAG_FRAMES)) ? 1U : 0U;
+        phantom += (output.smoothed_people_count > expected) ? 1U : 0U;
+    }
+
+    printf("door scene: %u frames, leaf swings into view %u times, %u crossings\n", frame_count, scene.swings,
+           crossings);
+    printf("%-6s %8s %10s %10s %10s %9s %6s %6s\n", "modes", "bg ns", "filter ns", "total ns", "phantom", "", "in",
+           "out");
+    printf("K=%-4u %8u %10u %10u %10u %8.1f%% %6u %6u\n", TOF_BG_MODES, door_bench_mean_ns(TOF_PROFILE_BG),
+           door_bench_mean_ns(TOF_PROFILE_FG_FILTER), door_bench_mean_ns(TOF_PROFILE_TOTAL), phantom,
+           (frame_count > blind) ? (100.0 * (double)phantom / (double)(frame_count - blind)) : 0.0,
+           output.people.people_in, output.people.people_out);
+}
+
+static bool door_bench_capture(const char *path)
+{
+    frame_log_reader_t reader;
+    frame_log_meta_t meta;
+    VL53L5CX_ResultsData frame;
+    tof_pipeline_output_t output;
+    uint32_t frames = 0U;
+    uint32_t occupied = 0U;
+
+    if (!frame_log_reader_open(&reader, path))
+    {
+        fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+
+    memset(&output, 0, sizeof(output));
+    while (frame_log_reader_next(&reader, &frame, &meta))
+    {
+        door_bench_process(&frame, &output);
+        frames++;
+        occupied += (output.smoothed_people_count > 0U) ? 1U : 0U;
+    }
+    frame_log_reader_close(&reader);
+
+    printf("%s: %u frames\n", path, frames);
+    printf("%-6s %8s %10s %10s %10s %6s %6s\n", "modes", "bg ns", "filter ns", "total ns", "occupied", "in", "out");
+    printf("K=%-4u %8u %10u %10u %10u %6u %6u\n", TOF_BG_MODES, door_bench_mean_ns(TOF_PROFILE_BG),
+           door_bench_mean_ns(TOF_PROFILE_FG_FILTER), door_bench_mean_ns(TOF_PROFILE_TOTAL), occupied,
+           output.people.people_in, output.people.people_out);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    uint32_t frame_count = DOOR_BENCH_DEFAULT_FRAMES;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            frame_count = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'f':
+            path = optarg;
+            break;
+        default:
+            door_bench_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+    if ((path == NULL) && (frame_count == 0U))
+    {
+        door_bench_usage(argv[0]);
+        return 2;
+    }
+
+    tof_pipeline_runtime_init();
+    tof_pipeline_init(&s_pipeline);
+    if (path != NULL)
+    {
+        ok = door_bench_capture(path);
+    }
+    else
+    {
+        door_bench_synthetic(frame_count);
+    }
+    return ok ? 0 : 1;
+}
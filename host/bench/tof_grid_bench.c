@@ -0,0 +1,200 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tof_grid.h"
+#include "tof_process.h"
+#include "tof_profiler.h"
+
+/*
+ * Pipeline throughput on the grid this binary was compiled for (see
+ * tof_add_grid_bench() in host/CMakeLists.txt). Frames are synthesised
+ * directly on the stitched grid: a noisy floor plane and people walking
+ * along it, sized in sensor zones so a person covers the same floor area
+ * whatever the sensor resolution or number of tiles.
+ */
+
+#define GRID_BENCH_DEFAULT_FRAMES 2000U
+#define GRID_BENCH_DEFAULT_LOOPS 10U
+#define GRID_BENCH_BG_FRAMES 120U
+#define GRID_BENCH_FLOOR_MM 2600
+#define GRID_BENCH_HEAD_MM 900
+#define GRID_BENCH_BODY_MM 1400
+#define GRID_BENCH_STATUS_VALID 5U
+/* A person spans 3x3 zones of an 8x8 sensor, never less than 2x2 */
+#define GRID_BENCH_PERSON_ZONES (((3U * TOF_SENSOR_COLS) / 8U) < 2U ? 2U : ((3U * TOF_SENSOR_COLS) / 8U))
+/* Frames per zone of walking, one 8x8 zone every 4 frames */
+#define GRID_BENCH_FRAMES_PER_ZONE ((4U * 8U) / TOF_SENSOR_COLS)
+
+static uint64_t grid_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t grid_bench_lcg_next(uint32_t *state)
+{
+    *state = (*state * 1664525U) + 1013904223U;
+    return *state >> 16;
+}
+
+static tof_pipeline_t s_pipeline;
+
+/* Walker w keeps to lane w of `walkers` lanes and crosses the grid from the
+ * left on even lanes and from the right on odd ones. */
+static void grid_bench_synth_frame(tof_frame_t *frame, uint32_t index, uint32_t walkers, uint32_t *seed)
+{
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        {
+            int32_t noise = (int32_t)(grid_bench_lcg_next(seed) % 31U) - 15;
+
+            frame->distance_mm[row][col] = (uint16_t)(GRID_BENCH_FLOOR_MM + noise);
+            frame->target_status[row][col] = GRID_BENCH_STATUS_VALID;
+#if TOF_QUALITY
+            /* Full confidence, or the quality gate drops every zone */
+            frame->confidence[row][col] = UINT8_MAX;
+            frame->margin_mm[row][col] = 0U;
+#endif
+        }
+    }
+
+    if (index < GRID_BENCH_BG_FRAMES)
+    {
+        return;
+    }
+
+    for (uint32_t w = 0U; w < walkers; w++)
+    {
+        uint32_t span = TOF_COLS + (2U * GRID_BENCH_PERSON_ZONES);
+        uint32_t t = (index - GRID_BENCH_BG_FRAMES) + (w * 7U * GRID_BENCH_FRAMES_PER_ZONE);
+        int32_t step = (int32_t)((t / GRID_BENCH_FRAMES_PER_ZONE) % span) - (int32_t)GRID_BENCH_PERSON_ZONES;
+        int32_t col0 = ((w % 2U) == 0U) ? step : ((int32_t)TOF_COLS - 1 - step);
+        int32_t row0 = (int32_t)(((2U * w + 1U) * TOF_ROWS) / (2U * walkers)) - (int32_t)(GRID_BENCH_PERSON_ZONES / 2U);
+
+        for (uint32_t dr = 0U; dr < GRID_BENCH_PERSON_ZONES; dr++)
+        {
+            for (uint32_t dc = 0U; dc < GRID_BENCH_PERSON_ZONES; dc++)
+            {
+                int32_t row = row0 + (int32_t)dr;
+                int32_t col = col0 + (int32_t)dc;
+                bool head = (dr == (GRID_BENCH_PERSON_ZONES / 2U)) && (dc == (GRID_BENCH_PERSON_ZONES / 2U));
+                int32_t depth = head ? GRID_BENCH_HEAD_MM : GRID_BENCH_BODY_MM;
+
+                if ((row < 0) || (row >= (int32_t)TOF_ROWS) || (col < 0) || (col >= (int32_t)TOF_COLS))
+                {
+                    continue;
+                }
+                frame->distance_mm[row][col] = (uint16_t)(depth + ((int32_t)(grid_bench_lcg_next(seed) % 21U) - 10));
+            }
+        }
+    }
+}
+
+static void grid_bench_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n frames] [-l loops] [-p people]\n"
+            "  -n  number of synthetic frames (default %u)\n"
+            "  -l  number of timed passes over the frames (default %u)\n"
+            "  -p  people walking at once (default one per sensor tile)\n",
+            prog, GRID_BENCH_DEFAULT_FRAMES, GRID_BENCH_DEFAULT_LOOPS);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frame_count = GRID_BENCH_DEFAULT_FRAMES;
+    uint32_t loops = GRID_BENCH_DEFAULT_LOOPS;
+    uint32_t walkers = TOF_TILES;
+    uint32_t seed = 0x1234U;
+    tof_frame_t *frames;
+    tof_pipeline_output_t output;
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    uint64_t total_frames;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:p:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            frame_count = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            loops = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            walkers = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            grid_bench_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((frame_count <= GRID_BENCH_BG_FRAMES) || (loops == 0U))
+    {
+        grid_bench_usage(argv[0]);
+        return 2;
+    }
+
+    frames = calloc(frame_count, sizeof(tof_frame_t));
+    if (frames == NULL)
+    {
+        return 1;
+    }
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        grid_bench_synth_frame(&frames[i], i, walkers, &seed);
+    }
+
+    /* The first pass learns the background and is not timed */
+    tof_pipeline_runtime_init();
+    tof_pipeline_init(&s_pipeline);
+    for (uint32_t i = 0U; i < frame_count; i++)
+    {
+        tof_pipeline_process_grid(&s_pipeline, &frames[i], &output);
+    }
+    tof_profiler_reset();
+
+    start_ns = grid_bench_now_ns();
+    for (uint32_t loop = 0U; loop < loops; loop++)
+    {
+        for (uint32_t i = 0U; i < frame_count; i++)
+        {
+            tof_pipeline_process_grid(&s_pipeline, &frames[i], &output);
+        }
+    }
+    elapsed_ns = grid_bench_now_ns() - start_ns;
+    total_frames = (uint64_t)frame_count * loops;
+    elapsed_ns = (elapsed_ns > 0U) ? elapsed_ns : 1U;
+
+    printf("grid %ux%u: %ux%u sensors of %ux%u, %u zones, %u people, %u frames x %u loops\n", TOF_COLS, TOF_ROWS,
+           TOF_TILES_X, TOF_TILES_Y, TOF_SENSOR_COLS, TOF_SENSOR_ROWS, TOF_ZONES, walkers, frame_count, loops);
+    printf("%-14s %10s %10s %10s %10s (ns)\n", "stage", "min", "mean", "p99", "max");
+    for (uint32_t s = 0U; s < TOF_PROFILE_STAGE_COUNT; s++)
+    {
+        tof_profile_stats_t profile;
+
+        if (!tof_profiler_get_stats((tof_profile_stage_t)s, &profile))
+        {
+            continue;
+        }
+        printf("%-14s %10u %10u %10u %10u\n", tof_profiler_stage_name((tof_profile_stage_t)s), profile.min_ticks,
+               profile.mean_ticks, profile.p99_ticks, profile.max_ticks);
+    }
+    printf("throughput: %.0f frames/s, %.1f ns/frame, %.2f ns/zone\n", (double)total_frames * 1e9 / (double)elapsed_ns,
+           (double)elapsed_ns / (double)total_frames, (double)elapsed_ns / (double)(total_frames * TOF_ZONES));
+    printf("people: in=%u out=%u\n\n", output.people.people_in, output.people.people_out);
+
+    free(frames);
+    return 0;
+}
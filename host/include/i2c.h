@@ -0,0 +1,10 @@
+#ifndef HOST_I2C_H
+#define HOST_I2C_H
+
+/* Host stand-in for the CubeMX i2c.h, the handles live in host/sim/i2c_bus_sim.c */
+#include "main.h"
+
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c3;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_MAIN_H
+#define HOST_MAIN_H
+
+/* Host stand-in for the CubeMX main.h: the pins of a board with four VL53L5CX,
+ * all on one port, for vl53l5cx.c in tof_bringup_sim. */
+#include "stm32h5xx.h"
+
+extern GPIO_TypeDef host_gpioa;
+
+#define GPIOA (&host_gpioa)
+
+#define VL53_INT_Pin GPIO_PIN_0
+#define VL53_INT_GPIO_Port GPIOA
+#define VL53_xshut_Pin GPIO_PIN_1
+#define VL53_xshut_GPIO_Port GPIOA
+#define VL53_2_INT_Pin GPIO_PIN_2
+#define VL53_2_INT_GPIO_Port GPIOA
+#define VL53_2_xshut_Pin GPIO_PIN_3
+#define VL53_2_xshut_GPIO_Port GPIOA
+#define VL53_3_INT_Pin GPIO_PIN_4
+#define VL53_3_INT_GPIO_Port GPIOA
+#define VL53_3_xshut_Pin GPIO_PIN_5
+#define VL53_3_xshut_GPIO_Port GPIOA
+#define VL53_4_INT_Pin GPIO_PIN_6
+#define VL53_4_INT_GPIO_Port GPIOA
+#define VL53_4_xshut_Pin GPIO_PIN_7
+#define VL53_4_xshut_GPIO_Port GPIOA
+
+#endif
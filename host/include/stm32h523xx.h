@@ -0,0 +1,11 @@
+#ifndef HOST_STM32H523XX_H
+#define HOST_STM32H523XX_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+#endif
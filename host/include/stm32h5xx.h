@@ -0,0 +1,10 @@
+#ifndef HOST_STM32H5XX_H
+#define HOST_STM32H5XX_H
+
+/* Host stand-in for the CMSIS device header so driver and BSP headers can be
+ * included when building the pipeline natively. Only the types referenced by
+ * those headers are provided; like on target, the HAL comes along. */
+#include "stm32h523xx.h"
+#include "stm32h5xx_hal.h"
+
+#endif
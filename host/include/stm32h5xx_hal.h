@@ -0,0 +1,81 @@
+#ifndef HOST_STM32H5XX_HAL_H
+#define HOST_STM32H5XX_HAL_H
+
+/* Host stand-in for the HAL: the tick, the I2C calls made by the VL53L5CX
+ * platform layer (platform.c) and the GPIO and I2C calls of the board glue
+ * (vl53l5cx.c). host/sim/i2c_bus_sim.c implements them over a modelled board
+ * for tof_boot_sim and tof_bringup_sim; the pipeline libraries never call them. */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stm32h523xx.h"
+
+typedef enum
+{
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U,
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U,
+    HAL_I2C_STATE_BUSY_TX = 0x21U,
+    HAL_I2C_STATE_BUSY_RX = 0x22U,
+} HAL_I2C_StateTypeDef;
+
+typedef enum
+{
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET,
+} GPIO_PinState;
+
+#define GPIO_PIN_0 ((uint16_t)0x0001U)
+#define GPIO_PIN_1 ((uint16_t)0x0002U)
+#define GPIO_PIN_2 ((uint16_t)0x0004U)
+#define GPIO_PIN_3 ((uint16_t)0x0008U)
+#define GPIO_PIN_4 ((uint16_t)0x0010U)
+#define GPIO_PIN_5 ((uint16_t)0x0020U)
+#define GPIO_PIN_6 ((uint16_t)0x0040U)
+#define GPIO_PIN_7 ((uint16_t)0x0080U)
+
+#define HAL_I2C_ERROR_NONE 0x00000000U
+#define HAL_I2C_ERROR_AF 0x00000004U
+#define I2C_MEMADD_SIZE_16BIT 0x00000002U
+
+typedef struct __DMA_HandleTypeDef DMA_HandleTypeDef;
+
+typedef struct __I2C_HandleTypeDef
+{
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    volatile HAL_I2C_StateTypeDef State;
+    volatile uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size,
+                                          uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size,
+                                         uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(const I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(const I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+#endif
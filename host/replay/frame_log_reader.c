@@ -0,0 +1,165 @@
+#include "frame_log_reader.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool frame_log_write_all(int fd, const uint8_t *buf, size_t len)
+{
+    while (len > 0U)
+    {
+        ssize_t written = write(fd, buf, len);
+        if (written <= 0)
+        {
+            return false;
+        }
+        buf += written;
+        len -= (size_t)written;
+    }
+    return true;
+}
+
+bool frame_log_reader_open(frame_log_reader_t *reader, const char *path)
+{
+    struct stat st;
+    void *map;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    if ((fstat(reader->fd, &st) != 0) || (st.st_size < (off_t)FRAME_LOG_HEADER_SIZE))
+    {
+        fprintf(stderr, "%s: too small for a frame log\n", path);
+        close(reader->fd);
+        return false;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: mmap failed\n", path);
+        close(reader->fd);
+        return false;
+    }
+    (void)madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    reader->base = map;
+    reader->size = (size_t)st.st_size;
+    if (!frame_log_read_header(reader->base, reader->size, &reader->config))
+    {
+        fprintf(stderr, "%s: not a frame log of this build (version %u, %u targets)\n", path, FRAME_LOG_VERSION,
+                (unsigned)FRAME_LOG_TARGETS);
+        frame_log_reader_close(reader);
+        return false;
+    }
+
+    reader->device = 0U;
+    frame_log_reader_rewind(reader);
+    return true;
+}
+
+void frame_log_reader_select(frame_log_reader_t *reader, uint8_t device)
+{
+    reader->device = device;
+    frame_log_reader_rewind(reader);
+}
+
+bool frame_log_reader_next(frame_log_reader_t *reader, VL53L5CX_ResultsData *frame, frame_log_meta_t *meta)
+{
+    while (reader->offset < reader->size)
+    {
+        const uint8_t *record = reader->base + reader->offset;
+        size_t remaining = reader->size - reader->offset;
+        uint16_t record_size = frame_log_record_size(record[0]);
+        uint8_t device;
+
+        if ((record_size == 0U) || (remaining < record_size) ||
+            (frame_log_record_device(record) >= reader->config.devices))
+        {
+            /* Corrupt or truncated tail, e.g. a capture cut mid-record */
+            reader->offset = reader->size;
+            return false;
+        }
+
+        reader->offset += record_size;
+        device = frame_log_record_device(record);
+        if ((reader->device != FRAME_LOG_READER_ALL_DEVICES) && (device != reader->device))
+        {
+            continue;
+        }
+        if (frame_log_decode(&reader->decoders[device], record, remaining, frame, meta))
+        {
+            reader->frames_read++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void frame_log_reader_rewind(frame_log_reader_t *reader)
+{
+    reader->offset = FRAME_LOG_HEADER_SIZE;
+    reader->frames_read = 0U;
+    for (uint8_t device = 0U; device < FRAME_LOG_MAX_DEVICES; device++)
+    {
+        frame_log_decoder_init(&reader->decoders[device]);
+    }
+}
+
+void frame_log_reader_close(frame_log_reader_t *reader)
+{
+    if (reader->base != NULL)
+    {
+        munmap((void *)reader->base, reader->size);
+        reader->base = NULL;
+    }
+    if (reader->fd >= 0)
+    {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+}
+
+bool frame_log_writer_open(frame_log_writer_t *writer, const char *path, const frame_log_config_t *config)
+{
+    uint8_t header[FRAME_LOG_HEADER_SIZE];
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0)
+    {
+        fprintf(stderr, "cannot create %s\n", path);
+        return false;
+    }
+
+    frame_log_encoder_init(&writer->encoder, config, 0U);
+    (void)frame_log_write_header(&writer->encoder.config, header);
+    if (!frame_log_write_all(writer->fd, header, sizeof(header)))
+    {
+        frame_log_writer_close(writer);
+        return false;
+    }
+    return true;
+}
+
+bool frame_log_writer_append(frame_log_writer_t *writer, const VL53L5CX_ResultsData *frame, uint32_t timestamp_ms)
+{
+    uint16_t len = frame_log_encode(&writer->encoder, frame, timestamp_ms, writer->record);
+
+    return (len > 0U) && frame_log_write_all(writer->fd, writer->record, len);
+}
+
+void frame_log_writer_close(frame_log_writer_t *writer)
+{
+    if (writer->fd >= 0)
+    {
+        close(writer->fd);
+        writer->fd = -1;
+    }
+}
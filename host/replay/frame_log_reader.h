@@ -0,0 +1,45 @@
+#ifndef FRAME_LOG_READER_H
+#define FRAME_LOG_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_log.h"
+
+/* frame_log_reader_select() argument returning the records of every device */
+#define FRAME_LOG_READER_ALL_DEVICES 0xFFU
+
+/* Streaming reader over a memory-mapped frame log. Records are decoded on
+ * demand, so captures larger than RAM can be replayed at full speed. Each
+ * record is routed to the decoder of its device; only the selected device's
+ * records are returned (device 0 after open). */
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    size_t offset;
+    int fd;
+    frame_log_config_t config;
+    uint8_t device;
+    frame_log_decoder_t decoders[FRAME_LOG_MAX_DEVICES];
+    uint64_t frames_read;
+} frame_log_reader_t;
+
+bool frame_log_reader_open(frame_log_reader_t *reader, const char *path);
+void frame_log_reader_select(frame_log_reader_t *reader, uint8_t device);
+bool frame_log_reader_next(frame_log_reader_t *reader, VL53L5CX_ResultsData *frame, frame_log_meta_t *meta);
+void frame_log_reader_rewind(frame_log_reader_t *reader);
+void frame_log_reader_close(frame_log_reader_t *reader);
+
+/* Append-only writer used by the host tools to produce single-device captures. */
+typedef struct {
+    int fd;
+    frame_log_encoder_t encoder;
+    uint8_t record[FRAME_LOG_MAX_RECORD_SIZE];
+} frame_log_writer_t;
+
+bool frame_log_writer_open(frame_log_writer_t *writer, const char *path, const frame_log_config_t *config);
+bool frame_log_writer_append(frame_log_writer_t *writer, const VL53L5CX_ResultsData *frame, uint32_t timestamp_ms);
+void frame_log_writer_close(frame_log_writer_t *writer);
+
+#endif
@@ -0,0 +1,441 @@
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "frame_log_reader.h"
+#include "tof_process.h"
+
+#define REPLAY_MAX_THREADS 64U
+
+/* One capture replayed through its own pipeline instance */
+typedef struct
+{
+    const char *path;
+    frame_log_reader_t reader;
+    tof_pipeline_t pipeline;
+    tof_pipeline_output_t output;
+    uint64_t frames;
+    uint64_t elapsed_ns;
+    uint64_t trajectory_samples;
+    uint64_t trajectory_bytes;
+    bool ok;
+} replay_job_t;
+
+typedef struct
+{
+    replay_job_t *jobs;
+    uint32_t job_count;
+    uint32_t loops;
+    bool verbose;
+    bool profiling;
+    uint8_t device;
+    line_config_t lines[TOF_MAX_LINES];
+    uint8_t line_count;
+    region_config_t regions[TOF_MAX_REGIONS];
+    uint8_t region_count;
+    /* Bytes of trajectory records exported every trajectory_interval frames, 0 for none */
+    uint16_t trajectory_room;
+    uint32_t trajectory_interval;
+    pthread_mutex_t lock;
+    uint32_t next_job;
+} replay_batch_t;
+
+static uint64_t replay_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static void replay_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-l loops] [-j threads] [-d device] [-L line]... [-R region]... [-T bytes[,frames]] [-v]\n"
+            "       capture.tofl [capture.tofl ...]\n"
+            "  -l  number of passes over each capture (default 1)\n"
+            "  -d  device whose records are replayed in a capture of several sensors (default 0)\n"
+            "  -j  captures replayed in parallel, each through its own pipeline (default 1)\n"
+            "  -L  count crossings of row_a,col_a,row_b,col_b[,hysteresis], in zones (up to %u lines)\n"
+            "  -R  occupancy of the polygon row,col,row,col[,...], in zones; two vertices are a rectangle's corners\n"
+            "      (%u to %u vertices, up to %u regions)\n"
+            "  -T  export up to bytes of trajectory records every frames (default 1), and after the next frames\n"
+            "      while some are left, then decode them\n"
+            "  -v  print the pipeline output of every frame (single thread only)\n",
+            prog, TOF_MAX_LINES, 2U, REGION_MAX_VERTICES, TOF_MAX_REGIONS);
+}
+
+/* Zones to the 1/TOF_SUBZONE of line_config_t */
+static bool replay_parse_line(const char *arg, line_config_t *line)
+{
+    float row_a;
+    float col_a;
+    float row_b;
+    float col_b;
+    float hysteresis = (float)LINE_DEFAULT_HYSTERESIS / (float)TOF_SUBZONE;
+    int fields = sscanf(arg, "%f,%f,%f,%f,%f", &row_a, &col_a, &row_b, &col_b, &hysteresis);
+
+    if ((fields < 4) || (hysteresis < 0.0f))
+    {
+        return false;
+    }
+    line->row_a = (int16_t)lroundf(row_a * (float)TOF_SUBZONE);
+    line->col_a = (int16_t)lroundf(col_a * (float)TOF_SUBZONE);
+    line->row_b = (int16_t)lroundf(row_b * (float)TOF_SUBZONE);
+    line->col_b = (int16_t)lroundf(col_b * (float)TOF_SUBZONE);
+    line->hysteresis = (uint16_t)lroundf(hysteresis * (float)TOF_SUBZONE);
+    return true;
+}
+
+/* Zones to the 1/TOF_SUBZONE of region_config_t */
+static bool replay_parse_region(const char *arg, region_config_t *region)
+{
+    const char *cursor = arg;
+    uint32_t values = 0U;
+    float coords[REGION_MAX_VERTICES * 2U];
+
+    for (;;)
+    {
+        char *end;
+
+        if (values >= (REGION_MAX_VERTICES * 2U))
+        {
+            return false;
+        }
+        coords[values++] = strtof(cursor, &end);
+        if ((end == cursor) || ((*end != ',') && (*end != '\0')))
+        {
+            return false;
+        }
+        if (*end == '\0')
+        {
+            break;
+        }
+        cursor = end + 1;
+    }
+    if (((values % 2U) != 0U) || (values < 4U))
+    {
+        return false;
+    }
+
+    region->vertex_count = (uint8_t)(values / 2U);
+    for (uint8_t v = 0U; v < region->vertex_count; v++)
+    {
+        region->row[v] = (int16_t)lroundf(coords[2U * v] * (float)TOF_SUBZONE);
+        region->col[v] = (int16_t)lroundf(coords[(2U * v) + 1U] * (float)TOF_SUBZONE);
+    }
+    return true;
+}
+
+static int16_t replay_get_i16_be(const uint8_t *data)
+{
+    return (int16_t)(((uint16_t)data[0] << 8) | data[1]);
+}
+
+/* Decodes the records of trajectory_export(); false if they do not add up to len */
+static bool replay_decode_trajectories(const uint8_t *data, uint16_t len, bool verbose, uint64_t *samples)
+{
+    uint16_t idx = 0U;
+
+    while ((idx + TRAJECTORY_RECORD_HEADER_SIZE) <= len)
+    {
+        uint8_t id = data[idx];
+        uint8_t count = data[idx + 1U];
+        uint16_t frame = (uint16_t)(((uint16_t)data[idx + 2U] << 8) | data[idx + 3U]);
+        int row = replay_get_i16_be(&data[idx + 4U]);
+        int col = replay_get_i16_be(&data[idx + 6U]);
+
+        idx += TRAJECTORY_RECORD_HEADER_SIZE;
+        if ((count == 0U) || ((idx + ((count - 1U) * TRAJECTORY_SAMPLE_SIZE)) > len))
+        {
+            return false;
+        }
+        for (uint8_t s = 0U; s < count; s++)
+        {
+            if (s > 0U)
+            {
+                row += (int8_t)data[idx];
+                col += (int8_t)data[idx + 1U];
+                frame = (uint16_t)(frame + data[idx + 2U]);
+                idx += TRAJECTORY_SAMPLE_SIZE;
+            }
+            if (verbose)
+            {
+                printf("  track %u frame %u at %.2f,%.2f\n", id, frame, (double)row / TRAJECTORY_SCALE,
+                       (double)col / TRAJECTORY_SCALE);
+            }
+        }
+        *samples += count;
+    }
+    return idx == len;
+}
+
+static void replay_run_job(replay_job_t *job, const replay_batch_t *batch)
+{
+    VL53L5CX_ResultsData frame;
+    frame_log_meta_t meta;
+    uint64_t start_ns;
+    uint32_t trajectory_wait = 0U;
+
+    if (!frame_log_reader_open(&job->reader, job->path))
+    {
+        return;
+    }
+    if (batch->device >= job->reader.config.devices)
+    {
+        fprintf(stderr, "%s: no device %u, the capture has %u\n", job->path, batch->device,
+                job->reader.config.devices);
+        return;
+    }
+    frame_log_reader_select(&job->reader, batch->device);
+
+    memset(&frame, 0, sizeof(frame));
+    memset(&job->output, 0, sizeof(job->output));
+    tof_pipeline_init(&job->pipeline);
+    tof_pipeline_set_profiling(&job->pipeline, batch->profiling);
+    for (uint8_t l = 0U; l < batch->line_count; l++)
+    {
+        (void)tof_pipeline_set_line(&job->pipeline, l, &batch->lines[l]);
+    }
+    for (uint8_t r = 0U; r < batch->region_count; r++)
+    {
+        (void)tof_pipeline_set_region(&job->pipeline, r, &batch->regions[r]);
+    }
+
+    start_ns = replay_now_ns();
+    for (uint32_t loop = 0U; loop < batch->loops; loop++)
+    {
+        frame_log_reader_rewind(&job->reader);
+        while (frame_log_reader_next(&job->reader, &frame, &meta))
+        {
+            tof_pipeline_process_frame(&job->pipeline, &frame, &job->output);
+            job->frames++;
+            if (batch->verbose)
+            {
+                printf("%u %u bg=%u people=%u in=%u out=%u class=%u\n", meta.seq, meta.timestamp_ms,
+                       job->output.background_collecting, job->output.smoothed_people_count,
+                       job->output.people.people_in, job->output.people.people_out, job->output.people.class_id);
+            }
+            if ((batch->trajectory_room > 0U) && (trajectory_wait > 0U))
+            {
+                trajectory_wait--;
+            }
+            else if (batch->trajectory_room > 0U)
+            {
+                uint8_t records[UINT16_MAX];
+                uint16_t len = tof_pipeline_export_trajectories(&job->pipeline, records, batch->trajectory_room);
+
+                if (tof_pipeline_pending_trajectories(&job->pipeline) == 0U)
+                {
+                    trajectory_wait = batch->trajectory_interval - 1U;
+                }
+                if (!replay_decode_trajectories(records, len, batch->verbose, &job->trajectory_samples))
+                {
+                    fprintf(stderr, "%s: bad trajectory records after frame %u\n", job->path, meta.seq);
+                    return;
+                }
+                job->trajectory_bytes += len;
+            }
+        }
+    }
+    job->elapsed_ns = replay_now_ns() - start_ns;
+    job->ok = true;
+}
+
+static void *replay_worker(void *arg)
+{
+    replay_batch_t *batch = arg;
+
+    for (;;)
+    {
+        uint32_t index;
+
+        pthread_mutex_lock(&batch->lock);
+        index = batch->next_job++;
+        pthread_mutex_unlock(&batch->lock);
+        if (index >= batch->job_count)
+        {
+            return NULL;
+        }
+        replay_run_job(&batch->jobs[index], batch);
+    }
+}
+
+static void replay_print_job(const replay_job_t *job)
+{
+    const frame_log_reader_t *reader = &job->reader;
+    uint64_t elapsed_ns = job->elapsed_ns;
+
+    printf("frames: %llu (%u skipped after gaps), odr %u Hz, delta %s\n", (unsigned long long)job->frames,
+           reader->decoders[reader->device].skipped_records, reader->config.odr_hz,
+           ((reader->config.flags & FRAME_LOG_FLAG_DELTA_DISTANCE) != 0U) ? "on" : "off");
+    printf("throughput: %.0f frames/s (%.1f x realtime)\n",
+           (double)job->frames * 1e9 / (double)((elapsed_ns > 0U) ? elapsed_ns : 1U),
+           (reader->config.odr_hz > 0U)
+               ? ((double)job->frames * 1e9 / (double)((elapsed_ns > 0U) ? elapsed_ns : 1U)) / reader->config.odr_hz
+               : 0.0);
+    printf("people: in=%u out=%u\n", job->output.people.people_in, job->output.people.people_out);
+    for (uint8_t l = 0U; l < job->output.line_count; l++)
+    {
+        printf("line %u: in=%u out=%u\n", l, job->output.line_in[l], job->output.line_out[l]);
+    }
+    if (job->trajectory_bytes > 0U)
+    {
+        printf("trajectories: %llu samples in %llu bytes, %.2f bytes per sample, %u dropped\n",
+               (unsigned long long)job->trajectory_samples, (unsigned long long)job->trajectory_bytes,
+               (double)job->trajectory_bytes / (double)job->trajectory_samples, job->output.trajectory_dropped);
+    }
+    for (uint8_t r = 0U; r < job->output.region_count; r++)
+    {
+        const region_stats_t *stats = &job->output.regions[r];
+
+        printf("region %u: occupancy=%u entries=%u dwell=", r, stats->occupancy, stats->entries);
+        for (uint8_t b = 0U; b < REGION_DWELL_BINS; b++)
+        {
+            printf("%s%u", (b > 0U) ? "," : "", stats->dwell[b]);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    replay_batch_t batch;
+    pthread_t threads[REPLAY_MAX_THREADS];
+    uint32_t thread_count = 1U;
+    uint64_t frames = 0U;
+    uint64_t start_ns;
+    uint64_t elapsed_ns;
+    bool ok = true;
+    int opt;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.loops = 1U;
+    while ((opt = getopt(argc, argv, "l:j:d:L:R:T:vh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            batch.loops = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'j':
+            thread_count = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            batch.device = (uint8_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'L':
+            if ((batch.line_count >= TOF_MAX_LINES) || !replay_parse_line(optarg, &batch.lines[batch.line_count]))
+            {
+                replay_usage(argv[0]);
+                return 2;
+            }
+            batch.line_count++;
+            break;
+        case 'R':
+            if ((batch.region_count >= TOF_MAX_REGIONS) ||
+                !replay_parse_region(optarg, &batch.regions[batch.region_count]))
+            {
+                replay_usage(argv[0]);
+                return 2;
+            }
+            batch.region_count++;
+            break;
+        case 'T':
+            batch.trajectory_interval = 1U;
+            if ((sscanf(optarg, "%hu,%u", &batch.trajectory_room, &batch.trajectory_interval) < 1) ||
+                (batch.trajectory_room < TRAJECTORY_RECORD_HEADER_SIZE) || (batch.trajectory_interval == 0U))
+            {
+                replay_usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'v':
+            batch.verbose = true;
+            break;
+        default:
+            replay_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((optind >= argc) || (batch.loops == 0U) || (thread_count == 0U) || (thread_count > REPLAY_MAX_THREADS) ||
+        (batch.verbose && (thread_count > 1U)))
+    {
+        replay_usage(argv[0]);
+        return 2;
+    }
+
+    /* A pipeline instance is a few tens of KiB, too much for a worker stack */
+    batch.job_count = (uint32_t)(argc - optind);
+    batch.jobs = calloc(batch.job_count, sizeof(replay_job_t));
+    if (batch.jobs == NULL)
+    {
+        return 1;
+    }
+    for (uint32_t i = 0U; i < batch.job_count; i++)
+    {
+        batch.jobs[i].path = argv[optind + (int)i];
+    }
+    thread_count = (thread_count < batch.job_count) ? thread_count : batch.job_count;
+    /* The stage profiler is shared by every instance */
+    batch.profiling = (thread_count == 1U);
+    pthread_mutex_init(&batch.lock, NULL);
+    tof_pipeline_runtime_init();
+
+    start_ns = replay_now_ns();
+    if (thread_count == 1U)
+    {
+        (void)replay_worker(&batch);
+    }
+    else
+    {
+        for (uint32_t t = 0U; t < thread_count; t++)
+        {
+            if (pthread_create(&threads[t], NULL, replay_worker, &batch) != 0)
+            {
+                thread_count = t;
+                break;
+            }
+        }
+        for (uint32_t t = 0U; t < thread_count; t++)
+        {
+            pthread_join(threads[t], NULL);
+        }
+        /* Jobs left behind by a thread that failed to start */
+        (void)replay_worker(&batch);
+    }
+    elapsed_ns = replay_now_ns() - start_ns;
+
+    for (uint32_t i = 0U; i < batch.job_count; i++)
+    {
+        replay_job_t *job = &batch.jobs[i];
+
+        if (!job->ok)
+        {
+            ok = false;
+            continue;
+        }
+        if (batch.job_count > 1U)
+        {
+            printf("%s\n", job->path);
+        }
+        replay_print_job(job);
+        frames += job->frames;
+        frame_log_reader_close(&job->reader);
+    }
+    if (batch.job_count > 1U)
+    {
+        printf("batch: %u captures on %u threads, %.0f frames/s\n", batch.job_count, thread_count,
+               (double)frames * 1e9 / (double)((elapsed_ns > 0U) ? elapsed_ns : 1U));
+    }
+
+    pthread_mutex_destroy(&batch.lock);
+    free(batch.jobs);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#include "flash_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FLASH_SIM_NO_TEAR UINT32_MAX
+#define FLASH_SIM_UNITS (BSP_FLASH_STORE_SIZE / BSP_FLASH_WRITE_UNIT)
+
+/* The file holds the image, then a byte per write unit, non-zero for one whose ECC fails */
+static uint8_t s_image[BSP_FLASH_STORE_SIZE];
+static uint8_t s_ecc_bad[FLASH_SIM_UNITS];
+static FILE *s_file = NULL;
+static uint32_t s_tear_units = FLASH_SIM_NO_TEAR;
+static bool s_tear_erase = false;
+static uint32_t s_erase_count = 0U;
+static uint32_t s_ecc_errors = 0U;
+
+static bool flash_sim_sync(void)
+{
+    if (s_file == NULL)
+    {
+        return true;
+    }
+
+    return (fseek(s_file, 0L, SEEK_SET) == 0) && (fwrite(s_image, 1U, sizeof(s_image), s_file) == sizeof(s_image)) &&
+           (fwrite(s_ecc_bad, 1U, sizeof(s_ecc_bad), s_file) == sizeof(s_ecc_bad)) && (fflush(s_file) == 0);
+}
+
+bool flash_sim_open(const char *path)
+{
+    flash_sim_close();
+    memset(s_image, 0xFF, sizeof(s_image));
+    memset(s_ecc_bad, 0, sizeof(s_ecc_bad));
+    s_tear_units = FLASH_SIM_NO_TEAR;
+    s_tear_erase = false;
+    s_erase_count = 0U;
+    s_ecc_errors = 0U;
+    if (path == NULL)
+    {
+        return true;
+    }
+
+    s_file = fopen(path, "r+b");
+    if (s_file != NULL)
+    {
+        size_t size = fread(s_image, 1U, sizeof(s_image), s_file);
+
+        /* A short file reads as erased past its end, with no unit ECC-bad */
+        memset(&s_image[size], 0xFF, sizeof(s_image) - size);
+        if (size == sizeof(s_image))
+        {
+            size = fread(s_ecc_bad, 1U, sizeof(s_ecc_bad), s_file);
+            memset(&s_ecc_bad[size], 0, sizeof(s_ecc_bad) - size);
+        }
+        return true;
+    }
+
+    s_file = fopen(path, "w+b");
+    return (s_file != NULL) && flash_sim_sync();
+}
+
+void flash_sim_close(void)
+{
+    if (s_file != NULL)
+    {
+        fclose(s_file);
+        s_file = NULL;
+    }
+}
+
+void flash_sim_tear_next_write(uint32_t units)
+{
+    s_tear_units = units;
+}
+
+void flash_sim_tear_next_erase(void)
+{
+    s_tear_erase = true;
+}
+
+uint32_t flash_sim_erase_count(void)
+{
+    return s_erase_count;
+}
+
+uint32_t flash_sim_ecc_errors(void)
+{
+    return s_ecc_errors;
+}
+
+static bool flash_sim_in_store(uint32_t offset, uint32_t size)
+{
+    return (offset <= BSP_FLASH_STORE_SIZE) && (size <= (BSP_FLASH_STORE_SIZE - offset));
+}
+
+bool bsp_flash_store_read(uint32_t offset, void *data, uint32_t size)
+{
+    if ((data == NULL) || !flash_sim_in_store(offset, size))
+    {
+        return false;
+    }
+
+    memcpy(data, &s_image[offset], size);
+    for (uint32_t unit = offset / BSP_FLASH_WRITE_UNIT; (unit * BSP_FLASH_WRITE_UNIT) < (offset + size); unit++)
+    {
+        if (s_ecc_bad[unit] != 0U)
+        {
+            s_ecc_errors++;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool bsp_flash_store_erase(void)
+{
+    s_erase_count++;
+    if (s_tear_erase)
+    {
+        s_tear_erase = false;
+        for (uint32_t unit = 0U; unit < FLASH_SIM_UNITS; unit++)
+        {
+            for (uint32_t i = 0U; i < BSP_FLASH_WRITE_UNIT; i++)
+            {
+                s_ecc_bad[unit] |= (s_image[(unit * BSP_FLASH_WRITE_UNIT) + i] != 0xFFU) ? 1U : 0U;
+            }
+        }
+        (void)flash_sim_sync();
+        return false;
+    }
+    memset(s_image, 0xFF, sizeof(s_image));
+    memset(s_ecc_bad, 0, sizeof(s_ecc_bad));
+    return flash_sim_sync();
+}
+
+bool bsp_flash_store_write(uint32_t offset, const void *data, uint32_t size)
+{
+    const uint8_t *bytes = data;
+    uint32_t units = (size + BSP_FLASH_WRITE_UNIT - 1U) / BSP_FLASH_WRITE_UNIT;
+    bool torn = (s_tear_units != FLASH_SIM_NO_TEAR) && (s_tear_units < units);
+
+    if ((data == NULL) || ((offset % BSP_FLASH_WRITE_UNIT) != 0U) ||
+        !flash_sim_in_store(offset, units * BSP_FLASH_WRITE_UNIT))
+    {
+        return false;
+    }
+
+    units = torn ? s_tear_units : units;
+    s_tear_units = FLASH_SIM_NO_TEAR;
+    for (uint32_t unit = 0U; unit < units; unit++)
+    {
+        uint8_t *dst = &s_image[offset + (unit * BSP_FLASH_WRITE_UNIT)];
+        uint32_t done = unit * BSP_FLASH_WRITE_UNIT;
+        uint32_t chunk = ((size - done) < BSP_FLASH_WRITE_UNIT) ? (size - done) : BSP_FLASH_WRITE_UNIT;
+        bool erased = s_ecc_bad[(offset / BSP_FLASH_WRITE_UNIT) + unit] == 0U;
+
+        for (uint32_t i = 0U; i < BSP_FLASH_WRITE_UNIT; i++)
+        {
+            erased = erased && (dst[i] == 0xFFU);
+        }
+        if (!erased)
+        {
+            (void)flash_sim_sync();
+            return false;
+        }
+        memset(dst, 0xFF, BSP_FLASH_WRITE_UNIT);
+        memcpy(dst, &bytes[done], chunk);
+    }
+    /* The unit being programmed when the reset hit holds part of its bits and not its ECC */
+    if (torn)
+    {
+        uint32_t unit = (offset / BSP_FLASH_WRITE_UNIT) + units;
+        uint32_t done = units * BSP_FLASH_WRITE_UNIT;
+
+        memcpy(&s_image[unit * BSP_FLASH_WRITE_UNIT], &bytes[done],
+               ((size - done) < BSP_FLASH_WRITE_UNIT) ? (size - done) : BSP_FLASH_WRITE_UNIT);
+        s_ecc_bad[unit] = 1U;
+    }
+
+    return flash_sim_sync() && !torn;
+}
@@ -0,0 +1,31 @@
+#ifndef FLASH_SIM_H
+#define FLASH_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bsp_flash.h"
+
+/*
+ * Host stand-in for src/bsp/bsp_flash.c. The store sector lives in RAM and,
+ * once flash_sim_open() names a file, is written through to it so it survives
+ * between runs like flash survives a reset. Programming follows the target:
+ * only erased write units can be programmed. flash_sim_tear_next_write()
+ * and flash_sim_tear_next_erase() model a reset in the middle of a write or
+ * an erase: the units it caught half done fail their ECC, so reads over them
+ * fail like bsp_flash_nmi() makes them on the target, and only an erase
+ * clears them.
+ */
+
+/* path may be NULL for a RAM-only store; a missing file starts erased */
+bool flash_sim_open(const char *path);
+void flash_sim_close(void);
+/* The next bsp_flash_store_write() stops after `units` write units and fails, the unit after them ECC-bad */
+void flash_sim_tear_next_write(uint32_t units);
+/* The next bsp_flash_store_erase() stops half done and fails: every unit still holding data is ECC-bad */
+void flash_sim_tear_next_erase(void);
+uint32_t flash_sim_erase_count(void);
+/* Reads that failed on an ECC-bad unit since flash_sim_open() */
+uint32_t flash_sim_ecc_errors(void);
+
+#endif
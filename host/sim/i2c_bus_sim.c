@@ -0,0 +1,827 @@
+#include "i2c_bus_sim.h"
+
+#include <string.h>
+
+#include "bsp_gpio.h"
+#include "vl53l5cx_api.h"
+
+/* HAL call and transfer start, on top of the bits on the wire */
+#define I2C_BUS_SIM_SETUP_NS 2000U
+/* START and STOP, then 9 clocks per byte with its acknowledge */
+#define I2C_BUS_SIM_FRAME_BITS(bytes) (2U + (9U * (bytes)))
+
+#define I2C_BUS_SIM_PAGE_REG 0x7FFFU
+#define I2C_BUS_SIM_PAGE_COUNT 16U
+#define I2C_BUS_SIM_PAGE_SIZE 0x10000U
+#define I2C_BUS_SIM_FW_FIRST_PAGE 0x09U
+#define I2C_BUS_SIM_FW_LAST_PAGE 0x0BU
+#define I2C_BUS_SIM_FW_PAGE_SIZE 0x8000U
+#define I2C_BUS_SIM_ADDRESS_REG 0x0004U
+#define I2C_BUS_SIM_MCU_STOP_REG 0x0014U
+#define I2C_BUS_SIM_BUSES 2U
+
+/* Page 2 holds the command interface of the sensor firmware */
+#define I2C_BUS_SIM_UI_PAGE 0x02U
+#define I2C_BUS_SIM_OFFSET_REG 0x2E18U
+#define I2C_BUS_SIM_XTALK_REG 0x2CF8U
+#define I2C_BUS_SIM_DCI_FOOTER_SIZE 8U
+#define I2C_BUS_SIM_DCI_HEADER_SIZE 4U
+#define I2C_BUS_SIM_DCI_READ_CMD_SIZE 12U
+#define I2C_BUS_SIM_DCI_ENTRIES 32U
+#define I2C_BUS_SIM_DCI_MAX_SIZE 256U
+/* Ranging data layout the firmware reports once started, its word 2 is the read size */
+#define I2C_BUS_SIM_DCI_RANGE_INFO 0x5440U
+#define I2C_BUS_SIM_DCI_RANGE_INFO_SIZE 12U
+
+typedef struct
+{
+    uint16_t index;
+    uint16_t size;
+    uint8_t data[I2C_BUS_SIM_DCI_MAX_SIZE];
+} i2c_bus_sim_dci_t;
+
+typedef struct
+{
+    I2C_HandleTypeDef *hi2c;
+    uint16_t xshut_pin;
+    uint16_t int_pin;
+    uint32_t frame_ms;
+    uint32_t boot_delay_ms;
+    uint32_t nack;
+    bool plugged;
+    bool powered;
+    bool ranging;
+    /* Answers from then on, once out of reset */
+    uint64_t alive_ns;
+    uint64_t next_ready_ns;
+    uint16_t address;
+    uint8_t page;
+    uint16_t read_reg;
+    uint32_t fw_next_reg[I2C_BUS_SIM_FW_LAST_PAGE - I2C_BUS_SIM_FW_FIRST_PAGE + 1U];
+    /* What the next read at VL53L5CX_UI_CMD_START returns */
+    uint8_t reply[VL53L5CX_TEMPORARY_BUFFER_SIZE];
+    uint32_t reply_size;
+    i2c_bus_sim_dci_t dci[I2C_BUS_SIM_DCI_ENTRIES];
+    uint32_t dci_count;
+    uint8_t mem[I2C_BUS_SIM_PAGE_COUNT][I2C_BUS_SIM_PAGE_SIZE];
+} i2c_bus_sim_sensor_t;
+
+/* A DMA or IT read in flight, it lands at done_ns */
+typedef struct
+{
+    I2C_HandleTypeDef *hi2c;
+    i2c_bus_sim_sensor_t *sensor;
+    uint8_t *data;
+    uint16_t reg;
+    uint16_t size;
+    uint64_t done_ns;
+} i2c_bus_sim_read_t;
+
+typedef struct
+{
+    uint16_t pin;
+    gpio_exit_cb_t cb;
+} i2c_bus_sim_exti_t;
+
+I2C_HandleTypeDef hi2c1;
+I2C_HandleTypeDef hi2c3;
+GPIO_TypeDef host_gpioa;
+
+static i2c_bus_sim_sensor_t s_sensors[I2C_BUS_SIM_SENSORS];
+static i2c_bus_sim_read_t s_reads[I2C_BUS_SIM_BUSES];
+static i2c_bus_sim_exti_t s_exti[I2C_BUS_SIM_SENSORS];
+static uint32_t s_exti_count = 0U;
+static i2c_bus_sim_stats_t s_stats;
+static uint64_t s_now_ns = 0U;
+static uint32_t s_bus_hz = 400000U;
+/* Set while interrupts are dispatched, they do not nest */
+static bool s_in_irq = false;
+/* Only ever compared against NULL by the platform layer */
+static uint8_t s_dma_channel;
+
+static uint64_t i2c_bus_sim_transfer_ns(uint32_t bytes)
+{
+    return I2C_BUS_SIM_SETUP_NS + (((uint64_t)I2C_BUS_SIM_FRAME_BITS(bytes) * 1000000000ULL) / s_bus_hz);
+}
+
+/* Earliest data-ready or read completion, UINT64_MAX if none */
+static uint64_t i2c_bus_sim_next_event(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t i = 0U; i < I2C_BUS_SIM_SENSORS; i++)
+    {
+        const i2c_bus_sim_sensor_t *sensor = &s_sensors[i];
+
+        if (sensor->ranging && (sensor->next_ready_ns < next))
+        {
+            next = sensor->next_ready_ns;
+        }
+    }
+    for (uint32_t bus = 0U; bus < I2C_BUS_SIM_BUSES; bus++)
+    {
+        if ((s_reads[bus].hi2c != NULL) && (s_reads[bus].done_ns < next))
+        {
+            next = s_reads[bus].done_ns;
+        }
+    }
+    return next;
+}
+
+static void i2c_bus_sim_read_done(i2c_bus_sim_read_t *read)
+{
+    I2C_HandleTypeDef *hi2c = read->hi2c;
+    i2c_bus_sim_sensor_t *sensor = read->sensor;
+
+    read->hi2c = NULL;
+    hi2c->State = HAL_I2C_STATE_READY;
+    /* The sensor was lost while the data went out */
+    if ((sensor == NULL) || !sensor->powered || !sensor->plugged)
+    {
+        s_stats.read_errors++;
+        hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+        HAL_I2C_ErrorCallback(hi2c);
+        return;
+    }
+
+    memcpy(read->data, &sensor->mem[sensor->page][read->reg], read->size);
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    HAL_I2C_MemRxCpltCallback(hi2c);
+}
+
+static void i2c_bus_sim_data_ready(const i2c_bus_sim_sensor_t *sensor)
+{
+    s_stats.data_ready++;
+    for (uint32_t i = 0U; i < s_exti_count; i++)
+    {
+        if (s_exti[i].pin == sensor->int_pin)
+        {
+            s_exti[i].cb();
+        }
+    }
+}
+
+/* Moves the clock on, firing the interrupts that fall due on the way */
+static void i2c_bus_sim_advance(uint64_t ns)
+{
+    uint64_t end = s_now_ns + ns;
+
+    if (s_in_irq)
+    {
+        s_now_ns = end;
+        return;
+    }
+
+    s_in_irq = true;
+    for (;;)
+    {
+        uint64_t next = i2c_bus_sim_next_event();
+
+        if (next > end)
+        {
+            break;
+        }
+        s_now_ns = (next > s_now_ns) ? next : s_now_ns;
+        for (uint32_t bus = 0U; bus < I2C_BUS_SIM_BUSES; bus++)
+        {
+            if ((s_reads[bus].hi2c != NULL) && (s_reads[bus].done_ns <= s_now_ns))
+            {
+                i2c_bus_sim_read_done(&s_reads[bus]);
+            }
+        }
+        for (uint32_t i = 0U; i < I2C_BUS_SIM_SENSORS; i++)
+        {
+            i2c_bus_sim_sensor_t *sensor = &s_sensors[i];
+
+            if (sensor->ranging && (sensor->next_ready_ns <= s_now_ns))
+            {
+                sensor->next_ready_ns += (uint64_t)sensor->frame_ms * 1000000ULL;
+                i2c_bus_sim_data_ready(sensor);
+            }
+        }
+    }
+    s_now_ns = end;
+    s_in_irq = false;
+}
+
+/* A blocking transfer holds the bus, reads landing meanwhile find it busy */
+static void i2c_bus_sim_clock(I2C_HandleTypeDef *hi2c, uint32_t bytes)
+{
+    HAL_I2C_StateTypeDef state = hi2c->State;
+
+    s_stats.transfers++;
+    hi2c->State = HAL_I2C_STATE_BUSY_TX;
+    i2c_bus_sim_advance(i2c_bus_sim_transfer_ns(bytes));
+    hi2c->State = state;
+}
+
+static i2c_bus_sim_dci_t *i2c_bus_sim_dci_find(i2c_bus_sim_sensor_t *sensor, uint16_t index, bool create)
+{
+    for (uint32_t i = 0U; i < sensor->dci_count; i++)
+    {
+        if (sensor->dci[i].index == index)
+        {
+            return &sensor->dci[i];
+        }
+    }
+    if (!create || (sensor->dci_count >= I2C_BUS_SIM_DCI_ENTRIES))
+    {
+        return NULL;
+    }
+
+    sensor->dci[sensor->dci_count].index = index;
+    return &sensor->dci[sensor->dci_count++];
+}
+
+/* The ULD swaps DCI data to the firmware's word order before writing it and back after reading it, so the
+ * bytes are stored as written */
+static void i2c_bus_sim_dci_write(i2c_bus_sim_sensor_t *sensor, const uint8_t *cmd, uint32_t size)
+{
+    uint16_t index = (uint16_t)((cmd[0] << 8) | cmd[1]);
+    uint16_t data_size = (uint16_t)((cmd[2] << 4) | (cmd[3] >> 4));
+    i2c_bus_sim_dci_t *entry;
+
+    if ((data_size > I2C_BUS_SIM_DCI_MAX_SIZE) ||
+        ((I2C_BUS_SIM_DCI_HEADER_SIZE + data_size + I2C_BUS_SIM_DCI_FOOTER_SIZE) != size))
+    {
+        return;
+    }
+    entry = i2c_bus_sim_dci_find(sensor, index, true);
+    if (entry != NULL)
+    {
+        entry->size = data_size;
+        memcpy(entry->data, &cmd[I2C_BUS_SIM_DCI_HEADER_SIZE], data_size);
+    }
+}
+
+/* Header, the data asked for (zeroes for what was never written) and the footer */
+static void i2c_bus_sim_dci_read(i2c_bus_sim_sensor_t *sensor, const uint8_t *cmd)
+{
+    uint16_t index = (uint16_t)((cmd[0] << 8) | cmd[1]);
+    uint16_t data_size = (uint16_t)((cmd[2] << 4) | (cmd[3] >> 4));
+    const i2c_bus_sim_dci_t *entry = i2c_bus_sim_dci_find(sensor, index, false);
+
+    sensor->reply_size = I2C_BUS_SIM_DCI_HEADER_SIZE + (uint32_t)data_size + I2C_BUS_SIM_DCI_FOOTER_SIZE;
+    if (sensor->reply_size > sizeof(sensor->reply))
+    {
+        sensor->reply_size = 0U;
+        return;
+    }
+    memset(sensor->reply, 0, sensor->reply_size);
+    memcpy(sensor->reply, cmd, I2C_BUS_SIM_DCI_HEADER_SIZE);
+    if (entry != NULL)
+    {
+        memcpy(&sensor->reply[I2C_BUS_SIM_DCI_HEADER_SIZE], entry->data,
+               (entry->size < data_size) ? entry->size : data_size);
+    }
+}
+
+/* Starting to range publishes the read size that was configured through the output config; the first
+ * data-ready follows a frame period later */
+static void i2c_bus_sim_start_ranging(i2c_bus_sim_sensor_t *sensor)
+{
+    const i2c_bus_sim_dci_t *config = i2c_bus_sim_dci_find(sensor, VL53L5CX_DCI_OUTPUT_CONFIG, false);
+    i2c_bus_sim_dci_t *info = i2c_bus_sim_dci_find(sensor, I2C_BUS_SIM_DCI_RANGE_INFO, true);
+
+    if (info == NULL)
+    {
+        return;
+    }
+    if (sensor->frame_ms > 0U)
+    {
+        sensor->ranging = true;
+        sensor->next_ready_ns = s_now_ns + ((uint64_t)sensor->frame_ms * 1000000ULL);
+    }
+    memset(info->data, 0, I2C_BUS_SIM_DCI_RANGE_INFO_SIZE);
+    info->size = I2C_BUS_SIM_DCI_RANGE_INFO_SIZE;
+    if ((config != NULL) && (config->size >= 4U))
+    {
+        memcpy(&info->data[8], config->data, 4U);
+    }
+}
+
+/* Commands end at VL53L5CX_UI_CMD_END and the firmware answers them at once. Any other one (the NVM read)
+ * is answered with zeroes. */
+static void i2c_bus_sim_command(i2c_bus_sim_sensor_t *sensor, const uint8_t *cmd, uint32_t size)
+{
+    static const uint8_t s_start_cmd[] = {0x00U, 0x03U, 0x00U, 0x00U};
+    static const uint8_t s_read_tail[] = {0x00U, 0x00U, 0x00U, 0x0FU, 0x00U, 0x02U, 0x00U, 0x08U};
+    const uint8_t *footer = (size >= I2C_BUS_SIM_DCI_FOOTER_SIZE) ? &cmd[size - I2C_BUS_SIM_DCI_FOOTER_SIZE] : cmd;
+
+    if ((size == sizeof(s_start_cmd)) && (memcmp(cmd, s_start_cmd, sizeof(s_start_cmd)) == 0))
+    {
+        i2c_bus_sim_start_ranging(sensor);
+    }
+    else if ((size == I2C_BUS_SIM_DCI_READ_CMD_SIZE) && (memcmp(footer, s_read_tail, sizeof(s_read_tail)) == 0))
+    {
+        i2c_bus_sim_dci_read(sensor, cmd);
+    }
+    else if ((size >= (I2C_BUS_SIM_DCI_HEADER_SIZE + I2C_BUS_SIM_DCI_FOOTER_SIZE)) && (footer[3] == 0x0FU) &&
+             (footer[4] == 0x05U))
+    {
+        i2c_bus_sim_dci_write(sensor, cmd, size);
+    }
+    else
+    {
+        memset(sensor->reply, 0, sizeof(sensor->reply));
+        sensor->reply_size = sizeof(sensor->reply);
+    }
+}
+
+static void i2c_bus_sim_write(i2c_bus_sim_sensor_t *sensor, uint16_t reg, const uint8_t *data, uint32_t size)
+{
+    uint8_t page = sensor->page;
+
+    s_stats.writes++;
+    s_stats.bytes += size;
+    s_stats.max_write = (size > s_stats.max_write) ? size : s_stats.max_write;
+
+    if ((reg == I2C_BUS_SIM_PAGE_REG) && (size == 1U))
+    {
+        sensor->page = data[0];
+        return;
+    }
+    if ((page >= I2C_BUS_SIM_PAGE_COUNT) || (((uint32_t)reg + size) > I2C_BUS_SIM_PAGE_SIZE))
+    {
+        return;
+    }
+    memcpy(&sensor->mem[page][reg], data, size);
+
+    if ((page == 0U) && (reg == I2C_BUS_SIM_ADDRESS_REG) && (size == 1U))
+    {
+        sensor->address = (uint16_t)(data[0] << 1);
+    }
+    else if ((page == 0U) && (reg == I2C_BUS_SIM_MCU_STOP_REG) && (size == 1U))
+    {
+        /* vl53l5cx_stop_ranging() stops the MCU, then polls for it in the GO2 status */
+        sensor->ranging = sensor->ranging && (data[0] == 0U);
+        sensor->mem[0][0x06] = (data[0] != 0U) ? 0x81U : 0x01U;
+        sensor->mem[0][0x07] = (data[0] != 0U) ? 0x84U : 0x00U;
+    }
+    else if ((page >= I2C_BUS_SIM_FW_FIRST_PAGE) && (page <= I2C_BUS_SIM_FW_LAST_PAGE))
+    {
+        uint32_t *next_reg = &sensor->fw_next_reg[page - I2C_BUS_SIM_FW_FIRST_PAGE];
+
+        s_stats.firmware_writes++;
+        s_stats.firmware_gaps += (reg != *next_reg) ? 1U : 0U;
+        *next_reg = (uint32_t)reg + size;
+    }
+    else if (page == I2C_BUS_SIM_UI_PAGE)
+    {
+        if (reg == I2C_BUS_SIM_OFFSET_REG)
+        {
+            s_stats.offset_bytes = size;
+        }
+        else if (reg == I2C_BUS_SIM_XTALK_REG)
+        {
+            s_stats.xtalk_bytes = size;
+        }
+        if (((uint32_t)reg + size) == ((uint32_t)VL53L5CX_UI_CMD_END + 1U))
+        {
+            i2c_bus_sim_command(sensor, data, size);
+        }
+    }
+}
+
+static void i2c_bus_sim_read(i2c_bus_sim_sensor_t *sensor, uint16_t reg, uint8_t *data, uint32_t size)
+{
+    uint8_t page = sensor->page;
+
+    memset(data, 0, size);
+    if (reg == I2C_BUS_SIM_PAGE_REG)
+    {
+        data[0] = page;
+    }
+    else if ((page == I2C_BUS_SIM_UI_PAGE) && (reg == VL53L5CX_UI_CMD_START))
+    {
+        memcpy(data, sensor->reply, (size < sensor->reply_size) ? size : sensor->reply_size);
+    }
+    else if ((page < I2C_BUS_SIM_PAGE_COUNT) && (((uint32_t)reg + size) <= I2C_BUS_SIM_PAGE_SIZE))
+    {
+        memcpy(data, &sensor->mem[page][reg], size);
+    }
+}
+
+/* Power-on state: default address, the id registers, and the boot and MCU status the init polls */
+static void i2c_bus_sim_power_on(i2c_bus_sim_sensor_t *sensor)
+{
+    sensor->powered = true;
+    sensor->ranging = false;
+    sensor->alive_ns = s_now_ns + ((uint64_t)sensor->boot_delay_ms * 1000000ULL);
+    sensor->address = VL53L5CX_DEFAULT_I2C_ADDRESS;
+    sensor->page = 0U;
+    sensor->read_reg = 0U;
+    memset(sensor->fw_next_reg, 0, sizeof(sensor->fw_next_reg));
+    sensor->reply_size = 0U;
+    sensor->dci_count = 0U;
+    memset(sensor->mem, 0, sizeof(sensor->mem));
+    /* Device and revision id, the boot and MCU status the init polls, firmware access granted */
+    sensor->mem[0][0x00] = 0xF0U;
+    sensor->mem[0][0x01] = 0x02U;
+    sensor->mem[0][0x06] = 0x01U;
+    sensor->mem[1][0x21] = 0x10U;
+    /* Command status: NVM read done (byte 0) and command done (byte 1) */
+    sensor->mem[I2C_BUS_SIM_UI_PAGE][VL53L5CX_UI_CMD_STATUS] = 0x02U;
+    sensor->mem[I2C_BUS_SIM_UI_PAGE][VL53L5CX_UI_CMD_STATUS + 1U] = 0x03U;
+}
+
+static void i2c_bus_sim_power_off(i2c_bus_sim_sensor_t *sensor)
+{
+    sensor->powered = false;
+    sensor->ranging = false;
+}
+
+/* The sensor at the address on the bus, NULL if none acknowledges it. Two sensors at the same address garble
+ * the transfer, and a sensor with NACKs to inject leaves it unacknowledged. */
+static i2c_bus_sim_sensor_t *i2c_bus_sim_find(I2C_HandleTypeDef *hi2c, uint16_t address)
+{
+    i2c_bus_sim_sensor_t *found = NULL;
+    uint32_t answers = 0U;
+
+    for (uint32_t i = 0U; i < I2C_BUS_SIM_SENSORS; i++)
+    {
+        i2c_bus_sim_sensor_t *sensor = &s_sensors[i];
+
+        if ((sensor->hi2c == hi2c) && sensor->plugged && sensor->powered && (s_now_ns >= sensor->alive_ns) &&
+            (sensor->address == address))
+        {
+            found = sensor;
+            answers++;
+        }
+    }
+    if (answers > 1U)
+    {
+        s_stats.collisions++;
+        found = NULL;
+    }
+    else if ((found != NULL) && (found->nack > 0U))
+    {
+        found->nack--;
+        found = NULL;
+    }
+    return found;
+}
+
+/* A blocking transfer that finds no sensor ends after the address byte */
+static i2c_bus_sim_sensor_t *i2c_bus_sim_ack(I2C_HandleTypeDef *hi2c, uint16_t address)
+{
+    i2c_bus_sim_sensor_t *found = i2c_bus_sim_find(hi2c, address);
+
+    if (found != NULL)
+    {
+        hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+        return found;
+    }
+
+    i2c_bus_sim_clock(hi2c, 1U);
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return NULL;
+}
+
+/* A blocking transfer cannot start while a DMA or IT read holds the bus */
+static bool i2c_bus_sim_bus_free(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->State == HAL_I2C_STATE_READY)
+    {
+        return true;
+    }
+    s_stats.busy++;
+    return false;
+}
+
+static uint32_t i2c_bus_sim_bus_index(const I2C_HandleTypeDef *hi2c)
+{
+    return (hi2c == &hi2c1) ? 0U : 1U;
+}
+
+void i2c_bus_sim_init(uint32_t bus_hz, bool dma)
+{
+    memset(s_sensors, 0, sizeof(s_sensors));
+    memset(s_reads, 0, sizeof(s_reads));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_now_ns = 0U;
+    s_bus_hz = (bus_hz > 0U) ? bus_hz : 400000U;
+    /* The EXTI dispatch belongs to the firmware, its handlers stay registered */
+    s_in_irq = false;
+
+    memset(&hi2c1, 0, sizeof(hi2c1));
+    memset(&hi2c3, 0, sizeof(hi2c3));
+    hi2c1.State = HAL_I2C_STATE_READY;
+    hi2c3.State = HAL_I2C_STATE_READY;
+    hi2c1.hdmatx = dma ? (DMA_HandleTypeDef *)(void *)&s_dma_channel : NULL;
+    hi2c1.hdmarx = hi2c1.hdmatx;
+
+    s_sensors[0].hi2c = &hi2c1;
+    s_sensors[0].plugged = true;
+    i2c_bus_sim_power_on(&s_sensors[0]);
+}
+
+void i2c_bus_sim_wire(uint8_t sensor, I2C_HandleTypeDef *hi2c, uint16_t xshut_pin, uint16_t int_pin,
+                      uint32_t frame_ms)
+{
+    i2c_bus_sim_sensor_t *entry;
+
+    if (sensor >= I2C_BUS_SIM_SENSORS)
+    {
+        return;
+    }
+
+    entry = &s_sensors[sensor];
+    entry->hi2c = hi2c;
+    entry->xshut_pin = xshut_pin;
+    entry->int_pin = int_pin;
+    entry->frame_ms = frame_ms;
+    entry->plugged = true;
+    i2c_bus_sim_power_off(entry);
+}
+
+void i2c_bus_sim_set_boot_delay(uint8_t sensor, uint32_t ms)
+{
+    if (sensor < I2C_BUS_SIM_SENSORS)
+    {
+        s_sensors[sensor].boot_delay_ms = ms;
+    }
+}
+
+void i2c_bus_sim_set_plugged(uint8_t sensor, bool plugged)
+{
+    i2c_bus_sim_sensor_t *entry;
+
+    if (sensor >= I2C_BUS_SIM_SENSORS)
+    {
+        return;
+    }
+
+    entry = &s_sensors[sensor];
+    if (plugged && !entry->plugged && entry->powered)
+    {
+        i2c_bus_sim_power_on(entry);
+    }
+    else if (!plugged)
+    {
+        entry->ranging = false;
+    }
+    entry->plugged = plugged;
+}
+
+void i2c_bus_sim_nack(uint8_t sensor, uint32_t transfers)
+{
+    if (sensor < I2C_BUS_SIM_SENSORS)
+    {
+        s_sensors[sensor].nack = transfers;
+    }
+}
+
+bool i2c_bus_sim_ranging(uint8_t sensor)
+{
+    return (sensor < I2C_BUS_SIM_SENSORS) && s_sensors[sensor].ranging;
+}
+
+uint64_t i2c_bus_sim_now_ns(void)
+{
+    return s_now_ns;
+}
+
+const i2c_bus_sim_stats_t *i2c_bus_sim_stats(void)
+{
+    return &s_stats;
+}
+
+bool i2c_bus_sim_firmware_matches(const uint8_t *image, uint32_t size)
+{
+    const i2c_bus_sim_sensor_t *sensor = &s_sensors[0];
+
+    for (uint32_t offset = 0U; offset < size; offset += I2C_BUS_SIM_FW_PAGE_SIZE)
+    {
+        uint32_t page = I2C_BUS_SIM_FW_FIRST_PAGE + (offset / I2C_BUS_SIM_FW_PAGE_SIZE);
+        uint32_t chunk = ((size - offset) < I2C_BUS_SIM_FW_PAGE_SIZE) ? (size - offset) : I2C_BUS_SIM_FW_PAGE_SIZE;
+
+        if ((page > I2C_BUS_SIM_FW_LAST_PAGE) || (memcmp(sensor->mem[page], &image[offset], chunk) != 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(s_now_ns / 1000000ULL);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    i2c_bus_sim_advance((uint64_t)Delay * 1000000ULL);
+}
+
+/* XSHUT high takes the sensors behind the pin out of reset, low powers them down */
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    (void)GPIOx;
+    for (uint32_t i = 0U; i < I2C_BUS_SIM_SENSORS; i++)
+    {
+        i2c_bus_sim_sensor_t *sensor = &s_sensors[i];
+
+        if ((sensor->hi2c == NULL) || (sensor->xshut_pin != GPIO_Pin))
+        {
+            continue;
+        }
+        if (PinState == GPIO_PIN_SET)
+        {
+            if (!sensor->powered)
+            {
+                i2c_bus_sim_power_on(sensor);
+            }
+        }
+        else
+        {
+            i2c_bus_sim_power_off(sensor);
+        }
+    }
+}
+
+/* The bsp_gpio EXTI dispatch, fed by the data-ready lines of the sensors */
+void bsp_gpio_exit_register_cb(gpio_exit_cb_t cb, uint16_t pin)
+{
+    if (s_exti_count >= I2C_BUS_SIM_SENSORS)
+    {
+        return;
+    }
+    s_exti[s_exti_count].cb = cb;
+    s_exti[s_exti_count].pin = pin;
+    s_exti_count++;
+}
+
+/* Two bytes set the register the next receive starts at, more are a register write */
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size,
+                                          uint32_t Timeout)
+{
+    i2c_bus_sim_sensor_t *sensor;
+    uint16_t reg;
+
+    (void)Timeout;
+    if (!i2c_bus_sim_bus_free(hi2c))
+    {
+        return HAL_BUSY;
+    }
+    sensor = i2c_bus_sim_ack(hi2c, DevAddress);
+    if ((sensor == NULL) || (Size < 2U))
+    {
+        return HAL_ERROR;
+    }
+
+    i2c_bus_sim_clock(hi2c, 1U + Size);
+    reg = (uint16_t)((pData[0] << 8) | pData[1]);
+    if (Size == 2U)
+    {
+        sensor->read_reg = reg;
+    }
+    else
+    {
+        i2c_bus_sim_write(sensor, reg, &pData[2], Size - 2U);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size,
+                                         uint32_t Timeout)
+{
+    i2c_bus_sim_sensor_t *sensor;
+
+    (void)Timeout;
+    if (!i2c_bus_sim_bus_free(hi2c))
+    {
+        return HAL_BUSY;
+    }
+    sensor = i2c_bus_sim_ack(hi2c, DevAddress);
+    if (sensor == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    i2c_bus_sim_clock(hi2c, 1U + Size);
+    i2c_bus_sim_read(sensor, sensor->read_reg, pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    i2c_bus_sim_sensor_t *sensor;
+
+    (void)Timeout;
+    if (MemAddSize != I2C_MEMADD_SIZE_16BIT)
+    {
+        return HAL_ERROR;
+    }
+    if (!i2c_bus_sim_bus_free(hi2c))
+    {
+        return HAL_BUSY;
+    }
+    sensor = i2c_bus_sim_ack(hi2c, DevAddress);
+    if (sensor == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    i2c_bus_sim_clock(hi2c, 3U + Size);
+    i2c_bus_sim_write(sensor, MemAddress, pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                        uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    HAL_StatusTypeDef status;
+
+    if (hi2c->hdmatx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    status = HAL_I2C_Mem_Write(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size, 0U);
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+    s_stats.dma_writes++;
+    return HAL_OK;
+}
+
+/* The read runs in the background and ends in HAL_I2C_MemRxCpltCallback() or HAL_I2C_ErrorCallback(); an
+ * address NACK ends it after the address byte */
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                      uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    i2c_bus_sim_read_t *read = &s_reads[i2c_bus_sim_bus_index(hi2c)];
+    i2c_bus_sim_sensor_t *sensor;
+    uint32_t bytes = 1U;
+
+    if ((MemAddSize != I2C_MEMADD_SIZE_16BIT) || (pData == NULL) || (Size == 0U))
+    {
+        return HAL_ERROR;
+    }
+    if (!i2c_bus_sim_bus_free(hi2c))
+    {
+        return HAL_BUSY;
+    }
+
+    sensor = i2c_bus_sim_find(hi2c, DevAddress);
+    if ((sensor != NULL) && (((uint32_t)MemAddress + Size) <= I2C_BUS_SIM_PAGE_SIZE) &&
+        (sensor->page < I2C_BUS_SIM_PAGE_COUNT))
+    {
+        bytes = 4U + Size;
+    }
+    else
+    {
+        sensor = NULL;
+    }
+
+    s_stats.transfers++;
+    s_stats.reads++;
+    hi2c->State = HAL_I2C_STATE_BUSY_RX;
+    read->hi2c = hi2c;
+    read->sensor = sensor;
+    read->data = pData;
+    read->reg = MemAddress;
+    read->size = Size;
+    read->done_ns = s_now_ns + i2c_bus_sim_transfer_ns(bytes);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                       uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+    if (hi2c->hdmarx == NULL)
+    {
+        return HAL_ERROR;
+    }
+    return HAL_I2C_Mem_Read_IT(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+/* Weak like in the HAL, vl53l5cx.c overrides them */
+__attribute__((weak)) void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)hi2c;
+}
+
+__attribute__((weak)) void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    (void)hi2c;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress)
+{
+    (void)DevAddress;
+    hi2c->State = HAL_I2C_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(const I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->State;
+}
+
+uint32_t HAL_I2C_GetError(const I2C_HandleTypeDef *hi2c)
+{
+    return hi2c->ErrorCode;
+}
@@ -0,0 +1,66 @@
+#ifndef I2C_BUS_SIM_H
+#define I2C_BUS_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stm32h5xx_hal.h"
+
+/*
+ * Host stand-in for the HAL I2C driver, tick and GPIO, modelling a board of
+ * up to I2C_BUS_SIM_SENSORS VL53L5CX on hi2c1 and hi2c3. A sensor answers the
+ * register polls of vl53l5cx_init() at once, keeps what is written to it
+ * (firmware pages included) and runs the DCI command interface, so the real
+ * ULD and platform.c boot it; once ranging it raises its data-ready line
+ * every frame period. Time only moves with the bus: every transfer costs its
+ * bits at the bus speed plus a fixed setup, and HAL_Delay() advances it, so
+ * HAL_GetTick() reports the modelled time. Data-ready and the end of a DMA or
+ * IT read fire as time moves, like interrupts. A DMA write completes before
+ * HAL_I2C_Mem_Write_DMA() returns.
+ *
+ * Faults are injected per sensor: a delay before it answers once out of
+ * reset, a run of transfers it leaves unacknowledged, and unplugging.
+ */
+
+#define I2C_BUS_SIM_SENSORS 4U
+
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c3;
+
+typedef struct
+{
+    uint32_t transfers;
+    uint32_t writes;
+    uint32_t dma_writes;
+    uint32_t max_write;
+    uint64_t bytes;
+    /* Writes into the firmware pages, and those not starting where the previous one on the page ended */
+    uint32_t firmware_writes;
+    uint32_t firmware_gaps;
+    /* Bytes of the last offset and xtalk buffer sent */
+    uint32_t offset_bytes;
+    uint32_t xtalk_bytes;
+    /* Transfers answered by two sensors at once, and refused because the bus was busy */
+    uint32_t collisions;
+    uint32_t busy;
+    uint32_t data_ready;
+    uint32_t reads;
+    uint32_t read_errors;
+} i2c_bus_sim_stats_t;
+
+/* Sensor 0 alone on hi2c1, out of reset at the default address; hi2c1 gets DMA channels when dma is set */
+void i2c_bus_sim_init(uint32_t bus_hz, bool dma);
+/* Puts a sensor on hi2c behind the XSHUT and INT pins, in reset until XSHUT goes high */
+void i2c_bus_sim_wire(uint8_t sensor, I2C_HandleTypeDef *hi2c, uint16_t xshut_pin, uint16_t int_pin,
+                      uint32_t frame_ms);
+void i2c_bus_sim_set_boot_delay(uint8_t sensor, uint32_t ms);
+/* Unplugging loses the firmware: plugged back, the sensor is at the default address */
+void i2c_bus_sim_set_plugged(uint8_t sensor, bool plugged);
+void i2c_bus_sim_nack(uint8_t sensor, uint32_t transfers);
+bool i2c_bus_sim_ranging(uint8_t sensor);
+uint64_t i2c_bus_sim_now_ns(void);
+const i2c_bus_sim_stats_t *i2c_bus_sim_stats(void);
+/* Whether the firmware pages of sensor 0 hold the image, in the order vl53l5cx_init() downloads it */
+bool i2c_bus_sim_firmware_matches(const uint8_t *image, uint32_t size);
+
+#endif
@@ -0,0 +1,465 @@
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_log_reader.h"
+#include "frame_queue.h"
+#include "sensor_manager.h"
+#include "vl53l5cx_sim.h"
+
+/*
+ * Discrete-event model of frame acquisition at a given ODR, I2C clock and
+ * per-frame processing time. "blocking" is the original super-loop (poll the
+ * data-ready flag, read the frame on the CPU, then process it); "queued" runs
+ * the real sensor_manager/frame_queue code against the simulated sensor, with
+ * the DMA read overlapping processing of the previous frame. Every delivered
+ * frame is compared with the frame the sensor produced. With -m it prints the
+ * bus model of the output profiles instead.
+ */
+
+#define SIM_DEFAULT_FRAMES 2000U
+#define SIM_DEFAULT_BUS_HZ 400000U
+#define SIM_DEFAULT_PROCESS_US 60000U
+#define SIM_I2C_READ_OVERHEAD_BYTES 4U
+#define SIM_NS_NEVER UINT64_MAX
+/* Highest ranging frequency of the sensor itself */
+#define SIM_SENSOR_MAX_ODR_4X4 60U
+#define SIM_SENSOR_MAX_ODR_8X8 15U
+
+typedef struct {
+    uint32_t produced;
+    uint32_t delivered;
+    uint32_t dropped;
+    uint32_t overruns;
+    uint32_t bus_errors;
+    uint32_t mismatches;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+    uint64_t cpu_bus_wait_ns;
+    uint64_t end_ns;
+} sim_result_t;
+
+typedef struct {
+    VL53L5CX_ResultsData *frames;
+    uint32_t count;
+    uint64_t period_ns;
+    uint64_t transfer_ns;
+    uint64_t process_ns;
+    uint32_t error_every;
+} sim_config_t;
+
+static uint32_t s_sim_rng = 0x12345678U;
+
+static const char *const s_profile_names[VL53L5_PROFILE_COUNT] = {"minimal", "tracking", "diagnostic"};
+
+static uint32_t sim_rand(void)
+{
+    s_sim_rng = (s_sim_rng * 1664525U) + 1013904223U;
+    return s_sim_rng >> 8;
+}
+
+static void sim_tag_frame(VL53L5CX_ResultsData *frame, uint32_t index)
+{
+    vl53l5_sim_set_tag(frame, index);
+    vl53l5_sim_quantize(frame);
+}
+
+static void sim_generate_frame(VL53L5CX_ResultsData *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->silicon_temp_degc = (int8_t)(20U + (sim_rand() % 30U));
+    for (uint32_t i = 0U; i < VL53L5CX_RESOLUTION_8X8; i++)
+    {
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+        frame->ambient_per_spad[i] = sim_rand();
+#endif
+        frame->nb_target_detected[i] = ((sim_rand() % 32U) == 0U) ? 0U : 1U;
+#ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
+        frame->nb_spads_enabled[i] = sim_rand();
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+        frame->signal_per_spad[i] = sim_rand();
+#endif
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+        frame->range_sigma_mm[i] = (uint16_t)sim_rand();
+#endif
+        frame->distance_mm[i] = (int16_t)(sim_rand() % 4000U);
+#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+        frame->reflectance[i] = (uint8_t)sim_rand();
+#endif
+        frame->target_status[i] = ((sim_rand() % 8U) == 0U) ? 4U : 5U;
+    }
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+    frame->motion_indicator.global_indicator_2 = sim_rand();
+    frame->motion_indicator.status = (uint8_t)sim_rand();
+    for (uint32_t i = 0U; i < 32U; i++)
+    {
+        frame->motion_indicator.motion[i] = sim_rand();
+    }
+#endif
+}
+
+static uint32_t sim_load_frames(const char *path, uint32_t limit, VL53L5CX_ResultsData **frames)
+{
+    frame_log_reader_t reader;
+    uint32_t count = 0U;
+
+    *frames = calloc(limit, sizeof(VL53L5CX_ResultsData));
+    if (*frames == NULL)
+    {
+        return 0U;
+    }
+
+    if (path == NULL)
+    {
+        for (count = 0U; count < limit; count++)
+        {
+            sim_generate_frame(&(*frames)[count]);
+        }
+    }
+    else
+    {
+        if (!frame_log_reader_open(&reader, path))
+        {
+            return 0U;
+        }
+        while ((count < limit) && frame_log_reader_next(&reader, &(*frames)[count], NULL))
+        {
+            for (uint32_t i = 0U; i < VL53L5CX_RESOLUTION_8X8; i++)
+            {
+                (*frames)[count].nb_target_detected[i] = ((*frames)[count].target_status[i] == 255U) ? 0U : 1U;
+            }
+            count++;
+        }
+        frame_log_reader_close(&reader);
+    }
+
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        sim_tag_frame(&(*frames)[i], i);
+    }
+    return count;
+}
+
+static void sim_deliver(const sim_config_t *config, sim_result_t *result, const VL53L5CX_ResultsData *frame,
+                        uint64_t done_ns)
+{
+    uint32_t tag = vl53l5_sim_get_tag(frame);
+    uint64_t latency_ns;
+
+    if ((tag >= config->count) || (memcmp(frame, &config->frames[tag], sizeof(*frame)) != 0))
+    {
+        result->mismatches++;
+        return;
+    }
+
+    latency_ns = done_ns - ((uint64_t)tag * config->period_ns);
+    result->delivered++;
+    result->latency_sum_ns += latency_ns;
+    if (latency_ns > result->latency_max_ns)
+    {
+        result->latency_max_ns = latency_ns;
+    }
+}
+
+/* Original flow: the flag set by the EXTI is polled, the frame is read on the CPU and then processed */
+static void sim_run_blocking(const sim_config_t *config, sim_result_t *result)
+{
+    static uint8_t raw[VL53L5CX_MAX_RESULTS_SIZE] __attribute__((aligned(4)));
+    VL53L5CX_ResultsData decoded;
+    uint64_t cpu_free_ns = 0U;
+    uint32_t reads = 0U;
+    int32_t pending = -1;
+
+    memset(result, 0, sizeof(*result));
+    vl53l5_sim_init();
+
+    memset(&decoded, 0, sizeof(decoded));
+    for (uint32_t k = 0U; k <= config->count; k++)
+    {
+        uint64_t now_ns = (k < config->count) ? ((uint64_t)k * config->period_ns) : SIM_NS_NEVER;
+
+        /* The CPU picks up the pending frame as soon as it is idle, before this one lands */
+        while ((pending >= 0) && (cpu_free_ns <= now_ns))
+        {
+            uint64_t start_ns = cpu_free_ns;
+            bool ok;
+
+            if (start_ns < ((uint64_t)pending * config->period_ns))
+            {
+                start_ns = (uint64_t)pending * config->period_ns;
+            }
+
+            reads++;
+            ok = (config->error_every == 0U) || ((reads % config->error_every) != 0U);
+            (void)vl53l5_sim_encode(&config->frames[pending], (uint8_t)pending, raw);
+            result->cpu_bus_wait_ns += config->transfer_ns;
+            cpu_free_ns = start_ns + config->transfer_ns;
+            if (ok && vl53l5_decode(0U, raw, &decoded))
+            {
+                cpu_free_ns += config->process_ns;
+                sim_deliver(config, result, &decoded, cpu_free_ns);
+            }
+            else
+            {
+                result->bus_errors++;
+            }
+            pending = -1;
+        }
+
+        if (k == config->count)
+        {
+            break;
+        }
+        if (pending >= 0)
+        {
+            /* Sensor overwrote a frame nobody read */
+            result->dropped++;
+        }
+        pending = (int32_t)k;
+        result->produced++;
+    }
+
+    result->end_ns = cpu_free_ns;
+}
+
+/* Queued flow: the real sensor_manager and frame_queue against the simulated sensor */
+static void sim_run_queued(const sim_config_t *config, sim_result_t *result)
+{
+    const VL53L5CX_ResultsData *frame = NULL;
+    sensor_stats_t stats;
+    uint64_t read_done_ns = SIM_NS_NEVER;
+    uint64_t cpu_free_ns = 0U;
+    uint64_t now_ns = 0U;
+    uint32_t reads = 0U;
+    uint32_t k = 0U;
+
+    memset(result, 0, sizeof(*result));
+    vl53l5_sim_init();
+    sensor_init();
+
+    while ((k < config->count) || (read_done_ns != SIM_NS_NEVER) || (cpu_free_ns > now_ns))
+    {
+        uint64_t frame_ns = (k < config->count) ? ((uint64_t)k * config->period_ns) : SIM_NS_NEVER;
+        uint64_t cpu_ns = (cpu_free_ns > now_ns) ? cpu_free_ns : SIM_NS_NEVER;
+
+        now_ns = frame_ns;
+        if (read_done_ns < now_ns)
+        {
+            now_ns = read_done_ns;
+        }
+        if (cpu_ns < now_ns)
+        {
+            now_ns = cpu_ns;
+        }
+
+        if (now_ns == read_done_ns)
+        {
+            reads++;
+            read_done_ns = SIM_NS_NEVER;
+            vl53l5_sim_complete_read(0U, (config->error_every == 0U) || ((reads % config->error_every) != 0U));
+        }
+        if (now_ns == frame_ns)
+        {
+            vl53l5_sim_set_frame(0U, &config->frames[k]);
+            if (vl53l5_sim_read_pending(0U) && (read_done_ns == SIM_NS_NEVER))
+            {
+                read_done_ns = now_ns + config->transfer_ns;
+            }
+            result->produced++;
+            k++;
+        }
+
+        if ((cpu_free_ns <= now_ns) && sensor_get_data(NULL, &frame))
+        {
+            cpu_free_ns = now_ns + config->process_ns;
+            sim_deliver(config, result, frame, cpu_free_ns);
+        }
+    }
+
+    /* Hands the last slot back */
+    (void)sensor_get_data(NULL, &frame);
+    sensor_get_stats(0U, &stats);
+    result->dropped = stats.dropped;
+    result->overruns = stats.overruns;
+    result->bus_errors = stats.bus_errors + stats.decode_errors;
+    result->end_ns = cpu_free_ns;
+}
+
+static void sim_print(const char *name, const sim_result_t *result)
+{
+    double mean_ms = (result->delivered > 0U) ? ((double)result->latency_sum_ns / result->delivered / 1e6) : 0.0;
+
+    printf("%-9s %9u %9u %8u %8u %8u %10.2f %10.2f %9.1f %10u\n", name, result->produced, result->delivered,
+           result->dropped, result->overruns, result->bus_errors, mean_ms, (double)result->latency_max_ns / 1e6,
+           (result->end_ns > 0U) ? (100.0 * (double)result->cpu_bus_wait_ns / (double)result->end_ns) : 0.0,
+           result->mismatches);
+}
+
+/* 9 clocks per byte, plus device address and 16-bit register address */
+static uint64_t sim_transfer_ns(uint32_t size, uint32_t bus_hz)
+{
+    return ((uint64_t)(size + SIM_I2C_READ_OVERHEAD_BYTES) * 9U * 1000000000ULL) / bus_hz;
+}
+
+/*
+ * Bytes per frame of every profile as the sensor streams them, whether this
+ * build compiles all of their outputs in or not, and the highest ODR the bus
+ * carries when the devices sharing it take turns. The achievable ODR is also
+ * capped by the sensor.
+ */
+static void sim_print_bus_model(void)
+{
+    static const uint32_t bus_hz[] = {400000U, 1000000U};
+    static const uint32_t zones[] = {VL53L5CX_RESOLUTION_4X4, VL53L5CX_RESOLUTION_8X8};
+    uint32_t per_bus = (VL53L5_DEVICE_COUNT + VL53L5_BUS_COUNT - 1U) / VL53L5_BUS_COUNT;
+
+    printf("%u sensor(s) per bus, ODR in Hz: bus limit / achievable\n", per_bus);
+    printf("%-11s %5s %6s %16s %16s\n", "profile", "zones", "bytes", "400 kHz", "1 MHz");
+    for (uint32_t z = 0U; z < (uint32_t)(sizeof(zones) / sizeof(zones[0])); z++)
+    {
+        double sensor_max = (zones[z] == VL53L5CX_RESOLUTION_4X4) ? SIM_SENSOR_MAX_ODR_4X4 : SIM_SENSOR_MAX_ODR_8X8;
+
+        for (uint32_t p = 0U; p < VL53L5_PROFILE_COUNT; p++)
+        {
+            uint32_t size = vl53l5_sim_read_size(vl53l5_profile_outputs((vl53l5_output_profile_t)p), zones[z]);
+
+            printf("%-11s %5u %6u", s_profile_names[p], zones[z], size);
+            for (uint32_t b = 0U; b < (uint32_t)(sizeof(bus_hz) / sizeof(bus_hz[0])); b++)
+            {
+                double limit = 1e9 / ((double)sim_transfer_ns(size, bus_hz[b]) * per_bus);
+
+                printf(" %8.1f / %5.1f", limit, (limit < sensor_max) ? limit : sensor_max);
+            }
+            printf("\n");
+        }
+    }
+
+    printf("this build reads");
+    for (uint32_t p = 0U; p < VL53L5_PROFILE_COUNT; p++)
+    {
+        (void)vl53l5_set_output_profile((vl53l5_output_profile_t)p);
+        vl53l5_sim_init();
+        printf(" %s %u B%s", s_profile_names[p], vl53l5_read_size(), (p + 1U < VL53L5_PROFILE_COUNT) ? "," : "");
+    }
+    printf(" per 8x8 frame\n");
+}
+
+static bool sim_parse_profile(const char *name, vl53l5_output_profile_t *profile)
+{
+    for (uint32_t p = 0U; p < VL53L5_PROFILE_COUNT; p++)
+    {
+        if (strcmp(name, s_profile_names[p]) == 0)
+        {
+            *profile = (vl53l5_output_profile_t)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sim_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-f capture.tofl] [-n frames] [-r odr_hz] [-b bus_hz] [-p process_us] [-e n] [-o profile]\n"
+            "       %s -m\n"
+            "  -f  replay frames from a frame log instead of generated test patterns\n"
+            "  -n  number of frames (default %u)\n"
+            "  -r  sensor output data rate in Hz (default %u)\n"
+            "  -b  I2C clock in Hz (default %u)\n"
+            "  -p  processing time per frame in microseconds (default %u)\n"
+            "  -e  fail every n-th bus read (default 0, never)\n"
+            "  -o  sensor output profile: minimal, tracking or diagnostic (default %s)\n"
+            "  -m  print bytes per frame and the bus-limited ODR of every output profile\n",
+            prog, prog, SIM_DEFAULT_FRAMES, (unsigned)DISTANCE_ODR, SIM_DEFAULT_BUS_HZ, SIM_DEFAULT_PROCESS_US,
+            s_profile_names[VL53L5_DEFAULT_PROFILE]);
+}
+
+int main(int argc, char **argv)
+{
+    sim_config_t config;
+    sim_result_t blocking;
+    sim_result_t queued;
+    const char *path = NULL;
+    uint32_t frames = SIM_DEFAULT_FRAMES;
+    uint32_t odr_hz = DISTANCE_ODR;
+    uint32_t bus_hz = SIM_DEFAULT_BUS_HZ;
+    uint32_t process_us = SIM_DEFAULT_PROCESS_US;
+    uint32_t error_every = 0U;
+    vl53l5_output_profile_t profile = VL53L5_DEFAULT_PROFILE;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:r:b:p:e:o:mh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            path = optarg;
+            break;
+        case 'n':
+            frames = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            odr_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            bus_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            process_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            error_every = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            if (!sim_parse_profile(optarg, &profile))
+            {
+                sim_usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'm':
+            sim_print_bus_model();
+            return 0;
+        default:
+            sim_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((frames == 0U) || (odr_hz == 0U) || (bus_hz == 0U))
+    {
+        sim_usage(argv[0]);
+        return 2;
+    }
+
+    (void)vl53l5_set_output_profile(profile);
+    vl53l5_sim_init();
+    memset(&config, 0, sizeof(config));
+    config.count = sim_load_frames(path, frames, &config.frames);
+    if (config.count == 0U)
+    {
+        fprintf(stderr, "no frames to simulate\n");
+        return 1;
+    }
+    config.period_ns = 1000000000ULL / odr_hz;
+    config.transfer_ns = sim_transfer_ns(vl53l5_read_size(), bus_hz);
+    config.process_ns = (uint64_t)process_us * 1000U;
+    config.error_every = error_every;
+
+    printf("frames %u  odr %u Hz (period %.2f ms)  %s read %u B @ %u Hz = %.2f ms  process %.2f ms  slots %u\n",
+           config.count, odr_hz, (double)config.period_ns / 1e6, s_profile_names[profile], vl53l5_read_size(), bus_hz,
+           (double)config.transfer_ns / 1e6, (double)config.process_ns / 1e6, FRAME_QUEUE_SLOTS);
+    printf("%-9s %9s %9s %8s %8s %8s %10s %10s %9s %10s\n", "mode", "produced", "delivered", "dropped", "overrun",
+           "bus_err", "lat_ms", "lat_max_ms", "cpu_bus%", "mismatch");
+
+    sim_run_blocking(&config, &blocking);
+    sim_print("blocking", &blocking);
+    sim_run_queued(&config, &queued);
+    sim_print("queued", &queued);
+
+    free(config.frames);
+    return ((blocking.mismatches == 0U) && (queued.mismatches == 0U)) ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2c_bus_sim.h"
+#include "vl53l5cx.h"
+#include "vl53l5cx_api.h"
+#include "vl53l5cx_plugin_xtalk.h"
+
+/*
+ * Boots one VL53L5CX through the real ULD and platform.c over the modelled
+ * bus of i2c_bus_sim.c, with the settings vl53l5cx.c applies, once per bus
+ * speed and write path. Every run checks that
+ * the firmware image landed in the sensor pages in order and in chunks of at
+ * most VL53L5CX_COMMS_CHUNK_SIZE, that the offset and xtalk buffers went out
+ * and that ranging started; the modelled time of each boot phase follows, as
+ * the platform layer recorded it. A bus boots one sensor at a time, see
+ * tof_bringup_sim for a whole board.
+ */
+
+#define BOOT_SIM_MAX_SPEEDS 8U
+#define BOOT_SIM_ALIVE_RETRIES 50U
+/* Pages 0x09 and 0x0a take 0x8000 bytes, page 0x0b the last 0x5000 */
+#define BOOT_SIM_FIRMWARE_SIZE 0x15000U
+
+extern const uint8_t VL53L5CX_FIRMWARE[];
+
+static VL53L5CX_Configuration s_dev;
+
+static const char *const s_phase_names[VL53L5CX_BOOT_PHASE_COUNT] = {"alive", "reset",  "firmware",
+                                                                      "calib", "config", "start"};
+
+static void boot_sim_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-s bus_hz]...\n"
+            "  -s  bus speed to model, repeatable (default 100000, 400000 and 1000000)\n",
+            prog);
+}
+
+/* Same sequence and settings as the bring-up of device 0 in vl53l5cx.c, in one go */
+static bool boot_sim_run(void)
+{
+    uint8_t status;
+    uint8_t is_alive = 0U;
+    uint32_t retries = 0U;
+
+    memset(&s_dev, 0, sizeof(s_dev));
+    s_dev.platform.address = VL53L5CX_DEFAULT_I2C_ADDRESS;
+    s_dev.platform.hi2c = &hi2c1;
+    s_dev.platform.boot_phase = VL53L5CX_BOOT_DONE;
+
+    VL53L5CX_BootPhase(&s_dev.platform, VL53L5CX_BOOT_ALIVE);
+    do
+    {
+        HAL_Delay(10);
+        status = vl53l5cx_is_alive(&s_dev, &is_alive);
+    } while ((!is_alive || status) && (++retries < BOOT_SIM_ALIVE_RETRIES));
+    if (!is_alive || status)
+    {
+        return false;
+    }
+
+    status = vl53l5cx_init(&s_dev);
+    status |= vl53l5cx_set_xtalk_margin(&s_dev, 50);
+    status |= vl53l5cx_set_target_order(&s_dev, VL53L5CX_TARGET_ORDER_STRONGEST);
+    status |= vl53l5cx_set_sharpener_percent(&s_dev, 5);
+    status |= vl53l5cx_set_ranging_frequency_hz(&s_dev, DISTANCE_ODR);
+    status |= vl53l5cx_set_resolution(&s_dev, FRAME_RESOLUTION);
+    status |= vl53l5cx_set_outputs(&s_dev, vl53l5_profile_outputs(VL53L5_DEFAULT_PROFILE));
+    status |= vl53l5cx_set_ranging_mode(&s_dev, VL53L5CX_RANGING_MODE_CONTINUOUS);
+
+    VL53L5CX_BootPhase(&s_dev.platform, VL53L5CX_BOOT_START);
+    status |= vl53l5cx_start_ranging(&s_dev);
+    VL53L5CX_BootPhase(&s_dev.platform, VL53L5CX_BOOT_DONE);
+    return status == VL53L5CX_STATUS_OK;
+}
+
+/* Prints one row and returns whether the boot went through as expected */
+static bool boot_sim_report(uint32_t bus_hz, bool dma)
+{
+    const i2c_bus_sim_stats_t *stats;
+    bool started;
+    bool ok;
+
+    i2c_bus_sim_init(bus_hz, dma);
+    started = boot_sim_run();
+    stats = i2c_bus_sim_stats();
+    ok = started && i2c_bus_sim_firmware_matches(VL53L5CX_FIRMWARE, BOOT_SIM_FIRMWARE_SIZE) &&
+         (stats->firmware_gaps == 0U) && (stats->max_write <= VL53L5CX_COMMS_CHUNK_SIZE) &&
+         (stats->offset_bytes == VL53L5CX_OFFSET_BUFFER_SIZE) && (stats->xtalk_bytes == VL53L5CX_XTALK_BUFFER_SIZE) &&
+         (dma == (stats->dma_writes > 0U));
+
+    printf("%7u %-6s", bus_hz / 1000U, dma ? "dma" : "polled");
+    for (uint32_t phase = 0U; phase < VL53L5CX_BOOT_PHASE_COUNT; phase++)
+    {
+        printf(" %8u", s_dev.platform.boot_ms[phase]);
+    }
+    printf(" %8.1f %9u %6u  %s\n", (double)i2c_bus_sim_now_ns() / 1e6, stats->transfers, stats->firmware_writes,
+           ok ? "ok" : "FAIL");
+    if (!ok)
+    {
+        fprintf(stderr,
+                "  started %u, firmware gaps %u, largest write %u B, offset %u B, xtalk %u B, dma writes %u\n",
+                started, stats->firmware_gaps, stats->max_write, stats->offset_bytes, stats->xtalk_bytes,
+                stats->dma_writes);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t speeds[BOOT_SIM_MAX_SPEEDS] = {100000U, 400000U, 1000000U};
+    uint32_t speed_count = 0U;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            if (speed_count >= BOOT_SIM_MAX_SPEEDS)
+            {
+                boot_sim_usage(argv[0]);
+                return 2;
+            }
+            speeds[speed_count++] = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            boot_sim_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+    speed_count = (speed_count == 0U) ? 3U : speed_count;
+    for (uint32_t i = 0U; i < speed_count; i++)
+    {
+        if (speeds[i] < 1000U)
+        {
+            boot_sim_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    printf("firmware %u B in chunks of up to %u B, %u zones at %u Hz\n", BOOT_SIM_FIRMWARE_SIZE,
+           VL53L5CX_COMMS_CHUNK_SIZE, FRAME_RESOLUTION, DISTANCE_ODR);
+    printf("%7s %-6s", "bus kHz", "write");
+    for (uint32_t phase = 0U; phase < VL53L5CX_BOOT_PHASE_COUNT; phase++)
+    {
+        printf(" %8s", s_phase_names[phase]);
+    }
+    printf(" %8s %9s %6s  %s\n", "total ms", "transfers", "fw wr", "check");
+    for (uint32_t i = 0U; i < speed_count; i++)
+    {
+        ok = boot_sim_report(speeds[i], true) && ok;
+        ok = boot_sim_report(speeds[i], false) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2c.h"
+#include "i2c_bus_sim.h"
+#include "sensor_manager.h"
+
+/*
+ * Brings up a board of four VL53L5CX, two per bus, through the real
+ * vl53l5cx.c and sensor_manager.c over the modelled board of i2c_bus_sim.c,
+ * driven the way app_main() drives them: sensor_process(), the frames, then
+ * 1 ms of idle. Each scenario injects its faults at set times. It passes when
+ * every sensor streams at the end, the faulty ones went through at least one
+ * restart and the others none, no two sensors ever answered the same address,
+ * no bring-up step found a read on its bus, and no sensor_process() call held
+ * the main loop longer than one firmware chunk per bus, plus the DCI polls of
+ * one step.
+ */
+
+#define BRINGUP_SIM_SENSORS 4U
+#define BRINGUP_SIM_MAX_EVENTS 4U
+#define BRINGUP_SIM_RUN_MS 20000U
+/* The scenarios are timed for this bus speed and stretched for slower ones, the boot takes that much longer */
+#define BRINGUP_SIM_BASE_HZ 400000U
+/* A sensor streams if it delivered a frame this recently */
+#define BRINGUP_SIM_STREAM_MS 500U
+/* A step may wait on a few DCI polls of 10 ms on top of its transfers */
+#define BRINGUP_SIM_STEP_SLACK_MS 100U
+
+#if VL53L5_DEVICE_COUNT != BRINGUP_SIM_SENSORS
+#error "tof_bringup_sim models a board of four sensors"
+#endif
+
+typedef enum
+{
+    BRINGUP_UNPLUG = 0,
+    BRINGUP_PLUG,
+    BRINGUP_NACK,
+} bringup_action_t;
+
+typedef struct
+{
+    uint32_t at_ms;
+    uint8_t sensor;
+    bringup_action_t action;
+    uint32_t count;
+} bringup_event_t;
+
+typedef struct
+{
+    const char *name;
+    const char *what;
+    uint32_t boot_delay_ms[BRINGUP_SIM_SENSORS];
+    bringup_event_t events[BRINGUP_SIM_MAX_EVENTS];
+    uint32_t event_count;
+    /* Sensors that must have been restarted, one bit each */
+    uint8_t faulty;
+} bringup_scenario_t;
+
+static const bringup_scenario_t s_scenarios[] = {
+    {"clean", "every sensor answers at once", {0U, 0U, 0U, 0U}, {{0}}, 0U, 0x0U},
+    {"slow", "sensors 1 and 2 answer 450 and 300 ms out of reset", {0U, 450U, 300U, 0U}, {{0}}, 0U, 0x0U},
+    {"absent",
+     "sensor 1 missing until 3 s",
+     {0U, 0U, 0U, 0U},
+     {{0U, 1U, BRINGUP_UNPLUG, 0U}, {3000U, 1U, BRINGUP_PLUG, 0U}},
+     2U,
+     0x2U},
+    {"unplug",
+     "sensor 1 unplugged from 10 s to 12 s",
+     {0U, 0U, 0U, 0U},
+     {{10000U, 1U, BRINGUP_UNPLUG, 0U}, {12000U, 1U, BRINGUP_PLUG, 0U}},
+     2U,
+     0x2U},
+    {"glitch",
+     "sensor 0 NACKs 20 transfers at 300 ms, sensor 2 5 transfers at 14 s",
+     {0U, 0U, 0U, 0U},
+     {{300U, 0U, BRINGUP_NACK, 20U}, {14000U, 2U, BRINGUP_NACK, 5U}},
+     2U,
+     0x5U},
+};
+
+static const char *const s_state_names[] = {"off", "alive", "init", "config", "slot", "running"};
+static const char *const s_fault_names[] = {"-", "no answer", "init", "config", "start", "stalled", "read"};
+
+static const uint16_t s_xshut_pins[BRINGUP_SIM_SENSORS] = {VL53_xshut_Pin, VL53_2_xshut_Pin, VL53_3_xshut_Pin,
+                                                            VL53_4_xshut_Pin};
+static const uint16_t s_int_pins[BRINGUP_SIM_SENSORS] = {VL53_INT_Pin, VL53_2_INT_Pin, VL53_3_INT_Pin,
+                                                          VL53_4_INT_Pin};
+
+static void bringup_sim_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-s bus_hz] [-v]\n"
+            "  -s  bus speed to model (default 400000)\n"
+            "  -v  print every state change\n",
+            prog);
+}
+
+static void bringup_sim_apply(const bringup_event_t *event)
+{
+    switch (event->action)
+    {
+    case BRINGUP_UNPLUG:
+        i2c_bus_sim_set_plugged(event->sensor, false);
+        break;
+    case BRINGUP_PLUG:
+        i2c_bus_sim_set_plugged(event->sensor, true);
+        break;
+    case BRINGUP_NACK:
+        i2c_bus_sim_nack(event->sensor, event->count);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Runs one scenario, prints its row and returns whether it passed */
+static bool bringup_sim_run(const bringup_scenario_t *scenario, uint32_t bus_hz, bool verbose)
+{
+    uint32_t frames[BRINGUP_SIM_SENSORS] = {0};
+    uint32_t last_frame_ms[BRINGUP_SIM_SENSORS] = {0};
+    vl53l5_state_t states[BRINGUP_SIM_SENSORS];
+    vl53l5_status_t status[BRINGUP_SIM_SENSORS];
+    /* One firmware chunk of VL53L5CX_COMMS_CHUNK_SIZE bytes on each bus, both buses step in one call */
+    uint64_t chunk_ns = ((uint64_t)(VL53L5CX_COMMS_CHUNK_SIZE * 9U) * 1000000000ULL) / bus_hz;
+    uint64_t step_limit_ns = (chunk_ns * VL53L5_BUS_COUNT) + ((uint64_t)BRINGUP_SIM_STEP_SLACK_MS * 1000000ULL);
+    uint64_t max_step_ns = 0U;
+    uint32_t stretch = (bus_hz < BRINGUP_SIM_BASE_HZ) ? ((BRINGUP_SIM_BASE_HZ + bus_hz - 1U) / bus_hz) : 1U;
+    uint32_t next_event = 0U;
+    uint32_t up_ms = 0U;
+    uint32_t now;
+    bool ok = true;
+
+    i2c_bus_sim_init(bus_hz, true);
+    for (uint8_t i = 0U; i < BRINGUP_SIM_SENSORS; i++)
+    {
+        /* Sensors alternate between the buses like the devices of vl53l5cx.c */
+        i2c_bus_sim_wire(i, ((i % 2U) == 0U) ? &hi2c1 : &hi2c3, s_xshut_pins[i], s_int_pins[i],
+                         1000U / DISTANCE_ODR);
+        i2c_bus_sim_set_boot_delay(i, scenario->boot_delay_ms[i]);
+        states[i] = VL53L5_STATE_OFF;
+    }
+    sensor_init();
+
+    while ((now = HAL_GetTick()) < (BRINGUP_SIM_RUN_MS * stretch))
+    {
+        const VL53L5CX_ResultsData *frame;
+        uint64_t start_ns;
+        uint8_t device;
+        bool all_running = true;
+
+        while ((next_event < scenario->event_count) && ((scenario->events[next_event].at_ms * stretch) <= now))
+        {
+            bringup_sim_apply(&scenario->events[next_event++]);
+        }
+
+        start_ns = i2c_bus_sim_now_ns();
+        sensor_process();
+        if ((i2c_bus_sim_now_ns() - start_ns) > max_step_ns)
+        {
+            max_step_ns = i2c_bus_sim_now_ns() - start_ns;
+        }
+
+        while (sensor_get_data(&device, &frame))
+        {
+            frames[device]++;
+            last_frame_ms[device] = HAL_GetTick();
+        }
+
+        for (uint8_t i = 0U; i < BRINGUP_SIM_SENSORS; i++)
+        {
+            (void)vl53l5_get_status(i, &status[i]);
+            if (verbose && (status[i].state != states[i]))
+            {
+                printf("  %6u ms  sensor %u %-7s -> %-7s fault %s\n", HAL_GetTick(), i, s_state_names[states[i]],
+                       s_state_names[status[i].state], s_fault_names[status[i].last_fault]);
+            }
+            states[i] = status[i].state;
+            all_running = all_running && (status[i].state == VL53L5_STATE_RUNNING);
+        }
+        if (all_running && (up_ms == 0U))
+        {
+            up_ms = HAL_GetTick();
+        }
+
+        HAL_Delay(1U);
+    }
+
+    now = HAL_GetTick();
+    printf("%-7s %6u %8.1f", scenario->name, up_ms, (double)max_step_ns / 1e6);
+    for (uint8_t i = 0U; i < BRINGUP_SIM_SENSORS; i++)
+    {
+        bool faulty = (scenario->faulty & (1U << i)) != 0U;
+        bool streaming = (status[i].state == VL53L5_STATE_RUNNING) &&
+                         ((now - last_frame_ms[i]) <= BRINGUP_SIM_STREAM_MS) && (frames[i] > 0U);
+
+        ok = ok && streaming && (faulty == (status[i].faults > 0U));
+        printf("  %u/%u %-9s %4u", status[i].attempts, status[i].faults, s_fault_names[status[i].last_fault],
+               frames[i]);
+    }
+    ok = ok && (up_ms > 0U) && (max_step_ns <= step_limit_ns) && (i2c_bus_sim_stats()->collisions == 0U) &&
+         (i2c_bus_sim_stats()->busy == 0U);
+    printf("  %s\n", ok ? "ok" : "FAIL");
+    if (!ok || verbose)
+    {
+        fprintf(stderr, "  %s: collisions %u, busy bus %u, longest step %.1f ms (limit %.1f), read errors %u\n",
+                scenario->what, i2c_bus_sim_stats()->collisions, i2c_bus_sim_stats()->busy,
+                (double)max_step_ns / 1e6, (double)step_limit_ns / 1e6, i2c_bus_sim_stats()->read_errors);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t bus_hz = BRINGUP_SIM_BASE_HZ;
+    uint32_t stretch;
+    bool verbose = false;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:vh")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            bus_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            bringup_sim_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+    if (bus_hz < 1000U)
+    {
+        bringup_sim_usage(argv[0]);
+        return 2;
+    }
+
+    stretch = (bus_hz < BRINGUP_SIM_BASE_HZ) ? ((BRINGUP_SIM_BASE_HZ + bus_hz - 1U) / bus_hz) : 1U;
+    printf("%u sensors on 2 buses at %u kHz, %u zones at %u Hz, %u s per scenario\n", BRINGUP_SIM_SENSORS,
+           bus_hz / 1000U, FRAME_RESOLUTION, DISTANCE_ODR, (BRINGUP_SIM_RUN_MS * stretch) / 1000U);
+    printf("%-7s %6s %8s", "case", "up ms", "step ms");
+    for (uint8_t i = 0U; i < BRINGUP_SIM_SENSORS; i++)
+    {
+        printf("  s%u boot/flt last   frm", i);
+    }
+    printf("  check\n");
+    for (uint32_t i = 0U; i < (sizeof(s_scenarios) / sizeof(s_scenarios[0])); i++)
+    {
+        ok = bringup_sim_run(&s_scenarios[i], bus_hz, verbose) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sensor_manager.h"
+#include "tof_process.h"
+#include "vl53l5cx_sim.h"
+
+/*
+ * Discrete-event model of VL53L5_DEVICE_COUNT sensors fanned in to one
+ * pipeline: the real sensor_manager registry arbitrates the simulated buses
+ * (device d on bus d % VL53L5_BUS_COUNT) and every delivered frame goes
+ * through tof_pipeline_process_tile(). Each sensor free-runs on its own
+ * clock, off by d * drift ppm. "aligned" starts every sensor at once,
+ * "staggered" spaces the starts a period / VL53L5_DEVICE_COUNT apart as
+ * vl53l5_tof_init() does. Every delivered frame is compared with the frame
+ * its sensor produced.
+ */
+
+#define SIM_DEFAULT_FRAMES 400U
+#define SIM_DEFAULT_BUS_HZ 400000U
+#define SIM_DEFAULT_DECODE_US 500U
+#define SIM_DEFAULT_PROCESS_US 20000U
+#define SIM_DEFAULT_DRIFT_PPM 200U
+#define SIM_I2C_READ_OVERHEAD_BYTES 4U
+#define SIM_FLOOR_MM 2600
+#define SIM_NS_NEVER UINT64_MAX
+
+typedef struct {
+    uint32_t produced;
+    uint32_t delivered;
+    uint32_t mismatches;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+    sensor_stats_t stats;
+} sim_device_result_t;
+
+typedef struct {
+    sim_device_result_t devices[VL53L5_DEVICE_COUNT];
+    uint32_t grids;
+    uint64_t end_ns;
+} sim_result_t;
+
+typedef struct {
+    VL53L5CX_ResultsData *frames[VL53L5_DEVICE_COUNT];
+    uint32_t count;
+    uint64_t period_ns[VL53L5_DEVICE_COUNT];
+    uint64_t transfer_ns;
+    uint64_t decode_ns;
+    uint64_t process_ns;
+} sim_config_t;
+
+static uint32_t s_sim_rng = 0x12345678U;
+static tof_pipeline_t s_pipeline;
+
+static uint32_t sim_rand(void)
+{
+    s_sim_rng = (s_sim_rng * 1664525U) + 1013904223U;
+    return s_sim_rng >> 8;
+}
+
+/* An empty floor seen from the ceiling */
+static void sim_generate_frame(VL53L5CX_ResultsData *frame, uint8_t dev, uint32_t index)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->silicon_temp_degc = (int8_t)(20U + (sim_rand() % 30U));
+    for (uint32_t i = 0U; i < VL53L5CX_RESOLUTION_8X8; i++)
+    {
+        frame->nb_target_detected[i] = 1U;
+        frame->distance_mm[i] = (int16_t)(SIM_FLOOR_MM + (int32_t)(sim_rand() % 31U) - 15);
+        frame->target_status[i] = 5U;
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+        frame->signal_per_spad[i] = sim_rand();
+#endif
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+        frame->ambient_per_spad[i] = sim_rand();
+#endif
+    }
+    /* Device in the top byte, frame index below */
+    vl53l5_sim_set_tag(frame, ((uint32_t)dev << 24) | index);
+    vl53l5_sim_quantize(frame);
+}
+
+static uint64_t sim_frame_ns(const sim_config_t *config, const uint64_t *phase_ns, uint8_t dev, uint32_t k)
+{
+    return phase_ns[dev] + ((uint64_t)k * config->period_ns[dev]);
+}
+
+static void sim_deliver(const sim_config_t *config, const uint64_t *phase_ns, sim_result_t *result, uint8_t dev,
+                        const VL53L5CX_ResultsData *frame, uint64_t done_ns)
+{
+    sim_device_result_t *device = &result->devices[dev];
+    uint32_t tag = vl53l5_sim_get_tag(frame);
+    uint32_t k = tag & 0xFFFFFFU;
+    uint64_t latency_ns;
+
+    if (((tag >> 24) != dev) || (k >= config->count) || (memcmp(frame, &config->frames[dev][k], sizeof(*frame)) != 0))
+    {
+        device->mismatches++;
+        return;
+    }
+
+    latency_ns = done_ns - sim_frame_ns(config, phase_ns, dev, k);
+    device->delivered++;
+    device->latency_sum_ns += latency_ns;
+    if (latency_ns > device->latency_max_ns)
+    {
+        device->latency_max_ns = latency_ns;
+    }
+}
+
+static void sim_run(const sim_config_t *config, bool staggered, sim_result_t *result)
+{
+    const VL53L5CX_ResultsData *frame = NULL;
+    tof_pipeline_output_t output;
+    uint64_t phase_ns[VL53L5_DEVICE_COUNT];
+    uint64_t read_done_ns[VL53L5_DEVICE_COUNT];
+    uint32_t next_frame[VL53L5_DEVICE_COUNT];
+    uint64_t cpu_free_ns = 0U;
+    uint64_t now_ns = 0U;
+    uint8_t dev;
+
+    memset(result, 0, sizeof(*result));
+    for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        phase_ns[dev] = staggered ? ((config->period_ns[0] * dev) / VL53L5_DEVICE_COUNT) : 0U;
+        read_done_ns[dev] = SIM_NS_NEVER;
+        next_frame[dev] = 0U;
+    }
+    vl53l5_sim_init();
+    sensor_init();
+    tof_pipeline_runtime_init();
+    tof_pipeline_init(&s_pipeline);
+
+    for (;;)
+    {
+        bool busy = cpu_free_ns > now_ns;
+
+        now_ns = busy ? cpu_free_ns : SIM_NS_NEVER;
+        for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+        {
+            uint64_t frame_ns = (next_frame[dev] < config->count) ? sim_frame_ns(config, phase_ns, dev, next_frame[dev])
+                                                                   : SIM_NS_NEVER;
+
+            now_ns = (frame_ns < now_ns) ? frame_ns : now_ns;
+            now_ns = (read_done_ns[dev] < now_ns) ? read_done_ns[dev] : now_ns;
+        }
+        if (now_ns == SIM_NS_NEVER)
+        {
+            break;
+        }
+
+        /* Transfers land before new data-ready events so a freed bus is handed on first */
+        for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+        {
+            if (read_done_ns[dev] == now_ns)
+            {
+                read_done_ns[dev] = SIM_NS_NEVER;
+                vl53l5_sim_complete_read(dev, true);
+            }
+        }
+        for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+        {
+            if ((next_frame[dev] < config->count) && (sim_frame_ns(config, phase_ns, dev, next_frame[dev]) == now_ns))
+            {
+                vl53l5_sim_set_frame(dev, &config->frames[dev][next_frame[dev]]);
+                result->devices[dev].produced++;
+                next_frame[dev]++;
+            }
+        }
+        for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+        {
+            if (vl53l5_sim_read_pending(dev) && (read_done_ns[dev] == SIM_NS_NEVER))
+            {
+                read_done_ns[dev] = now_ns + config->transfer_ns;
+            }
+        }
+
+        if ((cpu_free_ns <= now_ns) && sensor_get_data(&dev, &frame))
+        {
+            cpu_free_ns = now_ns + config->decode_ns;
+            sim_deliver(config, phase_ns, result, dev, frame, cpu_free_ns);
+            if (tof_pipeline_process_tile(&s_pipeline, dev, frame, &output))
+            {
+                cpu_free_ns += config->process_ns;
+                result->grids++;
+            }
+        }
+    }
+
+    /* Hands the last slot back */
+    (void)sensor_get_data(NULL, &frame);
+    for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        sensor_get_stats(dev, &result->devices[dev].stats);
+    }
+    result->end_ns = cpu_free_ns;
+    for (dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        uint64_t last_ns = sim_frame_ns(config, phase_ns, dev, config->count);
+
+        result->end_ns = (last_ns > result->end_ns) ? last_ns : result->end_ns;
+    }
+}
+
+static bool sim_print(const char *name, const sim_result_t *result)
+{
+    uint32_t produced = 0U;
+    uint32_t delivered = 0U;
+    uint32_t mismatches = 0U;
+    double seconds = (double)result->end_ns / 1e9;
+
+    printf("%s\n", name);
+    printf("  %-6s %3s %9s %9s %9s %8s %8s %8s %10s %10s %9s\n", "device", "bus", "produced", "delivered", "deferred",
+           "dropped", "overrun", "bus_err", "lat_ms", "lat_max_ms", "mismatch");
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        const sim_device_result_t *device = &result->devices[dev];
+        double mean_ms = (device->delivered > 0U) ? ((double)device->latency_sum_ns / device->delivered / 1e6) : 0.0;
+
+        printf("  %-6u %3u %9u %9u %9u %8u %8u %8u %10.2f %10.2f %9u\n", dev, vl53l5_bus(dev), device->produced,
+               device->delivered, device->stats.deferred, device->stats.dropped, device->stats.overruns,
+               device->stats.bus_errors + device->stats.decode_errors, mean_ms,
+               (double)device->latency_max_ns / 1e6, device->mismatches);
+        produced += device->produced;
+        delivered += device->delivered;
+        mismatches += device->mismatches;
+    }
+    printf("  aggregate: %.1f frames/s produced, %.1f frames/s delivered (%.1f%%), %.1f grids/s\n\n",
+           (double)produced / seconds, (double)delivered / seconds,
+           (produced > 0U) ? (100.0 * delivered / produced) : 0.0, (double)result->grids / seconds);
+    return mismatches == 0U;
+}
+
+static void sim_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n frames] [-r odr_hz] [-b bus_hz] [-c decode_us] [-p process_us] [-d drift_ppm]\n"
+            "  -n  frames per sensor (default %u)\n"
+            "  -r  sensor output data rate in Hz (default %u)\n"
+            "  -b  I2C clock of both buses in Hz (default %u)\n"
+            "  -c  decode and tile load time per frame in microseconds (default %u)\n"
+            "  -p  processing time per grid in microseconds (default %u)\n"
+            "  -d  clock error of sensor d is d times this, in ppm (default %u)\n",
+            prog, SIM_DEFAULT_FRAMES, (unsigned)DISTANCE_ODR, SIM_DEFAULT_BUS_HZ, SIM_DEFAULT_DECODE_US,
+            SIM_DEFAULT_PROCESS_US, SIM_DEFAULT_DRIFT_PPM);
+}
+
+int main(int argc, char **argv)
+{
+    static sim_result_t aligned;
+    static sim_result_t staggered;
+    sim_config_t config;
+    uint32_t frames = SIM_DEFAULT_FRAMES;
+    uint32_t odr_hz = DISTANCE_ODR;
+    uint32_t bus_hz = SIM_DEFAULT_BUS_HZ;
+    uint32_t decode_us = SIM_DEFAULT_DECODE_US;
+    uint32_t process_us = SIM_DEFAULT_PROCESS_US;
+    uint32_t drift_ppm = SIM_DEFAULT_DRIFT_PPM;
+    bool ok;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:b:c:p:d:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            frames = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            odr_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            bus_hz = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            decode_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            process_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            drift_ppm = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            sim_usage(argv[0]);
+            return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((frames == 0U) || (frames > 0xFFFFFFU) || (odr_hz == 0U) || (bus_hz == 0U))
+    {
+        sim_usage(argv[0]);
+        return 2;
+    }
+
+    vl53l5_sim_init();
+    memset(&config, 0, sizeof(config));
+    config.count = frames;
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        config.frames[dev] = calloc(frames, sizeof(VL53L5CX_ResultsData));
+        if (config.frames[dev] == NULL)
+        {
+            return 1;
+        }
+        for (uint32_t k = 0U; k < frames; k++)
+        {
+            sim_generate_frame(&config.frames[dev][k], dev, k);
+        }
+        config.period_ns[dev] = (1000000000ULL * (1000000ULL + ((uint64_t)dev * drift_ppm))) / (odr_hz * 1000000ULL);
+    }
+    /* 9 clocks per byte, plus device address and 16-bit register address */
+    config.transfer_ns = ((uint64_t)(vl53l5_read_size() + SIM_I2C_READ_OVERHEAD_BYTES) * 9U * 1000000000ULL) / bus_hz;
+    config.decode_ns = (uint64_t)decode_us * 1000U;
+    config.process_ns = (uint64_t)process_us * 1000U;
+
+    printf("%u sensors on %u buses, %u frames each  odr %u Hz (period %.2f ms, drift %u ppm/sensor)\n",
+           VL53L5_DEVICE_COUNT, VL53L5_BUS_COUNT, config.count, odr_hz, (double)config.period_ns[0] / 1e6, drift_ppm);
+    printf("read %u B @ %u Hz = %.2f ms  decode %.2f ms  grid %ux%u process %.2f ms\n\n", vl53l5_read_size(), bus_hz,
+           (double)config.transfer_ns / 1e6, (double)config.decode_ns / 1e6, TOF_COLS, TOF_ROWS,
+           (double)config.process_ns / 1e6);
+
+    sim_run(&config, false, &aligned);
+    ok = sim_print("aligned", &aligned);
+    sim_run(&config, true, &staggered);
+    ok = sim_print("staggered", &staggered) && ok;
+
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        free(config.frames[dev]);
+    }
+    return ok ? 0 : 1;
+}
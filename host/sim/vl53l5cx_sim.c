@@ -0,0 +1,536 @@
+#include "vl53l5cx_sim.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define SIM_HEADER_SIZE 16U
+#define SIM_FOOTER_SIZE 8U
+#define SIM_ZONES VL53L5CX_RESOLUTION_8X8
+#define SIM_TARGETS (VL53L5CX_RESOLUTION_8X8 * VL53L5CX_NB_TARGET_PER_ZONE)
+
+typedef struct {
+    uint8_t sensor_blob[VL53L5CX_MAX_RESULTS_SIZE] __attribute__((aligned(4)));
+    uint8_t dma_blob[VL53L5CX_MAX_RESULTS_SIZE] __attribute__((aligned(4)));
+    uint8_t *dma_dst;
+    uint8_t stream_count;
+} vl53l5_sim_device_t;
+
+/* Every simulated device runs the same configuration, s_dev holds it */
+static VL53L5CX_Configuration s_dev;
+static vl53l5_sim_device_t s_devices[VL53L5_DEVICE_COUNT];
+static vl53l5_data_ready_cb_t s_data_ready_cb = NULL;
+static vl53l5_read_done_cb_t s_read_done_cb = NULL;
+
+typedef struct {
+    uint32_t bh;
+    /* VL53L5CX_OUTPUT_* bit, 0 for the blocks always streamed */
+    uint32_t output;
+} vl53l5_sim_output_t;
+
+/* Output blocks in the order vl53l5cx_start_ranging() lists them */
+static const vl53l5_sim_output_t s_sim_outputs[] = {
+    {VL53L5CX_START_BH, 0U},
+    {VL53L5CX_METADATA_BH, 0U},
+    {VL53L5CX_COMMONDATA_BH, 0U},
+    {VL53L5CX_AMBIENT_RATE_BH, VL53L5CX_OUTPUT_AMBIENT_PER_SPAD},
+    {VL53L5CX_SPAD_COUNT_BH, VL53L5CX_OUTPUT_NB_SPADS_ENABLED},
+    {VL53L5CX_NB_TARGET_DETECTED_BH, VL53L5CX_OUTPUT_NB_TARGET_DETECTED},
+    {VL53L5CX_SIGNAL_RATE_BH, VL53L5CX_OUTPUT_SIGNAL_PER_SPAD},
+    {VL53L5CX_RANGE_SIGMA_MM_BH, VL53L5CX_OUTPUT_RANGE_SIGMA_MM},
+    {VL53L5CX_DISTANCE_BH, VL53L5CX_OUTPUT_DISTANCE_MM},
+    {VL53L5CX_REFLECTANCE_BH, VL53L5CX_OUTPUT_REFLECTANCE_PERCENT},
+    {VL53L5CX_TARGET_STATUS_BH, VL53L5CX_OUTPUT_TARGET_STATUS},
+    {VL53L5CX_MOTION_DETECT_BH, VL53L5CX_OUTPUT_MOTION_INDICATOR},
+};
+
+static vl53l5_output_profile_t s_profile = VL53L5_DEFAULT_PROFILE;
+/* Outputs compiled in and selected by s_profile */
+static uint32_t s_streamed = 0U;
+
+static union Block_header vl53l5_sim_block(uint32_t output, uint32_t zones)
+{
+    union Block_header bh;
+
+    bh.bytes = output;
+    if ((bh.type >= 0x1U) && (bh.type < 0x0dU))
+    {
+        bh.size = ((bh.idx >= 0x54d0U) && (bh.idx < (0x54d0U + 960U))) ? zones
+                                                                        : (zones * VL53L5CX_NB_TARGET_PER_ZONE);
+    }
+    return bh;
+}
+
+static uint32_t vl53l5_sim_block_size(union Block_header bh)
+{
+    return ((bh.type >= 0x1U) && (bh.type < 0x0dU)) ? (uint32_t)bh.type * bh.size : bh.size;
+}
+
+static bool vl53l5_sim_is_streamed(uint32_t output)
+{
+    return (output == 0U) || ((s_streamed & output) != 0U);
+}
+
+/* Same sum as vl53l5cx_start_ranging(): every block with its header, plus the frame header and footer */
+uint32_t vl53l5_sim_read_size(uint32_t outputs, uint32_t zones)
+{
+    uint32_t size = SIM_HEADER_SIZE + SIM_FOOTER_SIZE;
+
+    for (uint32_t i = 0U; i < (uint32_t)(sizeof(s_sim_outputs) / sizeof(s_sim_outputs[0])); i++)
+    {
+        if ((s_sim_outputs[i].output == 0U) || ((outputs & s_sim_outputs[i].output) != 0U))
+        {
+            size += 4U + vl53l5_sim_block_size(vl53l5_sim_block(s_sim_outputs[i].bh, zones));
+        }
+    }
+    return size;
+}
+
+#if !defined(VL53L5CX_DISABLE_AMBIENT_PER_SPAD) || !defined(VL53L5CX_DISABLE_SIGNAL_PER_SPAD)
+static void vl53l5_sim_put_scaled_u32(uint8_t *dst, const uint32_t *src, uint32_t count, uint32_t scale)
+{
+    for (uint32_t i = 0U; i < count; i++)
+    {
+        uint32_t value = src[i] * scale;
+        memcpy(&dst[i * 4U], &value, 4U);
+    }
+}
+#endif
+
+static void vl53l5_sim_fill_block(uint8_t *dst, uint16_t idx, const VL53L5CX_ResultsData *frame)
+{
+    switch (idx)
+    {
+    case VL53L5CX_METADATA_IDX:
+        dst[8] = (uint8_t)frame->silicon_temp_degc;
+        break;
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+    case VL53L5CX_AMBIENT_RATE_IDX:
+        vl53l5_sim_put_scaled_u32(dst, frame->ambient_per_spad, SIM_ZONES, 2048U);
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
+    case VL53L5CX_SPAD_COUNT_IDX:
+        memcpy(dst, frame->nb_spads_enabled, sizeof(frame->nb_spads_enabled));
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
+    case VL53L5CX_NB_TARGET_DETECTED_IDX:
+        memcpy(dst, frame->nb_target_detected, sizeof(frame->nb_target_detected));
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+    case VL53L5CX_SIGNAL_RATE_IDX:
+        vl53l5_sim_put_scaled_u32(dst, frame->signal_per_spad, SIM_TARGETS, 2048U);
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+    case VL53L5CX_RANGE_SIGMA_MM_IDX:
+        for (uint32_t i = 0U; i < SIM_TARGETS; i++)
+        {
+            uint16_t value = (uint16_t)(frame->range_sigma_mm[i] * 128U);
+            memcpy(&dst[i * 2U], &value, 2U);
+        }
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_DISTANCE_MM
+    case VL53L5CX_DISTANCE_IDX:
+        for (uint32_t i = 0U; i < SIM_TARGETS; i++)
+        {
+            int16_t value = (int16_t)(frame->distance_mm[i] * 4);
+            memcpy(&dst[i * 2U], &value, 2U);
+        }
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+    case VL53L5CX_REFLECTANCE_EST_PC_IDX:
+        for (uint32_t i = 0U; i < SIM_TARGETS; i++)
+        {
+            dst[i] = (uint8_t)(frame->reflectance[i] * 2U);
+        }
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_TARGET_STATUS
+    case VL53L5CX_TARGET_STATUS_IDX:
+        memcpy(dst, frame->target_status, sizeof(frame->target_status));
+        break;
+#endif
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+    case VL53L5CX_MOTION_DETEC_IDX:
+        memcpy(dst, &frame->motion_indicator, 12U);
+        vl53l5_sim_put_scaled_u32(&dst[12], frame->motion_indicator.motion, 32U, 65535U);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/* Encodes a frame into the byte stream the sensor puts on the bus, the inverse of vl53l5cx_decode_ranging_data() */
+uint32_t vl53l5_sim_encode(const VL53L5CX_ResultsData *frame, uint8_t stream_count, uint8_t *raw)
+{
+    uint32_t pos = SIM_HEADER_SIZE;
+    uint16_t frame_id = (uint16_t)(0x5A00U | stream_count);
+
+    memset(raw, 0, s_dev.data_read_size);
+    for (uint32_t i = 0U; i < (uint32_t)(sizeof(s_sim_outputs) / sizeof(s_sim_outputs[0])); i++)
+    {
+        union Block_header bh = vl53l5_sim_block(s_sim_outputs[i].bh, SIM_ZONES);
+
+        if (!vl53l5_sim_is_streamed(s_sim_outputs[i].output))
+        {
+            continue;
+        }
+        memcpy(&raw[pos], &bh.bytes, 4U);
+        vl53l5_sim_fill_block(&raw[pos + 4U], (uint16_t)bh.idx, frame);
+        pos += 4U + vl53l5_sim_block_size(bh);
+    }
+
+    raw[8] = (uint8_t)(frame_id >> 8);
+    raw[9] = (uint8_t)(frame_id & 0xFFU);
+    raw[s_dev.data_read_size - 4U] = raw[8];
+    raw[s_dev.data_read_size - 3U] = raw[9];
+
+    /* Back to bus byte order; the first streamed byte is the stream count */
+    VL53L5CX_SwapBuffer(raw, (uint16_t)s_dev.data_read_size);
+    raw[0] = stream_count;
+    return s_dev.data_read_size;
+}
+
+/* The driver clears the results of the outputs left out of the stream */
+static void vl53l5_sim_clear_unstreamed(VL53L5CX_ResultsData *frame)
+{
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_AMBIENT_PER_SPAD))
+    {
+        memset(frame->ambient_per_spad, 0, sizeof(frame->ambient_per_spad));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_NB_SPADS_ENABLED
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_NB_SPADS_ENABLED))
+    {
+        memset(frame->nb_spads_enabled, 0, sizeof(frame->nb_spads_enabled));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_NB_TARGET_DETECTED))
+    {
+        memset(frame->nb_target_detected, 0, sizeof(frame->nb_target_detected));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_SIGNAL_PER_SPAD))
+    {
+        memset(frame->signal_per_spad, 0, sizeof(frame->signal_per_spad));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_RANGE_SIGMA_MM))
+    {
+        memset(frame->range_sigma_mm, 0, sizeof(frame->range_sigma_mm));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_DISTANCE_MM
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_DISTANCE_MM))
+    {
+        memset(frame->distance_mm, 0, sizeof(frame->distance_mm));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_REFLECTANCE_PERCENT))
+    {
+        memset(frame->reflectance, 0, sizeof(frame->reflectance));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_TARGET_STATUS
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_TARGET_STATUS))
+    {
+        memset(frame->target_status, 0, sizeof(frame->target_status));
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+    if (!vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_MOTION_INDICATOR))
+    {
+        memset(&frame->motion_indicator, 0, sizeof(frame->motion_indicator));
+    }
+#endif
+}
+
+/* Rounds a frame to what survives the sensor's fixed-point output format and the output profile */
+void vl53l5_sim_quantize(VL53L5CX_ResultsData *frame)
+{
+    vl53l5_sim_clear_unstreamed(frame);
+    for (uint32_t i = 0U; i < SIM_TARGETS; i++)
+    {
+#ifndef VL53L5CX_DISABLE_DISTANCE_MM
+        if (frame->distance_mm[i] < 0)
+        {
+            frame->distance_mm[i] = 0;
+        }
+        if (frame->distance_mm[i] > 8191)
+        {
+            frame->distance_mm[i] = 8191;
+        }
+#endif
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+        frame->range_sigma_mm[i] &= 0x1FFU;
+#endif
+#ifndef VL53L5CX_DISABLE_REFLECTANCE_PERCENT
+        frame->reflectance[i] &= 0x7FU;
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+        frame->signal_per_spad[i] &= 0x1FFFFFU;
+#endif
+    }
+
+    for (uint32_t i = 0U; i < SIM_ZONES; i++)
+    {
+#ifndef VL53L5CX_DISABLE_AMBIENT_PER_SPAD
+        frame->ambient_per_spad[i] &= 0x1FFFFFU;
+#endif
+#if !defined(VL53L5CX_DISABLE_NB_TARGET_DETECTED) && !defined(VL53L5CX_DISABLE_TARGET_STATUS)
+        if ((frame->nb_target_detected[i] == 0U) && vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_NB_TARGET_DETECTED))
+        {
+            for (uint32_t j = 0U; j < VL53L5CX_NB_TARGET_PER_ZONE; j++)
+            {
+                frame->target_status[(i * VL53L5CX_NB_TARGET_PER_ZONE) + j] = 255U;
+            }
+        }
+#endif
+    }
+
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+    for (uint32_t i = 0U; i < 32U; i++)
+    {
+        frame->motion_indicator.motion[i] &= 0xFFFFU;
+    }
+#endif
+}
+
+void vl53l5_sim_set_tag(VL53L5CX_ResultsData *frame, uint32_t tag)
+{
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+    if (vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_MOTION_INDICATOR))
+    {
+        frame->motion_indicator.global_indicator_1 = tag;
+        return;
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+    if (vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_SIGNAL_PER_SPAD))
+    {
+        /* 21 bits per signal rate */
+        frame->signal_per_spad[0] = tag & 0x1FFFFFU;
+        frame->signal_per_spad[VL53L5CX_NB_TARGET_PER_ZONE] = tag >> 21;
+        return;
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
+    if (vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_NB_TARGET_DETECTED))
+    {
+        /* Zones whose byte is 0 read as empty, in the tagged frame and the delivered one alike */
+        memcpy(frame->nb_target_detected, &tag, sizeof(tag));
+        return;
+    }
+#endif
+    (void)frame;
+    (void)tag;
+}
+
+uint32_t vl53l5_sim_get_tag(const VL53L5CX_ResultsData *frame)
+{
+#ifndef VL53L5CX_DISABLE_MOTION_INDICATOR
+    if (vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_MOTION_INDICATOR))
+    {
+        return frame->motion_indicator.global_indicator_1;
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+    if (vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_SIGNAL_PER_SPAD))
+    {
+        return frame->signal_per_spad[0] | (frame->signal_per_spad[VL53L5CX_NB_TARGET_PER_ZONE] << 21);
+    }
+#endif
+#ifndef VL53L5CX_DISABLE_NB_TARGET_DETECTED
+    if (vl53l5_sim_is_streamed(VL53L5CX_OUTPUT_NB_TARGET_DETECTED))
+    {
+        uint32_t tag;
+
+        memcpy(&tag, frame->nb_target_detected, sizeof(tag));
+        return tag;
+    }
+#endif
+    (void)frame;
+    return UINT32_MAX;
+}
+
+void vl53l5_sim_init(void)
+{
+    memset(&s_dev, 0, sizeof(s_dev));
+    (void)vl53l5cx_set_outputs(&s_dev, vl53l5_profile_outputs(s_profile));
+    (void)vl53l5cx_get_outputs(&s_dev, &s_streamed);
+    s_dev.data_read_size = vl53l5_sim_read_size(s_streamed, SIM_ZONES);
+    s_dev.streamcount = 255U;
+    for (uint8_t dev = 0U; dev < VL53L5_DEVICE_COUNT; dev++)
+    {
+        s_devices[dev].stream_count = 0U;
+        s_devices[dev].dma_dst = NULL;
+    }
+}
+
+void vl53l5_sim_set_frame(uint8_t dev, const VL53L5CX_ResultsData *frame)
+{
+    if (dev >= VL53L5_DEVICE_COUNT)
+    {
+        return;
+    }
+
+    (void)vl53l5_sim_encode(frame, s_devices[dev].stream_count++, s_devices[dev].sensor_blob);
+    if (s_data_ready_cb != NULL)
+    {
+        s_data_ready_cb(dev);
+    }
+}
+
+bool vl53l5_sim_read_pending(uint8_t dev)
+{
+    return (dev < VL53L5_DEVICE_COUNT) && (s_devices[dev].dma_dst != NULL);
+}
+
+void vl53l5_sim_complete_read(uint8_t dev, bool ok)
+{
+    uint8_t *dst;
+
+    if ((dev >= VL53L5_DEVICE_COUNT) || (s_devices[dev].dma_dst == NULL))
+    {
+        return;
+    }
+
+    dst = s_devices[dev].dma_dst;
+    s_devices[dev].dma_dst = NULL;
+    if (ok)
+    {
+        memcpy(dst, s_devices[dev].dma_blob, s_dev.data_read_size);
+    }
+    if (s_read_done_cb != NULL)
+    {
+        s_read_done_cb(dev, ok);
+    }
+}
+
+void vl53l5_tof_init(void)
+{
+    if (s_dev.data_read_size == 0U)
+    {
+        vl53l5_sim_init();
+    }
+}
+
+/* Simulated devices range from vl53l5_tof_init() on, see tof_bringup_sim for the bring-up */
+bool vl53l5_bringup_due(uint8_t bus)
+{
+    (void)bus;
+    return false;
+}
+
+void vl53l5_bringup_step(uint8_t bus)
+{
+    (void)bus;
+}
+
+bool vl53l5_get_status(uint8_t dev, vl53l5_status_t *status)
+{
+    if ((dev >= VL53L5_DEVICE_COUNT) || (status == NULL))
+    {
+        return false;
+    }
+
+    memset(status, 0, sizeof(*status));
+    status->state = VL53L5_STATE_RUNNING;
+    status->attempts = 1U;
+    return true;
+}
+
+void vl53l5_set_callbacks(vl53l5_data_ready_cb_t data_ready_cb, vl53l5_read_done_cb_t read_done_cb)
+{
+    s_data_ready_cb = data_ready_cb;
+    s_read_done_cb = read_done_cb;
+}
+
+bool vl53l5_is_ready(uint8_t dev)
+{
+    return dev < VL53L5_DEVICE_COUNT;
+}
+
+/* Nothing is downloaded to a simulated device, see tof_boot_sim for the boot */
+bool vl53l5_get_boot_ms(uint8_t dev, uint32_t boot_ms[VL53L5CX_BOOT_PHASE_COUNT])
+{
+    if ((dev >= VL53L5_DEVICE_COUNT) || (boot_ms == NULL))
+    {
+        return false;
+    }
+
+    memset(boot_ms, 0, VL53L5CX_BOOT_PHASE_COUNT * sizeof(uint32_t));
+    return true;
+}
+
+uint8_t vl53l5_bus(uint8_t dev)
+{
+    return (uint8_t)(dev % VL53L5_BUS_COUNT);
+}
+
+uint32_t vl53l5_read_size(void)
+{
+    return s_dev.data_read_size;
+}
+
+/* The bus samples the sensor's result registers when the transfer starts; like the HAL, a transfer
+ * is refused while another device's is still running on the same bus */
+bool vl53l5_start_read(uint8_t dev, uint8_t *raw)
+{
+    if ((dev >= VL53L5_DEVICE_COUNT) || (raw == NULL))
+    {
+        return false;
+    }
+
+    for (uint8_t other = 0U; other < VL53L5_DEVICE_COUNT; other++)
+    {
+        if ((vl53l5_bus(other) == vl53l5_bus(dev)) && (s_devices[other].dma_dst != NULL))
+        {
+            return false;
+        }
+    }
+
+    memcpy(s_devices[dev].dma_blob, s_devices[dev].sensor_blob, s_dev.data_read_size);
+    s_devices[dev].dma_dst = raw;
+    return true;
+}
+
+/* Takes effect at once on every device; like on the board, no read may be in flight */
+bool vl53l5_set_output_profile(vl53l5_output_profile_t profile)
+{
+    if (profile >= VL53L5_PROFILE_COUNT)
+    {
+        return false;
+    }
+
+    s_profile = profile;
+    (void)vl53l5cx_set_outputs(&s_dev, vl53l5_profile_outputs(profile));
+    (void)vl53l5cx_get_outputs(&s_dev, &s_streamed);
+    s_dev.data_read_size = vl53l5_sim_read_size(s_streamed, SIM_ZONES);
+    return true;
+}
+
+vl53l5_output_profile_t vl53l5_get_output_profile(void)
+{
+    return s_profile;
+}
+
+bool vl53l5_decode(uint8_t dev, uint8_t *raw, VL53L5CX_ResultsData *results)
+{
+    if (dev >= VL53L5_DEVICE_COUNT)
+    {
+        return false;
+    }
+
+    return vl53l5cx_decode_ranging_data(&s_dev, raw, results) == VL53L5CX_STATUS_OK;
+}
@@ -0,0 +1,35 @@
+#ifndef VL53L5CX_SIM_H
+#define VL53L5CX_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vl53l5cx.h"
+
+/*
+ * Host stand-in for driver/VL53L5CX_ULD_API/src/vl53l5cx.c. Frames handed to
+ * vl53l5_sim_set_frame() are encoded into the register blob the sensor would
+ * stream over I2C (same block layout as vl53l5cx_start_ranging() configures),
+ * so the real vl53l5cx_decode_ranging_data() runs on them. The caller drives
+ * time: a data-ready event is raised when a frame is set, and a DMA read
+ * started by the application only lands when vl53l5_sim_complete_read() is
+ * called. There are VL53L5_DEVICE_COUNT independent devices, on buses
+ * assigned as on the board. vl53l5_set_output_profile() changes the blocks
+ * streamed; it survives vl53l5_sim_init().
+ */
+
+void vl53l5_sim_init(void);
+uint32_t vl53l5_sim_encode(const VL53L5CX_ResultsData *frame, uint8_t stream_count, uint8_t *raw);
+void vl53l5_sim_quantize(VL53L5CX_ResultsData *frame);
+/* Bytes vl53l5cx_start_ranging() reads per frame for a set of VL53L5CX_OUTPUT_* bits and zones, whether they
+ * are compiled in or not */
+uint32_t vl53l5_sim_read_size(uint32_t outputs, uint32_t zones);
+/* Stamps a frame with a tag that survives the blob, in the first output streamed of: the motion indicator,
+ * the signal rate of zones 0 and 1, the target count of zones 0..3. UINT32_MAX when none is. */
+void vl53l5_sim_set_tag(VL53L5CX_ResultsData *frame, uint32_t tag);
+uint32_t vl53l5_sim_get_tag(const VL53L5CX_ResultsData *frame);
+void vl53l5_sim_set_frame(uint8_t dev, const VL53L5CX_ResultsData *frame);
+bool vl53l5_sim_read_pending(uint8_t dev);
+void vl53l5_sim_complete_read(uint8_t dev, bool ok);
+
+#endif
@@ -0,0 +1,62 @@
+#include "ai.h"
+
+/* Host stand-in for the X-CUBE-AI network. The CM33 runtime library cannot be
+ * linked natively, so AI_Run() derives a deterministic score from the input
+ * features instead. It keeps the classifier post-processing (moving average,
+ * fall state machine) exercised but says nothing about model accuracy or the
+ * real inference cost. */
+
+void AI_Init(void)
+{
+}
+
+void AI_Run(float *pIn, float *pOut)
+{
+    float near = 0.0f;
+    float mid = 0.0f;
+    float far = 0.0f;
+
+    for (uint32_t i = 0U; i < AI_NETWORK_IN_1_SIZE; i++)
+    {
+        if (pIn[i] >= 3.0f)
+        {
+            near += 1.0f;
+        }
+        else if (pIn[i] >= 2.0f)
+        {
+            mid += 1.0f;
+        }
+        else if (pIn[i] >= 1.0f)
+        {
+            far += 1.0f;
+        }
+    }
+
+    float total = near + mid + far;
+    if (total <= 0.0f)
+    {
+        pOut[0] = 0.0f;
+        pOut[1] = 0.0f;
+        pOut[2] = 0.0f;
+        return;
+    }
+
+    pOut[0] = far / total;
+    pOut[1] = near / total;
+    pOut[2] = mid / total;
+}
+
+int argmax(const float *values, uint32_t len)
+{
+    float max_value = values[0];
+    uint32_t max_index = 0;
+    for (uint32_t i = 1; i < len; i++)
+    {
+        if (values[i] > max_value)
+        {
+            max_value = values[i];
+            max_index = i;
+        }
+    }
+    return (int)max_index;
+}
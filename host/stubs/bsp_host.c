@@ -0,0 +1,48 @@
+#include "bsp_btn.h"
+#include "bsp_led.h"
+
+/* LED and button hooks used by the pipeline. On host there is no board, so
+ * they only satisfy the linker. */
+
+void led_init(void)
+{
+}
+
+void led_on(uint16_t led)
+{
+    (void)led;
+}
+
+void led_off(uint16_t led)
+{
+    (void)led;
+}
+
+void led_blink(uint16_t led)
+{
+    (void)led;
+}
+
+void led_chase_enable(void)
+{
+}
+
+void led_chase_disable(void)
+{
+}
+
+void reg_btn_pos_edge_cb(uint16_t btn, btn_cb_t cb)
+{
+    (void)btn;
+    (void)cb;
+}
+
+void reg_btn_neg_edge_cb(uint16_t btn, btn_cb_t cb)
+{
+    (void)btn;
+    (void)cb;
+}
+
+void btn_init(void)
+{
+}
@@ -0,0 +1,70 @@
+#include "platform.h"
+
+/* VL53L5CX platform layer for host builds. There is no bus: writes are
+ * accepted and reads return zeroes, so only the pure parts of the ULD
+ * (result decoding) are meaningful on host. */
+
+uint8_t VL53L5CX_RdByte(VL53L5CX_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_value)
+{
+    (void)p_platform;
+    (void)RegisterAdress;
+    *p_value = 0U;
+    return 0U;
+}
+
+uint8_t VL53L5CX_WrByte(VL53L5CX_Platform *p_platform, uint16_t RegisterAdress, uint8_t value)
+{
+    (void)p_platform;
+    (void)RegisterAdress;
+    (void)value;
+    return 0U;
+}
+
+uint8_t VL53L5CX_RdMulti(VL53L5CX_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size)
+{
+    (void)p_platform;
+    (void)RegisterAdress;
+    memset(p_values, 0, size);
+    return 0U;
+}
+
+uint8_t VL53L5CX_WrMulti(VL53L5CX_Platform *p_platform, uint16_t RegisterAdress, uint8_t *p_values, uint32_t size)
+{
+    (void)p_platform;
+    (void)RegisterAdress;
+    (void)p_values;
+    (void)size;
+    return 0U;
+}
+
+uint8_t VL53L5CX_Reset_Sensor(VL53L5CX_Platform *p_platform)
+{
+    (void)p_platform;
+    return 0U;
+}
+
+void VL53L5CX_SwapBuffer(uint8_t *buffer, uint16_t size)
+{
+    uint32_t i, tmp;
+
+    for (i = 0; i < size; i = i + 4)
+    {
+        tmp = ((uint32_t)buffer[i] << 24) | ((uint32_t)buffer[i + 1] << 16) | ((uint32_t)buffer[i + 2] << 8) |
+              (uint32_t)buffer[i + 3];
+
+        memcpy(&(buffer[i]), &tmp, 4);
+    }
+}
+
+uint8_t VL53L5CX_WaitMs(VL53L5CX_Platform *p_platform, uint32_t TimeMs)
+{
+    (void)p_platform;
+    (void)TimeMs;
+    return 0U;
+}
+
+void VL53L5CX_BootPhase(VL53L5CX_Platform *p_platform, uint8_t phase)
+{
+    (void)p_platform;
+    (void)phase;
+}
@@ -1,5 +1,6 @@
 #include "app_main.h"
 
+#include "bg_store.h"
 #include "bsp_btn.h"
 #include "bsp_led.h"
 #include "bsp_serial.h"
@@ -9,19 +10,61 @@
 #include "pb_manager.h"
 #include "usart.h"
 
+/* Each sensor feeds its own tile of one pipeline's grid */
+#if SENSOR_COUNT != (TOF_TILES * TOF_PIPELINES)
+#error "VL53L5_DEVICE_COUNT must match TOF_TILES_X * TOF_TILES_Y * TOF_PIPELINES"
+#endif
+
+/* The adaptive background drifts away from the stored one, refresh it once a day: ~365 erases a year leave the
+ * 10k cycles of the store sector for over 25 years */
+#define APP_BG_STORE_REFRESH_MS (24UL * 60UL * 60UL * 1000UL)
+
 typedef struct
 {
     app_mode_t mode;
-    tof_pipeline_output_t pipeline_output;
+    tof_pipeline_t pipelines[TOF_PIPELINES];
+    tof_pipeline_output_t pipeline_outputs[TOF_PIPELINES];
+    uint32_t bg_stored_tick;
 } app_context_t;
 
 static app_context_t s_app_ctx = {
     .mode = APP_MODE_INFERENCE,
 };
 
+#if TOF_PIPELINES == 1U
+static bg_info_t s_bg_snapshot;
+#endif
+
 uint8_t received_data[12] = {1};
 volatile uint8_t test = 0;
 
+static void app_update_leds(void)
+{
+    bool collecting = false;
+    bool occupied = false;
+
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        collecting = collecting || s_app_ctx.pipeline_outputs[p].background_collecting;
+        occupied = occupied || (s_app_ctx.pipeline_outputs[p].smoothed_people_count > 0);
+    }
+    if (collecting)
+    {
+        led_chase_enable();
+        return;
+    }
+
+    led_chase_disable();
+    if (occupied)
+    {
+        led_on(LED3);
+    }
+    else
+    {
+        led_off(LED3);
+    }
+}
+
 void app_init(void)
 {
     bsp_serial_init();
@@ -29,25 +72,67 @@ void app_init(void)
     btn_init();
     sensor_init();
     conn_init();
-    tof_pipeline_init();
+    tof_pipeline_runtime_init();
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        tof_pipeline_init(&s_app_ctx.pipelines[p]);
+    }
+    reg_btn_pos_edge_cb(BTN1, app_restart_background);
+#if TOF_PIPELINES == 1U
+    if (bg_store_load(&s_bg_snapshot))
+    {
+        tof_pipeline_restore_background(&s_app_ctx.pipelines[0], &s_bg_snapshot);
+    }
+#endif
+}
+
+/* The store holds a single snapshot, so several pipelines learn their background at every start */
+#if TOF_PIPELINES == 1U
+static void app_store_background(const tof_pipeline_output_t *output)
+{
+    uint32_t now = HAL_GetTick();
+
+    if (output->background_learnt || ((now - s_app_ctx.bg_stored_tick) >= APP_BG_STORE_REFRESH_MS))
+    {
+        (void)bg_store_save(tof_pipeline_get_background(&s_app_ctx.pipelines[0]));
+        s_app_ctx.bg_stored_tick = now;
+    }
 }
+#endif
 
 void app_main(void)
 {
     const VL53L5CX_ResultsData *frame = NULL;
+    uint8_t device = 0U;
+    uint8_t pipeline;
+    tof_pipeline_output_t *output;
 
+    sensor_process();
     conn_process_pending_commands();
 
-    if (!sensor_get_data(&frame))
+    if (!sensor_get_data(&device, &frame))
     {
         return;
     }
+    pipeline = (uint8_t)(device / TOF_TILES);
+    output = &s_app_ctx.pipeline_outputs[pipeline];
 
     switch (s_app_ctx.mode)
     {
     case APP_MODE_INFERENCE:
-        tof_pipeline_process_frame(frame, &s_app_ctx.pipeline_output);
-        send_pb_result(frame, &s_app_ctx.pipeline_output);
+        /* Until every tile of its grid is in, the pipeline has nothing new to publish */
+        if (!tof_pipeline_process_tile(&s_app_ctx.pipelines[pipeline], (uint8_t)(device % TOF_TILES), frame, output))
+        {
+            return;
+        }
+        app_update_leds();
+#if TOF_PIPELINES == 1U
+        if (!output->background_collecting)
+        {
+            app_store_background(output);
+        }
+#endif
+        send_pb_result(frame, output);
         break;
     case APP_MODE_DATA_RECORD:
         break;
@@ -55,7 +140,7 @@ void app_main(void)
         break;
     }
 
-    conn_publish_frame(s_app_ctx.mode, frame, &s_app_ctx.pipeline_output);
+    conn_publish_frame(s_app_ctx.mode, device, pipeline, frame, output);
 }
 
 void app_set_mode(app_mode_t mode)
@@ -67,3 +152,90 @@ app_mode_t app_get_mode(void)
 {
     return s_app_ctx.mode;
 }
+
+void app_restart_background(void)
+{
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        tof_pipeline_restart_background(&s_app_ctx.pipelines[p]);
+    }
+}
+
+void app_refresh_background(void)
+{
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        tof_pipeline_refresh_background(&s_app_ctx.pipelines[p]);
+    }
+}
+
+void app_set_background_learning(uint8_t learn_shift)
+{
+    bg_config_t config;
+
+    bg_default_config(&config);
+    config.adaptive = (learn_shift > 0U);
+    config.collect_frames = config.adaptive ? BG_ADAPTIVE_FRAMES : BG_DEFAULT_FRAMES;
+    if (config.adaptive)
+    {
+        config.learn_shift = learn_shift;
+    }
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        tof_pipeline_set_background_config(&s_app_ctx.pipelines[p], &config);
+    }
+}
+
+bool app_set_output_profile(vl53l5_output_profile_t profile)
+{
+    return sensor_set_output_profile(profile);
+}
+
+bool app_set_count_line(uint8_t index, const line_config_t *line)
+{
+    bool ok = true;
+
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        ok = tof_pipeline_set_line(&s_app_ctx.pipelines[p], index, line) && ok;
+    }
+    return ok;
+}
+
+void app_remove_count_line(uint8_t index)
+{
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        tof_pipeline_remove_line(&s_app_ctx.pipelines[p], index);
+    }
+}
+
+bool app_set_region(uint8_t index, const region_config_t *region)
+{
+    bool ok = true;
+
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        ok = tof_pipeline_set_region(&s_app_ctx.pipelines[p], index, region) && ok;
+    }
+    return ok;
+}
+
+void app_remove_region(uint8_t index)
+{
+    for (uint8_t p = 0U; p < TOF_PIPELINES; p++)
+    {
+        tof_pipeline_remove_region(&s_app_ctx.pipelines[p], index);
+    }
+}
+
+uint16_t app_export_trajectories(uint8_t pipeline, uint8_t *buffer, uint16_t size)
+{
+    return (pipeline < TOF_PIPELINES) ? tof_pipeline_export_trajectories(&s_app_ctx.pipelines[pipeline], buffer, size)
+                                      : 0U;
+}
+
+uint16_t app_pending_trajectories(uint8_t pipeline)
+{
+    return (pipeline < TOF_PIPELINES) ? tof_pipeline_pending_trajectories(&s_app_ctx.pipelines[pipeline]) : 0U;
+}
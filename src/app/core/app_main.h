@@ -1,6 +1,23 @@
 #ifndef __APP_MAIN_H
 #define __APP_MAIN_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "line_counter.h"
+#include "region_counter.h"
+#include "vl53l5cx.h"
+
+/*
+ * Pipelines run side by side, one per doorway: device d feeds tile
+ * d % TOF_TILES of pipeline d / TOF_TILES, each with its own background,
+ * tracks and counters. Settings below apply to every pipeline. Set from
+ * CMake (TOF_PIPELINES).
+ */
+#ifndef TOF_PIPELINES
+#define TOF_PIPELINES 1U
+#endif
+
 typedef enum {
     APP_MODE_INFERENCE = 0,
     APP_MODE_DATA_RECORD,
@@ -10,5 +27,23 @@ void app_init(void);
 void app_main(void);
 void app_set_mode(app_mode_t mode);
 app_mode_t app_get_mode(void);
+void app_restart_background(void);
+/* Re-learns the background without interrupting the count */
+void app_refresh_background(void);
+/* 0 learns the background once, n keeps adapting it at 1/2^n per frame */
+void app_set_background_learning(uint8_t learn_shift);
+/* Switches the blocks the sensors stream; false until the transfers in flight have landed */
+bool app_set_output_profile(vl53l5_output_profile_t profile);
+/* Sets or adds a counting line, see line_counter_set() */
+bool app_set_count_line(uint8_t index, const line_config_t *line);
+/* Drops a counting line, or every line with LINE_ALL */
+void app_remove_count_line(uint8_t index);
+/* Sets or adds an occupancy region, see region_counter_set() */
+bool app_set_region(uint8_t index, const region_config_t *region);
+/* Drops an occupancy region, or every region with REGION_ALL */
+void app_remove_region(uint8_t index);
+/* Trajectory samples of a pipeline not exported yet, see trajectory_export() */
+uint16_t app_export_trajectories(uint8_t pipeline, uint8_t *buffer, uint16_t size);
+uint16_t app_pending_trajectories(uint8_t pipeline);
 
 #endif
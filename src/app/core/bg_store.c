@@ -0,0 +1,123 @@
+#include "bg_store.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "bsp_flash.h"
+#include "vl53l5cx.h"
+
+#define BG_STORE_MAGIC 0x31534742UL /* "BGS1" */
+#define BG_STORE_VERSION 2U
+/* The header goes in last, a record without one was never completed */
+#define BG_STORE_HEADER_OFFSET 0U
+#define BG_STORE_PAYLOAD_OFFSET BSP_FLASH_WRITE_UNIT
+#define BG_STORE_COMPARE_CHUNK 64U
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t fingerprint;
+    uint32_t payload_crc;
+} bg_store_header_t;
+
+static uint32_t bg_store_crc32(uint32_t crc, const void *data, uint32_t size)
+{
+    const uint8_t *bytes = data;
+
+    crc = ~crc;
+    for (uint32_t i = 0U; i < size; i++)
+    {
+        crc ^= bytes[i];
+        for (uint8_t bit = 0U; bit < 8U; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+        }
+    }
+    return ~crc;
+}
+
+static bool bg_store_fits(void)
+{
+    return (sizeof(bg_store_header_t) <= BSP_FLASH_WRITE_UNIT) &&
+           ((BG_STORE_PAYLOAD_OFFSET + sizeof(bg_info_t)) <= BSP_FLASH_STORE_SIZE);
+}
+
+uint32_t bg_store_fingerprint(void)
+{
+    const uint32_t config[] = {
+        BG_STORE_VERSION, TOF_SENSOR_ROWS, TOF_SENSOR_COLS, TOF_TILES_X, TOF_TILES_Y,
+        DISTANCE_ODR,     (uint32_t)sizeof(bg_info_t),
+    };
+
+    return bg_store_crc32(0U, config, sizeof(config));
+}
+
+bool bg_store_load(bg_info_t *info)
+{
+    bg_store_header_t header;
+
+    if ((info == NULL) || !bg_store_fits() || !bsp_flash_store_read(BG_STORE_HEADER_OFFSET, &header, sizeof(header)))
+    {
+        return false;
+    }
+    if ((header.magic != BG_STORE_MAGIC) || (header.version != BG_STORE_VERSION) ||
+        (header.fingerprint != bg_store_fingerprint()))
+    {
+        return false;
+    }
+    if (!bsp_flash_store_read(BG_STORE_PAYLOAD_OFFSET, info, sizeof(*info)))
+    {
+        return false;
+    }
+    return bg_store_crc32(0U, info, sizeof(*info)) == header.payload_crc;
+}
+
+static bool bg_store_matches(const bg_store_header_t *header, const bg_info_t *info)
+{
+    bg_store_header_t stored;
+    uint8_t chunk[BG_STORE_COMPARE_CHUNK];
+    const uint8_t *bytes = (const uint8_t *)info;
+
+    if (!bsp_flash_store_read(BG_STORE_HEADER_OFFSET, &stored, sizeof(stored)) ||
+        (memcmp(&stored, header, sizeof(stored)) != 0))
+    {
+        return false;
+    }
+    for (uint32_t done = 0U; done < sizeof(*info); done += BG_STORE_COMPARE_CHUNK)
+    {
+        uint32_t size = ((sizeof(*info) - done) < BG_STORE_COMPARE_CHUNK) ? (sizeof(*info) - done)
+                                                                         : BG_STORE_COMPARE_CHUNK;
+
+        if (!bsp_flash_store_read(BG_STORE_PAYLOAD_OFFSET + done, chunk, size) ||
+            (memcmp(chunk, &bytes[done], size) != 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool bg_store_save(const bg_info_t *info)
+{
+    bg_store_header_t header;
+
+    if ((info == NULL) || !bg_store_fits())
+    {
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = BG_STORE_MAGIC;
+    header.version = BG_STORE_VERSION;
+    header.fingerprint = bg_store_fingerprint();
+    header.payload_crc = bg_store_crc32(0U, info, sizeof(*info));
+    if (bg_store_matches(&header, info))
+    {
+        return true;
+    }
+
+    return bsp_flash_store_erase() && bsp_flash_store_write(BG_STORE_PAYLOAD_OFFSET, info, sizeof(*info)) &&
+           bsp_flash_store_write(BG_STORE_HEADER_OFFSET, &header, sizeof(header));
+}
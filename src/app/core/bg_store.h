@@ -0,0 +1,22 @@
+#ifndef BG_STORE_H
+#define BG_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "background.h"
+
+/*
+ * Background snapshot in the flash store, so a reset only has to confirm the
+ * scene instead of learning it again. The record carries a CRC and a
+ * fingerprint of the grid and ranging configuration; a snapshot taken with a
+ * different configuration, or torn by a reset while it was written, is not
+ * loaded.
+ */
+
+uint32_t bg_store_fingerprint(void);
+bool bg_store_load(bg_info_t *info);
+/* Skips the write when the store already holds this snapshot */
+bool bg_store_save(const bg_info_t *info);
+
+#endif
@@ -4,26 +4,103 @@
 #include <string.h>
 
 #include "bsp_serial.h"
+#include "frame_log.h"
+#include "main.h"
 #include "pb_manager.h"
+#include "tof_profiler.h"
 #include "vl53l5cx.h"
 
 #define CONN_PACKET_MAX_SIZE 220U
-#define CONN_FRAME_PIXELS (TOF_ROWS * TOF_COLS)
+/* Framing: magic, type and length before the payload, checksum and end marker after it */
+#define CONN_PAYLOAD_MAX_SIZE (CONN_PACKET_MAX_SIZE - 11U)
+#define CONN_FRAME_PIXELS TOF_SENSOR_ZONES
 
 #define CONN_TYPE_BUNDLE 0xAFU
 #define CONN_TYPE_DISTANCE_DATA 0xA3U
 #define CONN_TYPE_IN_OUT_DATA 0xA4U
 #define CONN_TYPE_PERSON_INFO 0xA5U
 #define CONN_TYPE_BG_STATUS 0xA6U
+#define CONN_TYPE_FRAME_LOG 0xA7U
+#define CONN_TYPE_PROFILE_DATA 0xA8U
+#define CONN_TYPE_BOOT_DATA 0xA9U
+#define CONN_TYPE_LINE_COUNTS 0xAAU
+#define CONN_TYPE_REGION_DATA 0xABU
+#define CONN_TYPE_TRAJECTORY 0xACU
+#define CONN_TYPE_PIPELINE 0xADU
 
 #define CONN_CMD_BG_REINIT 0xA1U
 #define CONN_CMD_DISTANCE_STREAM 0xA2U
+#define CONN_CMD_DATA_RECORD 0xA3U
+#define CONN_CMD_PROFILE 0xA4U
+#define CONN_CMD_BG_LEARNING 0xA5U
+#define CONN_CMD_SENSOR_OUTPUTS 0xA6U
+#define CONN_CMD_COUNT_LINE 0xA7U
+#define CONN_CMD_REGION 0xA8U
+#define CONN_CMD_TRAJECTORY_STREAM 0xA9U
+#define CONN_BG_LEARNING_NONE 0xFFU
+/* CONN_CMD_BG_REINIT values: 0x01 re-learns while counting carries on, 0x02 restarts from scratch */
+#define CONN_BG_REINIT_NONE 0x00U
+#define CONN_BG_REINIT_REFRESH 0x01U
+#define CONN_BG_REINIT_RESTART 0x02U
+/* CONN_CMD_SENSOR_OUTPUTS values: 0x01 + vl53l5_output_profile_t */
+#define CONN_OUTPUTS_NONE 0x00U
+#define CONN_OUTPUTS_FIRST 0x01U
+/* CONN_CMD_COUNT_LINE payloads: the line index alone drops it, with the line it sets it, see conn_get_line() */
+#define CONN_LINE_NONE 0xFEU
+#define CONN_LINE_SET_SIZE 11U
+/* CONN_CMD_REGION payloads: the region index alone drops it, with its vertices it sets it */
+#define CONN_REGION_NONE 0xFEU
+#define CONN_REGION_VERTEX_SIZE 4U
+
+#define CONN_FRAME_LOG_PAYLOAD_IDX 7U
+#define CONN_FRAME_LOG_PACKET_MAX_SIZE (FRAME_LOG_MAX_RECORD_SIZE + 12U)
+#define CONN_FRAME_LOG_KEY_INTERVAL 16U
+/* Sections of a runtime packet at their largest: pipeline, distance, in/out, person info, counting lines and
+ * regions. Trajectory records fill what is left of CONN_PACKET_MAX_SIZE. */
+#define CONN_PIPELINE_SECTION_SIZE ((TOF_PIPELINES > 1U) ? 4U : 0U)
+#define CONN_RUNTIME_PAYLOAD_SIZE                                                                                      \
+    (CONN_PIPELINE_SECTION_SIZE + ((CONN_FRAME_PIXELS * 2U) + 3U) + 7U + 14U + (4U + (TOF_MAX_LINES * 4U)) +           \
+     (5U + (TOF_MAX_REGIONS * 3U) + (REGION_DWELL_BINS * 2U)))
+#if CONN_RUNTIME_PAYLOAD_SIZE > CONN_PAYLOAD_MAX_SIZE
+#error "a runtime packet does not fit CONN_PACKET_MAX_SIZE"
+#endif
+/* Runtime packets of a pipeline between two of its trajectory exports, so that a record carries that many samples of
+ * its track */
+#define CONN_TRAJECTORY_INTERVAL 8U
+/* Boot phase times, then the status of the device */
+#define CONN_BOOT_DEVICE_SIZE ((VL53L5CX_BOOT_PHASE_COUNT * 2U) + 7U)
+/* Devices of a boot data section after its 3-byte header; more take as many packets as needed */
+#define CONN_BOOT_DEVICES_PER_PACKET ((CONN_PAYLOAD_MAX_SIZE - 3U - 3U) / CONN_BOOT_DEVICE_SIZE)
+#if CONN_BOOT_DEVICES_PER_PACKET == 0U
+#error "the boot data of a device does not fit CONN_PACKET_MAX_SIZE"
+#endif
 
 static volatile bool s_distance_stream_enabled = true;
-static volatile bool s_request_bg_reinit = false;
+static volatile bool s_trajectory_stream_enabled = false;
+static uint8_t s_trajectory_wait[TOF_PIPELINES];
+static volatile uint8_t s_request_bg_reinit = CONN_BG_REINIT_NONE;
+static volatile uint8_t s_request_mode = 0U;
+static volatile uint8_t s_request_profile = 0U;
+static volatile uint8_t s_request_bg_learning = CONN_BG_LEARNING_NONE;
+static volatile uint8_t s_request_outputs = CONN_OUTPUTS_NONE;
+static volatile uint8_t s_request_line_index = CONN_LINE_NONE;
+static volatile bool s_request_line_set = false;
+static line_config_t s_request_line;
+static volatile uint8_t s_request_region_index = CONN_REGION_NONE;
+static volatile bool s_request_region_set = false;
+static region_config_t s_request_region;
+static uint8_t s_region_dwell_idx[TOF_PIPELINES];
+static uint8_t s_boot_next_device = 0U;
 static uint8_t s_tx_buffer[CONN_PACKET_MAX_SIZE];
-
-static bool conn_parse_command(const uint8_t *packet, uint16_t packet_len, uint8_t *cmd_type, uint8_t *cmd_value)
+static uint8_t s_frame_log_tx_buffer[CONN_FRAME_LOG_PACKET_MAX_SIZE];
+/* One delta chain per device, all records share the header */
+static frame_log_encoder_t s_frame_log_encoders[VL53L5_DEVICE_COUNT];
+static bool s_frame_log_header_sent = false;
+static app_mode_t s_last_mode = APP_MODE_INFERENCE;
+
+/* The payload is left in the packet, cmd_len bytes at cmd_payload */
+static bool conn_parse_command(const uint8_t *packet, uint16_t packet_len, uint8_t *cmd_type,
+                               const uint8_t **cmd_payload, uint8_t *cmd_len)
 {
     uint8_t payload_len;
     uint8_t expected_checksum = 0U;
@@ -31,7 +108,7 @@ static bool conn_parse_command(const uint8_t *packet, uint16_t packet_len, uint8
     uint16_t min_packet_len;
     uint16_t footer_idx;
 
-    if ((packet == NULL) || (cmd_type == NULL) || (cmd_value == NULL) || (packet_len < 11U))
+    if ((packet == NULL) || (cmd_type == NULL) || (cmd_payload == NULL) || (cmd_len == NULL) || (packet_len < 11U))
     {
         return false;
     }
@@ -69,23 +146,59 @@ static bool conn_parse_command(const uint8_t *packet, uint16_t packet_len, uint8
     }
 
     *cmd_type = packet[4];
-    *cmd_value = packet[6];
+    *cmd_payload = &packet[6];
+    *cmd_len = payload_len;
     return true;
 }
 
+static int16_t conn_get_i16_be(const uint8_t *buf)
+{
+    return (int16_t)(uint16_t)(((uint16_t)buf[0] << 8) | buf[1]);
+}
+
+/* row_a, col_a, row_b and col_b as i16 then hysteresis as u16, big-endian, in 1/TOF_SUBZONE zone; a hysteresis
+ * of 0 takes LINE_DEFAULT_HYSTERESIS */
+static void conn_get_line(const uint8_t *data, line_config_t *line)
+{
+    line->row_a = conn_get_i16_be(&data[0]);
+    line->col_a = conn_get_i16_be(&data[2]);
+    line->row_b = conn_get_i16_be(&data[4]);
+    line->col_b = conn_get_i16_be(&data[6]);
+    line->hysteresis = (uint16_t)conn_get_i16_be(&data[8]);
+    if (line->hysteresis == 0U)
+    {
+        line->hysteresis = LINE_DEFAULT_HYSTERESIS;
+    }
+}
+
+/* row and col of each vertex as i16, big-endian, in 1/TOF_SUBZONE zone */
+static void conn_get_region(const uint8_t *data, uint8_t vertex_count, region_config_t *region)
+{
+    region->vertex_count = vertex_count;
+    for (uint8_t v = 0U; v < vertex_count; v++)
+    {
+        region->row[v] = conn_get_i16_be(&data[v * CONN_REGION_VERTEX_SIZE]);
+        region->col[v] = conn_get_i16_be(&data[(v * CONN_REGION_VERTEX_SIZE) + 2U]);
+    }
+}
+
 static void conn_rx_callback(uint8_t *packet, uint32_t packet_len)
 {
+    const uint8_t *cmd_payload;
     uint8_t cmd_type;
     uint8_t cmd_value;
+    uint8_t cmd_len;
 
-    if (!conn_parse_command(packet, (uint16_t)packet_len, &cmd_type, &cmd_value))
+    if (!conn_parse_command(packet, (uint16_t)packet_len, &cmd_type, &cmd_payload, &cmd_len))
     {
         return;
     }
+    cmd_value = cmd_payload[0];
 
-    if ((cmd_type == CONN_CMD_BG_REINIT) && (cmd_value == 0x01U))
+    if ((cmd_type == CONN_CMD_BG_REINIT) &&
+        ((cmd_value == CONN_BG_REINIT_REFRESH) || (cmd_value == CONN_BG_REINIT_RESTART)))
     {
-        s_request_bg_reinit = true;
+        s_request_bg_reinit = cmd_value;
         return;
     }
 
@@ -99,6 +212,84 @@ static void conn_rx_callback(uint8_t *packet, uint32_t packet_len)
         {
             s_distance_stream_enabled = false;
         }
+        return;
+    }
+
+    if (cmd_type == CONN_CMD_TRAJECTORY_STREAM)
+    {
+        if (cmd_value == 0x01U)
+        {
+            s_trajectory_stream_enabled = true;
+        }
+        else if (cmd_value == 0x02U)
+        {
+            s_trajectory_stream_enabled = false;
+        }
+        return;
+    }
+
+    if ((cmd_type == CONN_CMD_DATA_RECORD) && ((cmd_value == 0x01U) || (cmd_value == 0x02U)))
+    {
+        s_request_mode = cmd_value;
+        return;
+    }
+
+    /* 0x01 dumps the stage statistics, 0x02 resets them, 0x03 dumps the sensor boot phases and status */
+    if ((cmd_type == CONN_CMD_PROFILE) && (cmd_value >= 0x01U) && (cmd_value <= 0x03U))
+    {
+        s_request_profile = cmd_value;
+        return;
+    }
+
+    /* 0: learn once at start, n: keep learning at a rate of 1/2^n per frame */
+    if ((cmd_type == CONN_CMD_BG_LEARNING) && (cmd_value <= BG_MAX_LEARN_SHIFT))
+    {
+        s_request_bg_learning = cmd_value;
+        return;
+    }
+
+    if ((cmd_type == CONN_CMD_SENSOR_OUTPUTS) && (cmd_value >= CONN_OUTPUTS_FIRST) &&
+        (cmd_value < (uint8_t)(CONN_OUTPUTS_FIRST + VL53L5_PROFILE_COUNT)))
+    {
+        s_request_outputs = cmd_value;
+        return;
+    }
+
+    /* One change at a time: the main loop has to take the pending one first */
+    if ((cmd_type == CONN_CMD_COUNT_LINE) && (s_request_line_index == CONN_LINE_NONE) &&
+        ((cmd_value < TOF_MAX_LINES) || (cmd_value == LINE_ALL)))
+    {
+        if ((cmd_len == CONN_LINE_SET_SIZE) && (cmd_value != LINE_ALL))
+        {
+            conn_get_line(&cmd_payload[1], &s_request_line);
+            s_request_line_set = true;
+            s_request_line_index = cmd_value;
+        }
+        else if (cmd_len == 1U)
+        {
+            s_request_line_set = false;
+            s_request_line_index = cmd_value;
+        }
+        return;
+    }
+
+    if ((cmd_type == CONN_CMD_REGION) && (s_request_region_index == CONN_REGION_NONE) &&
+        ((cmd_value < TOF_MAX_REGIONS) || (cmd_value == REGION_ALL)))
+    {
+        uint8_t vertex_count = (uint8_t)((cmd_len - 1U) / CONN_REGION_VERTEX_SIZE);
+
+        if (cmd_len == 1U)
+        {
+            s_request_region_set = false;
+            s_request_region_index = cmd_value;
+        }
+        else if ((cmd_value != REGION_ALL) && (((cmd_len - 1U) % CONN_REGION_VERTEX_SIZE) == 0U) &&
+                 (vertex_count >= 2U) && (vertex_count <= REGION_MAX_VERTICES))
+        {
+            conn_get_region(&cmd_payload[1], vertex_count, &s_request_region);
+            s_request_region_set = true;
+            s_request_region_index = cmd_value;
+        }
     }
 }
 
@@ -138,6 +329,43 @@ static void conn_send_packet(uint8_t type, const uint8_t *payload, uint8_t paylo
     bsp_serial_tx_data(s_tx_buffer, idx);
 }
 
+/* Frame log records do not fit the 8-bit payload length of the regular
+ * packets, so CONN_TYPE_FRAME_LOG carries a 16-bit big-endian length. The
+ * payload (a frame log header starting with 'T', or one record) is encoded
+ * in place at CONN_FRAME_LOG_PAYLOAD_IDX to avoid copying it. */
+static void conn_send_frame_log_packet(uint16_t payload_len)
+{
+    uint16_t idx = 0U;
+    uint8_t checksum = 0U;
+
+    if ((payload_len + 12U) > CONN_FRAME_LOG_PACKET_MAX_SIZE)
+    {
+        return;
+    }
+
+    s_frame_log_tx_buffer[idx++] = 'F';
+    s_frame_log_tx_buffer[idx++] = 'U';
+    s_frame_log_tx_buffer[idx++] = 'T';
+    s_frame_log_tx_buffer[idx++] = '0';
+    s_frame_log_tx_buffer[idx++] = CONN_TYPE_FRAME_LOG;
+    s_frame_log_tx_buffer[idx++] = (uint8_t)((payload_len >> 8) & 0xFFU);
+    s_frame_log_tx_buffer[idx++] = (uint8_t)(payload_len & 0xFFU);
+    idx = (uint16_t)(idx + payload_len);
+
+    for (uint16_t i = 4U; i < idx; i++)
+    {
+        checksum ^= s_frame_log_tx_buffer[i];
+    }
+    s_frame_log_tx_buffer[idx++] = checksum;
+    s_frame_log_tx_buffer[idx++] = 'E';
+    s_frame_log_tx_buffer[idx++] = 'N';
+    s_frame_log_tx_buffer[idx++] = 'D';
+    s_frame_log_tx_buffer[idx++] = '0';
+    s_frame_log_tx_buffer[idx++] = '\n';
+
+    bsp_serial_tx_data(s_frame_log_tx_buffer, idx);
+}
+
 static bool conn_append_section(uint8_t *payload, uint8_t *payload_idx, uint8_t payload_max, uint8_t section_type,
                                 const uint8_t *section_data, uint8_t section_len)
 {
@@ -237,21 +465,206 @@ static bool conn_append_person_section(const tof_people_data_t *people, const to
     return conn_append_section(payload, payload_idx, payload_max, CONN_TYPE_PERSON_INFO, person_payload, idx);
 }
 
+/* Section layout: line_count u8, then per line in and out as u16 big-endian */
+static bool conn_append_line_section(const tof_pipeline_output_t *pipeline_output, uint8_t *payload,
+                                     uint8_t *payload_idx, uint8_t payload_max)
+{
+    uint8_t line_payload[1U + (TOF_MAX_LINES * 4U)] = {0};
+    uint8_t idx = 0U;
+
+    line_payload[idx++] = pipeline_output->line_count;
+    for (uint8_t l = 0U; (l < pipeline_output->line_count) && (l < TOF_MAX_LINES); l++)
+    {
+        line_payload[idx++] = (uint8_t)((pipeline_output->line_in[l] >> 8) & 0xFFU);
+        line_payload[idx++] = (uint8_t)(pipeline_output->line_in[l] & 0xFFU);
+        line_payload[idx++] = (uint8_t)((pipeline_output->line_out[l] >> 8) & 0xFFU);
+        line_payload[idx++] = (uint8_t)(pipeline_output->line_out[l] & 0xFFU);
+    }
+
+    return conn_append_section(payload, payload_idx, payload_max, CONN_TYPE_LINE_COUNTS, line_payload, idx);
+}
+
+/* Section layout: region_count u8, per region occupancy u8 and entries u16, then the dwell histogram of one
+ * region, a different one every packet of the pipeline: its index u8 and REGION_DWELL_BINS stays as u16. u16 are
+ * big-endian. */
+static bool conn_append_region_section(uint8_t pipeline, const tof_pipeline_output_t *pipeline_output,
+                                       uint8_t *payload, uint8_t *payload_idx, uint8_t payload_max)
+{
+    uint8_t region_payload[2U + (TOF_MAX_REGIONS * 3U) + (REGION_DWELL_BINS * 2U)] = {0};
+    uint8_t count = (pipeline_output->region_count < TOF_MAX_REGIONS) ? pipeline_output->region_count
+                                                                       : (uint8_t)TOF_MAX_REGIONS;
+    const region_stats_t *dwell_stats;
+    uint8_t dwell_idx;
+    uint8_t idx = 0U;
+
+    region_payload[idx++] = count;
+    for (uint8_t r = 0U; r < count; r++)
+    {
+        region_payload[idx++] = pipeline_output->regions[r].occupancy;
+        region_payload[idx++] = (uint8_t)((pipeline_output->regions[r].entries >> 8) & 0xFFU);
+        region_payload[idx++] = (uint8_t)(pipeline_output->regions[r].entries & 0xFFU);
+    }
+
+    dwell_idx = (uint8_t)(s_region_dwell_idx[pipeline] % count);
+    s_region_dwell_idx[pipeline] = (uint8_t)(dwell_idx + 1U);
+    dwell_stats = &pipeline_output->regions[dwell_idx];
+    region_payload[idx++] = dwell_idx;
+    for (uint8_t bin = 0U; bin < REGION_DWELL_BINS; bin++)
+    {
+        region_payload[idx++] = (uint8_t)((dwell_stats->dwell[bin] >> 8) & 0xFFU);
+        region_payload[idx++] = (uint8_t)(dwell_stats->dwell[bin] & 0xFFU);
+    }
+
+    return conn_append_section(payload, payload_idx, payload_max, CONN_TYPE_REGION_DATA, region_payload, idx);
+}
+
+static void conn_frame_log_start(void)
+{
+    frame_log_config_t config = {
+        .flags = FRAME_LOG_FLAG_DELTA_DISTANCE,
+        .key_interval = CONN_FRAME_LOG_KEY_INTERVAL,
+        .odr_hz = DISTANCE_ODR,
+        .devices = VL53L5_DEVICE_COUNT,
+    };
+
+    for (uint8_t device = 0U; device < VL53L5_DEVICE_COUNT; device++)
+    {
+        frame_log_encoder_init(&s_frame_log_encoders[device], &config, device);
+    }
+    s_frame_log_header_sent = false;
+}
+
+#if TOF_PROFILING
+static void conn_put_u32_be(uint8_t *buf, uint32_t value)
+{
+    buf[0] = (uint8_t)((value >> 24) & 0xFFU);
+    buf[1] = (uint8_t)((value >> 16) & 0xFFU);
+    buf[2] = (uint8_t)((value >> 8) & 0xFFU);
+    buf[3] = (uint8_t)(value & 0xFFU);
+}
+
+/* Section layout: ticks_per_us u16, odr_hz u8, stage_count u8, then per stage
+ * min, max, mean and p99 ticks as u32. All fields big-endian. */
+static void conn_send_profile_data(void)
+{
+    uint8_t payload[4U + (TOF_PROFILE_STAGE_COUNT * 16U) + 3U] = {0};
+    uint8_t profile_payload[4U + (TOF_PROFILE_STAGE_COUNT * 16U)] = {0};
+    uint8_t payload_idx = 0U;
+    uint8_t idx = 0U;
+    uint32_t ticks_per_us = tof_profiler_ticks_per_us();
+
+    profile_payload[idx++] = (uint8_t)((ticks_per_us >> 8) & 0xFFU);
+    profile_payload[idx++] = (uint8_t)(ticks_per_us & 0xFFU);
+    profile_payload[idx++] = DISTANCE_ODR;
+    profile_payload[idx++] = TOF_PROFILE_STAGE_COUNT;
+
+    for (uint8_t stage = 0U; stage < TOF_PROFILE_STAGE_COUNT; stage++)
+    {
+        tof_profile_stats_t stats;
+
+        (void)tof_profiler_get_stats((tof_profile_stage_t)stage, &stats);
+        conn_put_u32_be(&profile_payload[idx], stats.min_ticks);
+        conn_put_u32_be(&profile_payload[idx + 4U], stats.max_ticks);
+        conn_put_u32_be(&profile_payload[idx + 8U], stats.mean_ticks);
+        conn_put_u32_be(&profile_payload[idx + 12U], stats.p99_ticks);
+        idx = (uint8_t)(idx + 16U);
+    }
+
+    if (!conn_append_section(payload, &payload_idx, sizeof(payload), CONN_TYPE_PROFILE_DATA, profile_payload, idx))
+    {
+        return;
+    }
+
+    conn_send_packet(CONN_TYPE_BUNDLE, payload, payload_idx);
+}
+
+/* Section layout: device count u8, phase count u8, index of the first device u8, then per device from it the ms
+ * spent in each VL53L5CX_BootPhase_t as u16, then its vl53l5_status_t as state u8, last_fault u8, last_error u8,
+ * attempts u16 and faults u16; u16 are big-endian and the times saturated. True once the last device went out. */
+static bool conn_send_boot_data(void)
+{
+    uint8_t payload[3U + (CONN_BOOT_DEVICES_PER_PACKET * CONN_BOOT_DEVICE_SIZE) + 3U] = {0};
+    uint8_t boot_payload[3U + (CONN_BOOT_DEVICES_PER_PACKET * CONN_BOOT_DEVICE_SIZE)] = {0};
+    uint8_t payload_idx = 0U;
+    uint8_t idx = 0U;
+    uint8_t first = s_boot_next_device;
+    uint8_t end = ((VL53L5_DEVICE_COUNT - first) > CONN_BOOT_DEVICES_PER_PACKET)
+                      ? (uint8_t)(first + CONN_BOOT_DEVICES_PER_PACKET)
+                      : (uint8_t)VL53L5_DEVICE_COUNT;
+
+    s_boot_next_device = (end < VL53L5_DEVICE_COUNT) ? end : 0U;
+    boot_payload[idx++] = VL53L5_DEVICE_COUNT;
+    boot_payload[idx++] = VL53L5CX_BOOT_PHASE_COUNT;
+    boot_payload[idx++] = first;
+    for (uint8_t dev = first; dev < end; dev++)
+    {
+        uint32_t boot_ms[VL53L5CX_BOOT_PHASE_COUNT] = {0};
+        vl53l5_status_t status = {0};
+
+        (void)vl53l5_get_boot_ms(dev, boot_ms);
+        for (uint8_t phase = 0U; phase < VL53L5CX_BOOT_PHASE_COUNT; phase++)
+        {
+            uint32_t ms = (boot_ms[phase] > 0xFFFFU) ? 0xFFFFU : boot_ms[phase];
+
+            boot_payload[idx++] = (uint8_t)((ms >> 8) & 0xFFU);
+            boot_payload[idx++] = (uint8_t)(ms & 0xFFU);
+        }
+
+        (void)vl53l5_get_status(dev, &status);
+        boot_payload[idx++] = (uint8_t)status.state;
+        boot_payload[idx++] = (uint8_t)status.last_fault;
+        boot_payload[idx++] = status.last_error;
+        boot_payload[idx++] = (uint8_t)((status.attempts >> 8) & 0xFFU);
+        boot_payload[idx++] = (uint8_t)(status.attempts & 0xFFU);
+        boot_payload[idx++] = (uint8_t)((status.faults >> 8) & 0xFFU);
+        boot_payload[idx++] = (uint8_t)(status.faults & 0xFFU);
+    }
+
+    if (conn_append_section(payload, &payload_idx, sizeof(payload), CONN_TYPE_BOOT_DATA, boot_payload, idx))
+    {
+        conn_send_packet(CONN_TYPE_BUNDLE, payload, payload_idx);
+    }
+    return s_boot_next_device == 0U;
+}
+#endif
+
 void conn_init(void)
 {
     s_distance_stream_enabled = true;
-    s_request_bg_reinit = false;
+    s_trajectory_stream_enabled = false;
+    memset(s_trajectory_wait, 0, sizeof(s_trajectory_wait));
+    s_request_bg_reinit = CONN_BG_REINIT_NONE;
+    s_request_mode = 0U;
+    s_request_profile = 0U;
+    s_request_bg_learning = CONN_BG_LEARNING_NONE;
+    s_request_outputs = CONN_OUTPUTS_NONE;
+    s_request_line_index = CONN_LINE_NONE;
+    s_request_region_index = CONN_REGION_NONE;
+    memset(s_region_dwell_idx, 0, sizeof(s_region_dwell_idx));
+    s_boot_next_device = 0U;
+    conn_frame_log_start();
     bsp_serial_set_rx_cb(conn_rx_callback);
 }
 
-static void conn_send_background_status(bool background_collecting)
+/* With more than one pipeline, the one the sections after it belong to */
+static bool conn_append_pipeline_section(uint8_t pipeline, uint8_t *payload, uint8_t *payload_idx, uint8_t payload_max)
 {
-    uint8_t payload[8] = {0};
+    if (TOF_PIPELINES == 1U)
+    {
+        return true;
+    }
+    return conn_append_section(payload, payload_idx, payload_max, CONN_TYPE_PIPELINE, &pipeline, 1U);
+}
+
+static void conn_send_background_status(uint8_t pipeline, bool background_collecting)
+{
+    uint8_t payload[12] = {0};
     uint8_t payload_idx = 0U;
     uint8_t bg_payload[1];
 
     bg_payload[0] = background_collecting ? 1U : 0U;
-    if (!conn_append_section(payload, &payload_idx, sizeof(payload), CONN_TYPE_BG_STATUS, bg_payload,
+    if (!conn_append_pipeline_section(pipeline, payload, &payload_idx, sizeof(payload)) ||
+        !conn_append_section(payload, &payload_idx, sizeof(payload), CONN_TYPE_BG_STATUS, bg_payload,
                              sizeof(bg_payload)))
     {
         return;
@@ -260,12 +673,50 @@ static void conn_send_background_status(bool background_collecting)
     conn_send_packet(CONN_TYPE_BUNDLE, payload, payload_idx);
 }
 
-static void conn_send_runtime_data(const VL53L5CX_ResultsData *raw_frame, const tof_people_data_t *people,
-                                   const tof_person_info_t *person_info, uint8_t person_count)
+/* Every CONN_TRAJECTORY_INTERVAL packets, as many pending trajectory samples as the packet has room for; the rest go
+ * with the next ones. Section layout: samples dropped so far u16 big-endian, then trajectory_export() records. */
+static bool conn_append_trajectory_section(uint8_t pipeline, const tof_pipeline_output_t *pipeline_output,
+                                           uint8_t *payload, uint8_t *payload_idx, uint8_t payload_max)
 {
-    uint8_t payload[200] = {0};
+    uint8_t trajectory_payload[CONN_PAYLOAD_MAX_SIZE];
+    uint16_t room = (uint16_t)(payload_max - *payload_idx);
+    uint16_t len;
+
+    if (s_trajectory_wait[pipeline] > 0U)
+    {
+        s_trajectory_wait[pipeline]--;
+        return true;
+    }
+    /* Samples exported into a packet that cannot be sent would be lost */
+    if ((room < (TRAJECTORY_RECORD_HEADER_SIZE + 5U)) || (bsp_serial_tx_status() == 0U))
+    {
+        return true;
+    }
+    trajectory_payload[0] = (uint8_t)((pipeline_output->trajectory_dropped >> 8) & 0xFFU);
+    trajectory_payload[1] = (uint8_t)(pipeline_output->trajectory_dropped & 0xFFU);
+    len = app_export_trajectories(pipeline, &trajectory_payload[2], (uint16_t)(room - 5U));
+    if (app_pending_trajectories(pipeline) == 0U)
+    {
+        s_trajectory_wait[pipeline] = CONN_TRAJECTORY_INTERVAL - 1U;
+    }
+    if (len == 0U)
+    {
+        return true;
+    }
+    return conn_append_section(payload, payload_idx, payload_max, CONN_TYPE_TRAJECTORY, trajectory_payload,
+                               (uint8_t)(len + 2U));
+}
+
+static void conn_send_runtime_data(uint8_t pipeline, const VL53L5CX_ResultsData *raw_frame,
+                                   const tof_pipeline_output_t *pipeline_output)
+{
+    uint8_t payload[CONN_PAYLOAD_MAX_SIZE] = {0};
     uint8_t payload_idx = 0U;
 
+    if (!conn_append_pipeline_section(pipeline, payload, &payload_idx, sizeof(payload)))
+    {
+        return;
+    }
     if (s_distance_stream_enabled)
     {
         if (!conn_append_distance_section(raw_frame, payload, &payload_idx, sizeof(payload)))
@@ -273,11 +724,27 @@ static void conn_send_runtime_data(const VL53L5CX_ResultsData *raw_frame, const
             return;
         }
     }
-    if (!conn_append_in_out_section(people, payload, &payload_idx, sizeof(payload)))
+    if (!conn_append_in_out_section(&pipeline_output->people, payload, &payload_idx, sizeof(payload)))
+    {
+        return;
+    }
+    if (!conn_append_person_section(&pipeline_output->people, pipeline_output->person_info,
+                                    pipeline_output->person_info_count, payload, &payload_idx, sizeof(payload)))
+    {
+        return;
+    }
+    if ((pipeline_output->line_count > 0U) &&
+        !conn_append_line_section(pipeline_output, payload, &payload_idx, sizeof(payload)))
     {
         return;
     }
-    if (!conn_append_person_section(people, person_info, person_count, payload, &payload_idx, sizeof(payload)))
+    if ((pipeline_output->region_count > 0U) &&
+        !conn_append_region_section(pipeline, pipeline_output, payload, &payload_idx, sizeof(payload)))
+    {
+        return;
+    }
+    if (s_trajectory_stream_enabled &&
+        !conn_append_trajectory_section(pipeline, pipeline_output, payload, &payload_idx, sizeof(payload)))
     {
         return;
     }
@@ -285,20 +752,35 @@ static void conn_send_runtime_data(const VL53L5CX_ResultsData *raw_frame, const
     conn_send_packet(CONN_TYPE_BUNDLE, payload, payload_idx);
 }
 
-static void conn_send_data_frame_record(const VL53L5CX_ResultsData *raw_frame)
+static void conn_send_data_frame_record(uint8_t device, const VL53L5CX_ResultsData *raw_frame)
 {
-    uint8_t payload[140] = {0};
-    uint8_t payload_idx = 0U;
+    uint8_t *record = &s_frame_log_tx_buffer[CONN_FRAME_LOG_PAYLOAD_IDX];
+    uint16_t record_len;
 
-    if (!conn_append_distance_section(raw_frame, payload, &payload_idx, sizeof(payload)))
+    if ((raw_frame == NULL) || (device >= VL53L5_DEVICE_COUNT))
+    {
+        return;
+    }
+    /* A frame that cannot be sent is not encoded either, so the delta chain
+     * stays valid; the host sees the gap in the timestamps. */
+    if (bsp_serial_tx_status() == 0U)
     {
         return;
     }
 
-    conn_send_packet(CONN_TYPE_BUNDLE, payload, payload_idx);
+    if (!s_frame_log_header_sent)
+    {
+        record_len = frame_log_write_header(&s_frame_log_encoders[0].config, record);
+        conn_send_frame_log_packet(record_len);
+        s_frame_log_header_sent = true;
+        return;
+    }
+
+    record_len = frame_log_encode(&s_frame_log_encoders[device], raw_frame, HAL_GetTick(), record);
+    conn_send_frame_log_packet(record_len);
 }
 
-static void conn_send_data_frame_inference(const VL53L5CX_ResultsData *raw_frame,
+static void conn_send_data_frame_inference(uint8_t pipeline, const VL53L5CX_ResultsData *raw_frame,
                                            const tof_pipeline_output_t *pipeline_output)
 {
     if ((raw_frame == NULL) || (pipeline_output == NULL))
@@ -308,36 +790,119 @@ static void conn_send_data_frame_inference(const VL53L5CX_ResultsData *raw_frame
 
     if (pipeline_output->background_collecting)
     {
-        conn_send_background_status(true);
+        conn_send_background_status(pipeline, true);
         return;
     }
 
-    conn_send_runtime_data(raw_frame, &pipeline_output->people, pipeline_output->person_info,
-                           pipeline_output->person_info_count);
+    conn_send_runtime_data(pipeline, raw_frame, pipeline_output);
 }
 
 void conn_process_pending_commands(void)
 {
-    if (s_request_bg_reinit)
+    if (s_request_bg_reinit == CONN_BG_REINIT_REFRESH)
+    {
+        s_request_bg_reinit = CONN_BG_REINIT_NONE;
+        app_refresh_background();
+    }
+    else if (s_request_bg_reinit == CONN_BG_REINIT_RESTART)
+    {
+        s_request_bg_reinit = CONN_BG_REINIT_NONE;
+        app_restart_background();
+    }
+
+    if (s_request_bg_learning != CONN_BG_LEARNING_NONE)
+    {
+        app_set_background_learning(s_request_bg_learning);
+        s_request_bg_learning = CONN_BG_LEARNING_NONE;
+    }
+
+    /* Kept pending until the sensors are idle between two transfers */
+    if ((s_request_outputs != CONN_OUTPUTS_NONE) &&
+        app_set_output_profile((vl53l5_output_profile_t)(s_request_outputs - CONN_OUTPUTS_FIRST)))
     {
-        s_request_bg_reinit = false;
-        tof_pipeline_restart_background();
+        s_request_outputs = CONN_OUTPUTS_NONE;
     }
+
+    if (s_request_line_index != CONN_LINE_NONE)
+    {
+        if (s_request_line_set)
+        {
+            (void)app_set_count_line(s_request_line_index, &s_request_line);
+        }
+        else
+        {
+            app_remove_count_line(s_request_line_index);
+        }
+        s_request_line_index = CONN_LINE_NONE;
+    }
+
+    if (s_request_region_index != CONN_REGION_NONE)
+    {
+        if (s_request_region_set)
+        {
+            (void)app_set_region(s_request_region_index, &s_request_region);
+        }
+        else
+        {
+            app_remove_region(s_request_region_index);
+        }
+        s_request_region_index = CONN_REGION_NONE;
+    }
+
+    if (s_request_mode != 0U)
+    {
+        app_set_mode((s_request_mode == 0x01U) ? APP_MODE_DATA_RECORD : APP_MODE_INFERENCE);
+        s_request_mode = 0U;
+    }
+
+#if TOF_PROFILING
+    if (s_request_profile == 0x02U)
+    {
+        s_request_profile = 0U;
+        tof_profiler_reset();
+    }
+#endif
 }
 
-void conn_publish_frame(app_mode_t app_mode, const VL53L5CX_ResultsData *raw_frame,
+void conn_publish_frame(app_mode_t app_mode, uint8_t device, uint8_t pipeline, const VL53L5CX_ResultsData *raw_frame,
                         const tof_pipeline_output_t *pipeline_output)
 {
+#if TOF_PROFILING
+    /* The dump replaces this frame's packet: a second transfer right after it
+     * would be dropped while the CDC endpoint is busy. */
+    if (s_request_profile == 0x01U)
+    {
+        s_request_profile = 0U;
+        conn_send_profile_data();
+        return;
+    }
+    /* One packet of devices per frame */
+    if (s_request_profile == 0x03U)
+    {
+        if (conn_send_boot_data())
+        {
+            s_request_profile = 0U;
+        }
+        return;
+    }
+#endif
+
     if (app_mode == APP_MODE_INFERENCE)
     {
-        conn_send_data_frame_inference(raw_frame, pipeline_output);
+        s_last_mode = app_mode;
+        conn_send_data_frame_inference(pipeline, raw_frame, pipeline_output);
         send_pb_result(raw_frame, pipeline_output);
         return;
     }
 
     if (app_mode == APP_MODE_DATA_RECORD)
     {
-        conn_send_data_frame_record(raw_frame);
+        if (s_last_mode != APP_MODE_DATA_RECORD)
+        {
+            conn_frame_log_start();
+        }
+        s_last_mode = app_mode;
+        conn_send_data_frame_record(device, raw_frame);
     }
 
 }
@@ -9,7 +9,10 @@
 
 void conn_init(void);
 void conn_process_pending_commands(void);
+/* Sends raw_frame of device, or in inference mode what the pipeline it feeds made of the grid it completed */
 void conn_publish_frame(app_mode_t app_mode,
+                        uint8_t device,
+                        uint8_t pipeline,
                         const VL53L5CX_ResultsData *raw_frame,
                         const tof_pipeline_output_t *pipeline_output);
 
@@ -0,0 +1,286 @@
+#include "frame_log.h"
+
+#include <string.h>
+
+#define FRAME_LOG_DEFAULT_KEY_INTERVAL 16U
+
+static const uint8_t s_frame_log_magic[4] = {'T', 'O', 'F', 'L'};
+
+static void frame_log_put_u16(uint8_t *buf, uint16_t value)
+{
+    buf[0] = (uint8_t)(value & 0xFFU);
+    buf[1] = (uint8_t)((value >> 8) & 0xFFU);
+}
+
+static void frame_log_put_u32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = (uint8_t)(value & 0xFFU);
+    buf[1] = (uint8_t)((value >> 8) & 0xFFU);
+    buf[2] = (uint8_t)((value >> 16) & 0xFFU);
+    buf[3] = (uint8_t)((value >> 24) & 0xFFU);
+}
+
+static uint16_t frame_log_get_u16(const uint8_t *buf)
+{
+    return (uint16_t)((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+}
+
+static uint32_t frame_log_get_u32(const uint8_t *buf)
+{
+    return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static bool frame_log_can_delta(const frame_log_encoder_t *encoder, const VL53L5CX_ResultsData *frame)
+{
+    if (((encoder->config.flags & FRAME_LOG_FLAG_DELTA_DISTANCE) == 0U) ||
+        (encoder->since_key >= encoder->config.key_interval))
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+        int32_t delta = (int32_t)frame->distance_mm[i] - (int32_t)encoder->last_distance_mm[i];
+        if ((delta < -128) || (delta > 127))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint8_t frame_log_write_header(const frame_log_config_t *config, uint8_t *buf)
+{
+    if ((config == NULL) || (buf == NULL))
+    {
+        return 0U;
+    }
+
+    memcpy(buf, s_frame_log_magic, sizeof(s_frame_log_magic));
+    buf[4] = FRAME_LOG_VERSION;
+    buf[5] = FRAME_LOG_HEADER_SIZE;
+    buf[6] = config->flags;
+    buf[7] = config->key_interval;
+    frame_log_put_u16(&buf[8], FRAME_LOG_TARGETS);
+    frame_log_put_u16(&buf[10], FRAME_LOG_KEY_RECORD_SIZE);
+    frame_log_put_u16(&buf[12], FRAME_LOG_DELTA_RECORD_SIZE);
+    buf[14] = config->odr_hz;
+    buf[15] = (config->devices > 0U) ? config->devices : 1U;
+    return FRAME_LOG_HEADER_SIZE;
+}
+
+bool frame_log_read_header(const uint8_t *buf, size_t len, frame_log_config_t *config)
+{
+    if ((buf == NULL) || (config == NULL) || (len < FRAME_LOG_HEADER_SIZE))
+    {
+        return false;
+    }
+    if ((memcmp(buf, s_frame_log_magic, sizeof(s_frame_log_magic)) != 0) || (buf[4] != FRAME_LOG_VERSION) ||
+        (buf[5] != FRAME_LOG_HEADER_SIZE))
+    {
+        return false;
+    }
+    if ((frame_log_get_u16(&buf[8]) != FRAME_LOG_TARGETS) ||
+        (frame_log_get_u16(&buf[10]) != FRAME_LOG_KEY_RECORD_SIZE) ||
+        (frame_log_get_u16(&buf[12]) != FRAME_LOG_DELTA_RECORD_SIZE) || (buf[15] == 0U) ||
+        (buf[15] > FRAME_LOG_MAX_DEVICES))
+    {
+        return false;
+    }
+
+    config->flags = buf[6];
+    config->key_interval = buf[7];
+    config->odr_hz = buf[14];
+    config->devices = buf[15];
+    return true;
+}
+
+void frame_log_encoder_init(frame_log_encoder_t *encoder, const frame_log_config_t *config, uint8_t device)
+{
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->config = *config;
+    encoder->device = device;
+    if (encoder->config.key_interval == 0U)
+    {
+        encoder->config.key_interval = FRAME_LOG_DEFAULT_KEY_INTERVAL;
+    }
+    frame_log_encoder_force_key(encoder);
+}
+
+void frame_log_encoder_force_key(frame_log_encoder_t *encoder)
+{
+    encoder->since_key = encoder->config.key_interval;
+}
+
+uint16_t frame_log_encode(frame_log_encoder_t *encoder, const VL53L5CX_ResultsData *frame, uint32_t timestamp_ms,
+                          uint8_t *buf)
+{
+    uint16_t idx = FRAME_LOG_RECORD_PREFIX_SIZE;
+    bool delta;
+
+    if ((encoder == NULL) || (frame == NULL) || (buf == NULL))
+    {
+        return 0U;
+    }
+
+    delta = frame_log_can_delta(encoder, frame);
+    buf[0] = delta ? FRAME_LOG_RECORD_DELTA : FRAME_LOG_RECORD_KEY;
+    buf[1] = encoder->device;
+    buf[2] = (uint8_t)frame->silicon_temp_degc;
+    frame_log_put_u32(&buf[3], encoder->seq);
+    frame_log_put_u32(&buf[7], timestamp_ms);
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+        int16_t distance = frame->distance_mm[i];
+
+        if (delta)
+        {
+            buf[idx++] = (uint8_t)(int8_t)(distance - encoder->last_distance_mm[i]);
+        }
+        else
+        {
+            frame_log_put_u16(&buf[idx], (uint16_t)distance);
+            idx += 2U;
+        }
+        encoder->last_distance_mm[i] = distance;
+    }
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+#ifndef VL53L5CX_DISABLE_TARGET_STATUS
+        buf[idx++] = frame->target_status[i];
+#else
+        buf[idx++] = 0U;
+#endif
+    }
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+        frame_log_put_u16(&buf[idx], frame->range_sigma_mm[i]);
+#else
+        frame_log_put_u16(&buf[idx], 0U);
+#endif
+        idx += 2U;
+    }
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+        frame_log_put_u32(&buf[idx], frame->signal_per_spad[i]);
+#else
+        frame_log_put_u32(&buf[idx], 0U);
+#endif
+        idx += 4U;
+    }
+
+    encoder->since_key = delta ? (uint8_t)(encoder->since_key + 1U) : 1U;
+    encoder->seq++;
+    return idx;
+}
+
+void frame_log_decoder_init(frame_log_decoder_t *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+uint16_t frame_log_record_size(uint8_t type)
+{
+    if (type == FRAME_LOG_RECORD_KEY)
+    {
+        return FRAME_LOG_KEY_RECORD_SIZE;
+    }
+    if (type == FRAME_LOG_RECORD_DELTA)
+    {
+        return FRAME_LOG_DELTA_RECORD_SIZE;
+    }
+    return 0U;
+}
+
+uint8_t frame_log_record_device(const uint8_t *buf)
+{
+    return buf[1];
+}
+
+bool frame_log_decode(frame_log_decoder_t *decoder, const uint8_t *buf, size_t len, VL53L5CX_ResultsData *frame,
+                      frame_log_meta_t *meta)
+{
+    uint16_t record_size;
+    uint16_t idx = FRAME_LOG_RECORD_PREFIX_SIZE;
+    uint32_t seq;
+    bool delta;
+
+    if ((decoder == NULL) || (buf == NULL) || (frame == NULL) || (len < 1U))
+    {
+        return false;
+    }
+
+    record_size = frame_log_record_size(buf[0]);
+    if ((record_size == 0U) || (len < record_size))
+    {
+        return false;
+    }
+
+    delta = (buf[0] == FRAME_LOG_RECORD_DELTA);
+    seq = frame_log_get_u32(&buf[3]);
+    if (delta && (!decoder->synced || (seq != decoder->next_seq)))
+    {
+        decoder->synced = false;
+        decoder->skipped_records++;
+        return false;
+    }
+
+    frame->silicon_temp_degc = (int8_t)buf[2];
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+        int16_t distance;
+
+        if (delta)
+        {
+            distance = (int16_t)(decoder->last_distance_mm[i] + (int8_t)buf[idx++]);
+        }
+        else
+        {
+            distance = (int16_t)frame_log_get_u16(&buf[idx]);
+            idx += 2U;
+        }
+        decoder->last_distance_mm[i] = distance;
+#ifndef VL53L5CX_DISABLE_DISTANCE_MM
+        frame->distance_mm[i] = distance;
+#endif
+    }
+
+#ifndef VL53L5CX_DISABLE_TARGET_STATUS
+    memcpy(frame->target_status, &buf[idx], FRAME_LOG_TARGETS);
+#endif
+    idx += FRAME_LOG_TARGETS;
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+#ifndef VL53L5CX_DISABLE_RANGE_SIGMA_MM
+        frame->range_sigma_mm[i] = frame_log_get_u16(&buf[idx]);
+#endif
+        idx += 2U;
+    }
+
+    for (uint16_t i = 0U; i < FRAME_LOG_TARGETS; i++)
+    {
+#ifndef VL53L5CX_DISABLE_SIGNAL_PER_SPAD
+        frame->signal_per_spad[i] = frame_log_get_u32(&buf[idx]);
+#endif
+        idx += 4U;
+    }
+
+    decoder->synced = true;
+    decoder->next_seq = seq + 1U;
+    if (meta != NULL)
+    {
+        meta->seq = seq;
+        meta->timestamp_ms = frame_log_get_u32(&buf[7]);
+        meta->type = buf[0];
+        meta->device = buf[1];
+    }
+    return true;
+}
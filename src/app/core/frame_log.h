@@ -0,0 +1,95 @@
+#ifndef FRAME_LOG_H
+#define FRAME_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tof_types.h"
+#include "vl53l5cx_api.h"
+
+/*
+ * Append-only frame log: one header followed by fixed-size records.
+ * All multi-byte fields are little-endian.
+ *
+ * header (FRAME_LOG_HEADER_SIZE bytes)
+ *   magic "TOFL" | version u8 | header_size u8 | flags u8 | key_interval u8 |
+ *   targets u16 | key_record_size u16 | delta_record_size u16 | odr_hz u8 | devices u8
+ *
+ * record
+ *   type u8 ('K' key, 'D' delta) | device u8 | silicon_temp_degc i8 | seq u32 | timestamp_ms u32 |
+ *   distance_mm (i16[targets] for key, i8[targets] delta to previous record for delta) |
+ *   target_status u8[targets] | range_sigma_mm u16[targets] | signal_per_spad u32[targets]
+ *
+ * Delta records are only emitted when FRAME_LOG_FLAG_DELTA_DISTANCE is set,
+ * every per-target change fits in an int8 and fewer than key_interval records
+ * were written since the last key record. Records of the devices are
+ * interleaved; seq and the delta chain are per device, so a reader keeps one
+ * decoder per device and, when it detects a gap in a device's seq, skips that
+ * device's delta records until its next key record.
+ */
+
+#define FRAME_LOG_VERSION 2U
+#define FRAME_LOG_HEADER_SIZE 16U
+#define FRAME_LOG_RECORD_PREFIX_SIZE 11U
+#define FRAME_LOG_TARGETS (TOF_SENSOR_ZONES * VL53L5CX_NB_TARGET_PER_ZONE)
+#define FRAME_LOG_KEY_RECORD_SIZE (FRAME_LOG_RECORD_PREFIX_SIZE + (9U * FRAME_LOG_TARGETS))
+#define FRAME_LOG_DELTA_RECORD_SIZE (FRAME_LOG_RECORD_PREFIX_SIZE + (8U * FRAME_LOG_TARGETS))
+#define FRAME_LOG_MAX_RECORD_SIZE FRAME_LOG_KEY_RECORD_SIZE
+#define FRAME_LOG_MAX_DEVICES 16U
+
+#define FRAME_LOG_FLAG_DELTA_DISTANCE 0x01U
+
+#define FRAME_LOG_RECORD_KEY 'K'
+#define FRAME_LOG_RECORD_DELTA 'D'
+
+typedef struct {
+    uint8_t flags;
+    uint8_t key_interval;
+    uint8_t odr_hz;
+    /* Devices whose records share the log, 0 is taken as 1 */
+    uint8_t devices;
+} frame_log_config_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t timestamp_ms;
+    uint8_t type;
+    uint8_t device;
+} frame_log_meta_t;
+
+typedef struct {
+    frame_log_config_t config;
+    int16_t last_distance_mm[FRAME_LOG_TARGETS];
+    uint32_t seq;
+    uint8_t since_key;
+    uint8_t device;
+} frame_log_encoder_t;
+
+typedef struct {
+    int16_t last_distance_mm[FRAME_LOG_TARGETS];
+    uint32_t next_seq;
+    bool synced;
+    uint32_t skipped_records;
+} frame_log_decoder_t;
+
+uint8_t frame_log_write_header(const frame_log_config_t *config, uint8_t *buf);
+bool frame_log_read_header(const uint8_t *buf, size_t len, frame_log_config_t *config);
+
+void frame_log_encoder_init(frame_log_encoder_t *encoder, const frame_log_config_t *config, uint8_t device);
+void frame_log_encoder_force_key(frame_log_encoder_t *encoder);
+uint16_t frame_log_encode(frame_log_encoder_t *encoder,
+                          const VL53L5CX_ResultsData *frame,
+                          uint32_t timestamp_ms,
+                          uint8_t *buf);
+
+void frame_log_decoder_init(frame_log_decoder_t *decoder);
+uint16_t frame_log_record_size(uint8_t type);
+uint8_t frame_log_record_device(const uint8_t *buf);
+bool frame_log_decode(frame_log_decoder_t *decoder,
+                      const uint8_t *buf,
+                      size_t len,
+                      VL53L5CX_ResultsData *frame,
+                      frame_log_meta_t *meta);
+
+#endif
@@ -0,0 +1,129 @@
+#include "frame_queue.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(TOF_HOST_BUILD)
+#define FRAME_QUEUE_LOCK() uint32_t primask = 0U
+#define FRAME_QUEUE_UNLOCK() (void)primask
+#else
+#include "main.h"
+#define FRAME_QUEUE_LOCK()                                                                                           \
+    uint32_t primask = __get_PRIMASK();                                                                                \
+    __disable_irq()
+#define FRAME_QUEUE_UNLOCK() __set_PRIMASK(primask)
+#endif
+
+static frame_slot_t *frame_queue_find_oldest(frame_queue_t *queue, frame_slot_state_t state)
+{
+    frame_slot_t *oldest = NULL;
+
+    for (uint8_t i = 0U; i < FRAME_QUEUE_SLOTS; i++)
+    {
+        frame_slot_t *slot = &queue->slots[i];
+        if ((slot->state == state) && ((oldest == NULL) || ((int32_t)(slot->seq - oldest->seq) < 0)))
+        {
+            oldest = slot;
+        }
+    }
+
+    return oldest;
+}
+
+void frame_queue_init(frame_queue_t *queue)
+{
+    memset(queue, 0, sizeof(*queue));
+}
+
+frame_slot_t *frame_queue_begin_fill(frame_queue_t *queue)
+{
+    frame_slot_t *slot;
+
+    FRAME_QUEUE_LOCK();
+    if (frame_queue_find_oldest(queue, FRAME_SLOT_FILLING) != NULL)
+    {
+        /* Previous transfer still on the bus */
+        queue->overruns++;
+        FRAME_QUEUE_UNLOCK();
+        return NULL;
+    }
+
+    slot = frame_queue_find_oldest(queue, FRAME_SLOT_FREE);
+    if (slot == NULL)
+    {
+        slot = frame_queue_find_oldest(queue, FRAME_SLOT_READY);
+        if (slot == NULL)
+        {
+            queue->overruns++;
+            FRAME_QUEUE_UNLOCK();
+            return NULL;
+        }
+        queue->dropped++;
+    }
+
+    slot->state = FRAME_SLOT_FILLING;
+    slot->seq = queue->next_seq++;
+    FRAME_QUEUE_UNLOCK();
+    return slot;
+}
+
+void frame_queue_end_fill(frame_queue_t *queue, frame_slot_t *slot, bool ok)
+{
+    if (slot == NULL)
+    {
+        return;
+    }
+
+    FRAME_QUEUE_LOCK();
+    if (ok)
+    {
+        slot->state = FRAME_SLOT_READY;
+        queue->completed++;
+    }
+    else
+    {
+        slot->state = FRAME_SLOT_FREE;
+        queue->bus_errors++;
+    }
+    FRAME_QUEUE_UNLOCK();
+}
+
+frame_slot_t *frame_queue_pop(frame_queue_t *queue)
+{
+    frame_slot_t *slot;
+
+    FRAME_QUEUE_LOCK();
+    slot = frame_queue_find_oldest(queue, FRAME_SLOT_READY);
+    if (slot != NULL)
+    {
+        slot->state = FRAME_SLOT_PROCESSING;
+    }
+    FRAME_QUEUE_UNLOCK();
+    return slot;
+}
+
+void frame_queue_release(frame_queue_t *queue, frame_slot_t *slot)
+{
+    (void)queue;
+
+    if (slot == NULL)
+    {
+        return;
+    }
+
+    FRAME_QUEUE_LOCK();
+    slot->state = FRAME_SLOT_FREE;
+    FRAME_QUEUE_UNLOCK();
+}
+
+bool frame_queue_is_filling(const frame_queue_t *queue)
+{
+    for (uint8_t i = 0U; i < FRAME_QUEUE_SLOTS; i++)
+    {
+        if (queue->slots[i].state == FRAME_SLOT_FILLING)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,52 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vl53l5cx_api.h"
+
+/*
+ * Ready-queue of sensor frames shared between the I2C completion interrupt
+ * (producer) and the super-loop (consumer). Each slot holds the raw register
+ * blob the DMA writes into and the decoded results, so the transfer of frame
+ * N+1 overlaps the decode and processing of frame N.
+ *
+ * Slot life cycle: FREE -> FILLING (DMA running) -> READY -> PROCESSING -> FREE.
+ * When every slot is busy on a new data-ready event the oldest READY frame is
+ * recycled (counted in dropped); if none is READY the event is an overrun.
+ */
+
+#define FRAME_QUEUE_SLOTS 2U
+
+typedef enum {
+    FRAME_SLOT_FREE = 0,
+    FRAME_SLOT_FILLING,
+    FRAME_SLOT_READY,
+    FRAME_SLOT_PROCESSING,
+} frame_slot_state_t;
+
+typedef struct {
+    uint8_t raw[VL53L5CX_MAX_RESULTS_SIZE] __attribute__((aligned(4)));
+    VL53L5CX_ResultsData results;
+    uint32_t seq;
+    volatile frame_slot_state_t state;
+} frame_slot_t;
+
+typedef struct {
+    frame_slot_t slots[FRAME_QUEUE_SLOTS];
+    uint32_t next_seq;
+    uint32_t completed;
+    uint32_t dropped;
+    uint32_t overruns;
+    uint32_t bus_errors;
+} frame_queue_t;
+
+void frame_queue_init(frame_queue_t *queue);
+frame_slot_t *frame_queue_begin_fill(frame_queue_t *queue);
+void frame_queue_end_fill(frame_queue_t *queue, frame_slot_t *slot, bool ok);
+frame_slot_t *frame_queue_pop(frame_queue_t *queue);
+void frame_queue_release(frame_queue_t *queue, frame_slot_t *slot);
+bool frame_queue_is_filling(const frame_queue_t *queue);
+
+#endif
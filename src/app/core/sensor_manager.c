@@ -1,23 +1,294 @@
 #include "sensor_manager.h"
 
 #include <stddef.h>
+#include <string.h>
 
-#include "vl53l5cx.h"
+#include "frame_queue.h"
 
-static VL53L5CX_ResultsData *s_tof_frame = NULL;
+#if defined(TOF_HOST_BUILD)
+#define SENSOR_LOCK() uint32_t primask = 0U
+#define SENSOR_UNLOCK() (void)primask
+#else
+#include "main.h"
+/* The data-ready EXTI preempts the I2C completion interrupt */
+#define SENSOR_LOCK()                                                                                                  \
+    uint32_t primask = __get_PRIMASK();                                                                                \
+    __disable_irq()
+#define SENSOR_UNLOCK() __set_PRIMASK(primask)
+#endif
+
+#define SENSOR_NONE 0xFFU
+/* Bus owner while a bring-up step runs on it */
+#define SENSOR_BRINGUP 0xFEU
+
+typedef struct {
+    frame_queue_t queue;
+    frame_slot_t *volatile filling_slot;
+    volatile bool read_pending;
+    uint32_t frames;
+    uint32_t decode_errors;
+    uint32_t deferred;
+} sensor_device_t;
+
+static sensor_device_t s_devices[SENSOR_COUNT];
+static volatile uint8_t s_bus_owner[VL53L5_BUS_COUNT];
+static frame_slot_t *s_current_slot = NULL;
+static uint8_t s_current_device = 0U;
+static uint8_t s_next_device = 0U;
+/* Data-ready events are ignored while the sensors are being reconfigured */
+static volatile bool s_paused = false;
+
+/* Claims a slot and starts the read; the caller owns the device's bus */
+static bool sensor_start_read(uint8_t dev)
+{
+    sensor_device_t *device = &s_devices[dev];
+    frame_slot_t *slot = frame_queue_begin_fill(&device->queue);
+
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    device->filling_slot = slot;
+    if (!vl53l5_start_read(dev, slot->raw))
+    {
+        device->filling_slot = NULL;
+        frame_queue_end_fill(&device->queue, slot, false);
+        return false;
+    }
+    return true;
+}
+
+/* Hands the bus to the next device waiting on it, round-robin from the one after dev */
+static void sensor_release_bus(uint8_t bus, uint8_t dev)
+{
+    for (;;)
+    {
+        uint8_t next = SENSOR_NONE;
+
+        /* Picking the next owner and freeing the bus is one step, or a data-ready landing in between is lost */
+        SENSOR_LOCK();
+        for (uint8_t i = 1U; i <= SENSOR_COUNT; i++)
+        {
+            uint8_t candidate = (uint8_t)((dev + i) % SENSOR_COUNT);
+
+            if ((vl53l5_bus(candidate) == bus) && s_devices[candidate].read_pending)
+            {
+                s_devices[candidate].read_pending = false;
+                next = candidate;
+                break;
+            }
+        }
+        s_bus_owner[bus] = next;
+        SENSOR_UNLOCK();
+
+        if ((next == SENSOR_NONE) || sensor_start_read(next))
+        {
+            return;
+        }
+        dev = next;
+    }
+}
+
+/* Data-ready EXTI: start the read at once if the bus is free, otherwise queue behind the transfer on it */
+static void sensor_on_data_ready(uint8_t dev)
+{
+    uint8_t bus = vl53l5_bus(dev);
+    bool claimed = false;
+
+    if ((dev >= SENSOR_COUNT) || s_paused)
+    {
+        return;
+    }
+
+    SENSOR_LOCK();
+    if (s_bus_owner[bus] == SENSOR_NONE)
+    {
+        s_bus_owner[bus] = dev;
+        claimed = true;
+    }
+    else
+    {
+        s_devices[dev].read_pending = true;
+        s_devices[dev].deferred++;
+    }
+    SENSOR_UNLOCK();
+
+    if (claimed && !sensor_start_read(dev))
+    {
+        sensor_release_bus(bus, dev);
+    }
+}
+
+static void sensor_on_read_done(uint8_t dev, bool ok)
+{
+    sensor_device_t *device;
+    frame_slot_t *slot;
+
+    if (dev >= SENSOR_COUNT)
+    {
+        return;
+    }
+
+    device = &s_devices[dev];
+    slot = device->filling_slot;
+    device->filling_slot = NULL;
+    frame_queue_end_fill(&device->queue, slot, ok);
+    sensor_release_bus(vl53l5_bus(dev), dev);
+}
 
 void sensor_init(void)
 {
-    s_tof_frame = vl53l5_tof_init();
+    memset(s_devices, 0, sizeof(s_devices));
+    for (uint8_t dev = 0U; dev < SENSOR_COUNT; dev++)
+    {
+        frame_queue_init(&s_devices[dev].queue);
+    }
+    for (uint8_t bus = 0U; bus < VL53L5_BUS_COUNT; bus++)
+    {
+        s_bus_owner[bus] = SENSOR_NONE;
+    }
+    s_current_slot = NULL;
+    s_next_device = 0U;
+    s_paused = false;
+    vl53l5_set_callbacks(sensor_on_data_ready, sensor_on_read_done);
+    vl53l5_tof_init();
+}
+
+/*
+ * A bring-up step has the bus to itself: it waits for the read in flight to
+ * land, and data-ready events meanwhile are deferred as behind any transfer.
+ */
+void sensor_process(void)
+{
+    for (uint8_t bus = 0U; bus < VL53L5_BUS_COUNT; bus++)
+    {
+        bool claimed = false;
+
+        if (s_paused || !vl53l5_bringup_due(bus))
+        {
+            continue;
+        }
+
+        SENSOR_LOCK();
+        if (s_bus_owner[bus] == SENSOR_NONE)
+        {
+            s_bus_owner[bus] = SENSOR_BRINGUP;
+            claimed = true;
+        }
+        SENSOR_UNLOCK();
+        if (!claimed)
+        {
+            continue;
+        }
+
+        vl53l5_bringup_step(bus);
+        sensor_release_bus(bus, (uint8_t)(SENSOR_COUNT - 1U));
+    }
+}
+
+bool sensor_get_data(uint8_t *device, const VL53L5CX_ResultsData **frame)
+{
+    if (frame == NULL)
+    {
+        return false;
+    }
+
+    /* The previous frame is only handed back once the caller asks for the next one */
+    frame_queue_release(&s_devices[s_current_device].queue, s_current_slot);
+    s_current_slot = NULL;
+
+    for (uint8_t i = 0U; i < SENSOR_COUNT; i++)
+    {
+        uint8_t dev = (uint8_t)((s_next_device + i) % SENSOR_COUNT);
+        sensor_device_t *entry = &s_devices[dev];
+        frame_slot_t *slot;
+
+        while ((slot = frame_queue_pop(&entry->queue)) != NULL)
+        {
+            if (vl53l5_decode(dev, slot->raw, &slot->results))
+            {
+                s_current_slot = slot;
+                s_current_device = dev;
+                s_next_device = (uint8_t)((dev + 1U) % SENSOR_COUNT);
+                entry->frames++;
+                if (device != NULL)
+                {
+                    *device = dev;
+                }
+                *frame = &slot->results;
+                return true;
+            }
+
+            entry->decode_errors++;
+            frame_queue_release(&entry->queue, slot);
+        }
+    }
+
+    return false;
 }
 
-bool sensor_get_data(const VL53L5CX_ResultsData **frame)
+/*
+ * New data-ready events are ignored from the first call on. The sensors are
+ * only reconfigured once the transfers in flight have landed, until then
+ * false is returned and the caller tries again later. Frames still queued
+ * were read with the old layout and are dropped. The devices restart from
+ * sensor_process(), one that fails to is brought up again.
+ */
+bool sensor_set_output_profile(vl53l5_output_profile_t profile)
 {
-    if ((frame == NULL) || (s_tof_frame == NULL) || (!vl53l5_update_data()))
+    bool idle = true;
+
+    if (profile >= VL53L5_PROFILE_COUNT)
+    {
+        return false;
+    }
+
+    SENSOR_LOCK();
+    s_paused = true;
+    for (uint8_t dev = 0U; dev < SENSOR_COUNT; dev++)
+    {
+        s_devices[dev].read_pending = false;
+    }
+    for (uint8_t bus = 0U; bus < VL53L5_BUS_COUNT; bus++)
+    {
+        idle = idle && (s_bus_owner[bus] == SENSOR_NONE);
+    }
+    SENSOR_UNLOCK();
+    if (!idle)
     {
         return false;
     }
 
-    *frame = s_tof_frame;
+    for (uint8_t dev = 0U; dev < SENSOR_COUNT; dev++)
+    {
+        frame_slot_t *slot;
+
+        while ((slot = frame_queue_pop(&s_devices[dev].queue)) != NULL)
+        {
+            frame_queue_release(&s_devices[dev].queue, slot);
+        }
+    }
+
+    (void)vl53l5_set_output_profile(profile);
+    s_paused = false;
     return true;
 }
+
+void sensor_get_stats(uint8_t device, sensor_stats_t *stats)
+{
+    const sensor_device_t *entry;
+
+    if ((stats == NULL) || (device >= SENSOR_COUNT))
+    {
+        return;
+    }
+
+    entry = &s_devices[device];
+    stats->frames = entry->frames;
+    stats->dropped = entry->queue.dropped;
+    stats->overruns = entry->queue.overruns;
+    stats->bus_errors = entry->queue.bus_errors;
+    stats->decode_errors = entry->decode_errors;
+    stats->deferred = entry->deferred;
+}
@@ -4,9 +4,34 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "vl53l5cx_api.h"
+#include "vl53l5cx.h"
+
+/*
+ * Registry of the VL53L5_DEVICE_COUNT sensors. Each device has its own frame
+ * queue; devices sharing a bus take turns on it, a data-ready event that
+ * finds the bus busy is deferred until the transfer in flight completes.
+ * sensor_get_data() serves the queues round-robin so a fast device cannot
+ * starve the others.
+ */
+
+#define SENSOR_COUNT VL53L5_DEVICE_COUNT
+
+typedef struct {
+    uint32_t frames;
+    uint32_t dropped;
+    uint32_t overruns;
+    uint32_t bus_errors;
+    uint32_t decode_errors;
+    uint32_t deferred;
+} sensor_stats_t;
 
 void sensor_init(void);
-bool sensor_get_data(const VL53L5CX_ResultsData **frame);
+/* Brings the sensors up and recovers lost ones, a step at a time; call from the main loop */
+void sensor_process(void);
+/* device may be NULL; the frame stays valid until the next call */
+bool sensor_get_data(uint8_t *device, const VL53L5CX_ResultsData **frame);
+void sensor_get_stats(uint8_t device, sensor_stats_t *stats);
+/* False while a transfer is still in flight, call again until it returns true */
+bool sensor_set_output_profile(vl53l5_output_profile_t profile);
 
 #endif
@@ -2,134 +2,341 @@
 
 #include <string.h>
 
-#include "background.h"
-#include "bsp_btn.h"
-#include "bsp_led.h"
-#include "classifier.h"
-#include "depth_profile.h"
 #include "foreground_filter.h"
-#include "presence_logic.h"
+#include "quality.h"
 #include "segmentation.h"
-#include "tracking.h"
+#include "tof_grid.h"
+#include "tof_profiler.h"
 
-typedef struct
-{
-    uint16_t filtered_mm[TOF_ROWS][TOF_COLS];
-    uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS];
-    uint8_t labels[TOF_ROWS][TOF_COLS];
-    uint8_t depth_profile[TOF_ROWS][TOF_COLS];
-    tof_component_t components[TOF_MAX_COMPONENTS];
-    uint8_t component_count;
-    tof_people_data_t people;
-    tof_person_info_t person_info[TOF_MAX_TRACKS];
-    uint8_t person_info_count;
-    presence_state_t presence_state;
-    float ai_out[TOF_NUM_CLASSES];
-} tof_pipeline_context_t;
+#define TOF_MIN_COMPONENT_SIZE 2U
+
+#if TOF_TILES > 32U
+#error "fresh_tiles tracks one tile per bit of a uint32_t"
+#endif
 
-static tof_pipeline_context_t s_ctx;
+/* Only instances that opted in record into the shared profiler */
+#define TOF_PIPELINE_PROFILE_END(pipeline, stage, start)                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ((pipeline)->profiling)                                                                                     \
+        {                                                                                                              \
+            TOF_PROFILE_END(stage, start);                                                                             \
+        }                                                                                                              \
+    } while (0)
 
 static void tof_pipeline_clear_output(tof_pipeline_output_t *output)
 {
     memset(output, 0, sizeof(*output));
 }
 
-static void tof_pipeline_reset_context(void)
+/* Settings survive a restart, everything learnt from frames does not */
+static void tof_pipeline_reset_context(tof_pipeline_t *pipeline)
 {
-    memset(&s_ctx, 0, sizeof(s_ctx));
+    bool profiling = pipeline->profiling;
+    bg_config_t bg_config = pipeline->bg.config;
+    line_counter_t lines = pipeline->lines;
+    region_counter_t regions = pipeline->regions;
+
+    memset(pipeline, 0, sizeof(*pipeline));
+    tof_grid_clear(&pipeline->grid);
+    pipeline->profiling = profiling;
+    pipeline->bg.config = bg_config;
+    pipeline->lines = lines;
+    pipeline->regions = regions;
 }
 
-static void tof_pipeline_reset_runtime_modules(void)
+static void tof_pipeline_reset_runtime_modules(tof_pipeline_t *pipeline)
 {
-    track_reset();
-    classifier_reset();
-    presence_logic_reset();
+    bg_reset(&pipeline->bg);
+    track_reset(&pipeline->tracks);
+    line_counter_reset(&pipeline->lines);
+    region_counter_reset(&pipeline->regions);
+    trajectory_init(&pipeline->trajectories);
+    classifier_reset(&pipeline->classifier);
+    presence_logic_reset(&pipeline->presence);
 }
 
-static void tof_pipeline_run_segmentation_tracking(void)
+static void tof_pipeline_run_segmentation_tracking(tof_pipeline_t *pipeline, const tof_frame_t *frame)
 {
-    seg_clear_labels(s_ctx.labels);
-    s_ctx.component_count =
-        seg_label_components(s_ctx.filtered_mm, s_ctx.labels, s_ctx.components, TOF_MAX_COMPONENTS, 2U);
+#if !TOF_FUSED_SEGMENTATION
+    TOF_PROFILE_BEGIN(seg_start);
+    seg_clear_labels(pipeline->labels);
+    pipeline->component_count = seg_label_components(pipeline->filtered_mm, pipeline->labels, pipeline->components,
+                                                     TOF_MAX_COMPONENTS, TOF_MIN_COMPONENT_SIZE);
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_SEGMENTATION, seg_start);
+#endif
 
-    depth_profile_generate(s_ctx.filtered_mm, s_ctx.labels, s_ctx.components, &s_ctx.component_count,
-                           s_ctx.depth_profile);
+    TOF_PROFILE_BEGIN(depth_start);
+    depth_profile_generate(pipeline->filtered_mm, pipeline->labels, pipeline->components, &pipeline->component_count,
+                           &pipeline->depth_profile);
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_DEPTH_PROFILE, depth_start);
 
-    track_update(s_ctx.components, s_ctx.component_count, &s_ctx.people, s_ctx.person_info, &s_ctx.person_info_count);
+    /* The tracking stage times everything from the components to the counters */
+    TOF_PROFILE_BEGIN(track_start);
+#if TOF_QUALITY
+    /* Blobs of sunlit or weak zones are not tracked */
+    pipeline->component_count = quality_filter_components(frame, pipeline->components, pipeline->component_count);
+#else
+    (void)frame;
+#endif
+    track_update(&pipeline->tracks, pipeline->components, pipeline->component_count, &pipeline->people,
+                 pipeline->person_info, &pipeline->person_info_count);
+    line_counter_update(&pipeline->lines, &pipeline->tracks);
+    line_counter_apply(&pipeline->lines, &pipeline->people);
+    region_counter_update(&pipeline->regions, &pipeline->tracks);
+    trajectory_update(&pipeline->trajectories, &pipeline->tracks);
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_TRACKING, track_start);
 }
 
-static void tof_pipeline_run_presence_logic(void)
+static void tof_pipeline_run_presence_logic(tof_pipeline_t *pipeline)
 {
-    presence_logic_update(s_ctx.people.people_count, &s_ctx.presence_state);
-    s_ctx.people.people_count = s_ctx.presence_state.smoothed_people_count;
+    TOF_PROFILE_BEGIN(presence_start);
+    presence_logic_update(&pipeline->presence, pipeline->people.people_count, &pipeline->presence_state);
+    pipeline->people.people_count = pipeline->presence_state.smoothed_people_count;
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_PRESENCE, presence_start);
 }
 
-static void tof_pipeline_update_classification(void)
+static void tof_pipeline_update_classification(tof_pipeline_t *pipeline)
 {
-    if (s_ctx.people.people_count == 1U)
+    TOF_PROFILE_BEGIN(classifier_start);
+    if (pipeline->people.people_count == 1U)
     {
-        preprocess_and_run_ai(s_ctx.filtered_mm, s_ctx.pixel_distance_bg_mm, s_ctx.ai_out);
-        s_ctx.people.class_id = ai_output_moving_average(s_ctx.ai_out);
-        return;
+        preprocess_and_run_ai(pipeline->filtered_mm, pipeline->pixel_distance_bg_mm, pipeline->ai_out);
+        pipeline->people.class_id = ai_output_moving_average(&pipeline->classifier, pipeline->ai_out);
     }
-
-    memset(s_ctx.ai_out, 0, sizeof(s_ctx.ai_out));
-    (void)ai_output_moving_average(s_ctx.ai_out);
-    s_ctx.people.class_id = 0U;
+    else
+    {
+        memset(pipeline->ai_out, 0, sizeof(pipeline->ai_out));
+        (void)ai_output_moving_average(&pipeline->classifier, pipeline->ai_out);
+        pipeline->people.class_id = 0U;
+    }
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_CLASSIFIER, classifier_start);
 }
 
-static void tof_pipeline_fill_output(tof_pipeline_output_t *output)
+static void tof_pipeline_fill_output(const tof_pipeline_t *pipeline, tof_pipeline_output_t *output)
 {
     output->background_collecting = false;
-    output->raw_people_count = s_ctx.presence_state.raw_people_count;
-    output->smoothed_people_count = s_ctx.presence_state.smoothed_people_count;
-    output->people = s_ctx.people;
-    output->person_info_count = s_ctx.person_info_count;
+    output->raw_people_count = pipeline->presence_state.raw_people_count;
+    output->smoothed_people_count = pipeline->presence_state.smoothed_people_count;
+    output->people = pipeline->people;
+    output->person_info_count = pipeline->person_info_count;
+    output->line_count = pipeline->lines.line_count;
+    memcpy(output->line_in, pipeline->lines.in, sizeof(output->line_in));
+    memcpy(output->line_out, pipeline->lines.out, sizeof(output->line_out));
+    output->region_count = pipeline->regions.region_count;
+    memcpy(output->regions, pipeline->regions.stats, sizeof(output->regions));
+    output->trajectory_dropped = pipeline->trajectories.dropped;
 
-    if (s_ctx.person_info_count > 0U)
+    if (pipeline->person_info_count > 0U)
     {
-        memcpy(output->person_info, s_ctx.person_info, (size_t)s_ctx.person_info_count * sizeof(tof_person_info_t));
+        memcpy(output->person_info, pipeline->person_info,
+               (size_t)pipeline->person_info_count * sizeof(tof_person_info_t));
     }
 }
 
-void tof_pipeline_init(void)
+void tof_pipeline_runtime_init(void)
 {
-    tof_pipeline_reset_context();
-    bg_reset();
-    track_reset();
     classifier_init();
-    presence_logic_reset();
-    reg_btn_pos_edge_cb(BTN1, tof_pipeline_restart_background);
+#if TOF_PROFILING
+    tof_profiler_init();
+#endif
+}
+
+void tof_pipeline_init(tof_pipeline_t *pipeline)
+{
+    if (pipeline == NULL)
+    {
+        return;
+    }
+
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->profiling = true;
+    bg_init(&pipeline->bg, NULL);
+    tof_pipeline_restart_background(pipeline);
+}
+
+void tof_pipeline_set_profiling(tof_pipeline_t *pipeline, bool enable)
+{
+    if (pipeline != NULL)
+    {
+        pipeline->profiling = enable;
+    }
+}
+
+void tof_pipeline_set_background_config(tof_pipeline_t *pipeline, const bg_config_t *config)
+{
+    if (pipeline != NULL)
+    {
+        bg_init(&pipeline->bg, config);
+        tof_pipeline_restart_background(pipeline);
+    }
+}
+
+void tof_pipeline_process_frame(tof_pipeline_t *pipeline, const VL53L5CX_ResultsData *frame,
+                                tof_pipeline_output_t *output)
+{
+    (void)tof_grid_load_tile(&pipeline->grid, 0U, frame);
+    tof_pipeline_process_grid(pipeline, &pipeline->grid, output);
+}
+
+/*
+ * The grid runs once every tile holds a frame newer than the last run. A
+ * tile refreshed twice before that means another sensor lags or is gone, so
+ * the grid runs with what it has rather than waiting for it.
+ */
+bool tof_pipeline_process_tile(tof_pipeline_t *pipeline, uint8_t tile, const VL53L5CX_ResultsData *frame,
+                               tof_pipeline_output_t *output)
+{
+    const uint32_t all_tiles = (uint32_t)((1ULL << TOF_TILES) - 1U);
+    uint32_t bit;
+    bool processed = false;
+
+    if (tile >= TOF_TILES)
+    {
+        return false;
+    }
+
+    bit = 1UL << tile;
+    if ((pipeline->fresh_tiles & bit) != 0U)
+    {
+        tof_pipeline_process_grid(pipeline, &pipeline->grid, output);
+        pipeline->fresh_tiles = 0U;
+        processed = true;
+    }
+
+    (void)tof_grid_load_tile(&pipeline->grid, tile, frame);
+    pipeline->fresh_tiles |= bit;
+    if (pipeline->fresh_tiles == all_tiles)
+    {
+        tof_pipeline_process_grid(pipeline, &pipeline->grid, output);
+        pipeline->fresh_tiles = 0U;
+        processed = true;
+    }
+    return processed;
 }
 
-void tof_pipeline_process_frame(const VL53L5CX_ResultsData *frame, tof_pipeline_output_t *output)
+void tof_pipeline_process_grid(tof_pipeline_t *pipeline, const tof_frame_t *frame, tof_pipeline_output_t *output)
 {
+    bool was_learning;
+
+    TOF_PROFILE_BEGIN(total_start);
     tof_pipeline_clear_output(output);
-    output->background_collecting = bg_update(frame);
+
+    /* One bg sample per frame: the collection, or the update and the adaptation after the frame together */
+    TOF_PROFILE_BEGIN(bg_start);
+    was_learning = pipeline->bg.collecting || pipeline->bg.refreshing;
+    output->background_collecting = bg_update(&pipeline->bg, frame);
+    output->background_refreshing = pipeline->bg.refreshing;
+    output->background_learnt = was_learning && !output->background_collecting && !pipeline->bg.refreshing &&
+                                (pipeline->bg.source == BG_SOURCE_COLLECTED);
     if (output->background_collecting)
     {
-        led_chase_enable();
+        TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_BG, bg_start);
+        return;
+    }
+#if TOF_PROFILING
+    uint32_t bg_ticks = tof_profiler_now() - bg_start;
+#endif
+
+    /* With the fused kernel labelling is timed as part of the foreground filter */
+    TOF_PROFILE_BEGIN(fg_start);
+#if TOF_FUSED_SEGMENTATION
+    pipeline->component_count =
+        fg_filter_segment(frame, bg_get_info(&pipeline->bg), pipeline->filtered_mm, pipeline->pixel_distance_bg_mm,
+                          pipeline->labels, pipeline->components, TOF_MAX_COMPONENTS, TOF_MIN_COMPONENT_SIZE);
+#else
+    fg_filter_apply(frame, bg_get_info(&pipeline->bg), pipeline->filtered_mm, pipeline->pixel_distance_bg_mm);
+#endif
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_FG_FILTER, fg_start);
+
+    tof_pipeline_run_segmentation_tracking(pipeline, frame);
+    tof_pipeline_run_presence_logic(pipeline);
+    tof_pipeline_update_classification(pipeline);
+    tof_pipeline_fill_output(pipeline, output);
+
+    TOF_PROFILE_BEGIN(adapt_start);
+    bg_adapt(&pipeline->bg, frame, pipeline->filtered_mm);
+#if TOF_PROFILING
+    adapt_start -= bg_ticks;
+#endif
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_BG, adapt_start);
+    TOF_PIPELINE_PROFILE_END(pipeline, TOF_PROFILE_TOTAL, total_start);
+}
+
+bool tof_pipeline_set_line(tof_pipeline_t *pipeline, uint8_t index, const line_config_t *line)
+{
+    return (pipeline != NULL) && line_counter_set(&pipeline->lines, index, line);
+}
+
+void tof_pipeline_remove_line(tof_pipeline_t *pipeline, uint8_t index)
+{
+    if (pipeline != NULL)
+    {
+        line_counter_remove(&pipeline->lines, index);
+    }
+}
+
+bool tof_pipeline_set_region(tof_pipeline_t *pipeline, uint8_t index, const region_config_t *region)
+{
+    return (pipeline != NULL) && region_counter_set(&pipeline->regions, index, region);
+}
+
+void tof_pipeline_remove_region(tof_pipeline_t *pipeline, uint8_t index)
+{
+    if (pipeline != NULL)
+    {
+        region_counter_remove(&pipeline->regions, index);
+    }
+}
+
+uint8_t tof_pipeline_get_trajectory(const tof_pipeline_t *pipeline, int id, uint8_t count, trajectory_point_t *points)
+{
+    return (pipeline != NULL) ? trajectory_get(&pipeline->trajectories, id, count, points) : 0U;
+}
+
+uint16_t tof_pipeline_export_trajectories(tof_pipeline_t *pipeline, uint8_t *buffer, uint16_t size)
+{
+    return ((pipeline != NULL) && (buffer != NULL)) ? trajectory_export(&pipeline->trajectories, buffer, size) : 0U;
+}
+
+uint16_t tof_pipeline_pending_trajectories(const tof_pipeline_t *pipeline)
+{
+    return (pipeline != NULL) ? trajectory_pending(&pipeline->trajectories) : 0U;
+}
+
+void tof_pipeline_restart_background(tof_pipeline_t *pipeline)
+{
+    if (pipeline == NULL)
+    {
         return;
     }
-    fg_filter_apply(frame, bg_get_info(), s_ctx.filtered_mm, s_ctx.pixel_distance_bg_mm);
-    tof_pipeline_run_segmentation_tracking();
-    tof_pipeline_run_presence_logic();
-    tof_pipeline_update_classification();
-    tof_pipeline_fill_output(output);
-    led_chase_disable();
-    if (output->smoothed_people_count > 0)
+
+    tof_pipeline_reset_context(pipeline);
+    tof_pipeline_reset_runtime_modules(pipeline);
+}
+
+void tof_pipeline_refresh_background(tof_pipeline_t *pipeline)
+{
+    if (pipeline == NULL)
     {
-        led_on(LED3);
+        return;
     }
-    else
+
+    bg_refresh(&pipeline->bg);
+}
+
+void tof_pipeline_restore_background(tof_pipeline_t *pipeline, const bg_info_t *info)
+{
+    if ((pipeline == NULL) || (info == NULL))
     {
-        led_off(LED3);
+        return;
     }
+
+    tof_pipeline_restart_background(pipeline);
+    bg_restore(&pipeline->bg, info);
 }
 
-void tof_pipeline_restart_background(void)
+const bg_info_t *tof_pipeline_get_background(const tof_pipeline_t *pipeline)
 {
-    bg_reset();
-    tof_pipeline_reset_runtime_modules();
-    tof_pipeline_reset_context();
+    return (pipeline != NULL) ? bg_get_info(&pipeline->bg) : NULL;
 }
@@ -2,21 +2,103 @@
 #define TOF_PROCESS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
+#include "background.h"
+#include "classifier.h"
+#include "depth_profile.h"
+#include "line_counter.h"
+#include "presence_logic.h"
+#include "region_counter.h"
+#include "trajectory.h"
 #include "tof_types.h"
+#include "tracking.h"
 #include "vl53l5cx_api.h"
 
 typedef struct {
     bool background_collecting;
+    /* A replacement background is being learnt, counting carries on with the current one */
+    bool background_refreshing;
+    /* Set on the frame that completed a fresh background collection or refresh, the moment to persist it */
+    bool background_learnt;
     uint8_t raw_people_count;
     uint8_t smoothed_people_count;
     tof_people_data_t people;
     tof_person_info_t person_info[TOF_MAX_TRACKS];
     uint8_t person_info_count;
+    /* Crossings of each counting line; people.people_in/out are their totals while there is one */
+    uint8_t line_count;
+    uint16_t line_in[TOF_MAX_LINES];
+    uint16_t line_out[TOF_MAX_LINES];
+    uint8_t region_count;
+    region_stats_t regions[TOF_MAX_REGIONS];
+    /* Trajectory samples lost before they were exported */
+    uint16_t trajectory_dropped;
 } tof_pipeline_output_t;
 
-void tof_pipeline_init(void);
-void tof_pipeline_process_frame(const VL53L5CX_ResultsData *frame, tof_pipeline_output_t *output);
-void tof_pipeline_restart_background(void);
+/*
+ * Everything one pipeline instance remembers between frames, allocated by the
+ * caller. Members are private to tof_process.c. Instances only share the AI
+ * runtime and the stage profiler, so separate instances may run on separate
+ * threads once tof_pipeline_runtime_init() has been called.
+ */
+typedef struct {
+    tof_frame_t grid;
+    /* Tiles loaded since the grid was last processed, bit t for tile t */
+    uint32_t fresh_tiles;
+    uint16_t filtered_mm[TOF_ROWS][TOF_COLS];
+    uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS];
+    tof_label_t labels[TOF_ROWS][TOF_COLS];
+    depth_profile_t depth_profile;
+    tof_component_t components[TOF_MAX_COMPONENTS];
+    uint8_t component_count;
+    tof_people_data_t people;
+    tof_person_info_t person_info[TOF_MAX_TRACKS];
+    uint8_t person_info_count;
+    presence_state_t presence_state;
+    float ai_out[TOF_NUM_CLASSES];
+    bg_state_t bg;
+    track_state_t tracks;
+    line_counter_t lines;
+    region_counter_t regions;
+    trajectory_pool_t trajectories;
+    classifier_state_t classifier;
+    presence_logic_state_t presence;
+    /* Stage timings go to the shared profiler, which is not thread-safe */
+    bool profiling;
+} tof_pipeline_t;
+
+/* Once per process, before any instance runs */
+void tof_pipeline_runtime_init(void);
+void tof_pipeline_init(tof_pipeline_t *pipeline);
+void tof_pipeline_set_profiling(tof_pipeline_t *pipeline, bool enable);
+/* Applies config (NULL for the defaults) and restarts the background */
+void tof_pipeline_set_background_config(tof_pipeline_t *pipeline, const bg_config_t *config);
+/* Single sensor: frame becomes tile 0 of the grid */
+void tof_pipeline_process_frame(tof_pipeline_t *pipeline, const VL53L5CX_ResultsData *frame,
+                                tof_pipeline_output_t *output);
+/* Multiple sensors: loads frame into its tile, returns true when the grid was processed into output */
+bool tof_pipeline_process_tile(tof_pipeline_t *pipeline, uint8_t tile, const VL53L5CX_ResultsData *frame,
+                               tof_pipeline_output_t *output);
+void tof_pipeline_process_grid(tof_pipeline_t *pipeline, const tof_frame_t *frame, tof_pipeline_output_t *output);
+/* Sets counting line index, see line_counter_set(); the lines survive background restarts, their counts do not */
+bool tof_pipeline_set_line(tof_pipeline_t *pipeline, uint8_t index, const line_config_t *line);
+/* Drops counting line index, or every line with LINE_ALL */
+void tof_pipeline_remove_line(tof_pipeline_t *pipeline, uint8_t index);
+/* Sets occupancy region index, see region_counter_set(); kept like the counting lines */
+bool tof_pipeline_set_region(tof_pipeline_t *pipeline, uint8_t index, const region_config_t *region);
+/* Drops occupancy region index, or every region with REGION_ALL */
+void tof_pipeline_remove_region(tof_pipeline_t *pipeline, uint8_t index);
+/* Last samples of track id, see trajectory_get() */
+uint8_t tof_pipeline_get_trajectory(const tof_pipeline_t *pipeline, int id, uint8_t count, trajectory_point_t *points);
+/* Trajectory samples not exported yet, see trajectory_export() */
+uint16_t tof_pipeline_export_trajectories(tof_pipeline_t *pipeline, uint8_t *buffer, uint16_t size);
+uint16_t tof_pipeline_pending_trajectories(const tof_pipeline_t *pipeline);
+void tof_pipeline_restart_background(tof_pipeline_t *pipeline);
+/* Re-learns the background in the background: tracks, counts and presence carry on through it */
+void tof_pipeline_refresh_background(tof_pipeline_t *pipeline);
+/* Restarts with a stored background, checked against the next BG_VALIDATE_FRAMES frames */
+void tof_pipeline_restore_background(tof_pipeline_t *pipeline, const bg_info_t *info);
+const bg_info_t *tof_pipeline_get_background(const tof_pipeline_t *pipeline);
 
 #endif
@@ -0,0 +1,153 @@
+#include "tof_profiler.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(TOF_HOST_BUILD)
+#include <time.h>
+#else
+#include "main.h"
+#endif
+
+typedef struct
+{
+    uint32_t window[TOF_PROFILE_WINDOW];
+    uint16_t window_idx;
+    uint16_t window_count;
+    uint32_t count;
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t sum_ticks;
+} tof_profile_stage_state_t;
+
+static tof_profile_stage_state_t s_stages[TOF_PROFILE_STAGE_COUNT];
+
+static const char *const s_stage_names[TOF_PROFILE_STAGE_COUNT] = {
+    "bg", "fg_filter", "segmentation", "depth_profile", "tracking", "presence", "classifier", "total",
+};
+
+static uint32_t tof_profiler_percentile(const tof_profile_stage_state_t *state, uint32_t percent)
+{
+    uint32_t sorted[TOF_PROFILE_WINDOW];
+    uint16_t n = state->window_count;
+    uint16_t rank;
+
+    if (n == 0U)
+    {
+        return 0U;
+    }
+
+    memcpy(sorted, state->window, (size_t)n * sizeof(sorted[0]));
+    for (uint16_t i = 1U; i < n; i++)
+    {
+        uint32_t value = sorted[i];
+        uint16_t j = i;
+        while ((j > 0U) && (sorted[j - 1U] > value))
+        {
+            sorted[j] = sorted[j - 1U];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    rank = (uint16_t)(((uint32_t)n * percent + 99U) / 100U);
+    return sorted[(rank > 0U) ? (rank - 1U) : 0U];
+}
+
+void tof_profiler_init(void)
+{
+#if !defined(TOF_HOST_BUILD)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    tof_profiler_reset();
+}
+
+void tof_profiler_reset(void)
+{
+    memset(s_stages, 0, sizeof(s_stages));
+    for (uint8_t i = 0U; i < TOF_PROFILE_STAGE_COUNT; i++)
+    {
+        s_stages[i].min_ticks = UINT32_MAX;
+    }
+}
+
+uint32_t tof_profiler_now(void)
+{
+#if defined(TOF_HOST_BUILD)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+uint32_t tof_profiler_ticks_per_us(void)
+{
+#if defined(TOF_HOST_BUILD)
+    return 1000U;
+#else
+    return SystemCoreClock / 1000000U;
+#endif
+}
+
+void tof_profiler_record(tof_profile_stage_t stage, uint32_t ticks)
+{
+    tof_profile_stage_state_t *state;
+
+    if (stage >= TOF_PROFILE_STAGE_COUNT)
+    {
+        return;
+    }
+
+    state = &s_stages[stage];
+    state->window[state->window_idx] = ticks;
+    state->window_idx = (uint16_t)((state->window_idx + 1U) % TOF_PROFILE_WINDOW);
+    if (state->window_count < TOF_PROFILE_WINDOW)
+    {
+        state->window_count++;
+    }
+
+    state->count++;
+    state->sum_ticks += ticks;
+    if (ticks < state->min_ticks)
+    {
+        state->min_ticks = ticks;
+    }
+    if (ticks > state->max_ticks)
+    {
+        state->max_ticks = ticks;
+    }
+}
+
+bool tof_profiler_get_stats(tof_profile_stage_t stage, tof_profile_stats_t *stats)
+{
+    const tof_profile_stage_state_t *state;
+
+    if ((stage >= TOF_PROFILE_STAGE_COUNT) || (stats == NULL))
+    {
+        return false;
+    }
+
+    state = &s_stages[stage];
+    memset(stats, 0, sizeof(*stats));
+    if (state->count == 0U)
+    {
+        return false;
+    }
+
+    stats->count = state->count;
+    stats->min_ticks = state->min_ticks;
+    stats->max_ticks = state->max_ticks;
+    stats->mean_ticks = (uint32_t)(state->sum_ticks / state->count);
+    stats->p99_ticks = tof_profiler_percentile(state, 99U);
+    return true;
+}
+
+const char *tof_profiler_stage_name(tof_profile_stage_t stage)
+{
+    return (stage < TOF_PROFILE_STAGE_COUNT) ? s_stage_names[stage] : "?";
+}
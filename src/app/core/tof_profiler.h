@@ -0,0 +1,57 @@
+#ifndef TOF_PROFILER_H
+#define TOF_PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Per-stage timing of tof_pipeline_process_frame(). Compiled in with
+ * TOF_PROFILING=1; ticks are DWT cycles on target and nanoseconds on host
+ * (see tof_profiler_ticks_per_us()). The last TOF_PROFILE_WINDOW samples of
+ * every stage are kept for the p99 estimate, min/max/mean cover all samples
+ * since the last reset.
+ */
+
+#ifndef TOF_PROFILING
+#define TOF_PROFILING 0
+#endif
+
+#define TOF_PROFILE_WINDOW 128U
+
+typedef enum {
+    TOF_PROFILE_BG = 0,
+    TOF_PROFILE_FG_FILTER,
+    TOF_PROFILE_SEGMENTATION,
+    TOF_PROFILE_DEPTH_PROFILE,
+    TOF_PROFILE_TRACKING,
+    TOF_PROFILE_PRESENCE,
+    TOF_PROFILE_CLASSIFIER,
+    TOF_PROFILE_TOTAL,
+    TOF_PROFILE_STAGE_COUNT
+} tof_profile_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint32_t mean_ticks;
+    uint32_t p99_ticks;
+} tof_profile_stats_t;
+
+void tof_profiler_init(void);
+void tof_profiler_reset(void);
+uint32_t tof_profiler_now(void);
+uint32_t tof_profiler_ticks_per_us(void);
+void tof_profiler_record(tof_profile_stage_t stage, uint32_t ticks);
+bool tof_profiler_get_stats(tof_profile_stage_t stage, tof_profile_stats_t *stats);
+const char *tof_profiler_stage_name(tof_profile_stage_t stage);
+
+#if TOF_PROFILING
+#define TOF_PROFILE_BEGIN(start) uint32_t start = tof_profiler_now()
+#define TOF_PROFILE_END(stage, start) tof_profiler_record((stage), tof_profiler_now() - (start))
+#else
+#define TOF_PROFILE_BEGIN(start)
+#define TOF_PROFILE_END(stage, start)
+#endif
+
+#endif
@@ -1,108 +1,686 @@
 #include "background.h"
-#include <math.h>
+#include <stddef.h>
 #include <string.h>
-#define BG_DEFAULT_FRAMES 100U
+
+#include "quality.h"
 #define MIN_VALID_SAMPLES 1U
+#define BG_NO_TARGET_MM 4000U
+#define BG_STATUS_VALID_RANGE 5U
+#define BG_STATUS_VALID_LARGE_PULSE 9U
+/* A frame confirms a restored background when this share of its zones lies within tolerance */
+#define BG_VALIDATE_MATCH_PERCENT 85U
+#define BG_VALIDATE_STD_GAIN 3U
+#define BG_VALIDATE_MIN_DELTA_MM 100U
+/* Frames of the validation window that may disagree, e.g. someone walking through */
+#define BG_VALIDATE_MAX_MISSES 1U
+/* Extra modes: a depth held for 3 s at 8 Hz on two separate occasions becomes background */
+#define BG_MODE_MATCH_MM BG_THRESHOLD_MIN_MM
+#define BG_MODE_RUN_FRAMES 24U
+#define BG_MODE_MIN_VISITS 2U
+#define BG_MODE_MEAN_SHIFT 3U
+/* Weight builds within seconds and fades over tens of minutes, a door shut for a while is still known */
+#define BG_MODE_GAIN_SHIFT 5U
+#define BG_MODE_DECAY_SHIFT 12U
+#define BG_MODE_MIN_WEIGHT 4096U
+#define BG_MODE_NONE 0xFFU
+/* 1.4826 * MAD estimates the standard deviation of normally distributed samples */
+#define BG_MAD_TO_STD_Q10 1518U
+#if TOF_BG_MEDIAN
+#define BG_REFRESH_ESTIMATOR BG_ESTIMATOR_MEDIAN
+#else
+#define BG_REFRESH_ESTIMATOR BG_ESTIMATOR_MEAN
+#endif
+
+static bool bg_is_status_usable(uint8_t status)
+{
+    return (status == BG_STATUS_VALID_RANGE) || (status == BG_STATUS_VALID_LARGE_PULSE);
+}
+
+/* Sunlit and weak returns stay out of the statistics */
+static bool bg_is_confident(const tof_frame_t *frame, uint8_t row, uint8_t col)
+{
+#if TOF_QUALITY
+    return frame->confidence[row][col] >= QUALITY_USABLE;
+#else
+    (void)frame;
+    (void)row;
+    (void)col;
+    return true;
+#endif
+}
+
+/* floor(sqrt(value)) by Newton's method; a guess close to the root converges in one or two steps */
+static uint32_t bg_isqrt(uint32_t value, uint32_t guess)
+{
+    uint32_t root;
+    uint32_t next;
+
+    if (value == 0U)
+    {
+        return 0U;
+    }
+
+    /* The first step lands on or above the root from any positive guess, the rest descend onto it */
+    root = (guess > 0U) ? guess : value;
+    root = (uint32_t)(((uint64_t)root + (value / root)) / 2U);
+    next = (root + (value / root)) / 2U;
+    while (next < root)
+    {
+        root = next;
+        next = (root + (value / root)) / 2U;
+    }
+    return root;
+}
 
-static bg_info_t bg = {0};
+/* Publishes a zone's statistics, the foreground threshold included */
+static void bg_set_zone(bg_info_t *info, uint8_t row, uint8_t col, uint32_t mean_mm, uint32_t std_mm)
+{
+    uint32_t threshold_mm = std_mm * BG_THRESHOLD_STD_GAIN;
 
-static bool s_collecting = true;
-static uint16_t s_collected_frames = 0U;
+    threshold_mm = (threshold_mm < BG_THRESHOLD_MIN_MM) ? BG_THRESHOLD_MIN_MM : threshold_mm;
+    info->mean[row][col] = (mean_mm > UINT16_MAX) ? UINT16_MAX : (uint16_t)mean_mm;
+    info->threshold[row][col] = (threshold_mm > UINT16_MAX) ? UINT16_MAX : (uint16_t)threshold_mm;
+    info->std[row][col] = (std_mm > UINT8_MAX) ? UINT8_MAX : (uint8_t)std_mm;
+}
 
-static uint32_t s_sum[TOF_ROWS][TOF_COLS];
-static uint32_t s_sum_sq[TOF_ROWS][TOF_COLS];
-static uint16_t s_valid_count[TOF_ROWS][TOF_COLS];
-static uint32_t s_max_sum = 0U;
+#if TOF_BG_MODES > 1
+static bool bg_mode_published(const bg_mode_t *mode)
+{
+    return (mode->visits >= BG_MODE_MIN_VISITS) && (mode->weight >= BG_MODE_MIN_WEIGHT);
+}
 
-static void bg_compute(void)
+static void bg_mode_publish(bg_state_t *bg, uint8_t k, uint8_t row, uint8_t col)
 {
+    const bg_mode_t *mode = &bg->modes[k][row][col];
+    uint32_t mean_mm = (mode->mean_q8 + 128U) >> 8;
+
+    if (!bg_mode_published(mode))
+    {
+        bg->info.mode_low[k][row][col] = UINT16_MAX;
+        bg->info.mode_high[k][row][col] = 0U;
+        return;
+    }
+    bg->info.mode_low[k][row][col] = (mean_mm > BG_MODE_MATCH_MM) ? (uint16_t)(mean_mm - BG_MODE_MATCH_MM) : 0U;
+    bg->info.mode_high[k][row][col] =
+        ((mean_mm + BG_MODE_MATCH_MM) > UINT16_MAX) ? UINT16_MAX : (uint16_t)(mean_mm + BG_MODE_MATCH_MM);
+}
+
+/* Restored modes come back with the least weight that keeps them published */
+static void bg_modes_seed(bg_state_t *bg)
+{
+    for (uint8_t k = 0U; k < BG_EXTRA_MODES; k++)
+    {
+        for (uint8_t row = 0U; row < TOF_ROWS; row++)
+        {
+            for (uint8_t col = 0U; col < TOF_COLS; col++)
+            {
+                bg_mode_t *mode = &bg->modes[k][row][col];
+                uint16_t low = bg->info.mode_low[k][row][col];
+                uint16_t high = bg->info.mode_high[k][row][col];
+
+                memset(mode, 0, sizeof(*mode));
+                if (low <= high)
+                {
+                    mode->mean_q8 = (((uint32_t)low + high) / 2U) << 8;
+                    mode->weight = BG_MODE_MIN_WEIGHT * 2U;
+                    mode->visits = BG_MODE_MIN_VISITS;
+                }
+                bg_mode_publish(bg, k, row, col);
+            }
+        }
+    }
+}
+
+/*
+ * Follows the depths closer than the main background that a zone goes back
+ * to, such as a door leaf or a swinging sign. A depth gains weight once it
+ * has been held for BG_MODE_RUN_FRAMES and is published after
+ * BG_MODE_MIN_VISITS such runs, so a person standing still once is not
+ * learnt. A new depth only takes a slot without weight, people passing do
+ * not push out a depth seen once until it has faded. Returns whether the
+ * value matches a published mode.
+ */
+static bool bg_modes_update(bg_state_t *bg, uint8_t row, uint8_t col, uint16_t value_mm)
+{
+    bool closer = ((int32_t)bg->info.mean[row][col] - (int32_t)value_mm) > (int32_t)bg->info.threshold[row][col];
+    uint8_t matched = BG_MODE_NONE;
+    uint8_t spare = BG_MODE_NONE;
+
+    for (uint8_t k = 0U; k < BG_EXTRA_MODES; k++)
+    {
+        bg_mode_t *mode = &bg->modes[k][row][col];
+        int32_t delta = (int32_t)((uint32_t)value_mm << 8) - (int32_t)mode->mean_q8;
+
+        if (closer && (matched == BG_MODE_NONE) && (mode->mean_q8 != 0U) &&
+            (((delta < 0) ? -delta : delta) <= (int32_t)(BG_MODE_MATCH_MM << 8)))
+        {
+            matched = k;
+            mode->mean_q8 = (uint32_t)((int32_t)mode->mean_q8 + (delta / (int32_t)(1L << BG_MODE_MEAN_SHIFT)));
+            mode->run = (mode->run < UINT16_MAX) ? (uint16_t)(mode->run + 1U) : UINT16_MAX;
+            if ((mode->run == BG_MODE_RUN_FRAMES) && (mode->visits < UINT8_MAX))
+            {
+                mode->visits++;
+            }
+            if ((mode->run >= BG_MODE_RUN_FRAMES) || bg_mode_published(mode))
+            {
+                mode->weight = (uint16_t)(mode->weight + ((UINT16_MAX - mode->weight) >> BG_MODE_GAIN_SHIFT));
+            }
+        }
+        else
+        {
+            uint16_t decay = (uint16_t)(mode->weight >> BG_MODE_DECAY_SHIFT);
+
+            mode->run = 0U;
+            mode->weight = (uint16_t)(mode->weight - ((decay > 0U) ? decay : ((mode->weight > 0U) ? 1U : 0U)));
+            if ((mode->weight == 0U) && (mode->visits > 0U))
+            {
+                memset(mode, 0, sizeof(*mode));
+            }
+            if ((mode->weight == 0U) && (spare == BG_MODE_NONE))
+            {
+                spare = k;
+            }
+        }
+    }
+
+    if (closer && (matched == BG_MODE_NONE) && (spare != BG_MODE_NONE))
+    {
+        bg_mode_t *mode = &bg->modes[spare][row][col];
+
+        memset(mode, 0, sizeof(*mode));
+        mode->mean_q8 = (uint32_t)value_mm << 8;
+        mode->run = 1U;
+    }
+    for (uint8_t k = 0U; k < BG_EXTRA_MODES; k++)
+    {
+        bg_mode_publish(bg, k, row, col);
+    }
+    return (matched != BG_MODE_NONE) && bg_mode_published(&bg->modes[matched][row][col]);
+}
+#else
+static void bg_modes_seed(bg_state_t *bg)
+{
+    (void)bg;
+}
+
+static bool bg_modes_update(bg_state_t *bg, uint8_t row, uint8_t col, uint16_t value_mm)
+{
+    (void)bg;
+    (void)row;
+    (void)col;
+    (void)value_mm;
+    return false;
+}
+#endif
+
+#if TOF_BG_MEDIAN
+/* Samples below x_q4 (1/16 mm) in 1/512 samples, spread evenly over their bin */
+static uint32_t bg_hist_below(const uint16_t cum[BG_HIST_BINS + 1U], const uint8_t *hist, int32_t x_q4)
+{
+    const int32_t bin_q4 = (int32_t)BG_HIST_BIN_MM * 16;
+    int32_t bin;
+
+    if (x_q4 <= 0)
+    {
+        return 0U;
+    }
+    if (x_q4 >= (bin_q4 * (int32_t)BG_HIST_BINS))
+    {
+        return (uint32_t)cum[BG_HIST_BINS] * 512U;
+    }
+    bin = x_q4 / bin_q4;
+    return ((uint32_t)cum[bin] * 512U) + ((uint32_t)hist[bin] * (uint32_t)(x_q4 - (bin * bin_q4)));
+}
+
+/*
+ * Median and median absolute deviation of a zone's histogram in 1/16 mm,
+ * interpolated within bins. Both are binary searches on the cumulative count.
+ */
+static void bg_hist_median(const uint8_t *hist, uint32_t *median_q4, uint32_t *mad_q4)
+{
+    const int32_t span_q4 = (int32_t)(BG_HIST_BINS * BG_HIST_BIN_MM * 16U);
+    uint16_t cum[BG_HIST_BINS + 1U];
+    uint32_t half;
+    int32_t low = 0;
+    int32_t high = span_q4;
+    int32_t median;
+
+    cum[0] = 0U;
+    for (uint32_t bin = 0U; bin < BG_HIST_BINS; bin++)
+    {
+        cum[bin + 1U] = (uint16_t)(cum[bin] + hist[bin]);
+    }
+    half = (uint32_t)cum[BG_HIST_BINS] * 256U;
+
+    while (low < high)
+    {
+        int32_t mid = (low + high) / 2;
+
+        if (bg_hist_below(cum, hist, mid) >= half)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+    median = low;
+    *median_q4 = (uint32_t)median;
+
+    low = 0;
+    high = span_q4;
+    while (low < high)
+    {
+        int32_t mid = (low + high) / 2;
+
+        if ((bg_hist_below(cum, hist, median + mid) - bg_hist_below(cum, hist, median - mid)) >= half)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+    *mad_q4 = (uint32_t)low;
+}
+
+/* Counts the sample in its bin; a full counter halves the zone's histogram, which keeps its shape */
+static void bg_collect_median(bg_state_t *bg, uint8_t row, uint8_t col, uint16_t value_mm)
+{
+    uint8_t *hist = bg->hist[row][col];
+    uint32_t bin = value_mm / BG_HIST_BIN_MM;
+
+    bin = (bin < BG_HIST_BINS) ? bin : (BG_HIST_BINS - 1U);
+    if (hist[bin] == UINT8_MAX)
+    {
+        for (uint32_t i = 0U; i < BG_HIST_BINS; i++)
+        {
+            hist[i] = (uint8_t)((hist[i] + 1U) / 2U);
+        }
+    }
+    hist[bin]++;
+}
+
+/* Publishes the zone's median and MAD and starts its adaptive model from them */
+static void bg_compute_median(bg_state_t *bg, uint8_t row, uint8_t col)
+{
+    uint32_t median_q4;
+    uint32_t mad_q4;
+    uint32_t std_q4;
+
+    bg_hist_median(bg->hist[row][col], &median_q4, &mad_q4);
+    std_q4 = (mad_q4 * BG_MAD_TO_STD_Q10) >> 10;
+    bg_set_zone(&bg->info, row, col, (median_q4 + 8U) >> 4, std_q4 >> 4);
+    bg->mean_q8[row][col] = median_q4 << 4;
+    bg->var_q8[row][col] = std_q4 * std_q4;
+}
+#endif
+
+/*
+ * Turns the collection of every zone into the published background and
+ * seeds the adaptive model with it; the mean estimator seeds the exact mean
+ * and variance of the sums. Each zone is read out before it is written.
+ */
+static void bg_compute(bg_state_t *bg, bg_estimator_t estimator)
+{
+#if !TOF_BG_MEDIAN
+    (void)estimator;
+#endif
     for (uint8_t row = 0U; row < TOF_ROWS; row++)
     {
         for (uint8_t col = 0U; col < TOF_COLS; col++)
         {
-            uint16_t cnt = s_valid_count[row][col];
-            if (cnt >= MIN_VALID_SAMPLES)
+            uint64_t cnt = bg->valid_count[row][col];
+            uint64_t sum = bg->sum[row][col];
+            uint64_t sum_sq = bg->sum_sq[row][col];
+            uint64_t spread;
+            uint32_t mean;
+            uint64_t var;
+
+            bg->fg_frames[row][col] = 0U;
+            if (cnt < MIN_VALID_SAMPLES)
             {
-                uint32_t mean = s_sum[row][col] / cnt;
-                uint32_t mean_sq = s_sum_sq[row][col] / cnt;
-                uint32_t sq_mean = mean * mean;
-                uint32_t var = (mean_sq > sq_mean) ? (mean_sq - sq_mean) : 0U;
-                bg.mean[row][col] = mean;
-                bg.std[row][col] = (uint32_t)(sqrt((float)var));
+                bg_set_zone(&bg->info, row, col, BG_NO_TARGET_MM, 0U);
+                bg->mean_q8[row][col] = BG_NO_TARGET_MM << 8;
+                bg->var_q8[row][col] = 0U;
+                continue;
             }
-            else
+#if TOF_BG_MEDIAN
+            if (estimator == BG_ESTIMATOR_MEDIAN)
+            {
+                bg_compute_median(bg, row, col);
+                continue;
+            }
+#endif
+
+            mean = (uint32_t)(sum / cnt);
+            var = sum_sq / cnt;
+            var = (var > ((uint64_t)mean * mean)) ? (var - ((uint64_t)mean * mean)) : 0U;
+            bg_set_zone(&bg->info, row, col, mean, bg_isqrt((var > UINT32_MAX) ? UINT32_MAX : (uint32_t)var, 0U));
+            bg->mean_q8[row][col] = (uint32_t)((sum << 8) / cnt);
+            spread = (sum_sq * cnt) - (sum * sum);
+            spread = (spread <= (UINT64_MAX >> 8)) ? ((spread << 8) / (cnt * cnt)) : (((spread / cnt) << 8) / cnt);
+            bg->var_q8[row][col] = (spread > UINT32_MAX) ? UINT32_MAX : (uint32_t)spread;
+        }
+    }
+    bg->info.max = (bg->collected_frames > 0U) ? (uint16_t)(bg->max_sum / bg->collected_frames) : 0U;
+    bg->max_q8 = (uint32_t)bg->info.max << 8;
+    bg->source = BG_SOURCE_COLLECTED;
+}
+
+/* Starts the adaptive model from a restored background, over the collection run during validation */
+static void bg_seed_restored(bg_state_t *bg)
+{
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        {
+            uint32_t std = bg->info.std[row][col];
+
+            bg->mean_q8[row][col] = (uint32_t)bg->info.mean[row][col] << 8;
+            bg->var_q8[row][col] = (std * std) << 8;
+            bg->fg_frames[row][col] = 0U;
+        }
+    }
+    bg->max_q8 = (uint32_t)bg->info.max << 8;
+    bg_modes_seed(bg);
+    bg->source = BG_SOURCE_RESTORED;
+}
+
+static bool bg_frame_matches(const bg_state_t *bg, const tof_frame_t *frame)
+{
+    uint32_t usable = 0U;
+    uint32_t matched = 0U;
+
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        {
+            int32_t delta = (int32_t)frame->distance_mm[row][col] - (int32_t)bg->info.mean[row][col];
+            uint32_t tolerance = (uint32_t)bg->info.std[row][col] * BG_VALIDATE_STD_GAIN;
+
+            if (!bg_is_status_usable(frame->target_status[row][col]) || !bg_is_confident(frame, row, col))
             {
-                bg.std[row][col] = 0U;
-                bg.mean[row][col] = 4000U;
+                continue;
             }
+            tolerance = (tolerance < BG_VALIDATE_MIN_DELTA_MM) ? BG_VALIDATE_MIN_DELTA_MM : tolerance;
+            usable++;
+            matched += ((uint32_t)((delta < 0) ? -delta : delta) <= tolerance) ? 1U : 0U;
         }
     }
-    bg.max = (s_collected_frames > 0U) ? (uint16_t)(s_max_sum / s_collected_frames) : 0U;
+
+    return (usable > 0U) && ((matched * 100U) >= (usable * BG_VALIDATE_MATCH_PERCENT));
 }
 
-void bg_reset(void)
+void bg_default_config(bg_config_t *config)
 {
-    s_collected_frames = 0U;
-    s_max_sum = 0U;
-    s_collecting = true;
+    if (config == NULL)
+    {
+        return;
+    }
 
-    memset(&bg, 0, sizeof(bg));
-    memset(s_sum, 0, sizeof(s_sum));
-    memset(s_sum_sq, 0, sizeof(s_sum_sq));
-    memset(s_valid_count, 0, sizeof(s_valid_count));
+    config->estimator = (TOF_BG_MEDIAN != 0) ? BG_ESTIMATOR_MEDIAN : BG_ESTIMATOR_MEAN;
+    config->adaptive = (TOF_BG_ADAPTIVE != 0);
+    config->collect_frames = config->adaptive ? BG_ADAPTIVE_FRAMES : BG_DEFAULT_FRAMES;
+    config->learn_shift = BG_DEFAULT_LEARN_SHIFT;
+    config->absorb_frames = BG_DEFAULT_ABSORB_FRAMES;
 }
 
-void bg_collect(const VL53L5CX_ResultsData *tof_result)
+void bg_init(bg_state_t *bg, const bg_config_t *config)
+{
+    if (config != NULL)
+    {
+        bg->config = *config;
+    }
+    else
+    {
+        bg_default_config(&bg->config);
+    }
+    if (bg->config.collect_frames == 0U)
+    {
+        bg->config.collect_frames = 1U;
+    }
+    if ((TOF_BG_MEDIAN == 0) || (bg->config.estimator != BG_ESTIMATOR_MEDIAN))
+    {
+        bg->config.estimator = BG_ESTIMATOR_MEAN;
+    }
+    if ((bg->config.learn_shift == 0U) || (bg->config.learn_shift > BG_MAX_LEARN_SHIFT))
+    {
+        bg->config.learn_shift = BG_DEFAULT_LEARN_SHIFT;
+    }
+    bg_reset(bg);
+}
+
+void bg_reset(bg_state_t *bg)
+{
+    bg_config_t config = bg->config;
+
+    memset(bg, 0, sizeof(*bg));
+    bg->config = config;
+    bg->collecting = true;
+#if TOF_BG_MODES > 1
+    memset(bg->info.mode_low, 0xFF, sizeof(bg->info.mode_low));
+#endif
+}
+
+void bg_collect(bg_state_t *bg, const tof_frame_t *frame, bg_estimator_t estimator)
 {
     uint16_t frame_max = 0U;
 
+#if !TOF_BG_MEDIAN
+    (void)estimator;
+#endif
+
     for (uint8_t row = 0U; row < TOF_ROWS; row++)
     {
         for (uint8_t col = 0U; col < TOF_COLS; col++)
         {
-            uint8_t idx = (uint8_t)(row * TOF_COLS + col);
-            uint8_t status = tof_result->target_status[idx];
+            uint8_t status = frame->target_status[row][col];
 
-            if (status == 255U)
+            if ((status == 255U) || !bg_is_confident(frame, row, col))
             {
                 continue;
             }
-            uint16_t value = tof_result->distance_mm[idx];
-            s_valid_count[row][col]++;
-            s_sum[row][col] += value;
-            s_sum_sq[row][col] += (uint32_t)value * (uint32_t)value;
+            uint16_t value = frame->distance_mm[row][col];
+            bg->valid_count[row][col]++;
+#if TOF_BG_MEDIAN
+            if (estimator == BG_ESTIMATOR_MEDIAN)
+            {
+                bg_collect_median(bg, row, col, value);
+            }
+            else
+#endif
+            {
+                bg->sum[row][col] += value;
+                bg->sum_sq[row][col] += (uint32_t)value * (uint32_t)value;
+            }
 
-            if (((status == 5U) || (status == 9U)) && (value > frame_max))
+            if (bg_is_status_usable(status) && (value > frame_max))
             {
                 frame_max = value;
             }
         }
     }
 
-    s_max_sum += frame_max;
+    bg->max_sum += frame_max;
 }
 
-bool is_bg_collecting(void)
+bool is_bg_collecting(const bg_state_t *bg)
 {
-    return s_collecting;
+    return bg->collecting;
 }
 
-const bg_info_t *bg_get_info(void)
+const bg_info_t *bg_get_info(const bg_state_t *bg)
 {
-    return &bg;
+    return &bg->info;
 }
 
-bool bg_update(const VL53L5CX_ResultsData *tof_result)
+bool bg_update(bg_state_t *bg, const tof_frame_t *frame)
 {
-    if (s_collecting)
+    if (bg->validating)
+    {
+        bg->validated_frames += bg_frame_matches(bg, frame) ? 1U : 0U;
+        if ((bg->collected_frames + 1U) >= BG_VALIDATE_FRAMES)
+        {
+            bg->validating = false;
+            if ((bg->validated_frames + BG_VALIDATE_MAX_MISSES) >= BG_VALIDATE_FRAMES)
+            {
+                bg_seed_restored(bg);
+                bg->collecting = false;
+                return false;
+            }
+        }
+    }
+
+    if (bg->collecting)
     {
-        bg_collect(tof_result);
-        s_collected_frames++;
-        if (s_collected_frames == BG_DEFAULT_FRAMES)
+        bg_collect(bg, frame, bg->config.estimator);
+        bg->collected_frames++;
+        if (bg->collected_frames >= bg->config.collect_frames)
         {
-            bg_compute();
-            s_collecting = false;
+            bg_compute(bg, bg->config.estimator);
+            bg->collecting = false;
+            bg->validating = false;
         }
     }
-    return s_collecting;
+    else if (bg->refreshing)
+    {
+        /* People keep crossing while the replacement is learnt, which only the median ignores */
+        bg_collect(bg, frame, BG_REFRESH_ESTIMATOR);
+        bg->collected_frames++;
+        if (bg->collected_frames >= BG_REFRESH_FRAMES)
+        {
+            bg_compute(bg, BG_REFRESH_ESTIMATOR);
+            bg->refreshing = false;
+        }
+    }
+    return bg->collecting;
+}
+
+void bg_refresh(bg_state_t *bg)
+{
+    if ((bg == NULL) || bg->collecting || bg->refreshing)
+    {
+        return;
+    }
+
+    /* The collection takes over the adaptive model's storage, which bg_compute seeds again at the end */
+    memset(bg->sum, 0, sizeof(bg->sum));
+    memset(bg->sum_sq, 0, sizeof(bg->sum_sq));
+    memset(bg->valid_count, 0, sizeof(bg->valid_count));
+#if TOF_BG_MEDIAN
+    memset(bg->hist, 0, sizeof(bg->hist));
+#endif
+    bg->collected_frames = 0U;
+    bg->max_sum = 0U;
+    bg->refreshing = true;
+}
+
+void bg_restore(bg_state_t *bg, const bg_info_t *info)
+{
+    if ((bg == NULL) || (info == NULL))
+    {
+        return;
+    }
+
+    bg_reset(bg);
+    bg->info = *info;
+    bg->validating = true;
+}
+
+/* Edge zones of a target mix it with the background behind, so they stay frozen too */
+static bool bg_near_foreground(const uint16_t foreground_mm[TOF_ROWS][TOF_COLS], uint8_t row, uint8_t col)
+{
+    return ((row > 0U) && (foreground_mm[row - 1U][col] != 0U)) ||
+           ((row + 1U < TOF_ROWS) && (foreground_mm[row + 1U][col] != 0U)) ||
+           ((col > 0U) && (foreground_mm[row][col - 1U] != 0U)) ||
+           ((col + 1U < TOF_COLS) && (foreground_mm[row][col + 1U] != 0U));
+}
+
+/*
+ * Exponentially weighted mean and variance (West's incremental form):
+ *   d = x - mean, mean += a * d, var = (1 - a) * (var + a * d^2)
+ * with a = 2^-shift, kept in Q8 so a single mm step still moves the mean.
+ */
+static void bg_learn(bg_state_t *bg, uint8_t row, uint8_t col, uint16_t value_mm)
+{
+    uint8_t shift = bg->config.learn_shift;
+    int32_t delta = (int32_t)((uint32_t)value_mm << 8) - (int32_t)bg->mean_q8[row][col];
+    int32_t step = delta / (int32_t)(1L << shift);
+    uint64_t var = (uint64_t)bg->var_q8[row][col] + ((uint64_t)((int64_t)delta * step) >> 8);
+
+    var -= var >> shift;
+    bg->mean_q8[row][col] = (uint32_t)((int32_t)bg->mean_q8[row][col] + step);
+    bg->var_q8[row][col] = (var > UINT32_MAX) ? UINT32_MAX : (uint32_t)var;
+    bg_set_zone(&bg->info, row, col, (bg->mean_q8[row][col] + 128U) >> 8,
+                bg_isqrt(bg->var_q8[row][col] >> 8, bg->info.std[row][col]));
+}
+
+/* A zone that stays foreground for absorb_frames is taken as the new background */
+static void bg_absorb(bg_state_t *bg, uint8_t row, uint8_t col, uint16_t value_mm)
+{
+    if ((bg->config.absorb_frames == 0U) || (++bg->fg_frames[row][col] < bg->config.absorb_frames))
+    {
+        return;
+    }
+
+    bg->fg_frames[row][col] = 0U;
+    bg->mean_q8[row][col] = (uint32_t)value_mm << 8;
+    bg->info.mean[row][col] = value_mm;
+}
+
+void bg_adapt(bg_state_t *bg, const tof_frame_t *frame, const uint16_t foreground_mm[TOF_ROWS][TOF_COLS])
+{
+    uint16_t frame_max = 0U;
+
+    if ((bg == NULL) || (frame == NULL) || (foreground_mm == NULL) || bg->collecting ||
+        (!bg->config.adaptive && (TOF_BG_MODES == 1)))
+    {
+        return;
+    }
+
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        {
+            uint16_t value = frame->distance_mm[row][col];
+
+            if (!bg_is_status_usable(frame->target_status[row][col]) || !bg_is_confident(frame, row, col))
+            {
+                continue;
+            }
+            frame_max = (value > frame_max) ? value : frame_max;
+
+            /* A door standing open is background too, but not part of the main model */
+            if (bg_modes_update(bg, row, col, value))
+            {
+                bg->fg_frames[row][col] = 0U;
+                continue;
+            }
+            if (!bg->config.adaptive || bg->refreshing)
+            {
+                continue;
+            }
+            if (foreground_mm[row][col] != 0U)
+            {
+                bg_absorb(bg, row, col, value);
+                continue;
+            }
+            bg->fg_frames[row][col] = 0U;
+            if (!bg_near_foreground(foreground_mm, row, col))
+            {
+                bg_learn(bg, row, col, value);
+            }
+        }
+    }
+
+    if (bg->config.adaptive && !bg->refreshing && (frame_max > 0U))
+    {
+        int32_t delta = (int32_t)((uint32_t)frame_max << 8) - (int32_t)bg->max_q8;
+
+        bg->max_q8 = (uint32_t)((int32_t)bg->max_q8 + (delta / (int32_t)(1L << bg->config.learn_shift)));
+        bg->info.max = (uint16_t)((bg->max_q8 + 128U) >> 8);
+    }
 }
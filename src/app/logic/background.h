@@ -5,15 +5,146 @@
 #include <stdint.h>
 
 #include "tof_types.h"
-#include "vl53l5cx_api.h"
 
+/* 1: keep learning the background after the initial collection */
+#ifndef TOF_BG_ADAPTIVE
+#define TOF_BG_ADAPTIVE 1
+#endif
+
+/* 1: learn the initial background from the per-zone median instead of the mean. Builds the median estimator in at
+ * BG_HIST_BINS bytes per zone (8 KB at 8x8, 32 KB at 16x16); without it both it and a refresh use the mean. */
+#ifndef TOF_BG_MEDIAN
+#define TOF_BG_MEDIAN 0
+#endif
+
+/* Background depths per zone: 1 is the mean/std model, 2..3 also learn depths a zone keeps returning to (a door) */
+#ifndef TOF_BG_MODES
+#define TOF_BG_MODES 1
+#endif
+#if (TOF_BG_MODES < 1) || (TOF_BG_MODES > 3)
+#error "TOF_BG_MODES must be 1, 2 or 3"
+#endif
+#define BG_EXTRA_MODES (TOF_BG_MODES - 1)
+
+#define BG_DEFAULT_FRAMES 100U
+/* The adaptive model only needs a rough start, it converges while running */
+#define BG_ADAPTIVE_FRAMES 16U
+/* Learning rate 1/128 per frame, a time constant of 16 s at 8 Hz */
+#define BG_DEFAULT_LEARN_SHIFT 7U
+#define BG_MAX_LEARN_SHIFT 12U
+/* Foreground that has not moved for 5 min at 8 Hz (furniture) becomes background */
+#define BG_DEFAULT_ABSORB_FRAMES 2400U
+/* A refresh learns its replacement over 12 s at 8 Hz, nothing waits on it */
+#define BG_REFRESH_FRAMES 100U
+/* A restored background is checked against this many frames before it is used */
+#define BG_VALIDATE_FRAMES 4U
+/* Median estimator: per-zone histogram of 32 mm bins up to 4096 mm, byte counters halved when one fills */
+#define BG_HIST_BINS 128U
+#define BG_HIST_BIN_MM 32U
+/* Foreground threshold of a zone: max(BG_THRESHOLD_STD_GAIN * std, BG_THRESHOLD_MIN_MM) */
+#define BG_THRESHOLD_STD_GAIN 2U
+#define BG_THRESHOLD_MIN_MM 80U
+
+typedef enum {
+    BG_ESTIMATOR_MEAN = 0,
+    /* Median and MAD, unaffected by people crossing during the collection as long as a zone is mostly clear */
+    BG_ESTIMATOR_MEDIAN,
+} bg_estimator_t;
+
+typedef enum {
+    BG_SOURCE_NONE = 0,
+    BG_SOURCE_COLLECTED,
+    BG_SOURCE_RESTORED,
+} bg_source_t;
+
+/*
+ * Per-zone statistics in mm, one contiguous array per field so the
+ * foreground filter compares two zones per 32-bit word. The threshold is
+ * derived from the unsaturated deviation whenever the model changes.
+ */
 typedef struct {
-    uint32_t mean[TOF_ROWS][TOF_COLS];
-    uint32_t std[TOF_ROWS][TOF_COLS];
+    uint16_t mean[TOF_ROWS][TOF_COLS];
+    uint16_t threshold[TOF_ROWS][TOF_COLS];
+    uint8_t std[TOF_ROWS][TOF_COLS]; /* saturates at 255 mm */
+#if TOF_BG_MODES > 1
+    /* Distances within [low, high] match another background depth of the zone; empty while low > high */
+    uint16_t mode_low[BG_EXTRA_MODES][TOF_ROWS][TOF_COLS];
+    uint16_t mode_high[BG_EXTRA_MODES][TOF_ROWS][TOF_COLS];
+#endif
     uint16_t max;
 } bg_info_t;
 
-void bg_reset(void);
-const bg_info_t *bg_get_info(void);
-bool bg_update(const VL53L5CX_ResultsData *tof_result);
+#if TOF_BG_MODES > 1
+/* A depth closer than the main background; free while mean_q8 is 0 */
+typedef struct {
+    uint32_t mean_q8;
+    uint16_t weight; /* share of recent frames at this depth, 1/65536 */
+    uint16_t run;    /* consecutive frames at this depth */
+    uint8_t visits;  /* runs of BG_MODE_RUN_FRAMES seen */
+} bg_mode_t;
+#endif
+
+typedef struct {
+    uint16_t collect_frames;
+    bg_estimator_t estimator;
+    bool adaptive;
+    uint8_t learn_shift;    /* learning rate 1 / 2^learn_shift */
+    uint16_t absorb_frames; /* 0: foreground is never absorbed */
+} bg_config_t;
+
+typedef struct {
+    bg_info_t info;
+    bg_config_t config;
+    bg_source_t source;
+    bool collecting;
+    /* Checking a restored background; the collection runs alongside in case it fails */
+    bool validating;
+    uint8_t validated_frames;
+    /* Learning a replacement in the collection while info keeps being served; the main model stops adapting */
+    bool refreshing;
+    uint16_t collected_frames;
+    uint32_t max_sum;
+    uint32_t max_q8;
+    uint16_t fg_frames[TOF_ROWS][TOF_COLS];
+#if TOF_BG_MODES > 1
+    bg_mode_t modes[BG_EXTRA_MODES][TOF_ROWS][TOF_COLS];
+#endif
+    /*
+     * The collection is folded into the adaptive model once it completes.
+     * A zone's model only overlaps the collection of zones at or before it,
+     * so they are converted in raster order. With at most 65535 samples of
+     * up to 65535 mm neither sum can overflow.
+     */
+    union {
+        struct {
+            uint32_t sum[TOF_ROWS][TOF_COLS];
+            uint64_t sum_sq[TOF_ROWS][TOF_COLS];
+            uint16_t valid_count[TOF_ROWS][TOF_COLS];
+#if TOF_BG_MEDIAN
+            uint8_t hist[TOF_ROWS][TOF_COLS][BG_HIST_BINS];
+#endif
+        };
+        /* Adaptive model in 1/256 mm and 1/256 mm^2 */
+        struct {
+            uint32_t mean_q8[TOF_ROWS][TOF_COLS];
+            uint32_t var_q8[TOF_ROWS][TOF_COLS];
+        };
+    };
+} bg_state_t;
+
+void bg_default_config(bg_config_t *config);
+/* config may be NULL for the defaults */
+void bg_init(bg_state_t *bg, const bg_config_t *config);
+/* Restarts the collection, keeps the configuration */
+void bg_reset(bg_state_t *bg);
+const bg_info_t *bg_get_info(const bg_state_t *bg);
+bool bg_update(bg_state_t *bg, const tof_frame_t *frame);
+/* Learns a new background over BG_REFRESH_FRAMES frames while the current one stays in use, then replaces it
+ * within a single bg_update(). Ignored while a collection or refresh is running. */
+void bg_refresh(bg_state_t *bg);
+/* Restarts with a previously learnt background, used once the next frames confirm it */
+void bg_restore(bg_state_t *bg, const bg_info_t *info);
+/* Feeds the frame into the model where foreground_mm (fg_filter output) found no foreground. Extra background
+ * modes learn from every frame, the main model only with config.adaptive. */
+void bg_adapt(bg_state_t *bg, const tof_frame_t *frame, const uint16_t foreground_mm[TOF_ROWS][TOF_COLS]);
 #endif
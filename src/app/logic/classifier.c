@@ -11,21 +11,15 @@
 #define FALL_PRE_HOLD_FRAMES 2U
 #define FALL_TRANSITION_FRAMES 6U
 
+/* The network was trained on one 8x8 sensor; other grids are resampled to it */
+#define AI_INPUT_ROWS 8U
+#define AI_INPUT_COLS 8U
+
 #define CLASS_LYING 1U
 #define CLASS_STANDING 2U
 #define CLASS_SITTING 3U
 #define CLASS_FALLING 4U
 
-static float s_ai_input[AI_NETWORK_IN_1_SIZE];
-static float s_output_history[TOF_HISTORY_SIZE][TOF_NUM_CLASSES];
-static float s_output_sum[TOF_NUM_CLASSES];
-static uint8_t s_history_idx = 0U;
-static uint8_t s_history_count = 0U;
-static uint8_t s_previous_raw_class = 0U;
-static bool s_fall_sequence_active = false;
-static uint8_t s_fall_sequence_counter = 0U;
-static uint8_t s_pre_fall_class = 0U;
-
 static bool classifier_is_lying(uint8_t class_id)
 {
     return class_id == CLASS_LYING;
@@ -36,36 +30,36 @@ static bool classifier_is_upright(uint8_t class_id)
     return (class_id == CLASS_STANDING) || (class_id == CLASS_SITTING);
 }
 
-static uint8_t classifier_apply_fall_state(uint8_t raw_class_id)
+static uint8_t classifier_apply_fall_state(classifier_state_t *state, uint8_t raw_class_id)
 {
     const uint8_t transition_total_frames = FALL_PRE_HOLD_FRAMES + FALL_TRANSITION_FRAMES;
     uint8_t published_class_id = raw_class_id;
-    bool upright_to_lying = classifier_is_upright(s_previous_raw_class) && classifier_is_lying(raw_class_id);
+    bool upright_to_lying = classifier_is_upright(state->previous_raw_class) && classifier_is_lying(raw_class_id);
 
-    if (!s_fall_sequence_active && upright_to_lying)
+    if (!state->fall_sequence_active && upright_to_lying)
     {
-        s_fall_sequence_active = true;
-        s_fall_sequence_counter = 0U;
-        s_pre_fall_class = s_previous_raw_class;
+        state->fall_sequence_active = true;
+        state->fall_sequence_counter = 0U;
+        state->pre_fall_class = state->previous_raw_class;
     }
 
-    if (s_fall_sequence_active)
+    if (state->fall_sequence_active)
     {
         if (!classifier_is_lying(raw_class_id))
         {
-            s_fall_sequence_active = false;
-            s_fall_sequence_counter = 0U;
-            s_pre_fall_class = 0U;
+            state->fall_sequence_active = false;
+            state->fall_sequence_counter = 0U;
+            state->pre_fall_class = 0U;
         }
         else
         {
-            s_fall_sequence_counter++;
+            state->fall_sequence_counter++;
 
-            if (s_fall_sequence_counter <= FALL_PRE_HOLD_FRAMES)
+            if (state->fall_sequence_counter <= FALL_PRE_HOLD_FRAMES)
             {
-                published_class_id = s_pre_fall_class;
+                published_class_id = state->pre_fall_class;
             }
-            else if (s_fall_sequence_counter <= transition_total_frames)
+            else if (state->fall_sequence_counter <= transition_total_frames)
             {
                 published_class_id = CLASS_FALLING;
             }
@@ -76,97 +70,109 @@ static uint8_t classifier_apply_fall_state(uint8_t raw_class_id)
         }
     }
 
-    s_previous_raw_class = raw_class_id;
+    state->previous_raw_class = raw_class_id;
     return published_class_id;
 }
 
 void classifier_init(void)
 {
     AI_Init();
-    classifier_reset();
 }
 
-void classifier_reset(void)
+void classifier_reset(classifier_state_t *state)
 {
-    memset(s_ai_input, 0, sizeof(s_ai_input));
-    memset(s_output_history, 0, sizeof(s_output_history));
-    memset(s_output_sum, 0, sizeof(s_output_sum));
-    s_history_idx = 0U;
-    s_history_count = 0U;
-    s_previous_raw_class = 0U;
-    s_fall_sequence_active = false;
-    s_fall_sequence_counter = 0U;
-    s_pre_fall_class = 0U;
+    memset(state, 0, sizeof(*state));
 }
 
+static float classifier_zone_feature(uint16_t filtered_mm, uint16_t pixel_distance_bg_mm)
+{
+    if (filtered_mm == 0U)
+    {
+        return 0.0f;
+    }
+    if (pixel_distance_bg_mm > AI_BIN_NEAR)
+    {
+        return 3.0f;
+    }
+    if (pixel_distance_bg_mm > AI_BIN_MID)
+    {
+        return 2.0f;
+    }
+    return 1.0f;
+}
+
+/* Every input cell takes the largest feature of the zones it covers, or the
+ * nearest zone when the grid is coarser than the input. */
 void preprocess_and_run_ai(const uint16_t filtered_frame_mm[TOF_ROWS][TOF_COLS],
                            const uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS], float ai_out[TOF_NUM_CLASSES])
 {
+    float ai_input[AI_NETWORK_IN_1_SIZE] = {0.0f};
     uint16_t ai_idx = 0U;
-    memset(s_ai_input, 0, sizeof(s_ai_input));
 
-    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    for (uint8_t in_row = 0U; in_row < AI_INPUT_ROWS; in_row++)
     {
-        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        uint8_t row0 = (uint8_t)((in_row * TOF_ROWS) / AI_INPUT_ROWS);
+        uint8_t row1 = (uint8_t)(((in_row + 1U) * TOF_ROWS) / AI_INPUT_ROWS);
+
+        row1 = (row1 > row0) ? row1 : (uint8_t)(row0 + 1U);
+        for (uint8_t in_col = 0U; in_col < AI_INPUT_COLS; in_col++)
         {
+            uint8_t col0 = (uint8_t)((in_col * TOF_COLS) / AI_INPUT_COLS);
+            uint8_t col1 = (uint8_t)(((in_col + 1U) * TOF_COLS) / AI_INPUT_COLS);
             float feature = 0.0f;
 
-            if (filtered_frame_mm[row][col] != 0U)
+            col1 = (col1 > col0) ? col1 : (uint8_t)(col0 + 1U);
+            for (uint8_t row = row0; row < row1; row++)
             {
-                if (pixel_distance_bg_mm[row][col] > AI_BIN_NEAR)
-                {
-                    feature = 3.0f;
-                }
-                else if (pixel_distance_bg_mm[row][col] > AI_BIN_MID)
-                {
-                    feature = 2.0f;
-                }
-                else
+                for (uint8_t col = col0; col < col1; col++)
                 {
-                    feature = 1.0f;
+                    float zone_feature =
+                        classifier_zone_feature(filtered_frame_mm[row][col], pixel_distance_bg_mm[row][col]);
+
+                    feature = (zone_feature > feature) ? zone_feature : feature;
                 }
             }
 
             if (ai_idx < AI_NETWORK_IN_1_SIZE)
             {
-                s_ai_input[ai_idx] = feature;
+                ai_input[ai_idx] = feature;
                 ai_idx++;
             }
         }
     }
 
-    AI_Run(s_ai_input, ai_out);
+    AI_Run(ai_input, ai_out);
 }
 
-uint8_t ai_output_moving_average(float ai_out[TOF_NUM_CLASSES])
+uint8_t ai_output_moving_average(classifier_state_t *state, float ai_out[TOF_NUM_CLASSES])
 {
     uint8_t raw_class_id;
 
-    if (s_history_count == TOF_HISTORY_SIZE)
+    if (state->history_count == TOF_HISTORY_SIZE)
     {
         for (uint8_t i = 0U; i < TOF_NUM_CLASSES; i++)
         {
-            s_output_sum[i] -= s_output_history[s_history_idx][i];
+            state->output_sum[i] -= state->output_history[state->history_idx][i];
         }
     }
     else
     {
-        s_history_count++;
+        state->history_count++;
     }
 
     for (uint8_t i = 0U; i < TOF_NUM_CLASSES; i++)
     {
-        s_output_history[s_history_idx][i] = ai_out[i];
-        s_output_sum[i] += ai_out[i];
+        state->output_history[state->history_idx][i] = ai_out[i];
+        state->output_sum[i] += ai_out[i];
     }
 
-    s_history_idx = (uint8_t)((s_history_idx + 1U) % TOF_HISTORY_SIZE);
+    state->history_idx = (uint8_t)((state->history_idx + 1U) % TOF_HISTORY_SIZE);
 
     for (uint8_t i = 0U; i < TOF_NUM_CLASSES; i++)
     {
-        ai_out[i] = s_output_sum[i] / (float)s_history_count;
+        ai_out[i] = state->output_sum[i] / (float)state->history_count;
     }
 
     raw_class_id = (uint8_t)(argmax(ai_out, TOF_NUM_CLASSES) + 1U);
-    return classifier_apply_fall_state(raw_class_id);
+    return classifier_apply_fall_state(state, raw_class_id);
 }
@@ -1,16 +1,30 @@
 #ifndef CLASSIFIER_H
 #define CLASSIFIER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "tof_types.h"
 
+/* Moving average and fall detection of one pipeline instance */
+typedef struct {
+    float output_history[TOF_HISTORY_SIZE][TOF_NUM_CLASSES];
+    float output_sum[TOF_NUM_CLASSES];
+    uint8_t history_idx;
+    uint8_t history_count;
+    uint8_t previous_raw_class;
+    bool fall_sequence_active;
+    uint8_t fall_sequence_counter;
+    uint8_t pre_fall_class;
+} classifier_state_t;
+
+/* Brings up the AI runtime, which every instance shares */
 void classifier_init(void);
-void classifier_reset(void);
+void classifier_reset(classifier_state_t *state);
 
 void preprocess_and_run_ai(const uint16_t filtered_frame_mm[TOF_ROWS][TOF_COLS],
                         const uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS],
                         float ai_out[TOF_NUM_CLASSES]);
-uint8_t ai_output_moving_average(float ai_out[TOF_NUM_CLASSES]);
+uint8_t ai_output_moving_average(classifier_state_t *state, float ai_out[TOF_NUM_CLASSES]);
 
 #endif
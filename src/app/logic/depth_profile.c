@@ -2,13 +2,13 @@
 
 #include <math.h>
 #include <stddef.h>
-#include <string.h>
 
 #include "segmentation.h"
+#include "tof_mask.h"
 
 static float depth_profile_regional_scale(const tof_component_t *comp, int row)
 {
-    if ((row > 3) || (comp->second_max_distance_mm <= comp->min_distance_mm))
+    if ((row >= (int)(TOF_ROWS / 2U)) || (comp->second_max_distance_mm <= comp->min_distance_mm))
     {
         return 1.0f;
     }
@@ -23,27 +23,12 @@ static float depth_profile_regional_scale(const tof_component_t *comp, int row)
     return (scale > 1.0f) ? 1.0f : scale;
 }
 
-static void depth_profile_split_single_component(const uint8_t combined_profile[TOF_ROWS][TOF_COLS],
-                                                 uint8_t labels[TOF_ROWS][TOF_COLS], tof_component_t *components,
+static void depth_profile_split_single_component(const depth_profile_t *profile,
+                                                 tof_label_t labels[TOF_ROWS][TOF_COLS], tof_component_t *components,
                                                  uint8_t *component_count)
 {
-    uint16_t head_frame[TOF_ROWS][TOF_COLS] = {0};
-    uint16_t body_frame[TOF_ROWS][TOF_COLS] = {0};
-
     seg_clear_labels(labels);
-    *component_count = 0U;
-
-    for (uint8_t row = 0U; row < TOF_ROWS; row++)
-    {
-        for (uint8_t col = 0U; col < TOF_COLS; col++)
-        {
-            if (combined_profile[row][col] == 2U)
-            {
-                head_frame[row][col] = 1U;
-            }
-        }
-    }
-    *component_count = seg_label_components(head_frame, labels, components, TOF_MAX_COMPONENTS, 2U);
+    *component_count = seg_label_mask(profile->head, labels, components, TOF_MAX_COMPONENTS, 2U);
 
     if (*component_count > 1U)
     {
@@ -51,74 +36,104 @@ static void depth_profile_split_single_component(const uint8_t combined_profile[
     }
 
     seg_clear_labels(labels);
-    for (uint8_t row = 0U; row < TOF_ROWS; row++)
-    {
-        for (uint8_t col = 0U; col < TOF_COLS; col++)
-        {
-            if (combined_profile[row][col] == 1U)
-            {
-                body_frame[row][col] = 1U;
-            }
-        }
-    }
-
-    *component_count = seg_label_components(body_frame, labels, components, TOF_MAX_COMPONENTS, 2U);
+    *component_count = seg_label_mask(profile->body, labels, components, TOF_MAX_COMPONENTS, 2U);
     if (*component_count == 0U)
     {
         *component_count = 1U;
     }
 }
 
-void depth_profile_generate(const uint16_t frame_mm[TOF_ROWS][TOF_COLS], uint8_t labels[TOF_ROWS][TOF_COLS],
-                            tof_component_t *components, uint8_t *component_count,
-                            uint8_t combined_profile[TOF_ROWS][TOF_COLS])
+/*
+ * Zones weigh by their height above the deepest zone of the component, plus
+ * TOF_DEPTH_THRESHOLD_MM so a flat blob weighs them evenly: the centroid
+ * leans to the head. Split components carry no distances of their own, so
+ * both passes read the frame.
+ */
+static void depth_profile_centroid(const uint16_t frame_mm[TOF_ROWS][TOF_COLS], tof_component_t *comp)
 {
+    tof_mask_t zones = comp->mask;
+    uint16_t max_mm = 0U;
+    uint64_t weight_sum = 0U;
+    uint64_t row_sum = 0U;
+    uint64_t col_sum = 0U;
+
+    while (!tof_mask_is_empty(zones))
+    {
+        uint16_t zone = tof_mask_pop_first(&zones);
+        uint16_t distance = frame_mm[zone / TOF_COLS][zone % TOF_COLS];
+
+        max_mm = (distance > max_mm) ? distance : max_mm;
+    }
+
+    zones = comp->mask;
+    while (!tof_mask_is_empty(zones))
+    {
+        uint16_t zone = tof_mask_pop_first(&zones);
+        uint32_t row = zone / TOF_COLS;
+        uint32_t col = zone % TOF_COLS;
+        uint32_t weight = (uint32_t)(max_mm - frame_mm[row][col]) + TOF_DEPTH_THRESHOLD_MM;
+
+        weight_sum += weight;
+        row_sum += (uint64_t)weight * row;
+        col_sum += (uint64_t)weight * col;
+    }
+
+    if (weight_sum == 0U)
+    {
+        comp->centroid_row = ((comp->box.y1 + comp->box.y2) * TOF_SUBZONE) / 2;
+        comp->centroid_col = ((comp->box.x1 + comp->box.x2) * TOF_SUBZONE) / 2;
+        return;
+    }
+    comp->centroid_row = (int)(((row_sum * TOF_SUBZONE) + (weight_sum / 2U)) / weight_sum);
+    comp->centroid_col = (int)(((col_sum * TOF_SUBZONE) + (weight_sum / 2U)) / weight_sum);
+}
 
-    memset(combined_profile, 0, sizeof(uint8_t) * TOF_ROWS * TOF_COLS);
+void depth_profile_generate(const uint16_t frame_mm[TOF_ROWS][TOF_COLS], tof_label_t labels[TOF_ROWS][TOF_COLS],
+                            tof_component_t *components, uint8_t *component_count, depth_profile_t *profile)
+{
+    profile->head = tof_mask_none();
+    profile->body = tof_mask_none();
+    profile->shoulder = tof_mask_none();
 
     for (uint8_t c = 0U; c < *component_count; c++)
     {
-        for (int row = components[c].box.y1; row <= components[c].box.y2; row++)
+        tof_mask_t zones = components[c].mask;
+
+        while (!tof_mask_is_empty(zones))
         {
-            for (int col = components[c].box.x1; col <= components[c].box.x2; col++)
+            uint16_t zone = tof_mask_pop_first(&zones);
+            uint8_t row = (uint8_t)(zone / TOF_COLS);
+            uint8_t col = (uint8_t)(zone % TOF_COLS);
+
+            if (frame_mm[row][col] <= (components[c].min_distance_mm + TOF_DEPTH_THRESHOLD_MM))
             {
-                if ((row < 0) || (row >= (int)TOF_ROWS) || (col < 0) || (col >= (int)TOF_COLS) ||
-                    (labels[row][col] != components[c].label))
-                {
-                    continue;
-                }
-
-                float scale = depth_profile_regional_scale(&components[c], row);
-                uint16_t distance = (uint16_t)lroundf((float)frame_mm[row][col] * scale);
-                uint16_t local_max = (uint16_t)lroundf((float)components[c].second_max_distance_mm * scale);
-
-                if (frame_mm[row][col] <= (components[c].min_distance_mm + TOF_DEPTH_THRESHOLD_MM))
-                {
-                    combined_profile[row][col] = 2U; // Head or close to head
-                }
-                else
-                {
-                    combined_profile[row][col] = 1U; // Body
-                }
-
-                if (combined_profile[row][col] == 1U)
-                {
-                    uint16_t near_max_threshold = (local_max > 200U) ? (uint16_t)(local_max - 200U) : 0U;
-                    if (distance >= near_max_threshold)
-                    {
-                        combined_profile[row][col] = 3U; // Remain body or shoulder
-                    }
-                    else
-                    {
-                        combined_profile[row][col] = 1U; // close to head region
-                    }
-                }
+                tof_mask_set(&profile->head, row, col); // Head or close to head
+                continue;
+            }
+
+            float scale = depth_profile_regional_scale(&components[c], row);
+            uint16_t distance = (uint16_t)lroundf((float)frame_mm[row][col] * scale);
+            uint16_t local_max = (uint16_t)lroundf((float)components[c].second_max_distance_mm * scale);
+            uint16_t near_max_threshold = (local_max > 200U) ? (uint16_t)(local_max - 200U) : 0U;
+
+            if (distance >= near_max_threshold)
+            {
+                tof_mask_set(&profile->shoulder, row, col); // Remain body or shoulder
+            }
+            else
+            {
+                tof_mask_set(&profile->body, row, col); // close to head region
             }
         }
     }
 
     if (*component_count == 1U)
     {
-        depth_profile_split_single_component(combined_profile, labels, components, component_count);
+        depth_profile_split_single_component(profile, labels, components, component_count);
+    }
+
+    for (uint8_t c = 0U; c < *component_count; c++)
+    {
+        depth_profile_centroid(frame_mm, &components[c]);
     }
 }
@@ -5,10 +5,17 @@
 
 #include "tof_types.h"
 
+/* Zones of the labelled components, split by depth below the closest zone */
+typedef struct {
+    tof_mask_t head;     /* within TOF_DEPTH_THRESHOLD_MM of the component minimum */
+    tof_mask_t body;     /* between the head and the near-maximum band */
+    tof_mask_t shoulder; /* within 200 mm of the component second maximum */
+} depth_profile_t;
+
 void depth_profile_generate(const uint16_t frame_mm[TOF_ROWS][TOF_COLS],
-                            uint8_t labels[TOF_ROWS][TOF_COLS],
+                            tof_label_t labels[TOF_ROWS][TOF_COLS],
                             tof_component_t *components,
                             uint8_t *component_count,
-                            uint8_t combined_profile[TOF_ROWS][TOF_COLS]);
+                            depth_profile_t *profile);
 
 #endif
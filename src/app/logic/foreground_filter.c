@@ -1,45 +1,122 @@
 #include "foreground_filter.h"
 
-#include <stdbool.h>
 #include <stddef.h>
 
+#include "segmentation.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"
+#endif
+
 #define FG_MAX_DISTANCE_MM 4000U
-#define FG_STD_GAIN 2U
-#define FG_MIN_DELTA_MM 80U
 #define FG_STATUS_VALID_RANGE 5U
 #define FG_STATUS_VALID_LARGE_PULSE 9U
 
-static bool fg_is_status_usable(uint8_t status)
+/* 0xFFFF for a usable status, 0 otherwise */
+static uint32_t fg_status_mask(uint8_t status)
 {
-    return (status == FG_STATUS_VALID_RANGE) || (status == FG_STATUS_VALID_LARGE_PULSE);
+    return ((status == FG_STATUS_VALID_RANGE) || (status == FG_STATUS_VALID_LARGE_PULSE)) ? 0xFFFFU : 0U;
 }
 
-static uint32_t fg_threshold_mm(uint32_t bg_std_mm)
+/* 0xFFFF where mean - distance > threshold for a distance within range, 0 otherwise */
+static uint32_t fg_zone_mask(uint16_t distance_mm, uint8_t status, uint16_t mean_mm, uint32_t threshold_mm)
 {
-    uint32_t threshold_mm = bg_std_mm * FG_STD_GAIN;
+    uint32_t closer = ((distance_mm <= FG_MAX_DISTANCE_MM) &&
+                       (((int32_t)mean_mm - (int32_t)distance_mm) > (int32_t)threshold_mm)) ? 0xFFFFU : 0U;
 
-    if (threshold_mm < FG_MIN_DELTA_MM)
-    {
-        threshold_mm = FG_MIN_DELTA_MM;
-    }
-
-    return threshold_mm;
+    return closer & fg_status_mask(status);
 }
 
-static bool fg_is_foreground_pixel(uint16_t distance_mm, uint8_t status, uint32_t bg_mean_mm, uint32_t threshold_mm)
+/*
+ * Classifies the whole frame: filtered_mm keeps the distance of foreground
+ * zones, pixel_distance_bg_mm their height below the background maximum,
+ * both 0 elsewhere. With the DSP extension two zones are compared per
+ * halfword-SIMD instruction; sensor distances stay below 32768 mm, so the
+ * signed halfword differences cannot wrap for the distances kept.
+ */
+static void fg_classify(const tof_frame_t *frame, const bg_info_t *bg_info, uint16_t *filtered_mm,
+                        uint16_t *pixel_distance_bg_mm)
 {
-    int32_t delta_mm;
+    const uint16_t *distance_mm = &frame->distance_mm[0][0];
+    const uint8_t *status = &frame->target_status[0][0];
+    const uint16_t *mean_mm = &bg_info->mean[0][0];
+    const uint16_t *threshold_mm = &bg_info->threshold[0][0];
+#if TOF_QUALITY
+    const uint16_t *margin_mm = &frame->margin_mm[0][0];
+#endif
+    uint32_t zone = 0U;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    const uint32_t max_pair = ((uint32_t)bg_info->max << 16) | bg_info->max;
+    const uint32_t range_pair = (FG_MAX_DISTANCE_MM << 16) | FG_MAX_DISTANCE_MM;
 
-    if ((distance_mm > FG_MAX_DISTANCE_MM) || !fg_is_status_usable(status))
+    for (; (zone + 1U) < TOF_ZONES; zone += 2U)
     {
-        return false;
+        uint32_t distance = __UNALIGNED_UINT32_READ(&distance_mm[zone]);
+        uint32_t keep = fg_status_mask(status[zone]) | (fg_status_mask(status[zone + 1U]) << 16);
+        uint32_t threshold = __UNALIGNED_UINT32_READ(&threshold_mm[zone]);
+        uint32_t height;
+
+#if TOF_QUALITY
+        /* Saturates at 32767 mm, which no distance compared against exceeds */
+        threshold = __QADD16(threshold, __UNALIGNED_UINT32_READ(&margin_mm[zone]));
+#endif
+        /* GE set where threshold >= mean - distance: background */
+        (void)__SSUB16(threshold, __SSUB16(__UNALIGNED_UINT32_READ(&mean_mm[zone]), distance));
+        keep = __SEL(0U, keep);
+        /* GE set where the distance is within range */
+        (void)__USUB16(range_pair, distance);
+        keep = __SEL(keep, 0U);
+#if TOF_BG_MODES > 1
+        /* Distances within another background depth of the zone are not foreground */
+        for (uint32_t k = 0U; k < BG_EXTRA_MODES; k++)
+        {
+            const uint16_t *low_mm = &bg_info->mode_low[k][0][0];
+            const uint16_t *high_mm = &bg_info->mode_high[k][0][0];
+            uint32_t inside;
+
+            (void)__USUB16(distance, __UNALIGNED_UINT32_READ(&low_mm[zone]));
+            inside = __SEL(0xFFFFFFFFU, 0U);
+            (void)__USUB16(__UNALIGNED_UINT32_READ(&high_mm[zone]), distance);
+            inside = __SEL(inside, 0U);
+            keep &= ~inside;
+        }
+#endif
+        /* GE set where the background maximum is at or beyond the distance */
+        height = __USUB16(max_pair, distance);
+        height = __SEL(height, 0U);
+
+        __UNALIGNED_UINT32_WRITE(&filtered_mm[zone], distance & keep);
+        __UNALIGNED_UINT32_WRITE(&pixel_distance_bg_mm[zone], height & keep);
     }
+#endif
+    /* Branch-free, so the host compiler vectorises it */
+    for (; zone < TOF_ZONES; zone++)
+    {
+#if TOF_QUALITY
+        uint32_t keep = fg_zone_mask(distance_mm[zone], status[zone], mean_mm[zone],
+                                     (uint32_t)threshold_mm[zone] + margin_mm[zone]);
+#else
+        uint32_t keep = fg_zone_mask(distance_mm[zone], status[zone], mean_mm[zone], threshold_mm[zone]);
+#endif
+        uint32_t height = (bg_info->max > distance_mm[zone]) ? (uint32_t)(bg_info->max - distance_mm[zone]) : 0U;
+
+#if TOF_BG_MODES > 1
+        for (uint32_t k = 0U; k < BG_EXTRA_MODES; k++)
+        {
+            const uint16_t *low_mm = &bg_info->mode_low[k][0][0];
+            const uint16_t *high_mm = &bg_info->mode_high[k][0][0];
+
+            keep &= ((distance_mm[zone] >= low_mm[zone]) && (distance_mm[zone] <= high_mm[zone])) ? 0U : 0xFFFFU;
+        }
+#endif
 
-    delta_mm = (int32_t)bg_mean_mm - (int32_t)distance_mm;
-    return delta_mm > (int32_t)threshold_mm;
+        filtered_mm[zone] = (uint16_t)(distance_mm[zone] & keep);
+        pixel_distance_bg_mm[zone] = (uint16_t)(height & keep);
+    }
 }
 
-void fg_filter_apply(const VL53L5CX_ResultsData *frame, const bg_info_t *bg_info,
+void fg_filter_apply(const tof_frame_t *frame, const bg_info_t *bg_info,
                      uint16_t filtered_mm[TOF_ROWS][TOF_COLS], uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS])
 {
     if ((frame == NULL) || (bg_info == NULL) || (filtered_mm == NULL) || (pixel_distance_bg_mm == NULL))
@@ -47,26 +124,37 @@ void fg_filter_apply(const VL53L5CX_ResultsData *frame, const bg_info_t *bg_info
         return;
     }
 
+    fg_classify(frame, bg_info, &filtered_mm[0][0], &pixel_distance_bg_mm[0][0]);
+}
+
+/* fg_filter_apply() and seg_label_components() in one call: the frame is
+ * classified in bulk, then every foreground pixel is labelled with
+ * union-find in a single raster pass. */
+uint8_t fg_filter_segment(const tof_frame_t *frame, const bg_info_t *bg_info,
+                          uint16_t filtered_mm[TOF_ROWS][TOF_COLS], uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS],
+                          tof_label_t labels[TOF_ROWS][TOF_COLS], tof_component_t *components, uint8_t max_components,
+                          uint8_t min_component_size)
+{
+    seg_uf_t uf;
+
+    if ((frame == NULL) || (bg_info == NULL) || (filtered_mm == NULL) || (pixel_distance_bg_mm == NULL) ||
+        (labels == NULL) || (components == NULL))
+    {
+        return 0U;
+    }
+
+    fg_classify(frame, bg_info, &filtered_mm[0][0], &pixel_distance_bg_mm[0][0]);
+    seg_uf_begin(&uf, labels);
     for (uint8_t row = 0U; row < TOF_ROWS; row++)
     {
         for (uint8_t col = 0U; col < TOF_COLS; col++)
         {
-            uint8_t zone_idx = (uint8_t)((row * TOF_COLS) + col);
-            uint16_t target_idx = (uint16_t)(zone_idx * VL53L5CX_NB_TARGET_PER_ZONE);
-            uint16_t distance_mm = frame->distance_mm[target_idx];
-            uint8_t status = frame->target_status[target_idx];
-            uint32_t bg_mean_mm = bg_info->mean[row][col];
-            uint32_t threshold_mm = fg_threshold_mm(bg_info->std[row][col]);
-
-            if (!fg_is_foreground_pixel(distance_mm, status, bg_mean_mm, threshold_mm))
+            if (filtered_mm[row][col] != 0U)
             {
-                filtered_mm[row][col] = 0U;
-                pixel_distance_bg_mm[row][col] = 0U;
-                continue;
+                seg_uf_add_pixel(&uf, labels, row, col, filtered_mm[row][col]);
             }
-
-            filtered_mm[row][col] = distance_mm;
-            pixel_distance_bg_mm[row][col] = (bg_info->max > distance_mm) ? (uint16_t)(bg_info->max - distance_mm) : 0U;
         }
     }
+
+    return seg_uf_finish(&uf, labels, components, max_components, min_component_size);
 }
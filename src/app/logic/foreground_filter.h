@@ -5,11 +5,24 @@
 
 #include "background.h"
 #include "tof_types.h"
-#include "vl53l5cx_api.h"
 
-void fg_filter_apply(const VL53L5CX_ResultsData *frame,
+/* 1: fg_filter_segment() replaces fg_filter_apply() + seg_label_components() in the pipeline; slower than the
+ * bitboard labelling, so off by default */
+#ifndef TOF_FUSED_SEGMENTATION
+#define TOF_FUSED_SEGMENTATION 0
+#endif
+
+void fg_filter_apply(const tof_frame_t *frame,
                      const bg_info_t *bg_info,
                      uint16_t filtered_mm[TOF_ROWS][TOF_COLS],
                      uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS]);
+uint8_t fg_filter_segment(const tof_frame_t *frame,
+                          const bg_info_t *bg_info,
+                          uint16_t filtered_mm[TOF_ROWS][TOF_COLS],
+                          uint16_t pixel_distance_bg_mm[TOF_ROWS][TOF_COLS],
+                          tof_label_t labels[TOF_ROWS][TOF_COLS],
+                          tof_component_t *components,
+                          uint8_t max_components,
+                          uint8_t min_component_size);
 
 #endif
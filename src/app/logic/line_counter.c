@@ -0,0 +1,169 @@
+#include "line_counter.h"
+
+#include <string.h>
+
+#define LINE_PAST_ENDS 2
+
+/* 1 right of the line and clear of it, -1 left, 0 within the hysteresis, LINE_PAST_ENDS beyond a or b */
+static int8_t line_side(const line_config_t *line, int row, int col)
+{
+    int64_t d_row = (int64_t)line->row_b - line->row_a;
+    int64_t d_col = (int64_t)line->col_b - line->col_a;
+    int64_t p_row = (int64_t)row - line->row_a;
+    int64_t p_col = (int64_t)col - line->col_a;
+    int64_t length_sq = (d_row * d_row) + (d_col * d_col);
+    int64_t along = (p_row * d_row) + (p_col * d_col);
+    /* Distance from the line times its length, positive to the right of a->b (rows grow downwards) */
+    int64_t across = (p_row * d_col) - (p_col * d_row);
+    int64_t hysteresis = line->hysteresis;
+
+    if ((along < 0) || (along > length_sq))
+    {
+        return LINE_PAST_ENDS;
+    }
+    if ((across * across) <= (hysteresis * hysteresis * length_sq))
+    {
+        return 0;
+    }
+    return (across > 0) ? 1 : -1;
+}
+
+static void line_forget_line(line_counter_t *counter, uint8_t index)
+{
+    for (uint8_t i = 0U; i < counter->track_count; i++)
+    {
+        counter->tracks[i].side[index] = 0;
+    }
+}
+
+void line_counter_init(line_counter_t *counter)
+{
+    memset(counter, 0, sizeof(*counter));
+}
+
+void line_counter_reset(line_counter_t *counter)
+{
+    memset(counter->in, 0, sizeof(counter->in));
+    memset(counter->out, 0, sizeof(counter->out));
+    memset(counter->tracks, 0, sizeof(counter->tracks));
+    counter->track_count = 0U;
+}
+
+bool line_counter_set(line_counter_t *counter, uint8_t index, const line_config_t *line)
+{
+    if ((line == NULL) || (index >= TOF_MAX_LINES) || (index > counter->line_count) ||
+        ((line->row_a == line->row_b) && (line->col_a == line->col_b)))
+    {
+        return false;
+    }
+
+    counter->lines[index] = *line;
+    counter->in[index] = 0U;
+    counter->out[index] = 0U;
+    line_forget_line(counter, index);
+    if (index == counter->line_count)
+    {
+        counter->line_count++;
+    }
+    return true;
+}
+
+void line_counter_remove(line_counter_t *counter, uint8_t index)
+{
+    if (index == LINE_ALL)
+    {
+        line_counter_init(counter);
+        return;
+    }
+    if (index >= counter->line_count)
+    {
+        return;
+    }
+
+    for (uint8_t l = index; (l + 1U) < counter->line_count; l++)
+    {
+        counter->lines[l] = counter->lines[l + 1U];
+        counter->in[l] = counter->in[l + 1U];
+        counter->out[l] = counter->out[l + 1U];
+        for (uint8_t i = 0U; i < counter->track_count; i++)
+        {
+            counter->tracks[i].side[l] = counter->tracks[i].side[l + 1U];
+        }
+    }
+    counter->line_count--;
+    line_forget_line(counter, counter->line_count);
+}
+
+void line_counter_update(line_counter_t *counter, const track_state_t *tracks)
+{
+    line_track_t seen[TOF_MAX_TRACKS];
+    uint8_t seen_count = 0U;
+
+    if (counter->line_count == 0U)
+    {
+        return;
+    }
+
+    for (uint8_t t = 0U; (t < tracks->track_count) && (seen_count < TOF_MAX_TRACKS); t++)
+    {
+        const tof_track_t *track = &tracks->tracks[t];
+        line_track_t *entry = &seen[seen_count++];
+
+        track_carry_entry(entry, counter->tracks, counter->track_count, sizeof(line_track_t), track->id);
+        if (!track_is_located(track))
+        {
+            continue;
+        }
+
+        for (uint8_t l = 0U; l < counter->line_count; l++)
+        {
+            int8_t side = line_side(&counter->lines[l], track->position_row, track->position_col);
+
+            /* Past the ends the track starts over, within the hysteresis it keeps its side */
+            if (side == LINE_PAST_ENDS)
+            {
+                entry->side[l] = 0;
+                continue;
+            }
+            if (side == 0)
+            {
+                continue;
+            }
+
+            if (entry->side[l] == -side)
+            {
+                if (side > 0)
+                {
+                    counter->in[l]++;
+                }
+                else
+                {
+                    counter->out[l]++;
+                }
+            }
+            entry->side[l] = side;
+        }
+    }
+
+    memcpy(counter->tracks, seen, (size_t)seen_count * sizeof(line_track_t));
+    counter->track_count = seen_count;
+}
+
+void line_counter_apply(const line_counter_t *counter, tof_people_data_t *people)
+{
+    uint16_t in = 0U;
+    uint16_t out = 0U;
+
+    if (counter->line_count == 0U)
+    {
+        return;
+    }
+
+    for (uint8_t l = 0U; l < counter->line_count; l++)
+    {
+        in = (uint16_t)(in + counter->in[l]);
+        out = (uint16_t)(out + counter->out[l]);
+    }
+    people->people_in = in;
+    people->people_out = out;
+}
@@ -0,0 +1,59 @@
+#ifndef LINE_COUNTER_H
+#define LINE_COUNTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_types.h"
+#include "tracking.h"
+
+/*
+ * Directional counting on virtual lines across the grid. A line runs from a
+ * to b, in 1/TOF_SUBZONE zone of the stitched grid; a track crossing it to
+ * the right of a->b counts in, to the left out, so a line from (4, 0) to
+ * (4, 8) counts people walking down the rows in. The crossing counts once
+ * the track is further than hysteresis from the line on the far side, having
+ * been as far on the near side, between the ends of the line: someone
+ * standing on it or turning back does not count.
+ */
+#define LINE_DEFAULT_HYSTERESIS (TOF_SUBZONE / 4)
+/* line_counter_remove() of every line */
+#define LINE_ALL 0xFFU
+
+typedef struct {
+    int16_t row_a;
+    int16_t col_a;
+    int16_t row_b;
+    int16_t col_b;
+    uint16_t hysteresis;
+} line_config_t;
+
+/* The side of each line a track was last seen clear of: 0 none yet, 1 right, -1 left */
+typedef struct {
+    int id;
+    int8_t side[TOF_MAX_LINES];
+} line_track_t;
+
+typedef struct {
+    line_config_t lines[TOF_MAX_LINES];
+    uint8_t line_count;
+    uint16_t in[TOF_MAX_LINES];
+    uint16_t out[TOF_MAX_LINES];
+    line_track_t tracks[TOF_MAX_TRACKS];
+    uint8_t track_count;
+} line_counter_t;
+
+/* Drops every line */
+void line_counter_init(line_counter_t *counter);
+/* Restarts the counts, keeps the lines */
+void line_counter_reset(line_counter_t *counter);
+/* Replaces line index, or adds it at index == line_count; its counts restart. False for a line of no length. */
+bool line_counter_set(line_counter_t *counter, uint8_t index, const line_config_t *line);
+/* The lines after index move down one; LINE_ALL drops them all */
+void line_counter_remove(line_counter_t *counter, uint8_t index);
+/* Counts the crossings of the tracks matched this frame, after track_update() */
+void line_counter_update(line_counter_t *counter, const track_state_t *tracks);
+/* With lines set, people in and out are their totals instead of the tracks counted in and timed out */
+void line_counter_apply(const line_counter_t *counter, tof_people_data_t *people);
+
+#endif
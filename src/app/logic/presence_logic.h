@@ -4,12 +4,22 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "tof_types.h"
+
 typedef struct {
     uint8_t raw_people_count;
     uint8_t smoothed_people_count;
 } presence_state_t;
 
-void presence_logic_reset(void);
-void presence_logic_update(uint8_t raw_people_count, presence_state_t *state);
+typedef struct {
+    uint8_t history[TOF_HISTORY_SIZE];
+    uint8_t history_idx;
+    uint8_t history_count;
+    uint8_t enter_counter;
+    uint8_t exit_counter;
+} presence_logic_state_t;
+
+void presence_logic_reset(presence_logic_state_t *logic);
+void presence_logic_update(presence_logic_state_t *logic, uint8_t raw_people_count, presence_state_t *state);
 
 #endif
@@ -0,0 +1,66 @@
+#include "quality.h"
+
+#include <stddef.h>
+
+#include "tof_mask.h"
+
+#if TOF_QUALITY
+
+void quality_zone(uint16_t sigma_mm, uint32_t signal_per_spad, uint8_t *confidence, uint16_t *margin_mm)
+{
+    uint32_t excess_mm = (sigma_mm > QUALITY_SIGMA_NOMINAL_MM) ? (uint32_t)(sigma_mm - QUALITY_SIGMA_NOMINAL_MM) : 0U;
+    uint32_t sigma_conf = 0U;
+    uint32_t signal_conf = 255U;
+    uint32_t margin = excess_mm * QUALITY_MARGIN_GAIN;
+
+    if (excess_mm < (QUALITY_SIGMA_MAX_MM - QUALITY_SIGMA_NOMINAL_MM))
+    {
+        sigma_conf = 255U - ((excess_mm * 255U) / (QUALITY_SIGMA_MAX_MM - QUALITY_SIGMA_NOMINAL_MM));
+    }
+    if ((signal_per_spad > 0U) && (signal_per_spad < QUALITY_SIGNAL_FULL_KCPS))
+    {
+        signal_conf = (signal_per_spad * 255U) / QUALITY_SIGNAL_FULL_KCPS;
+    }
+
+    *confidence = (uint8_t)((sigma_conf < signal_conf) ? sigma_conf : signal_conf);
+    /* The foreground filter adds it to the threshold in signed halfwords */
+    *margin_mm = (margin > INT16_MAX) ? INT16_MAX : (uint16_t)margin;
+}
+
+uint8_t quality_filter_components(const tof_frame_t *frame, tof_component_t *components, uint8_t count)
+{
+    uint8_t kept = 0U;
+
+    if ((frame == NULL) || (components == NULL))
+    {
+        return 0U;
+    }
+
+    for (uint8_t c = 0U; c < count; c++)
+    {
+        tof_mask_t zones = components[c].mask;
+        uint32_t sum = 0U;
+        uint32_t size = 0U;
+
+        while (!tof_mask_is_empty(zones))
+        {
+            uint16_t zone = tof_mask_pop_first(&zones);
+
+            sum += frame->confidence[zone / TOF_COLS][zone % TOF_COLS];
+            size++;
+        }
+        components[c].confidence = (uint8_t)((size > 0U) ? (sum / size) : 0U);
+        if (components[c].confidence < QUALITY_USABLE)
+        {
+            continue;
+        }
+        if (kept != c)
+        {
+            components[kept] = components[c];
+        }
+        kept++;
+    }
+    return kept;
+}
+
+#endif
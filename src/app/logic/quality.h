@@ -0,0 +1,32 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <stdint.h>
+
+#include "tof_types.h"
+
+/*
+ * Zone quality map. With every distance the sensor reports its spread
+ * (range_sigma_mm) and the return it was measured from (signal_per_spad,
+ * kcps per SPAD): sunlight pushes the first up, dark or distant targets the
+ * second down. A zone's confidence runs from 255 for a clean return down to
+ * 0 for an unusable one, and the spread beyond the nominal widens its
+ * foreground threshold for the frame. A signal rate of 0 cannot come with a
+ * valid target, it means the field was not recorded (synthetic frames, logs
+ * of a build without it) and costs no confidence.
+ */
+#define QUALITY_SIGMA_NOMINAL_MM 15U
+#define QUALITY_SIGMA_MAX_MM 75U
+#define QUALITY_MARGIN_GAIN 2U
+#define QUALITY_SIGNAL_FULL_KCPS 4U
+/* Below this a zone stays out of the background statistics and a component is dropped */
+#define QUALITY_USABLE 64U
+
+#if TOF_QUALITY
+void quality_zone(uint16_t sigma_mm, uint32_t signal_per_spad, uint8_t *confidence, uint16_t *margin_mm);
+/* Sets the mean confidence of every component and drops the ones below QUALITY_USABLE, keeping the order.
+ * Returns the number left. */
+uint8_t quality_filter_components(const tof_frame_t *frame, tof_component_t *components, uint8_t count);
+#endif
+
+#endif
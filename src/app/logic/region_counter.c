@@ -0,0 +1,211 @@
+#include "region_counter.h"
+
+#include <string.h>
+
+/* Even-odd rule: a point on the top or left edge is inside, on the bottom or right edge outside */
+static bool region_contains(const region_config_t *region, int row, int col)
+{
+    bool inside = false;
+
+    for (uint8_t i = 0U, j = (uint8_t)(region->vertex_count - 1U); i < region->vertex_count; j = i++)
+    {
+        int64_t row_i = region->row[i];
+        int64_t row_j = region->row[j];
+        int64_t col_i = region->col[i];
+        int64_t col_j = region->col[j];
+
+        if ((row_i > row) != (row_j > row))
+        {
+            /* Whether the edge crosses the row to the right of col, without dividing by row_j - row_i */
+            int64_t lhs = ((int64_t)col - col_i) * (row_j - row_i);
+            int64_t rhs = ((int64_t)row - row_i) * (col_j - col_i);
+
+            if ((row_j > row_i) ? (lhs < rhs) : (lhs > rhs))
+            {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+static void region_file_dwell(region_stats_t *stats, uint16_t dwell_frames)
+{
+    uint8_t bin = 0U;
+
+    while (((bin + 1U) < REGION_DWELL_BINS) && (dwell_frames >= (REGION_DWELL_FIRST_FRAMES << bin)))
+    {
+        bin++;
+    }
+    if (stats->dwell[bin] < UINT16_MAX)
+    {
+        stats->dwell[bin]++;
+    }
+}
+
+static void region_forget_region(region_counter_t *counter, uint8_t index)
+{
+    for (uint8_t i = 0U; i < counter->track_count; i++)
+    {
+        counter->tracks[i].inside &= (uint8_t)~(1U << index);
+        counter->tracks[i].dwell_frames[index] = 0U;
+    }
+}
+
+void region_counter_init(region_counter_t *counter)
+{
+    memset(counter, 0, sizeof(*counter));
+}
+
+void region_counter_reset(region_counter_t *counter)
+{
+    memset(counter->stats, 0, sizeof(counter->stats));
+    memset(counter->tracks, 0, sizeof(counter->tracks));
+    counter->track_count = 0U;
+}
+
+bool region_counter_set(region_counter_t *counter, uint8_t index, const region_config_t *region)
+{
+    region_config_t *target;
+
+    if ((region == NULL) || (index >= TOF_MAX_REGIONS) || (index > counter->region_count) ||
+        (region->vertex_count < 2U) || (region->vertex_count > REGION_MAX_VERTICES))
+    {
+        return false;
+    }
+
+    target = &counter->regions[index];
+    if (region->vertex_count == 2U)
+    {
+        target->vertex_count = 4U;
+        target->row[0] = region->row[0];
+        target->col[0] = region->col[0];
+        target->row[1] = region->row[0];
+        target->col[1] = region->col[1];
+        target->row[2] = region->row[1];
+        target->col[2] = region->col[1];
+        target->row[3] = region->row[1];
+        target->col[3] = region->col[0];
+    }
+    else
+    {
+        *target = *region;
+    }
+    memset(&counter->stats[index], 0, sizeof(counter->stats[index]));
+    region_forget_region(counter, index);
+    if (index == counter->region_count)
+    {
+        counter->region_count++;
+    }
+    return true;
+}
+
+void region_counter_remove(region_counter_t *counter, uint8_t index)
+{
+    if (index == REGION_ALL)
+    {
+        region_counter_init(counter);
+        return;
+    }
+    if (index >= counter->region_count)
+    {
+        return;
+    }
+
+    for (uint8_t r = index; (r + 1U) < counter->region_count; r++)
+    {
+        counter->regions[r] = counter->regions[r + 1U];
+        counter->stats[r] = counter->stats[r + 1U];
+    }
+    for (uint8_t i = 0U; i < counter->track_count; i++)
+    {
+        region_track_t *track = &counter->tracks[i];
+        uint8_t below = (uint8_t)(track->inside & ((1U << index) - 1U));
+
+        track->inside = (uint8_t)(below | ((track->inside >> (index + 1U)) << index));
+        for (uint8_t r = index; (r + 1U) < counter->region_count; r++)
+        {
+            track->dwell_frames[r] = track->dwell_frames[r + 1U];
+        }
+    }
+    counter->region_count--;
+    region_forget_region(counter, counter->region_count);
+}
+
+void region_counter_update(region_counter_t *counter, const track_state_t *tracks)
+{
+    region_track_t seen[TOF_MAX_TRACKS];
+    uint8_t seen_count = 0U;
+
+    if (counter->region_count == 0U)
+    {
+        return;
+    }
+
+    for (uint8_t r = 0U; r < counter->region_count; r++)
+    {
+        counter->stats[r].occupancy = 0U;
+    }
+
+    for (uint8_t t = 0U; (t < tracks->track_count) && (seen_count < TOF_MAX_TRACKS); t++)
+    {
+        const tof_track_t *track = &tracks->tracks[t];
+        region_track_t *entry = &seen[seen_count++];
+        bool located = track_is_located(track);
+
+        track_carry_entry(entry, counter->tracks, counter->track_count, sizeof(region_track_t), track->id);
+
+        for (uint8_t r = 0U; r < counter->region_count; r++)
+        {
+            uint8_t bit = (uint8_t)(1U << r);
+            bool was_inside = (entry->inside & bit) != 0U;
+            bool inside = located ? region_contains(&counter->regions[r], track->position_row, track->position_col)
+                                  : was_inside;
+
+            if (inside && !was_inside)
+            {
+                entry->inside |= bit;
+                entry->dwell_frames[r] = 0U;
+                if (counter->stats[r].entries < UINT16_MAX)
+                {
+                    counter->stats[r].entries++;
+                }
+            }
+            else if (!inside && was_inside)
+            {
+                entry->inside &= (uint8_t)~bit;
+                region_file_dwell(&counter->stats[r], entry->dwell_frames[r]);
+            }
+
+            if (inside)
+            {
+                if (entry->dwell_frames[r] < UINT16_MAX)
+                {
+                    entry->dwell_frames[r]++;
+                }
+                counter->stats[r].occupancy++;
+            }
+        }
+    }
+
+    /* Dropped tracks leave the regions they were in */
+    for (uint8_t i = 0U; i < counter->track_count; i++)
+    {
+        const region_track_t *gone = &counter->tracks[i];
+
+        if ((gone->inside == 0U) || (track_find_entry(seen, seen_count, sizeof(region_track_t), gone->id) != NULL))
+        {
+            continue;
+        }
+        for (uint8_t r = 0U; r < counter->region_count; r++)
+        {
+            if ((gone->inside & (1U << r)) != 0U)
+            {
+                region_file_dwell(&counter->stats[r], gone->dwell_frames[r]);
+            }
+        }
+    }
+
+    memcpy(counter->tracks, seen, (size_t)seen_count * sizeof(region_track_t));
+    counter->track_count = seen_count;
+}
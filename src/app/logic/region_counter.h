@@ -0,0 +1,67 @@
+#ifndef REGION_COUNTER_H
+#define REGION_COUNTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_types.h"
+#include "tracking.h"
+
+/*
+ * Occupancy and dwell time of regions of the grid. A region is a polygon of
+ * up to REGION_MAX_VERTICES vertices in 1/TOF_SUBZONE zone of the stitched
+ * grid, or a rectangle given by two opposite corners. A track is in a region
+ * while its filtered position is; one that misses a frame stays where it was
+ * last seen. Leaving, or being dropped, files the frames it spent inside in
+ * the dwell histogram: bin b holds the stays shorter than
+ * REGION_DWELL_FIRST_FRAMES << b, the last bin the longer ones.
+ */
+#define REGION_MAX_VERTICES 8U
+#define REGION_DWELL_BINS 8U
+#define REGION_DWELL_FIRST_FRAMES 8U
+#if TOF_MAX_REGIONS > 8U
+#error "region_track_t keeps one region per bit of a uint8_t"
+#endif
+/* region_counter_remove() of every region */
+#define REGION_ALL 0xFFU
+
+typedef struct {
+    uint8_t vertex_count;
+    int16_t row[REGION_MAX_VERTICES];
+    int16_t col[REGION_MAX_VERTICES];
+} region_config_t;
+
+typedef struct {
+    uint8_t occupancy;
+    uint16_t entries;
+    uint16_t dwell[REGION_DWELL_BINS];
+} region_stats_t;
+
+/* The regions a track is in, one bit each, and the frames it has spent in each */
+typedef struct {
+    int id;
+    uint8_t inside;
+    uint16_t dwell_frames[TOF_MAX_REGIONS];
+} region_track_t;
+
+typedef struct {
+    region_config_t regions[TOF_MAX_REGIONS];
+    uint8_t region_count;
+    region_stats_t stats[TOF_MAX_REGIONS];
+    region_track_t tracks[TOF_MAX_TRACKS];
+    uint8_t track_count;
+} region_counter_t;
+
+/* Drops every region */
+void region_counter_init(region_counter_t *counter);
+/* Restarts the statistics, keeps the regions */
+void region_counter_reset(region_counter_t *counter);
+/* Replaces region index, or adds it at index == region_count; its statistics restart. A region of 2 vertices is
+ * the rectangle they are opposite corners of. False for fewer than 2 or more than REGION_MAX_VERTICES. */
+bool region_counter_set(region_counter_t *counter, uint8_t index, const region_config_t *region);
+/* The regions after index move down one; REGION_ALL drops them all */
+void region_counter_remove(region_counter_t *counter, uint8_t index);
+/* Moves the tracks in and out of the regions, after track_update() */
+void region_counter_update(region_counter_t *counter, const track_state_t *tracks);
+
+#endif
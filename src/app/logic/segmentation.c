@@ -3,35 +3,12 @@
 #include <stddef.h>
 #include <string.h>
 
-#define SEG_NEIGHBOR_COUNT 8U
+#include "tof_mask.h"
 
-typedef struct
-{
-    int row;
-    int col;
-} seg_node_t;
-
-static const int8_t s_neighbor_offsets[SEG_NEIGHBOR_COUNT][2] = {
-    {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {1, 1}, {1, -1}, {-1, 1},
-};
-
-static void seg_push_if_valid(seg_node_t *stack, int *top, int row, int col, uint16_t visited[TOF_ROWS][TOF_COLS])
-{
-    if (*top >= (int)(TOF_ROWS * TOF_COLS))
-    {
-        return;
-    }
-
-    if ((row >= 0) && (row < (int)TOF_ROWS) && (col >= 0) && (col < (int)TOF_COLS) && (visited[row][col] == 0U))
-    {
-        visited[row][col] = 1U;
-        stack[*top].row = row;
-        stack[*top].col = col;
-        (*top)++;
-    }
-}
+#define SEG_UF_DROPPED ((tof_label_t)~(tof_label_t)0U)
+#define SEG_NO_DISTANCE_MM 4000U
 
-static void seg_init_component(tof_component_t *comp, uint8_t label, int row, int col)
+static void seg_init_component(tof_component_t *comp, tof_label_t label, int row, int col)
 {
     comp->label = label;
     comp->size = 0U;
@@ -39,16 +16,33 @@ static void seg_init_component(tof_component_t *comp, uint8_t label, int row, in
     comp->box.y1 = row;
     comp->box.x2 = col;
     comp->box.y2 = row;
-    comp->min_distance_mm = 4000U;
+    comp->min_distance_mm = SEG_NO_DISTANCE_MM;
     comp->max_distance_mm = 0U;
     comp->second_max_distance_mm = 0U;
+    comp->mask = tof_mask_none();
 }
 
-static void seg_update_component(tof_component_t *comp, const uint16_t frame_mm[TOF_ROWS][TOF_COLS], int row, int col)
+static void seg_update_distance(tof_component_t *comp, uint16_t value)
 {
-    uint16_t value = frame_mm[row][col];
+    if (value < comp->min_distance_mm)
+    {
+        comp->min_distance_mm = value;
+    }
+    if (value > comp->max_distance_mm)
+    {
+        comp->second_max_distance_mm = comp->max_distance_mm;
+        comp->max_distance_mm = value;
+    }
+    else if ((value > comp->second_max_distance_mm) && (value < comp->max_distance_mm))
+    {
+        comp->second_max_distance_mm = value;
+    }
+}
 
+static void seg_update_component(tof_component_t *comp, int row, int col, uint16_t value)
+{
     comp->size++;
+    tof_mask_set(&comp->mask, (uint8_t)row, (uint8_t)col);
     if (col < comp->box.x1)
     {
         comp->box.x1 = col;
@@ -66,95 +60,261 @@ static void seg_update_component(tof_component_t *comp, const uint16_t frame_mm[
         comp->box.y2 = row;
     }
 
-    if (value < comp->min_distance_mm)
+    seg_update_distance(comp, value);
+}
+
+/*
+ * Components are peeled off the mask lowest bit first, i.e. in raster order
+ * of their first zone. Label numbers are kept from the earlier
+ * depth-first labeller, which consumed one number per seed and re-seeded every
+ * zone of a rejected component after clearing it: a component's label is the
+ * number of accepted components before it plus the rejected zones that
+ * precede its first zone, plus one.
+ */
+static uint8_t seg_label_bitboard(tof_mask_t mask, const uint16_t frame_mm[TOF_ROWS][TOF_COLS],
+                                  tof_label_t labels[TOF_ROWS][TOF_COLS], tof_component_t *components,
+                                  uint8_t max_components, uint8_t min_component_size)
+{
+    tof_mask_t rejected = tof_mask_none();
+    uint8_t component_count = 0U;
+
+    while (!tof_mask_is_empty(mask) && (component_count < max_components))
     {
-        comp->min_distance_mm = value;
+        uint16_t seed = tof_mask_first(mask);
+        tof_mask_t component = tof_mask_flood8(mask, tof_mask_zone_bit(seed));
+        tof_component_t *comp = &components[component_count];
+        tof_label_t label;
+
+        mask = tof_mask_andnot(mask, component);
+        if (tof_mask_count(component) < min_component_size)
+        {
+            rejected = tof_mask_or(rejected, component);
+            continue;
+        }
+
+        label = (tof_label_t)(component_count + tof_mask_count(tof_mask_and(rejected, tof_mask_below(seed))) + 1U);
+        seg_init_component(comp, label, seed / TOF_COLS, seed % TOF_COLS);
+        comp->size = tof_mask_count(component);
+        comp->box = tof_mask_bbox(component);
+        comp->mask = component;
+        while (!tof_mask_is_empty(component))
+        {
+            uint16_t zone = tof_mask_pop_first(&component);
+            uint8_t row = (uint8_t)(zone / TOF_COLS);
+            uint8_t col = (uint8_t)(zone % TOF_COLS);
+
+            labels[row][col] = label;
+            seg_update_distance(comp, (frame_mm != NULL) ? frame_mm[row][col] : 1U);
+        }
+        component_count++;
     }
-    if (value > comp->max_distance_mm)
+
+    return component_count;
+}
+
+void seg_clear_labels(tof_label_t labels[TOF_ROWS][TOF_COLS])
+{
+    memset(labels, 0, sizeof(tof_label_t) * TOF_ROWS * TOF_COLS);
+}
+
+uint8_t seg_label_components(const uint16_t frame_mm[TOF_ROWS][TOF_COLS], tof_label_t labels[TOF_ROWS][TOF_COLS],
+                             tof_component_t *components, uint8_t max_components, uint8_t min_component_size)
+{
+    tof_mask_t mask = tof_mask_none();
+
+    /* Zones that already carry a label are neither seeds nor part of a new component */
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
     {
-        comp->second_max_distance_mm = comp->max_distance_mm;
-        comp->max_distance_mm = value;
+        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        {
+            if ((frame_mm[row][col] != 0U) && (labels[row][col] == 0U))
+            {
+                tof_mask_set(&mask, row, col);
+            }
+        }
     }
-    else if ((value > comp->second_max_distance_mm) && (value < comp->max_distance_mm))
+
+    return seg_label_bitboard(mask, frame_mm, labels, components, max_components, min_component_size);
+}
+
+uint8_t seg_label_mask(tof_mask_t mask, tof_label_t labels[TOF_ROWS][TOF_COLS], tof_component_t *components,
+                       uint8_t max_components, uint8_t min_component_size)
+{
+    return seg_label_bitboard(tof_mask_and(mask, tof_mask_all()), NULL, labels, components, max_components,
+                              min_component_size);
+}
+
+static tof_label_t seg_uf_find(seg_uf_t *uf, tof_label_t label)
+{
+    while (uf->parent[label] != label)
     {
-        comp->second_max_distance_mm = value;
+        uf->parent[label] = uf->parent[uf->parent[label]];
+        label = uf->parent[label];
     }
+    return label;
 }
 
-void seg_clear_labels(uint8_t labels[TOF_ROWS][TOF_COLS])
+/* max/second_max keep the largest distinct values, as seg_update_component() does */
+static void seg_uf_merge_stats(tof_component_t *dst, const tof_component_t *src)
 {
-    memset(labels, 0, sizeof(uint8_t) * TOF_ROWS * TOF_COLS);
+    uint16_t max_mm;
+    uint16_t second_mm;
+
+    if (dst->max_distance_mm == src->max_distance_mm)
+    {
+        max_mm = dst->max_distance_mm;
+        second_mm = (dst->second_max_distance_mm > src->second_max_distance_mm) ? dst->second_max_distance_mm
+                                                                                : src->second_max_distance_mm;
+    }
+    else if (dst->max_distance_mm > src->max_distance_mm)
+    {
+        max_mm = dst->max_distance_mm;
+        second_mm = (dst->second_max_distance_mm > src->max_distance_mm) ? dst->second_max_distance_mm
+                                                                         : src->max_distance_mm;
+    }
+    else
+    {
+        max_mm = src->max_distance_mm;
+        second_mm = (src->second_max_distance_mm > dst->max_distance_mm) ? src->second_max_distance_mm
+                                                                         : dst->max_distance_mm;
+    }
+
+    dst->size = (uint16_t)(dst->size + src->size);
+    dst->mask = tof_mask_or(dst->mask, src->mask);
+    dst->box.x1 = (src->box.x1 < dst->box.x1) ? src->box.x1 : dst->box.x1;
+    dst->box.y1 = (src->box.y1 < dst->box.y1) ? src->box.y1 : dst->box.y1;
+    dst->box.x2 = (src->box.x2 > dst->box.x2) ? src->box.x2 : dst->box.x2;
+    dst->box.y2 = (src->box.y2 > dst->box.y2) ? src->box.y2 : dst->box.y2;
+    dst->min_distance_mm = (src->min_distance_mm < dst->min_distance_mm) ? src->min_distance_mm : dst->min_distance_mm;
+    dst->max_distance_mm = max_mm;
+    dst->second_max_distance_mm = second_mm;
 }
 
-uint8_t seg_label_components(const uint16_t frame_mm[TOF_ROWS][TOF_COLS], uint8_t labels[TOF_ROWS][TOF_COLS],
-                             tof_component_t *components, uint8_t max_components, uint8_t min_component_size)
+/* The smaller label always wins, so a root is the component's first pixel in raster order */
+static tof_label_t seg_uf_union(seg_uf_t *uf, tof_label_t a, tof_label_t b)
 {
-    uint8_t current_label = 0U;
-    uint8_t component_count = 0U;
-    uint16_t visited[TOF_ROWS][TOF_COLS] = {0};
-    seg_node_t stack[TOF_ROWS * TOF_COLS];
+    a = seg_uf_find(uf, a);
+    b = seg_uf_find(uf, b);
+    if (a == b)
+    {
+        return a;
+    }
+    if (b < a)
+    {
+        tof_label_t tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    uf->parent[b] = a;
+    seg_uf_merge_stats(&uf->stats[a], &uf->stats[b]);
+    return a;
+}
+
+void seg_uf_begin(seg_uf_t *uf, tof_label_t labels[TOF_ROWS][TOF_COLS])
+{
+    uf->label_count = 0U;
+    seg_clear_labels(labels);
+}
+
+void seg_uf_add_pixel(seg_uf_t *uf, tof_label_t labels[TOF_ROWS][TOF_COLS], uint8_t row, uint8_t col,
+                      uint16_t value_mm)
+{
+    tof_label_t label = 0U;
+    tof_label_t left = 0U;
+    tof_label_t up_right = 0U;
 
-    for (int row = 0; row < (int)TOF_ROWS; row++)
+    if (value_mm == 0U)
     {
-        for (int col = 0; col < (int)TOF_COLS; col++)
+        return;
+    }
+
+    /* N touches W, NW and NE, so it alone decides; otherwise W/NW (which touch
+     * each other) may still have to be joined with NE. */
+    if (row > 0U)
+    {
+        label = labels[row - 1U][col];
+        if ((label == 0U) && ((col + 1U) < TOF_COLS))
         {
-            if ((frame_mm[row][col] == 0U) || (labels[row][col] != 0U))
-            {
-                continue;
-            }
-            if (component_count >= max_components)
-            {
-                return component_count;
-            }
+            up_right = labels[row - 1U][col + 1U];
+        }
+    }
+    if ((label == 0U) && (col > 0U))
+    {
+        left = labels[row][col - 1U];
+        if ((left == 0U) && (row > 0U))
+        {
+            left = labels[row - 1U][col - 1U];
+        }
+    }
 
-            current_label++;
-            seg_init_component(&components[component_count], current_label, row, col);
+    if (label != 0U)
+    {
+        label = seg_uf_find(uf, label);
+    }
+    else if ((left != 0U) && (up_right != 0U))
+    {
+        label = seg_uf_union(uf, left, up_right);
+    }
+    else if ((left != 0U) || (up_right != 0U))
+    {
+        label = seg_uf_find(uf, (left != 0U) ? left : up_right);
+    }
+    else
+    {
+        label = ++uf->label_count;
+        uf->parent[label] = label;
+        seg_init_component(&uf->stats[label], label, row, col);
+    }
 
-            int top = 0;
-            stack[top].row = row;
-            stack[top].col = col;
-            top++;
+    labels[row][col] = label;
+    seg_update_component(&uf->stats[label], (int)row, (int)col, value_mm);
+}
 
-            while (top > 0)
-            {
-                top--;
-                int cr = stack[top].row;
-                int cc = stack[top].col;
+/* Final numbering matches seg_label_components(): one number per earlier
+ * accepted component plus one per rejected zone ahead of the first zone. */
+uint8_t seg_uf_finish(seg_uf_t *uf, tof_label_t labels[TOF_ROWS][TOF_COLS], tof_component_t *components,
+                      uint8_t max_components, uint8_t min_component_size)
+{
+    tof_label_t final_label[SEG_UF_MAX_LABELS + 1U] = {0};
+    tof_label_t current_label = 0U;
+    uint8_t component_count = 0U;
 
-                if ((cr < 0) || (cr >= (int)TOF_ROWS) || (cc < 0) || (cc >= (int)TOF_COLS) ||
-                    (frame_mm[cr][cc] == 0U) || (labels[cr][cc] != 0U))
-                {
-                    continue;
-                }
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        for (uint8_t col = 0U; col < TOF_COLS; col++)
+        {
+            tof_label_t root;
 
-                visited[cr][cc] = 1U;
-                labels[cr][cc] = current_label;
-                seg_update_component(&components[component_count], frame_mm, cr, cc);
-                for (uint8_t i = 0; i < SEG_NEIGHBOR_COUNT; i++)
-                {
-                    int nr = cr + s_neighbor_offsets[i][0];
-                    int nc = cc + s_neighbor_offsets[i][1];
-                    seg_push_if_valid(stack, &top, nr, nc, visited);
-                }
+            if (labels[row][col] == 0U)
+            {
+                continue;
             }
 
-            if (components[component_count].size >= min_component_size)
+            root = seg_uf_find(uf, labels[row][col]);
+            if (uf->stats[root].size < min_component_size)
             {
-                component_count++;
+                current_label++;
+                labels[row][col] = 0U;
+                continue;
             }
-            else
+
+            if (final_label[root] == 0U)
             {
-                for (int i = 0; i < (int)TOF_ROWS; i++)
+                if (component_count < max_components)
+                {
+                    current_label++;
+                    final_label[root] = current_label;
+                    components[component_count] = uf->stats[root];
+                    components[component_count].label = current_label;
+                    component_count++;
+                }
+                else
                 {
-                    for (int j = 0; j < (int)TOF_COLS; j++)
-                    {
-                        if (labels[i][j] == current_label)
-                        {
-                            labels[i][j] = 0U;
-                        }
-                    }
+                    final_label[root] = SEG_UF_DROPPED;
                 }
             }
+            labels[row][col] = (final_label[root] == SEG_UF_DROPPED) ? 0U : final_label[root];
         }
     }
 
@@ -5,11 +5,42 @@
 
 #include "tof_types.h"
 
-void seg_clear_labels(uint8_t labels[TOF_ROWS][TOF_COLS]);
+/* With 8-connectivity a new provisional label needs a background pixel to its
+ * left, so a row can open at most every other column. */
+#define SEG_UF_MAX_LABELS (TOF_ROWS * ((TOF_COLS + 1U) / 2U))
+
+/* Two-scan union-find labelling. Pixels are fed in raster order while the
+ * frame is being produced; component statistics are merged as labels are
+ * unified and seg_uf_finish() resolves the final labels in a single sweep.
+ * The result matches seg_label_components() on a cleared label map. */
+typedef struct {
+    tof_label_t parent[SEG_UF_MAX_LABELS + 1U];
+    tof_component_t stats[SEG_UF_MAX_LABELS + 1U];
+    tof_label_t label_count;
+} seg_uf_t;
+
+void seg_clear_labels(tof_label_t labels[TOF_ROWS][TOF_COLS]);
 uint8_t seg_label_components(const uint16_t frame_mm[TOF_ROWS][TOF_COLS],
-                             uint8_t labels[TOF_ROWS][TOF_COLS],
+                             tof_label_t labels[TOF_ROWS][TOF_COLS],
                              tof_component_t *components,
                              uint8_t max_components,
                              uint8_t min_component_size);
+uint8_t seg_label_mask(tof_mask_t mask,
+                       tof_label_t labels[TOF_ROWS][TOF_COLS],
+                       tof_component_t *components,
+                       uint8_t max_components,
+                       uint8_t min_component_size);
+
+void seg_uf_begin(seg_uf_t *uf, tof_label_t labels[TOF_ROWS][TOF_COLS]);
+void seg_uf_add_pixel(seg_uf_t *uf,
+                      tof_label_t labels[TOF_ROWS][TOF_COLS],
+                      uint8_t row,
+                      uint8_t col,
+                      uint16_t value_mm);
+uint8_t seg_uf_finish(seg_uf_t *uf,
+                      tof_label_t labels[TOF_ROWS][TOF_COLS],
+                      tof_component_t *components,
+                      uint8_t max_components,
+                      uint8_t min_component_size);
 
 #endif
@@ -0,0 +1,69 @@
+#include "tof_grid.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "quality.h"
+
+#if TOF_QUALITY && (defined(VL53L5CX_DISABLE_RANGE_SIGMA_MM) || defined(VL53L5CX_DISABLE_SIGNAL_PER_SPAD))
+#error "TOF_QUALITY needs range_sigma_mm and signal_per_spad, see platform.h"
+#endif
+
+#define TOF_GRID_NO_TARGET_STATUS 255U
+
+void tof_grid_clear(tof_frame_t *frame)
+{
+    if (frame == NULL)
+    {
+        return;
+    }
+
+    memset(frame->distance_mm, 0, sizeof(frame->distance_mm));
+    memset(frame->target_status, TOF_GRID_NO_TARGET_STATUS, sizeof(frame->target_status));
+#if TOF_QUALITY
+    memset(frame->confidence, 0, sizeof(frame->confidence));
+    memset(frame->margin_mm, 0, sizeof(frame->margin_mm));
+#endif
+}
+
+bool tof_grid_load_tile(tof_frame_t *frame, uint8_t tile, const VL53L5CX_ResultsData *results)
+{
+    uint8_t row0;
+    uint8_t col0;
+
+    if ((frame == NULL) || (results == NULL) || (tile >= TOF_TILES))
+    {
+        return false;
+    }
+
+    row0 = (uint8_t)((tile / TOF_TILES_X) * TOF_SENSOR_ROWS);
+    col0 = (uint8_t)((tile % TOF_TILES_X) * TOF_SENSOR_COLS);
+    for (uint8_t row = 0U; row < TOF_SENSOR_ROWS; row++)
+    {
+        uint16_t zone = (uint16_t)(row * TOF_SENSOR_COLS);
+
+#if VL53L5CX_NB_TARGET_PER_ZONE == 1
+        /* Sensor rows are contiguous: distances keep their bit pattern, negative ones fail the range checks */
+        memcpy(&frame->distance_mm[row0 + row][col0], &results->distance_mm[zone], TOF_SENSOR_COLS * sizeof(uint16_t));
+        memcpy(&frame->target_status[row0 + row][col0], &results->target_status[zone], TOF_SENSOR_COLS);
+#else
+        for (uint8_t col = 0U; col < TOF_SENSOR_COLS; col++)
+        {
+            uint16_t target_idx = (uint16_t)((zone + col) * VL53L5CX_NB_TARGET_PER_ZONE);
+
+            frame->distance_mm[row0 + row][col0 + col] = (uint16_t)results->distance_mm[target_idx];
+            frame->target_status[row0 + row][col0 + col] = results->target_status[target_idx];
+        }
+#endif
+#if TOF_QUALITY
+        for (uint8_t col = 0U; col < TOF_SENSOR_COLS; col++)
+        {
+            uint16_t target_idx = (uint16_t)((zone + col) * VL53L5CX_NB_TARGET_PER_ZONE);
+
+            quality_zone(results->range_sigma_mm[target_idx], results->signal_per_spad[target_idx],
+                         &frame->confidence[row0 + row][col0 + col], &frame->margin_mm[row0 + row][col0 + col]);
+        }
+#endif
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef TOF_GRID_H
+#define TOF_GRID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_types.h"
+#include "vl53l5cx_api.h"
+
+/*
+ * Sensor tiles are numbered row-major: tile t covers rows
+ * (t / TOF_TILES_X) * TOF_SENSOR_ROWS and columns (t % TOF_TILES_X) *
+ * TOF_SENSOR_COLS onwards. Zone z of a sensor lands at row z / TOF_SENSOR_COLS
+ * and column z % TOF_SENSOR_COLS of its tile, as the sensor reports it.
+ */
+
+void tof_grid_clear(tof_frame_t *frame);
+bool tof_grid_load_tile(tof_frame_t *frame, uint8_t tile, const VL53L5CX_ResultsData *results);
+
+#endif
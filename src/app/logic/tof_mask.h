@@ -0,0 +1,271 @@
+#ifndef TOF_MASK_H
+#define TOF_MASK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_types.h"
+
+/*
+ * Bitboard view of a zone grid: zone (row, col) is bit row * TOF_COLS + col,
+ * so bit order is raster order and the lowest set bit is the first zone a
+ * row-major scan would reach. Grids above 64 zones span TOF_MASK_WORDS words,
+ * least significant word first; on an 8x8 grid every loop below is a single
+ * iteration and the helpers reduce to plain uint64_t operations.
+ */
+
+#define TOF_MASK_ZONES TOF_ZONES
+#define TOF_MASK_WORD_BITS 64U
+
+#if TOF_COLS > 32U
+#error "tof_mask_bbox() gathers a row in a uint32_t, TOF_COLS must not exceed 32"
+#endif
+
+static inline tof_mask_t tof_mask_none(void)
+{
+    tof_mask_t mask = {{0U}};
+
+    return mask;
+}
+
+static inline tof_mask_t tof_mask_all(void)
+{
+    tof_mask_t mask;
+
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        uint16_t bits = TOF_MASK_ZONES - (i * TOF_MASK_WORD_BITS);
+
+        mask.w[i] = (bits >= TOF_MASK_WORD_BITS) ? UINT64_MAX : (UINT64_MAX >> (TOF_MASK_WORD_BITS - bits));
+    }
+    return mask;
+}
+
+static inline tof_mask_t tof_mask_zone_bit(uint16_t zone)
+{
+    tof_mask_t mask = tof_mask_none();
+
+    mask.w[zone / TOF_MASK_WORD_BITS] = (uint64_t)1U << (zone % TOF_MASK_WORD_BITS);
+    return mask;
+}
+
+static inline tof_mask_t tof_mask_bit(uint8_t row, uint8_t col)
+{
+    return tof_mask_zone_bit((uint16_t)((row * TOF_COLS) + col));
+}
+
+static inline void tof_mask_set(tof_mask_t *mask, uint8_t row, uint8_t col)
+{
+    uint16_t zone = (uint16_t)((row * TOF_COLS) + col);
+
+    mask->w[zone / TOF_MASK_WORD_BITS] |= (uint64_t)1U << (zone % TOF_MASK_WORD_BITS);
+}
+
+static inline bool tof_mask_test(tof_mask_t mask, uint8_t row, uint8_t col)
+{
+    uint16_t zone = (uint16_t)((row * TOF_COLS) + col);
+
+    return ((mask.w[zone / TOF_MASK_WORD_BITS] >> (zone % TOF_MASK_WORD_BITS)) & 1U) != 0U;
+}
+
+static inline bool tof_mask_is_empty(tof_mask_t mask)
+{
+    uint64_t any = 0U;
+
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        any |= mask.w[i];
+    }
+    return any == 0U;
+}
+
+static inline bool tof_mask_equal(tof_mask_t a, tof_mask_t b)
+{
+    uint64_t diff = 0U;
+
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        diff |= a.w[i] ^ b.w[i];
+    }
+    return diff == 0U;
+}
+
+static inline tof_mask_t tof_mask_and(tof_mask_t a, tof_mask_t b)
+{
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        a.w[i] &= b.w[i];
+    }
+    return a;
+}
+
+static inline tof_mask_t tof_mask_or(tof_mask_t a, tof_mask_t b)
+{
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        a.w[i] |= b.w[i];
+    }
+    return a;
+}
+
+/* a & ~b */
+static inline tof_mask_t tof_mask_andnot(tof_mask_t a, tof_mask_t b)
+{
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        a.w[i] &= ~b.w[i];
+    }
+    return a;
+}
+
+/* Zones strictly before zone in raster order */
+static inline tof_mask_t tof_mask_below(uint16_t zone)
+{
+    tof_mask_t mask = tof_mask_none();
+    uint16_t word = zone / TOF_MASK_WORD_BITS;
+
+    for (uint16_t i = 0U; i < word; i++)
+    {
+        mask.w[i] = UINT64_MAX;
+    }
+    mask.w[word] = ((uint64_t)1U << (zone % TOF_MASK_WORD_BITS)) - 1U;
+    return mask;
+}
+
+static inline uint16_t tof_mask_count(tof_mask_t mask)
+{
+    uint16_t count = 0U;
+
+    for (uint8_t i = 0U; i < TOF_MASK_WORDS; i++)
+    {
+        count = (uint16_t)(count + (uint16_t)__builtin_popcountll(mask.w[i]));
+    }
+    return count;
+}
+
+/* Index of the lowest set bit; mask must not be empty */
+static inline uint16_t tof_mask_first(tof_mask_t mask)
+{
+    uint8_t i = 0U;
+
+    while ((i < (TOF_MASK_WORDS - 1U)) && (mask.w[i] == 0U))
+    {
+        i++;
+    }
+    return (uint16_t)((i * TOF_MASK_WORD_BITS) + (uint16_t)__builtin_ctzll(mask.w[i]));
+}
+
+/* Index of the highest set bit; mask must not be empty */
+static inline uint16_t tof_mask_last(tof_mask_t mask)
+{
+    uint8_t i = TOF_MASK_WORDS - 1U;
+
+    while ((i > 0U) && (mask.w[i] == 0U))
+    {
+        i--;
+    }
+    return (uint16_t)((i * TOF_MASK_WORD_BITS) + 63U - (uint16_t)__builtin_clzll(mask.w[i]));
+}
+
+/* Removes and returns the lowest set zone; mask must not be empty */
+static inline uint16_t tof_mask_pop_first(tof_mask_t *mask)
+{
+    uint16_t zone = tof_mask_first(*mask);
+
+    mask->w[zone / TOF_MASK_WORD_BITS] &= mask->w[zone / TOF_MASK_WORD_BITS] - 1U;
+    return zone;
+}
+
+/* 0 < shift < 64 */
+static inline tof_mask_t tof_mask_shift_up(tof_mask_t mask, uint8_t shift)
+{
+    for (uint8_t i = TOF_MASK_WORDS - 1U; i > 0U; i--)
+    {
+        mask.w[i] = (mask.w[i] << shift) | (mask.w[i - 1U] >> (TOF_MASK_WORD_BITS - shift));
+    }
+    mask.w[0] <<= shift;
+    return mask;
+}
+
+/* 0 < shift < 64 */
+static inline tof_mask_t tof_mask_shift_down(tof_mask_t mask, uint8_t shift)
+{
+    for (uint8_t i = 0U; i < (TOF_MASK_WORDS - 1U); i++)
+    {
+        mask.w[i] = (mask.w[i] >> shift) | (mask.w[i + 1U] << (TOF_MASK_WORD_BITS - shift));
+    }
+    mask.w[TOF_MASK_WORDS - 1U] >>= shift;
+    return mask;
+}
+
+static inline tof_mask_t tof_mask_col_pattern(uint8_t col)
+{
+    tof_mask_t pattern = tof_mask_none();
+
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        tof_mask_set(&pattern, row, col);
+    }
+    return pattern;
+}
+
+/* One step of 8-connected dilation, clipped to the grid */
+static inline tof_mask_t tof_mask_dilate8(tof_mask_t mask)
+{
+    const tof_mask_t not_first_col = tof_mask_andnot(tof_mask_all(), tof_mask_col_pattern(0U));
+    const tof_mask_t not_last_col = tof_mask_andnot(tof_mask_all(), tof_mask_col_pattern((uint8_t)(TOF_COLS - 1U)));
+    tof_mask_t row_spread = tof_mask_or(mask, tof_mask_or(tof_mask_and(tof_mask_shift_up(mask, 1U), not_first_col),
+                                                          tof_mask_and(tof_mask_shift_down(mask, 1U), not_last_col)));
+    tof_mask_t spread = tof_mask_or(row_spread, tof_mask_or(tof_mask_shift_up(row_spread, TOF_COLS),
+                                                            tof_mask_shift_down(row_spread, TOF_COLS)));
+
+    return tof_mask_and(spread, tof_mask_all());
+}
+
+/* 8-connected component of mask that contains seed */
+static inline tof_mask_t tof_mask_flood8(tof_mask_t mask, tof_mask_t seed)
+{
+    tof_mask_t component = tof_mask_and(seed, mask);
+    tof_mask_t grown;
+
+    while (!tof_mask_equal(grown = tof_mask_and(tof_mask_dilate8(component), mask), component))
+    {
+        component = grown;
+    }
+    return component;
+}
+
+/* The TOF_COLS bits of one row, bit 0 being column 0 */
+static inline uint32_t tof_mask_row_bits(tof_mask_t mask, uint8_t row)
+{
+    uint16_t first = (uint16_t)(row * TOF_COLS);
+    uint16_t word = first / TOF_MASK_WORD_BITS;
+    uint8_t shift = (uint8_t)(first % TOF_MASK_WORD_BITS);
+    uint64_t bits = mask.w[word] >> shift;
+
+    if (((shift + TOF_COLS) > TOF_MASK_WORD_BITS) && ((word + 1U) < TOF_MASK_WORDS))
+    {
+        bits |= mask.w[word + 1U] << (TOF_MASK_WORD_BITS - shift);
+    }
+    return (uint32_t)(bits & (((uint64_t)1U << TOF_COLS) - 1U));
+}
+
+/* mask must not be empty */
+static inline tof_bounding_box_t tof_mask_bbox(tof_mask_t mask)
+{
+    tof_bounding_box_t box;
+    uint32_t cols = 0U;
+
+    for (uint8_t row = 0U; row < TOF_ROWS; row++)
+    {
+        cols |= tof_mask_row_bits(mask, row);
+    }
+
+    box.y1 = tof_mask_first(mask) / TOF_COLS;
+    box.y2 = tof_mask_last(mask) / TOF_COLS;
+    box.x1 = __builtin_ctz(cols);
+    box.x2 = 31 - __builtin_clz(cols);
+    return box;
+}
+
+#endif
@@ -4,18 +4,78 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#define TOF_ROWS 8U
-#define TOF_COLS 8U
+/*
+ * Zone grid seen by the pipeline: TOF_TILES_Y x TOF_TILES_X sensors of
+ * TOF_SENSOR_ROWS x TOF_SENSOR_COLS zones each, stitched row-major into one
+ * TOF_ROWS x TOF_COLS frame. Set from CMake (TOF_SENSOR_RESOLUTION,
+ * TOF_TILES_X, TOF_TILES_Y); the defaults are a single 8x8 sensor.
+ */
+#ifndef TOF_SENSOR_ROWS
+#define TOF_SENSOR_ROWS 8U
+#endif
+#ifndef TOF_SENSOR_COLS
+#define TOF_SENSOR_COLS 8U
+#endif
+#ifndef TOF_TILES_X
+#define TOF_TILES_X 1U
+#endif
+#ifndef TOF_TILES_Y
+#define TOF_TILES_Y 1U
+#endif
+
+/* 1: weigh every zone by the sensor's own confidence in it, see quality.h */
+#ifndef TOF_QUALITY
+#define TOF_QUALITY 1
+#endif
+
+#define TOF_SENSOR_ZONES (TOF_SENSOR_ROWS * TOF_SENSOR_COLS)
+#define TOF_TILES (TOF_TILES_X * TOF_TILES_Y)
+#define TOF_ROWS (TOF_SENSOR_ROWS * TOF_TILES_Y)
+#define TOF_COLS (TOF_SENSOR_COLS * TOF_TILES_X)
+#define TOF_ZONES (TOF_ROWS * TOF_COLS)
 
 #define TOF_MAX_COMPONENTS 10U
 #define TOF_MAX_TRACKS 10U
+/* Counting lines, see line_counter.h */
+#define TOF_MAX_LINES 4U
+/* Occupancy regions, see region_counter.h */
+#define TOF_MAX_REGIONS 4U
 #define TOF_MAX_PEOPLE_COUNT 2U
 #define TOF_HISTORY_SIZE 10U
 #define TOF_NUM_CLASSES 3U
 
 #define TOF_DEPTH_THRESHOLD_MM 150U
-#define TOF_MATCH_DISTANCE_THRESHOLD 5.0f
+/* Tuned in 8x8 zones; a 4x4 zone spans twice the angle */
+#define TOF_MATCH_DISTANCE_THRESHOLD (5.0f * (float)TOF_SENSOR_COLS / 8.0f)
 #define TOF_MAX_INACTIVE_FRAMES 5U
+/* Sub-zone positions are in 1/TOF_SUBZONE of a zone */
+#define TOF_SUBZONE_SHIFT 8U
+#define TOF_SUBZONE (1 << TOF_SUBZONE_SHIFT)
+
+/* One bit per zone, see tof_mask.h */
+#define TOF_MASK_WORDS ((TOF_ZONES + 63U) / 64U)
+
+typedef struct {
+    uint64_t w[TOF_MASK_WORDS];
+} tof_mask_t;
+
+/* Labels stay bytes while every label number fits, see seg_label_components() */
+#if (TOF_ZONES + TOF_MAX_COMPONENTS) < 255U
+typedef uint8_t tof_label_t;
+#else
+typedef uint16_t tof_label_t;
+#endif
+
+/* First target of every zone of the stitched grid */
+typedef struct {
+    uint16_t distance_mm[TOF_ROWS][TOF_COLS];
+    uint8_t target_status[TOF_ROWS][TOF_COLS];
+#if TOF_QUALITY
+    uint8_t confidence[TOF_ROWS][TOF_COLS];
+    /* Ranging noise of this frame beyond the nominal, added to the foreground threshold */
+    uint16_t margin_mm[TOF_ROWS][TOF_COLS];
+#endif
+} tof_frame_t;
 
 typedef struct {
     int x1;
@@ -25,12 +85,19 @@ typedef struct {
 } tof_bounding_box_t;
 
 typedef struct {
-    uint8_t label;
-    uint8_t size;
+    tof_label_t label;
+    uint16_t size;
     tof_bounding_box_t box;
     uint16_t min_distance_mm;
     uint16_t max_distance_mm;
     uint16_t second_max_distance_mm;
+#if TOF_QUALITY
+    uint8_t confidence; /* mean over the zones */
+#endif
+    /* Depth-weighted centroid in 1/TOF_SUBZONE zone, set by depth_profile_generate() */
+    int centroid_row;
+    int centroid_col;
+    tof_mask_t mask;
 } tof_component_t;
 
 typedef struct {
@@ -39,6 +106,14 @@ typedef struct {
     int current_col;
     int previous_row;
     int previous_col;
+    /* Filtered centroid and its velocity per frame, in 1/TOF_SUBZONE zone; current_row/col round it */
+    int position_row;
+    int position_col;
+    int velocity_row;
+    int velocity_col;
+    /* Head depth and size of the last component matched, for the assignment cost */
+    uint16_t depth_mm;
+    uint16_t size;
     uint8_t inactive_frames;
     uint8_t duration_frames;
     bool active;
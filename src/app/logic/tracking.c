@@ -1,11 +1,37 @@
 #include "tracking.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #define TRACK_STABLE_MIN_DURATION_FRAMES 4U
 #define TRACK_COUNT_IN_DURATION_FRAMES 8U
 #define TRACK_MAX_PEOPLE_COUNT 2U
 
+/*
+ * alpha-beta gains in 1/TRACK_GAIN_ONE: the position moves TRACK_ALPHA of
+ * the way from the prediction to the measured centroid, the velocity takes
+ * TRACK_BETA of that residual. A track that misses a frame coasts on its
+ * velocity, capped at TRACK_MAX_VELOCITY sub-zones per frame.
+ */
+#define TRACK_GAIN_ONE 256
+#define TRACK_ALPHA 160
+#define TRACK_BETA 48
+#define TRACK_MAX_VELOCITY (2 * TOF_SUBZONE)
+
+/*
+ * Optimal assignment cost of a component to a track: 64 per zone^2 of
+ * distance to where the track is expected, 1 per 10 mm of head depth difference and up to 64 for
+ * the size difference, relative to the larger of the two. Pairs further
+ * apart than TOF_MATCH_DISTANCE_THRESHOLD cost TRACK_COST_GATED, more than
+ * any assignment of allowed pairs, so the solver matches as many allowed
+ * pairs as it can before it looks at their cost.
+ */
+#define TRACK_COST_POSITION 64
+#define TRACK_COST_DEPTH_MM 10
+#define TRACK_COST_SIZE 64
+#define TRACK_COST_GATED 0x1000000
+#define TRACK_ASSIGN_MAX ((TOF_MAX_COMPONENTS > TOF_MAX_TRACKS) ? TOF_MAX_COMPONENTS : TOF_MAX_TRACKS)
+
 typedef struct
 {
     int comp_idx;
@@ -13,26 +39,89 @@ typedef struct
     uint32_t distance_sq;
 } track_match_pair_t;
 
-static tof_track_t s_tracks[TOF_MAX_TRACKS];
-static uint8_t s_track_count = 0U;
-static uint8_t s_next_id = 1U;
+/* In 1/TOF_SUBZONE^2 zone^2, like track_component_distance_sq() */
 static const uint32_t s_match_distance_threshold_sq =
-    (uint32_t)(TOF_MATCH_DISTANCE_THRESHOLD * TOF_MATCH_DISTANCE_THRESHOLD);
+    (uint32_t)(TOF_MATCH_DISTANCE_THRESHOLD * TOF_MATCH_DISTANCE_THRESHOLD * (float)(TOF_SUBZONE * TOF_SUBZONE));
+
+void track_reset(track_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+    state->next_id = 1U;
+    state->matcher = TOF_OPTIMAL_MATCHING ? TRACK_MATCHER_OPTIMAL : TRACK_MATCHER_GREEDY;
+    state->motion = TOF_TRACK_PREDICTION ? TRACK_MOTION_ALPHA_BETA : TRACK_MOTION_NONE;
+}
 
-void track_reset(void)
+const void *track_find_entry(const void *entries, uint8_t count, size_t entry_size, int id)
 {
-    memset(s_tracks, 0, sizeof(s_tracks));
-    s_track_count = 0U;
-    s_next_id = 1U;
+    const uint8_t *entry = (const uint8_t *)entries;
+
+    for (uint8_t i = 0U; i < count; i++, entry += entry_size)
+    {
+        if (*(const int *)entry == id)
+        {
+            return entry;
+        }
+    }
+    return NULL;
 }
 
-static uint32_t track_component_distance_sq(const tof_component_t *comp, const tof_track_t *track)
+void track_carry_entry(void *entry, const void *entries, uint8_t count, size_t entry_size, int id)
 {
-    int comp_center_row = (comp->box.y1 + comp->box.y2) / 2;
-    int comp_center_col = (comp->box.x1 + comp->box.x2) / 2;
-    int row_diff = comp_center_row - track->current_row;
-    int col_diff = comp_center_col - track->current_col;
+    const void *known = track_find_entry(entries, count, entry_size, id);
 
+    if (known != NULL)
+    {
+        memcpy(entry, known, entry_size);
+    }
+    else
+    {
+        memset(entry, 0, entry_size);
+        *(int *)entry = id;
+    }
+}
+
+/* Where the component is, in 1/TOF_SUBZONE zone */
+static void track_measure(const track_state_t *state, const tof_component_t *comp, int *row, int *col)
+{
+    if (state->motion == TRACK_MOTION_ALPHA_BETA)
+    {
+        *row = comp->centroid_row;
+        *col = comp->centroid_col;
+        return;
+    }
+    *row = ((comp->box.y1 + comp->box.y2) / 2) * TOF_SUBZONE;
+    *col = ((comp->box.x1 + comp->box.x2) / 2) * TOF_SUBZONE;
+}
+
+/* Nearest zone of a sub-zone position, kept on the grid */
+static int track_zone(int position, int zones)
+{
+    int zone = (position > 0) ? ((position + (TOF_SUBZONE / 2)) / TOF_SUBZONE) : 0;
+
+    return (zone < zones) ? zone : (zones - 1);
+}
+
+static int track_clamp_velocity(int velocity)
+{
+    if (velocity > TRACK_MAX_VELOCITY)
+    {
+        return TRACK_MAX_VELOCITY;
+    }
+    return (velocity < -TRACK_MAX_VELOCITY) ? -TRACK_MAX_VELOCITY : velocity;
+}
+
+/* Squared distance from the component to where the track is expected this frame */
+static uint32_t track_component_distance_sq(const track_state_t *state, const tof_component_t *comp,
+                                            const tof_track_t *track)
+{
+    int comp_row;
+    int comp_col;
+    int row_diff;
+    int col_diff;
+
+    track_measure(state, comp, &comp_row, &comp_col);
+    row_diff = comp_row - (track->position_row + track->velocity_row);
+    col_diff = comp_col - (track->position_col + track->velocity_col);
     return (uint32_t)((row_diff * row_diff) + (col_diff * col_diff));
 }
 
@@ -52,66 +141,161 @@ static void track_sort_pairs(track_match_pair_t *pairs, int pair_count)
     }
 }
 
-static void track_collect_people_info(tof_people_data_t *people, tof_person_info_t *person_info,
-                                      uint8_t *person_info_count)
+static int32_t track_assign_cost(const track_state_t *state, const tof_component_t *comp, const tof_track_t *track)
 {
-    uint8_t stable_count = 0U;
-    uint8_t info_count = 0U;
+    uint32_t distance_sq = track_component_distance_sq(state, comp, track);
+    int32_t depth_diff = abs((int32_t)comp->min_distance_mm - (int32_t)track->depth_mm);
+    int32_t size_diff = abs((int32_t)comp->size - (int32_t)track->size);
+    int32_t size_max = (comp->size > track->size) ? (int32_t)comp->size : (int32_t)track->size;
+
+    if (distance_sq > s_match_distance_threshold_sq)
+    {
+        return TRACK_COST_GATED;
+    }
+    return (int32_t)(distance_sq / ((TOF_SUBZONE * TOF_SUBZONE) / TRACK_COST_POSITION)) +
+           (depth_diff / TRACK_COST_DEPTH_MM) +
+           ((size_max > 0) ? ((size_diff * TRACK_COST_SIZE) / size_max) : 0);
+}
+
+/*
+ * Least-cost assignment of the n rows of a square cost matrix to its
+ * columns, Kuhn-Munkres with row and column potentials in O(n^3). Row and
+ * column 0 of the potentials stand for "none"; col_row[j] receives the row
+ * given column j.
+ */
+static void track_assign_hungarian(const int32_t cost[TRACK_ASSIGN_MAX][TRACK_ASSIGN_MAX], uint8_t n,
+                                   uint8_t col_row[TRACK_ASSIGN_MAX])
+{
+    int32_t row_pot[TRACK_ASSIGN_MAX + 1U] = {0};
+    int32_t col_pot[TRACK_ASSIGN_MAX + 1U] = {0};
+    uint8_t match[TRACK_ASSIGN_MAX + 1U] = {0};
+    uint8_t way[TRACK_ASSIGN_MAX + 1U] = {0};
 
-    for (uint8_t i = 0U; i < s_track_count; i++)
+    for (uint8_t row = 1U; row <= n; row++)
     {
-        if (s_tracks[i].duration_frames > TRACK_STABLE_MIN_DURATION_FRAMES)
+        int32_t min_slack[TRACK_ASSIGN_MAX + 1U];
+        bool used[TRACK_ASSIGN_MAX + 1U] = {false};
+        uint8_t col0 = 0U;
+
+        match[0] = row;
+        for (uint8_t col = 0U; col <= n; col++)
         {
-            person_info[info_count].id = s_tracks[i].id;
-            person_info[info_count].x = s_tracks[i].current_col;
-            person_info[info_count].y = s_tracks[i].current_row;
-            person_info[info_count].duration_frames = s_tracks[i].duration_frames;
-            info_count++;
-            stable_count++;
-            if (info_count >= TOF_MAX_TRACKS)
+            min_slack[col] = INT32_MAX;
+        }
+
+        /* Grow an alternating tree from the new row until it reaches a free column */
+        do
+        {
+            uint8_t row0 = match[col0];
+            uint8_t col1 = 0U;
+            int32_t delta = INT32_MAX;
+
+            used[col0] = true;
+            for (uint8_t col = 1U; col <= n; col++)
             {
-                break;
+                int32_t slack;
+
+                if (used[col])
+                {
+                    continue;
+                }
+                slack = cost[row0 - 1U][col - 1U] - row_pot[row0] - col_pot[col];
+                if (slack < min_slack[col])
+                {
+                    min_slack[col] = slack;
+                    way[col] = col0;
+                }
+                if (min_slack[col] < delta)
+                {
+                    delta = min_slack[col];
+                    col1 = col;
+                }
             }
-        }
+            for (uint8_t col = 0U; col <= n; col++)
+            {
+                if (used[col])
+                {
+                    row_pot[match[col]] += delta;
+                    col_pot[col] -= delta;
+                }
+                else
+                {
+                    min_slack[col] -= delta;
+                }
+            }
+            col0 = col1;
+        } while (match[col0] != 0U);
+
+        /* Flip the augmenting path */
+        do
+        {
+            uint8_t col1 = way[col0];
+
+            match[col0] = match[col1];
+            col0 = col1;
+        } while (col0 != 0U);
     }
 
-    *person_info_count = info_count;
-    people->people_count = (stable_count > TRACK_MAX_PEOPLE_COUNT) ? TRACK_MAX_PEOPLE_COUNT : stable_count;
+    for (uint8_t col = 1U; col <= n; col++)
+    {
+        col_row[col - 1U] = (uint8_t)(match[col] - 1U);
+    }
 }
 
-void track_update(const tof_component_t *components, uint8_t component_count, tof_people_data_t *people,
-                  tof_person_info_t *person_info, uint8_t *person_info_count)
+static void track_apply_match(const track_state_t *state, tof_track_t *track, const tof_component_t *comp)
 {
-    track_match_pair_t pairs[TOF_MAX_COMPONENTS * TOF_MAX_TRACKS];
-    for (uint8_t i = 0U; i < s_track_count; i++)
+    int row;
+    int col;
+
+    track_measure(state, comp, &row, &col);
+    if (state->motion == TRACK_MOTION_ALPHA_BETA)
     {
-        if (!s_tracks[i].active)
-        {
-            continue;
-        }
-        s_tracks[i].inactive_frames++;
+        int predicted_row = track->position_row + track->velocity_row;
+        int predicted_col = track->position_col + track->velocity_col;
+        int residual_row = row - predicted_row;
+        int residual_col = col - predicted_col;
+
+        row = predicted_row + ((residual_row * TRACK_ALPHA) / TRACK_GAIN_ONE);
+        col = predicted_col + ((residual_col * TRACK_ALPHA) / TRACK_GAIN_ONE);
+        track->velocity_row = track_clamp_velocity(track->velocity_row + ((residual_row * TRACK_BETA) / TRACK_GAIN_ONE));
+        track->velocity_col = track_clamp_velocity(track->velocity_col + ((residual_col * TRACK_BETA) / TRACK_GAIN_ONE));
     }
 
+    track->position_row = row;
+    track->position_col = col;
+    track->previous_row = track->current_row;
+    track->previous_col = track->current_col;
+    track->current_row = track_zone(row, (int)TOF_ROWS);
+    track->current_col = track_zone(col, (int)TOF_COLS);
+    track->depth_mm = comp->min_distance_mm;
+    track->size = comp->size;
+    track->inactive_frames = 0U;
+    track->duration_frames++;
+}
+
+static void track_match_greedy(track_state_t *state, const tof_component_t *components, uint8_t component_count,
+                               bool comp_matched[TOF_MAX_COMPONENTS])
+{
+    track_match_pair_t pairs[TOF_MAX_COMPONENTS * TOF_MAX_TRACKS];
+    bool track_matched[TOF_MAX_TRACKS] = {false};
     int pair_count = 0;
+
     for (uint8_t c = 0U; c < component_count; c++)
     {
-        for (uint8_t t = 0U; t < s_track_count; t++)
+        for (uint8_t t = 0U; t < state->track_count; t++)
         {
-            if (!s_tracks[t].active)
+            if (!state->tracks[t].active)
             {
                 continue;
             }
             pairs[pair_count].comp_idx = c;
             pairs[pair_count].track_idx = t;
-            pairs[pair_count].distance_sq = track_component_distance_sq(&components[c], &s_tracks[t]);
+            pairs[pair_count].distance_sq = track_component_distance_sq(state, &components[c], &state->tracks[t]);
             pair_count++;
         }
     }
     track_sort_pairs(pairs, pair_count);
 
-    bool comp_matched[TOF_MAX_COMPONENTS] = {false};
-    bool track_matched[TOF_MAX_TRACKS] = {false};
-
     for (int i = 0; i < pair_count; i++)
     {
         int c = pairs[i].comp_idx;
@@ -128,68 +312,185 @@ void track_update(const tof_component_t *components, uint8_t component_count, to
 
         comp_matched[c] = true;
         track_matched[t] = true;
-        s_tracks[t].previous_row = s_tracks[t].current_row;
-        s_tracks[t].previous_col = s_tracks[t].current_col;
-        s_tracks[t].current_row = (components[c].box.y1 + components[c].box.y2) / 2;
-        s_tracks[t].current_col = (components[c].box.x1 + components[c].box.x2) / 2;
-        s_tracks[t].inactive_frames = 0U;
-        s_tracks[t].duration_frames++;
+        track_apply_match(state, &state->tracks[t], &components[c]);
+    }
+}
+
+/* Components are the rows and active tracks the columns, padded square with zero-cost dummies */
+static void track_match_optimal(track_state_t *state, const tof_component_t *components, uint8_t component_count,
+                                bool comp_matched[TOF_MAX_COMPONENTS])
+{
+    int32_t cost[TRACK_ASSIGN_MAX][TRACK_ASSIGN_MAX];
+    uint8_t track_idx[TOF_MAX_TRACKS];
+    uint8_t col_row[TRACK_ASSIGN_MAX];
+    uint8_t track_count = 0U;
+    uint8_t n;
+
+    for (uint8_t t = 0U; t < state->track_count; t++)
+    {
+        if (state->tracks[t].active)
+        {
+            track_idx[track_count++] = t;
+        }
+    }
+    if ((component_count == 0U) || (track_count == 0U))
+    {
+        return;
+    }
+
+    n = (component_count > track_count) ? component_count : track_count;
+    for (uint8_t c = 0U; c < n; c++)
+    {
+        for (uint8_t t = 0U; t < n; t++)
+        {
+            cost[c][t] = ((c < component_count) && (t < track_count))
+                             ? track_assign_cost(state, &components[c], &state->tracks[track_idx[t]])
+                             : 0;
+        }
+    }
+    track_assign_hungarian(cost, n, col_row);
+
+    for (uint8_t t = 0U; t < track_count; t++)
+    {
+        uint8_t c = col_row[t];
+
+        if ((c >= component_count) || (cost[c][t] >= TRACK_COST_GATED))
+        {
+            continue;
+        }
+        comp_matched[c] = true;
+        track_apply_match(state, &state->tracks[track_idx[t]], &components[c]);
+    }
+}
+
+static void track_collect_people_info(const track_state_t *state, tof_people_data_t *people,
+                                      tof_person_info_t *person_info, uint8_t *person_info_count)
+{
+    uint8_t stable_count = 0U;
+    uint8_t info_count = 0U;
+
+    for (uint8_t i = 0U; i < state->track_count; i++)
+    {
+        if (state->tracks[i].duration_frames > TRACK_STABLE_MIN_DURATION_FRAMES)
+        {
+            person_info[info_count].id = state->tracks[i].id;
+            person_info[info_count].x = state->tracks[i].current_col;
+            person_info[info_count].y = state->tracks[i].current_row;
+            person_info[info_count].duration_frames = state->tracks[i].duration_frames;
+            info_count++;
+            stable_count++;
+            if (info_count >= TOF_MAX_TRACKS)
+            {
+                break;
+            }
+        }
+    }
+
+    *person_info_count = info_count;
+    people->people_count = (stable_count > TRACK_MAX_PEOPLE_COUNT) ? TRACK_MAX_PEOPLE_COUNT : stable_count;
+}
+
+void track_update(track_state_t *state, const tof_component_t *components, uint8_t component_count,
+                  tof_people_data_t *people, tof_person_info_t *person_info, uint8_t *person_info_count)
+{
+    bool comp_matched[TOF_MAX_COMPONENTS] = {false};
+
+    for (uint8_t i = 0U; i < state->track_count; i++)
+    {
+        if (!state->tracks[i].active)
+        {
+            continue;
+        }
+        state->tracks[i].inactive_frames++;
+    }
+
+    if (state->matcher == TRACK_MATCHER_OPTIMAL)
+    {
+        track_match_optimal(state, components, component_count, comp_matched);
+    }
+    else
+    {
+        track_match_greedy(state, components, component_count, comp_matched);
+    }
+
+    /* Tracks missing this frame coast on to where they are expected */
+    for (uint8_t t = 0U; t < state->track_count; t++)
+    {
+        tof_track_t *track = &state->tracks[t];
+
+        if (track->active && (track->inactive_frames > 0U))
+        {
+            track->position_row += track->velocity_row;
+            track->position_col += track->velocity_col;
+            track->current_row = track_zone(track->position_row, (int)TOF_ROWS);
+            track->current_col = track_zone(track->position_col, (int)TOF_COLS);
+        }
     }
 
     for (uint8_t c = 0U; c < component_count; c++)
     {
-        if (comp_matched[c] || (s_track_count >= TOF_MAX_TRACKS))
+        int row;
+        int col;
+
+        if (comp_matched[c] || (state->track_count >= TOF_MAX_TRACKS))
         {
             continue;
         }
 
-        s_tracks[s_track_count].id = s_next_id++;
-        s_tracks[s_track_count].current_row = (components[c].box.y1 + components[c].box.y2) / 2;
-        s_tracks[s_track_count].current_col = (components[c].box.x1 + components[c].box.x2) / 2;
-        s_tracks[s_track_count].previous_row = s_tracks[s_track_count].current_row;
-        s_tracks[s_track_count].previous_col = s_tracks[s_track_count].current_col;
-        s_tracks[s_track_count].active = true;
-        s_tracks[s_track_count].inactive_frames = 0U;
-        s_tracks[s_track_count].duration_frames = 1U;
-        s_tracks[s_track_count].counted_in = false;
-        s_tracks[s_track_count].counted_out = false;
-        s_track_count++;
+        track_measure(state, &components[c], &row, &col);
+        state->tracks[state->track_count].id = state->next_id++;
+        state->tracks[state->track_count].position_row = row;
+        state->tracks[state->track_count].position_col = col;
+        state->tracks[state->track_count].velocity_row = 0;
+        state->tracks[state->track_count].velocity_col = 0;
+        state->tracks[state->track_count].current_row = track_zone(row, (int)TOF_ROWS);
+        state->tracks[state->track_count].current_col = track_zone(col, (int)TOF_COLS);
+        state->tracks[state->track_count].previous_row = state->tracks[state->track_count].current_row;
+        state->tracks[state->track_count].previous_col = state->tracks[state->track_count].current_col;
+        state->tracks[state->track_count].depth_mm = components[c].min_distance_mm;
+        state->tracks[state->track_count].size = components[c].size;
+        state->tracks[state->track_count].active = true;
+        state->tracks[state->track_count].inactive_frames = 0U;
+        state->tracks[state->track_count].duration_frames = 1U;
+        state->tracks[state->track_count].counted_in = false;
+        state->tracks[state->track_count].counted_out = false;
+        state->track_count++;
     }
 
     uint8_t active_count = 0U;
-    for (uint8_t t = 0U; t < s_track_count; t++)
+    for (uint8_t t = 0U; t < state->track_count; t++)
     {
-        if (!s_tracks[t].active)
+        if (!state->tracks[t].active)
         {
             continue;
         }
 
-        if (s_tracks[t].inactive_frames > TOF_MAX_INACTIVE_FRAMES)
+        if (state->tracks[t].inactive_frames > TOF_MAX_INACTIVE_FRAMES)
         {
-            s_tracks[t].active = false;
-            s_tracks[t].duration_frames = 1U;
-            if (s_tracks[t].counted_in)
+            state->tracks[t].active = false;
+            state->tracks[t].duration_frames = 1U;
+            if (state->tracks[t].counted_in)
             {
                 people->people_out++;
             }
-            s_tracks[t].counted_in = false;
-            s_tracks[t].counted_out = false;
+            state->tracks[t].counted_in = false;
+            state->tracks[t].counted_out = false;
             continue;
         }
 
-        if (!s_tracks[t].counted_in && (s_tracks[t].duration_frames > TRACK_COUNT_IN_DURATION_FRAMES))
+        if (!state->tracks[t].counted_in && (state->tracks[t].duration_frames > TRACK_COUNT_IN_DURATION_FRAMES))
         {
             people->people_in++;
-            s_tracks[t].counted_in = true;
+            state->tracks[t].counted_in = true;
         }
 
         if (t != active_count)
         {
-            s_tracks[active_count] = s_tracks[t];
+            state->tracks[active_count] = state->tracks[t];
         }
         active_count++;
     }
-    s_track_count = active_count;
+    state->track_count = active_count;
 
-    track_collect_people_info(people, person_info, person_info_count);
+    track_collect_people_info(state, people, person_info, person_info_count);
 }
@@ -1,12 +1,58 @@
 #ifndef TRACKING_H
 #define TRACKING_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "tof_types.h"
 
-void track_reset(void);
-void track_update(const tof_component_t *components,
+/* 1: track_reset() selects TRACK_MOTION_ALPHA_BETA */
+#ifndef TOF_TRACK_PREDICTION
+#define TOF_TRACK_PREDICTION 0
+#endif
+
+/* 1: track_reset() selects TRACK_MATCHER_OPTIMAL; by default only for the static motion model, where it wins */
+#ifndef TOF_OPTIMAL_MATCHING
+#define TOF_OPTIMAL_MATCHING (!TOF_TRACK_PREDICTION)
+#endif
+
+typedef enum {
+    TRACK_MATCHER_GREEDY = 0, /* closest pairs first, on the centre distance alone */
+    TRACK_MATCHER_OPTIMAL,    /* least total cost over centre distance, head depth and size */
+} track_matcher_t;
+
+typedef enum {
+    TRACK_MOTION_NONE = 0,   /* a track sits on the bounding box centre of its last component */
+    TRACK_MOTION_ALPHA_BETA, /* filtered depth-weighted centroid and velocity, matched where it is predicted */
+} track_motion_t;
+
+typedef struct {
+    tof_track_t tracks[TOF_MAX_TRACKS];
+    uint8_t track_count;
+    uint8_t next_id;
+    track_matcher_t matcher;
+    track_motion_t motion;
+} track_state_t;
+
+/*
+ * track_update() moves tracks around its table, so a module that keeps state per track keys it by the track id,
+ * in entries whose first member is that int id. A track is located only in a frame it was matched in: while it
+ * coasts it is merely where it is expected, and nothing should be counted from its position.
+ */
+static inline bool track_is_located(const tof_track_t *track)
+{
+    return track->active && (track->inactive_frames == 0U);
+}
+
+/* The entry of id among count entries of entry_size bytes, or NULL */
+const void *track_find_entry(const void *entries, uint8_t count, size_t entry_size, int id);
+/* Fills entry with the one of id among count entries, or zeroes it and gives it that id if there is none */
+void track_carry_entry(void *entry, const void *entries, uint8_t count, size_t entry_size, int id);
+
+void track_reset(track_state_t *state);
+void track_update(track_state_t *state,
+                  const tof_component_t *components,
                   uint8_t component_count,
                   tof_people_data_t *people,
                   tof_person_info_t *person_info,
@@ -0,0 +1,330 @@
+#include "trajectory.h"
+
+#include <string.h>
+
+#define TRAJECTORY_STEP (TOF_SUBZONE / TRAJECTORY_SCALE)
+
+static int16_t trajectory_quantize(int position)
+{
+    return (int16_t)((position >= 0) ? ((position + (TRAJECTORY_STEP / 2)) / TRAJECTORY_STEP)
+                                     : -((-position + (TRAJECTORY_STEP / 2)) / TRAJECTORY_STEP));
+}
+
+static uint8_t trajectory_index(uint8_t index, int offset)
+{
+    return (uint8_t)(((int)index + (int)TOF_TRAJECTORY_LENGTH + offset) % (int)TOF_TRAJECTORY_LENGTH);
+}
+
+static void trajectory_drop(trajectory_pool_t *pool, uint8_t samples)
+{
+    uint32_t dropped = (uint32_t)pool->dropped + samples;
+
+    pool->dropped = (uint16_t)((dropped > UINT16_MAX) ? UINT16_MAX : dropped);
+}
+
+/* A full ring overwrites the oldest entry; the oldest sample goes with its last one */
+static void trajectory_put_entry(trajectory_t *history, int8_t d_row, int8_t d_col, uint8_t d_frame)
+{
+    history->head = trajectory_index(history->head, 1);
+    if (history->entries < TOF_TRAJECTORY_LENGTH)
+    {
+        history->entries++;
+    }
+    else if (history->steps[history->head].d_frame != 0U)
+    {
+        history->count--;
+    }
+    history->steps[history->head].d_row = d_row;
+    history->steps[history->head].d_col = d_col;
+    history->steps[history->head].d_frame = d_frame;
+}
+
+static void trajectory_push(trajectory_pool_t *pool, trajectory_t *history, int position_row, int position_col)
+{
+    int16_t row = trajectory_quantize(position_row);
+    int16_t col = trajectory_quantize(position_col);
+    int d_row = row - history->row;
+    int d_col = col - history->col;
+
+    if (history->count == 0U)
+    {
+        /* The first sample's step is never read, its d_frame only tells it from high bytes */
+        history->head = (uint8_t)(TOF_TRAJECTORY_LENGTH - 1U);
+        history->entries = 0U;
+        trajectory_put_entry(history, 0, 0, 1U);
+    }
+    else if ((d_row < INT8_MIN) || (d_row > INT8_MAX) || (d_col < INT8_MIN) || (d_col > INT8_MAX))
+    {
+        trajectory_put_entry(history, (int8_t)(uint8_t)((uint16_t)d_row >> 8), (int8_t)(uint8_t)((uint16_t)d_col >> 8),
+                             0U);
+        trajectory_put_entry(history, (int8_t)(uint8_t)d_row, (int8_t)(uint8_t)d_col,
+                             (uint8_t)(pool->frame - history->frame));
+    }
+    else
+    {
+        trajectory_put_entry(history, (int8_t)d_row, (int8_t)d_col, (uint8_t)(pool->frame - history->frame));
+    }
+    history->frame = pool->frame;
+    history->row = row;
+    history->col = col;
+    history->count++;
+    history->pending++;
+    if (history->pending > history->count)
+    {
+        trajectory_drop(pool, (uint8_t)(history->pending - history->count));
+        history->pending = history->count;
+    }
+}
+
+/* The step of the sample whose last entry is at index; returns the last entry of the sample before it */
+static uint8_t trajectory_step_back(const trajectory_t *history, uint8_t index, int *d_row, int *d_col, uint8_t *d_frame)
+{
+    const trajectory_step_t *step = &history->steps[index];
+    const trajectory_step_t *high = &history->steps[trajectory_index(index, -1)];
+
+    *d_row = step->d_row;
+    *d_col = step->d_col;
+    *d_frame = step->d_frame;
+    if (high->d_frame != 0U)
+    {
+        return trajectory_index(index, -1);
+    }
+    *d_row = (int16_t)(((uint16_t)(uint8_t)high->d_row << 8) | (uint8_t)step->d_row);
+    *d_col = (int16_t)(((uint16_t)(uint8_t)high->d_col << 8) | (uint8_t)step->d_col);
+    return trajectory_index(index, -2);
+}
+
+/* Walks back from the newest sample to the one back samples older; returns its last entry */
+static uint8_t trajectory_rewind(const trajectory_t *history, uint8_t back, uint32_t *frame, int *row, int *col)
+{
+    uint8_t index = history->head;
+
+    *frame = history->frame;
+    *row = history->row;
+    *col = history->col;
+    for (uint8_t i = 0U; i < back; i++)
+    {
+        int d_row;
+        int d_col;
+        uint8_t d_frame;
+
+        index = trajectory_step_back(history, index, &d_row, &d_col, &d_frame);
+        *frame -= d_frame;
+        *row -= d_row;
+        *col -= d_col;
+    }
+    return index;
+}
+
+static void trajectory_put_u16_be(uint8_t *data, uint16_t value)
+{
+    data[0] = (uint8_t)((value >> 8) & 0xFFU);
+    data[1] = (uint8_t)(value & 0xFFU);
+}
+
+/* The oldest pending samples, up to a long step or as many as fit room */
+static uint16_t trajectory_write_record(trajectory_t *history, uint16_t room, uint8_t *data)
+{
+    uint16_t idx = TRAJECTORY_RECORD_HEADER_SIZE;
+    uint8_t sample_count = 1U;
+    uint32_t frame;
+    int row;
+    int col;
+    uint8_t index = trajectory_rewind(history, (uint8_t)(history->pending - 1U), &frame, &row, &col);
+
+    data[0] = (uint8_t)history->id;
+    trajectory_put_u16_be(&data[2], (uint16_t)frame);
+    trajectory_put_u16_be(&data[4], (uint16_t)row);
+    trajectory_put_u16_be(&data[6], (uint16_t)col);
+    history->pending--;
+    while ((history->pending > 0U) && ((idx + TRAJECTORY_SAMPLE_SIZE) <= room))
+    {
+        const trajectory_step_t *step = &history->steps[trajectory_index(index, 1)];
+
+        if (step->d_frame == 0U)
+        {
+            break;
+        }
+        data[idx++] = (uint8_t)step->d_row;
+        data[idx++] = (uint8_t)step->d_col;
+        data[idx++] = step->d_frame;
+        index = trajectory_index(index, 1);
+        history->pending--;
+        sample_count++;
+    }
+    data[1] = sample_count;
+    return idx;
+}
+
+/* Nothing left to export first, then the dropped track seen longest ago */
+static trajectory_t *trajectory_claim(trajectory_pool_t *pool)
+{
+    trajectory_t *oldest = NULL;
+
+    for (uint8_t h = 0U; h < TOF_MAX_TRACKS; h++)
+    {
+        trajectory_t *history = &pool->histories[h];
+
+        if (history->live)
+        {
+            continue;
+        }
+        if (history->pending == 0U)
+        {
+            return history;
+        }
+        if ((oldest == NULL) || ((int32_t)(history->frame - oldest->frame) < 0))
+        {
+            oldest = history;
+        }
+    }
+    return oldest;
+}
+
+void trajectory_init(trajectory_pool_t *pool)
+{
+    memset(pool, 0, sizeof(*pool));
+}
+
+void trajectory_update(trajectory_pool_t *pool, const track_state_t *tracks)
+{
+    bool was_live[TOF_MAX_TRACKS];
+    bool known[TOF_MAX_TRACKS] = {false};
+
+    pool->frame++;
+    for (uint8_t h = 0U; h < TOF_MAX_TRACKS; h++)
+    {
+        was_live[h] = pool->histories[h].live;
+        pool->histories[h].live = false;
+    }
+
+    /* Tracks that carry on keep their history before new ones claim any */
+    for (uint8_t t = 0U; t < tracks->track_count; t++)
+    {
+        for (uint8_t h = 0U; tracks->tracks[t].active && (h < TOF_MAX_TRACKS); h++)
+        {
+            if (was_live[h] && (pool->histories[h].id == tracks->tracks[t].id))
+            {
+                pool->histories[h].live = true;
+                known[t] = true;
+                break;
+            }
+        }
+    }
+
+    for (uint8_t t = 0U; t < tracks->track_count; t++)
+    {
+        const tof_track_t *track = &tracks->tracks[t];
+        trajectory_t *history = NULL;
+
+        if (!track->active)
+        {
+            continue;
+        }
+        for (uint8_t h = 0U; known[t] && (h < TOF_MAX_TRACKS); h++)
+        {
+            if (pool->histories[h].live && (pool->histories[h].id == track->id))
+            {
+                history = &pool->histories[h];
+            }
+        }
+        if (history == NULL)
+        {
+            history = trajectory_claim(pool);
+            if (history == NULL)
+            {
+                continue;
+            }
+            trajectory_drop(pool, history->pending);
+            memset(history, 0, sizeof(*history));
+            history->id = track->id;
+            history->live = true;
+        }
+        if (track_is_located(track))
+        {
+            trajectory_push(pool, history, track->position_row, track->position_col);
+        }
+    }
+}
+
+uint8_t trajectory_get(const trajectory_pool_t *pool, int id, uint8_t count, trajectory_point_t *points)
+{
+    const trajectory_t *history = NULL;
+    uint8_t index;
+    uint32_t frame;
+    int row;
+    int col;
+
+    /* A live track before a dropped one that had the same id */
+    for (uint8_t h = 0U; h < TOF_MAX_TRACKS; h++)
+    {
+        const trajectory_t *candidate = &pool->histories[h];
+
+        if ((candidate->count > 0U) && (candidate->id == id) && ((history == NULL) || candidate->live))
+        {
+            history = candidate;
+        }
+    }
+    if ((history == NULL) || (points == NULL))
+    {
+        return 0U;
+    }
+
+    count = (count < history->count) ? count : history->count;
+    index = history->head;
+    frame = history->frame;
+    row = history->row;
+    col = history->col;
+    for (uint8_t i = count; i > 0U; i--)
+    {
+        int d_row;
+        int d_col;
+        uint8_t d_frame;
+
+        points[i - 1U].frame = frame;
+        points[i - 1U].row = row * TRAJECTORY_STEP;
+        points[i - 1U].col = col * TRAJECTORY_STEP;
+        if (i > 1U)
+        {
+            index = trajectory_step_back(history, index, &d_row, &d_col, &d_frame);
+            frame -= d_frame;
+            row -= d_row;
+            col -= d_col;
+        }
+    }
+    return count;
+}
+
+uint16_t trajectory_export(trajectory_pool_t *pool, uint8_t *buffer, uint16_t size)
+{
+    uint16_t used = 0U;
+
+    for (uint8_t n = 0U; n < TOF_MAX_TRACKS; n++)
+    {
+        uint8_t h = (uint8_t)((pool->export_next + n) % TOF_MAX_TRACKS);
+        trajectory_t *history = &pool->histories[h];
+
+        while (history->pending > 0U)
+        {
+            /* The rest waits for the next buffer, starting with this history */
+            if ((uint16_t)(size - used) < TRAJECTORY_RECORD_HEADER_SIZE)
+            {
+                pool->export_next = h;
+                return used;
+            }
+            used = (uint16_t)(used + trajectory_write_record(history, (uint16_t)(size - used), &buffer[used]));
+        }
+    }
+    return used;
+}
+
+uint16_t trajectory_pending(const trajectory_pool_t *pool)
+{
+    uint16_t pending = 0U;
+
+    for (uint8_t h = 0U; h < TOF_MAX_TRACKS; h++)
+    {
+        pending = (uint16_t)(pending + pool->histories[h].pending);
+    }
+    return pending;
+}
@@ -0,0 +1,95 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tof_types.h"
+#include "tracking.h"
+
+/*
+ * Recent path of every track. Each frame a track is matched in adds its
+ * filtered position, to 1/TRAJECTORY_SCALE zone, as a 3-byte step from the
+ * previous sample with the frames in between; a step too long for 8 bits
+ * takes a second entry for its high bytes. A history keeps as many samples
+ * as fit TOF_TRAJECTORY_LENGTH entries; the pool has one per track, and that
+ * of a dropped track stays readable until a new track needs it.
+ */
+#ifndef TOF_TRAJECTORY_LENGTH
+#define TOF_TRAJECTORY_LENGTH 32U
+#endif
+#if TOF_TRAJECTORY_LENGTH > 255U
+#error "a trajectory record keeps its sample count in a uint8_t"
+#endif
+#define TRAJECTORY_SCALE 16
+#if ((TOF_ROWS * TRAJECTORY_SCALE) > 16383U) || ((TOF_COLS * TRAJECTORY_SCALE) > 16383U)
+#error "a long trajectory step is an int16_t"
+#endif
+#if TOF_MAX_INACTIVE_FRAMES > 254U
+#error "the frames between two samples of a track are a uint8_t"
+#endif
+
+/*
+ * trajectory_export() record: track id u8 and sample count u8, then the
+ * first sample as frame u16 (low bits of the frame count), row and col i16,
+ * big-endian in 1/TRAJECTORY_SCALE zone, then each further sample as row and
+ * col steps i8 and the frames since the previous one u8. A step too long for
+ * i8 ends the record; the next one starts at that sample.
+ */
+#define TRAJECTORY_RECORD_HEADER_SIZE 8U
+#define TRAJECTORY_SAMPLE_SIZE 3U
+
+/* A sample decoded, position in 1/TOF_SUBZONE zone */
+typedef struct {
+    uint32_t frame;
+    int row;
+    int col;
+} trajectory_point_t;
+
+/* d_frame 0 marks the high bytes of the long step in the entry after it */
+typedef struct {
+    int8_t d_row;
+    int8_t d_col;
+    uint8_t d_frame;
+} trajectory_step_t;
+
+typedef struct {
+    int id;
+    /* The track was in the tracker's table at the last update */
+    bool live;
+    /* Newest sample, whose step ends at steps[head] */
+    uint32_t frame;
+    int16_t row;
+    int16_t col;
+    uint8_t head;
+    uint8_t entries;
+    uint8_t count;
+    /* Newest samples trajectory_export() has not written yet */
+    uint8_t pending;
+    /* Step of each sample from the one before; that of the oldest is stale */
+    trajectory_step_t steps[TOF_TRAJECTORY_LENGTH];
+} trajectory_t;
+
+typedef struct {
+    trajectory_t histories[TOF_MAX_TRACKS];
+    /* Updates since init, the frame stamp of the samples */
+    uint32_t frame;
+    /* History trajectory_export() starts from, the one it stopped at last */
+    uint8_t export_next;
+    /* Samples lost before they were exported, saturating */
+    uint16_t dropped;
+} trajectory_pool_t;
+
+/* Drops every history */
+void trajectory_init(trajectory_pool_t *pool);
+/* Records the tracks matched this frame, after track_update() */
+void trajectory_update(trajectory_pool_t *pool, const track_state_t *tracks);
+/* Copies up to count of the last samples of track id into points, oldest first; returns how many */
+uint8_t trajectory_get(const trajectory_pool_t *pool, int id, uint8_t count, trajectory_point_t *points);
+/* Writes the samples not exported yet as records into buffer, as many as fit size; returns the bytes written. The
+ * rest stay pending while their history holds them; older ones count as dropped. */
+uint16_t trajectory_export(trajectory_pool_t *pool, uint8_t *buffer, uint16_t size);
+/* Samples trajectory_export() has yet to write; exporting every few frames packs several in a record */
+uint16_t trajectory_pending(const trajectory_pool_t *pool);
+
+#endif
@@ -0,0 +1,113 @@
+#include "bsp_flash.h"
+
+#include <string.h>
+
+#include "main.h"
+
+#if BSP_FLASH_STORE_SIZE != FLASH_SECTOR_SIZE
+#error "the flash store is one erase sector"
+#endif
+
+#define BSP_FLASH_STORE_SECTOR (FLASH_SECTOR_NB - 1U)
+#define BSP_FLASH_STORE_ADDR (FLASH_BASE + FLASH_SIZE_DEFAULT - FLASH_SECTOR_SIZE)
+
+/* Set by bsp_flash_nmi() while bsp_flash_store_read() copies */
+static volatile bool s_store_ecc_error = false;
+
+static bool bsp_flash_in_store(uint32_t offset, uint32_t size)
+{
+    return (offset <= BSP_FLASH_STORE_SIZE) && (size <= (BSP_FLASH_STORE_SIZE - offset));
+}
+
+/* Programming and erasing change flash behind the instruction cache */
+static void bsp_flash_invalidate_cache(void)
+{
+#ifdef HAL_ICACHE_MODULE_ENABLED
+    (void)HAL_ICACHE_Invalidate();
+#endif
+}
+
+bool bsp_flash_store_read(uint32_t offset, void *data, uint32_t size)
+{
+    if ((data == NULL) || !bsp_flash_in_store(offset, size))
+    {
+        return false;
+    }
+
+    s_store_ecc_error = false;
+    memcpy(data, (const void *)(BSP_FLASH_STORE_ADDR + offset), size);
+    /* The NMI of a failing quad-word is taken before the copy goes on */
+    __DSB();
+    __ISB();
+    return !s_store_ecc_error;
+}
+
+bool bsp_flash_store_erase(void)
+{
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t sector_error = 0U;
+    HAL_StatusTypeDef status;
+
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Banks = FLASH_BANK_2;
+    erase.Sector = BSP_FLASH_STORE_SECTOR;
+    erase.NbSectors = 1U;
+
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return false;
+    }
+    status = HAL_FLASHEx_Erase(&erase, &sector_error);
+    (void)HAL_FLASH_Lock();
+    bsp_flash_invalidate_cache();
+    return status == HAL_OK;
+}
+
+bool bsp_flash_store_write(uint32_t offset, const void *data, uint32_t size)
+{
+    const uint8_t *bytes = data;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    if ((data == NULL) || ((offset % BSP_FLASH_WRITE_UNIT) != 0U) || !bsp_flash_in_store(offset, size))
+    {
+        return false;
+    }
+
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return false;
+    }
+    for (uint32_t done = 0U; (done < size) && (status == HAL_OK); done += BSP_FLASH_WRITE_UNIT)
+    {
+        /* HAL_FLASH_Program() reads the quad-word as four aligned words */
+        uint32_t quad[BSP_FLASH_WRITE_UNIT / sizeof(uint32_t)];
+        uint32_t chunk = ((size - done) < BSP_FLASH_WRITE_UNIT) ? (size - done) : BSP_FLASH_WRITE_UNIT;
+
+        memset(quad, 0xFF, sizeof(quad));
+        memcpy(quad, &bytes[done], chunk);
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, BSP_FLASH_STORE_ADDR + offset + done,
+                                   (uint32_t)(uintptr_t)quad);
+    }
+    (void)HAL_FLASH_Lock();
+    bsp_flash_invalidate_cache();
+    return status == HAL_OK;
+}
+
+bool bsp_flash_nmi(void)
+{
+    FLASH_EccInfoTypeDef ecc = {0};
+
+    if (!__HAL_FLASH_GET_FLAG(FLASH_FLAG_ECCD))
+    {
+        return false;
+    }
+    HAL_FLASHEx_GetEccInfo(&ecc);
+    if ((ecc.Area != FLASH_ECC_AREA_USER_BANK2) || (ecc.Address < BSP_FLASH_STORE_ADDR) ||
+        (ecc.Address >= (BSP_FLASH_STORE_ADDR + BSP_FLASH_STORE_SIZE)))
+    {
+        return false;
+    }
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ECCD);
+    s_store_ecc_error = true;
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef BSP_FLASH_H
+#define BSP_FLASH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * The last 8 KiB sector of bank 2 is kept out of the linker's FLASH region and
+ * holds data that has to survive a reset. Offsets are relative to the start of
+ * that sector. Writes land in whole BSP_FLASH_WRITE_UNIT blocks on erased
+ * flash (read back as 0xFF); a partial last block is padded with 0xFF.
+ */
+#define BSP_FLASH_STORE_SIZE 0x2000U
+#define BSP_FLASH_WRITE_UNIT 16U
+
+/* False as well when the range holds a quad-word whose ECC fails, as one torn by a reset while programmed or erased */
+bool bsp_flash_store_read(uint32_t offset, void *data, uint32_t size);
+bool bsp_flash_store_erase(void);
+bool bsp_flash_store_write(uint32_t offset, const void *data, uint32_t size);
+/* For NMI_Handler: clears an ECC double error in the store and returns true, false for any other NMI */
+bool bsp_flash_nmi(void);
+
+#endif
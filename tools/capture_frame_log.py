@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Capture CONN_TYPE_FRAME_LOG packets from the CDC port into a frame log file.
+
+The board must be switched to APP_MODE_DATA_RECORD (command 0xA3, value 0x01).
+The first packet after the switch carries the frame log header; every other
+packet carries one record which is appended unchanged.
+"""
+from __future__ import annotations
+
+import argparse
+import sys
+
+try:
+    import serial
+except ImportError:
+    sys.exit("pyserial not found. Install it (pip install pyserial).")
+
+
+CONN_TYPE_FRAME_LOG = 0xA7
+CONN_CMD_DATA_RECORD = 0xA3
+
+
+def build_command(cmd_type: int, value: int) -> bytes:
+    body = bytes([cmd_type, 1, value])
+    checksum = 0
+    for b in body:
+        checksum ^= b
+    return b"FUT0" + body + bytes([checksum]) + b"END0"
+
+
+def read_packets(port: serial.Serial):
+    buf = bytearray()
+    while True:
+        chunk = port.read(4096)
+        if not chunk:
+            continue
+        buf.extend(chunk)
+        while True:
+            start = buf.find(b"FUT0")
+            if start < 0:
+                del buf[:-3]
+                break
+            del buf[:start]
+            if len(buf) < 7:
+                break
+            if buf[4] != CONN_TYPE_FRAME_LOG:
+                # Regular packet: 8-bit length, skip it
+                total = buf[5] + 11
+                if len(buf) < total:
+                    break
+                del buf[:total]
+                continue
+            length = (buf[5] << 8) | buf[6]
+            total = 7 + length + 6
+            if len(buf) < total:
+                break
+            checksum = 0
+            for b in buf[4 : 7 + length]:
+                checksum ^= b
+            if checksum == buf[7 + length] and buf[8 + length : 12 + length] == b"END0":
+                yield bytes(buf[7 : 7 + length])
+            del buf[:total]
+
+
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("port", help="CDC serial port, e.g. /dev/ttyACM0")
+    parser.add_argument("output", help="Frame log file to write (.tofl)")
+    parser.add_argument("--frames", type=int, default=0, help="Stop after N records (0 = until Ctrl-C)")
+    return parser.parse_args()
+
+
+def main() -> int:
+    args = parse_args()
+    records = 0
+    with serial.Serial(args.port, timeout=0.1) as port, open(args.output, "wb") as out:
+        port.write(build_command(CONN_CMD_DATA_RECORD, 0x01))
+        header_seen = False
+        try:
+            for payload in read_packets(port):
+                if payload[:4] == b"TOFL":
+                    if not header_seen:
+                        out.write(payload)
+                        header_seen = True
+                    continue
+                if not header_seen:
+                    continue
+                out.write(payload)
+                records += 1
+                if args.frames and records >= args.frames:
+                    break
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.write(build_command(CONN_CMD_DATA_RECORD, 0x02))
+    print(f"{records} records written to {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())